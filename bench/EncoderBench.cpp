@@ -0,0 +1,252 @@
+// Micro-benchmarks for the Encoder hot paths: ffmpeg progress and log parsing, argument
+// planning and the progress signal path. Results are machine-readable with the
+// Qt Test loggers, e.g. `niseyuki-bench -o bench.xml,xml` or `-o bench.csv,csv`.
+
+#include "EncodeJob.h"
+#include "Encoder.h"
+#include "TimeUtils.h"
+
+#include <QByteArray>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QTest>
+
+Q_DECLARE_METATYPE(EncodeJob)
+
+namespace {
+// One -progress report as ffmpeg writes it every 500 ms.
+QByteArray progressBlock(qint64 outTimeMs, qint64 frame)
+{
+    return QStringLiteral("frame=%1\nfps=143.20\nstream_0_0_q=28.0\nbitrate=2215.4kbits/s\ntotal_size=%2\n"
+                          "out_time_us=%3\nout_time_ms=%3\nout_time=%4\ndup_frames=0\ndrop_frames=0\n"
+                          "speed=5.97x\nprogress=continue\n")
+        .arg(frame)
+        .arg(outTimeMs * 277)
+        .arg(outTimeMs * 1000)
+        .arg(formatTimecode(outTimeMs))
+        .toUtf8();
+}
+
+// A stream of reports 40 ms of media apart, as read from stdout.
+QByteArray progressStream(int reports)
+{
+    QByteArray stream;
+    for (int i = 0; i < reports; ++i) {
+        stream += progressBlock(i * 40, i);
+    }
+    return stream;
+}
+
+EncodeJob sampleJob()
+{
+    EncodeJob job;
+    job.id = 1;
+    job.videoPath = QStringLiteral("/media/anime/Series/Series - 01 [1080p].mkv");
+    job.subtitlePath = QStringLiteral("/media/anime/Series/Series - 01 [1080p].ass");
+    job.subtitleInfo.path = job.subtitlePath;
+    job.profile.editVideo().encoder = QStringLiteral("x264");
+    job.profile.editVideo().preset = QStringLiteral("slow");
+    job.profile.editVideo().qualityValue = 20.0;
+    job.profile.editVideo().resizeMode = QStringLiteral("720p");
+    job.profile.editAudio().codec = QStringLiteral("AAC");
+    job.globalOutputFolder = QStringLiteral("/media/out");
+    job.durationMs = 24 * 60 * 1000;
+    job.sourceHeight = 1080;
+    job.sourceFrameRate = 23.976;
+    return job;
+}
+} // namespace
+
+class EncoderBench : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void parseProgressLine_data();
+    void parseProgressLine();
+    void processOutput_data();
+    void processOutput();
+    void processLogLine_data();
+    void processLogLine();
+    void buildFfmpegArguments_data();
+    void buildFfmpegArguments();
+    void parseTimeToSeconds_data();
+    void parseTimeToSeconds();
+    void resolvedOutputPath_data();
+    void resolvedOutputPath();
+    void signalPath();
+
+private:
+    // Puts an encoder into the state it has while ffmpeg runs, without a process.
+    static void beginEncoding(Encoder &encoder, const EncodeJob &job)
+    {
+        encoder.m_currentJob = job;
+        encoder.m_state = Encoder::State::Encoding;
+        encoder.m_totalDurationMs = job.effectiveDurationMs();
+        encoder.m_eta.reset(encoder.m_totalDurationMs);
+        encoder.m_wallTimer.start();
+    }
+};
+
+void EncoderBench::parseProgressLine_data()
+{
+    QTest::addColumn<QByteArray>("line");
+    QTest::newRow("out_time_ms") << QByteArrayLiteral("out_time_ms=734160000");
+    QTest::newRow("out_time") << QByteArrayLiteral("out_time=00:12:14.160000");
+    QTest::newRow("fps") << QByteArrayLiteral("fps=143.20");
+    QTest::newRow("bitrate") << QByteArrayLiteral("bitrate=2215.4kbits/s");
+    QTest::newRow("speed") << QByteArrayLiteral("speed=5.97x");
+    QTest::newRow("progress") << QByteArrayLiteral("progress=continue");
+}
+
+void EncoderBench::parseProgressLine()
+{
+    QFETCH(QByteArray, line);
+    Encoder encoder;
+    beginEncoding(encoder, sampleJob());
+    QBENCHMARK {
+        encoder.parseProgressLine(line);
+    }
+}
+
+void EncoderBench::processOutput_data()
+{
+    QTest::addColumn<QByteArray>("chunk");
+    // Typical pipe reads: one report, a 4 KiB read, and a backlog after the GUI thread stalled.
+    QTest::newRow("1 report") << progressBlock(734160, 17602);
+    QTest::newRow("4 KiB") << progressStream(4096 / progressBlock(0, 0).size());
+    QTest::newRow("256 KiB") << progressStream(256 * 1024 / progressBlock(0, 0).size());
+}
+
+void EncoderBench::processOutput()
+{
+    QFETCH(QByteArray, chunk);
+    Encoder encoder;
+    beginEncoding(encoder, sampleJob());
+    QBENCHMARK {
+        encoder.processOutput(Encoder::Channel::Progress, chunk);
+    }
+}
+
+void EncoderBench::processLogLine_data()
+{
+    QTest::addColumn<QByteArray>("line");
+    // Lines as tagged by -loglevel level+...; info and below stay out of the UI.
+    QTest::newRow("info") << QByteArrayLiteral("[libx264 @ 0x55d0c8a3c2c0] [info] frame I:12 Avg QP:18.42 size: 93211");
+    QTest::newRow("warning") << QByteArrayLiteral("[matroska,webm @ 0x55d0c8a1f680] [warning] Could not find codec parameters");
+    QTest::newRow("untagged") << QByteArrayLiteral("Press [q] to stop, [?] for help");
+}
+
+void EncoderBench::processLogLine()
+{
+    QFETCH(QByteArray, line);
+    Encoder encoder;
+    QBENCHMARK {
+        encoder.processLogLine(line);
+    }
+}
+
+void EncoderBench::buildFfmpegArguments_data()
+{
+    QTest::addColumn<EncodeJob>("job");
+    QTest::addColumn<int>("pass");
+
+    const EncodeJob base = sampleJob();
+    QTest::newRow("x264 crf") << base << 0;
+
+    EncodeJob telegram = base;
+    telegram.telegramMode = true;
+    telegram.cutSettings.enabled = true;
+    telegram.cutSettings.startTime = QStringLiteral("00:01:30");
+    telegram.cutSettings.endTime = QStringLiteral("00:22:10");
+    QTest::newRow("telegram cut") << telegram << 0;
+
+    EncodeJob nvenc = base;
+    nvenc.profile.editVideo().encoder = QStringLiteral("nvenc");
+    nvenc.rateControl.maxrateKbps = 6000;
+    nvenc.rateControl.bufsizeKbps = 12000;
+    QTest::newRow("nvenc capped") << nvenc << 0;
+
+    EncodeJob twoPass = base;
+    twoPass.rateControl = {4000, 8000, 16000, true};
+    QTest::newRow("two-pass 1") << twoPass << 1;
+    QTest::newRow("two-pass 2") << twoPass << 2;
+}
+
+void EncoderBench::buildFfmpegArguments()
+{
+    QFETCH(EncodeJob, job);
+    QFETCH(int, pass);
+    Encoder encoder;
+    QStringList args;
+    QBENCHMARK {
+        args = encoder.buildFfmpegArguments(job, pass);
+    }
+    QVERIFY(!args.isEmpty());
+}
+
+void EncoderBench::parseTimeToSeconds_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::newRow("hh:mm:ss.micro") << QStringLiteral("00:12:14.160000");
+    QTest::newRow("mm:ss") << QStringLiteral("12:14");
+    QTest::newRow("seconds") << QStringLiteral("734.16");
+    QTest::newRow("invalid") << QStringLiteral("N/A");
+}
+
+void EncoderBench::parseTimeToSeconds()
+{
+    QFETCH(QString, text);
+    double seconds = 0.0;
+    QBENCHMARK {
+        ::parseTimeToSeconds(text, seconds);
+    }
+}
+
+void EncoderBench::resolvedOutputPath_data()
+{
+    QTest::addColumn<EncodeJob>("job");
+    EncodeJob explicitOutput = sampleJob();
+    explicitOutput.outputFile = QStringLiteral("/media/out/Series - 01.mkv");
+    QTest::newRow("output file") << explicitOutput;
+    QTest::newRow("output folder") << sampleJob();
+    EncodeJob besideSource = sampleJob();
+    besideSource.globalOutputFolder.clear();
+    QTest::newRow("beside source") << besideSource;
+}
+
+void EncoderBench::resolvedOutputPath()
+{
+    QFETCH(EncodeJob, job);
+    QString path;
+    QBENCHMARK {
+        path = job.resolvedOutputPath();
+    }
+    QVERIFY(!path.isEmpty());
+}
+
+void EncoderBench::signalPath()
+{
+    // End to end from pipe data to connected slots: ten minutes of media reported every 40 ms.
+    const QByteArray stream = progressStream(15000);
+    Encoder encoder;
+    qint64 deliveries = 0;
+    QString lastStatus;
+    connect(&encoder, &Encoder::progressChanged, this, [&deliveries](double) { ++deliveries; });
+    connect(&encoder, &Encoder::etaChanged, this, [&deliveries](qint64) { ++deliveries; });
+    connect(&encoder, &Encoder::statusTextChanged, this, [&deliveries, &lastStatus](const QString &text) {
+        lastStatus = text;
+        ++deliveries;
+    });
+    connect(&encoder, &Encoder::messageReceived, this, [&deliveries](const QString &) { ++deliveries; });
+    QBENCHMARK {
+        beginEncoding(encoder, sampleJob());
+        encoder.processOutput(Encoder::Channel::Progress, stream);
+    }
+    QVERIFY(deliveries > 0);
+    QVERIFY(!lastStatus.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(EncoderBench)
+#include "EncoderBench.moc"
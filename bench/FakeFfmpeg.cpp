@@ -0,0 +1,276 @@
+// Stand-in for ffmpeg and ffprobe in load tests. Point NISEYUKI_FFMPEG and
+// NISEYUKI_FFPROBE at this binary and it answers the probes Niseyuki runs and
+// plays back a -progress pipe:1 stream instead of encoding:
+//
+//   NISEYUKI_FAKE_DURATION_MS  media duration reported by ffprobe and encoded (default 60000)
+//   NISEYUKI_FAKE_SPEED        media time per wall time, e.g. 8 for 8x (default 8)
+//   NISEYUKI_FAKE_RATE_HZ      progress reports per wall second (default 2, ffmpeg's own rate)
+//   NISEYUKI_FAKE_SPLIT        write stdout in chunks of this many bytes, splitting lines (default off)
+//   NISEYUKI_FAKE_LOG_EVERY    write an encoder log line to stderr every N reports (default 20)
+//   NISEYUKI_FAKE_FAIL         comma-separated mode:percent, mode one of exit, crash, hang (e.g. "exit:5,hang:1")
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+#include <QRandomGenerator>
+#include <QString>
+#include <QStringList>
+#include <QThread>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+enum class Failure {
+    None,
+    Exit,
+    Crash,
+    Hang
+};
+
+qint64 envInteger(const char *name, qint64 fallback)
+{
+    bool ok = false;
+    const qint64 value = qEnvironmentVariable(name).toLongLong(&ok);
+    return ok && value > 0 ? value : fallback;
+}
+
+double envDouble(const char *name, double fallback)
+{
+    bool ok = false;
+    const double value = qEnvironmentVariable(name).toDouble(&ok);
+    return ok && value > 0.0 ? value : fallback;
+}
+
+Failure pickFailure()
+{
+    // Rolled once per run; the mode decides what happens at a random point of the encode.
+    const int roll = QRandomGenerator::global()->bounded(100);
+    int threshold = 0;
+    for (const QString &entry : qEnvironmentVariable("NISEYUKI_FAKE_FAIL").split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        const QString mode = entry.section(QLatin1Char(':'), 0, 0).trimmed();
+        threshold += entry.section(QLatin1Char(':'), 1, 1).toInt();
+        if (roll >= threshold) {
+            continue;
+        }
+        if (mode == QLatin1String("exit")) {
+            return Failure::Exit;
+        }
+        if (mode == QLatin1String("crash")) {
+            return Failure::Crash;
+        }
+        if (mode == QLatin1String("hang")) {
+            return Failure::Hang;
+        }
+    }
+    return Failure::None;
+}
+
+void writeOut(const QByteArray &data, int splitBytes)
+{
+    if (splitBytes <= 0) {
+        std::fwrite(data.constData(), 1, data.size(), stdout);
+        std::fflush(stdout);
+        return;
+    }
+    for (qsizetype offset = 0; offset < data.size(); offset += splitBytes) {
+        std::fwrite(data.constData() + offset, 1, std::min<qsizetype>(splitBytes, data.size() - offset), stdout);
+        std::fflush(stdout);
+        // Gives the reader a chance to see the fragment on its own.
+        QThread::usleep(200);
+    }
+}
+
+void writeErr(const QByteArray &line)
+{
+    std::fwrite(line.constData(), 1, line.size(), stderr);
+    std::fflush(stderr);
+}
+
+// Honours -loglevel like ffmpeg: lines above the level are dropped, and level+ tags the rest.
+class Logger
+{
+public:
+    explicit Logger(const QStringList &args)
+    {
+        const qsizetype option = args.indexOf(QStringLiteral("-loglevel"));
+        QString level = option < 0 ? QStringLiteral("info") : args.value(option + 1);
+        m_tagged = level.startsWith(QLatin1String("level+"));
+        level.remove(QStringLiteral("level+"));
+        m_rank = rank(level.toUtf8());
+    }
+
+    void log(const QByteArray &context, const QByteArray &level, const QByteArray &text) const
+    {
+        if (rank(level) > m_rank) {
+            return;
+        }
+        QByteArray line = context.isEmpty() ? QByteArray() : "[" + context + "] ";
+        if (m_tagged) {
+            line += "[" + level + "] ";
+        }
+        writeErr(line + text + "\n");
+    }
+
+private:
+    static int rank(const QByteArray &level)
+    {
+        static const QList<QByteArray> kLevels{"quiet", "panic", "fatal", "error", "warning", "info", "verbose", "debug", "trace"};
+        const qsizetype index = kLevels.indexOf(level);
+        return index < 0 ? 5 : static_cast<int>(index);
+    }
+
+    bool m_tagged = false;
+    int m_rank = 5;
+};
+
+QString timecode(qint64 ms)
+{
+    return QStringLiteral("%1:%2:%3.%4")
+        .arg(ms / 3600000, 2, 10, QLatin1Char('0'))
+        .arg((ms / 60000) % 60, 2, 10, QLatin1Char('0'))
+        .arg((ms / 1000) % 60, 2, 10, QLatin1Char('0'))
+        .arg((ms % 1000) * 1000, 6, 10, QLatin1Char('0'));
+}
+
+int runProbe(const QStringList &args, qint64 durationMs)
+{
+    const QString entries = args.value(args.indexOf(QStringLiteral("-show_entries")) + 1);
+    if (entries.startsWith(QLatin1String("packet="))) {
+        // compact=p=0 packet lines at 23.976 fps with a keyframe every 240 frames.
+        const qint64 frames = durationMs * 24000 / 1001 / 1000;
+        QByteArray out;
+        for (qint64 i = 0; i < frames; ++i) {
+            const double seconds = i * 1001.0 / 24000.0;
+            out += QStringLiteral("pts_time=%1|dts_time=%1|pos=%2|flags=%3\n")
+                       .arg(seconds, 0, 'f', 6)
+                       .arg(i * 20000)
+                       .arg(i % 240 == 0 ? QStringLiteral("K__") : QStringLiteral("___"))
+                       .toUtf8();
+            if (out.size() > 64 * 1024) {
+                writeOut(out, 0);
+                out.clear();
+            }
+        }
+        writeOut(out, 0);
+        return 0;
+    }
+    writeOut(QStringLiteral("width=1920\nheight=1080\navg_frame_rate=24000/1001\nduration=%1\n")
+                 .arg(durationMs / 1000.0, 0, 'f', 6)
+                 .toUtf8(),
+             0);
+    return 0;
+}
+
+int runListing(const QStringList &args)
+{
+    if (args.contains(QStringLiteral("-encoders"))) {
+        writeOut("Encoders:\n V..... = Video\n A..... = Audio\n ------\n"
+                 " V....D libx264              libx264 H.264 / AVC / MPEG-4 AVC (codec h264)\n"
+                 " V....D libx265              libx265 H.265 / HEVC (codec hevc)\n"
+                 " A....D aac                  AAC (Advanced Audio Coding)\n"
+                 " A....D libopus              libopus Opus (codec opus)\n",
+                 0);
+    } else if (args.contains(QStringLiteral("-filters"))) {
+        writeOut("Filters:\n"
+                 " ... ass               V->V       Render ASS subtitles onto input video using the libass library.\n"
+                 " ... scale             V->V       Scale the input video size and/or convert the image format.\n"
+                 " ... subtitles         V->V       Render text subtitles onto input video using the libass library.\n"
+                 " ... ssim              VV->V      Calculate the SSIM between two video streams.\n"
+                 " ... loudnorm          A->A       EBU R128 loudness normalization\n",
+                 0);
+    } else {
+        writeOut("Hardware acceleration methods:\n\n", 0);
+    }
+    return 0;
+}
+
+int runEncode(const QStringList &args, qint64 durationMs)
+{
+    const double speed = envDouble("NISEYUKI_FAKE_SPEED", 8.0);
+    const double rateHz = envDouble("NISEYUKI_FAKE_RATE_HZ", 2.0);
+    const int splitBytes = static_cast<int>(envInteger("NISEYUKI_FAKE_SPLIT", 0));
+    const qint64 logEvery = envInteger("NISEYUKI_FAKE_LOG_EVERY", 20);
+    const Failure failure = pickFailure();
+    const qint64 failAtMs = failure == Failure::None ? -1 : QRandomGenerator::global()->bounded(durationMs);
+
+    const Logger logger(args);
+    const QString output = args.value(args.size() - 1);
+    const bool writesFile = !output.isEmpty() && output != QLatin1String("-") && !output.startsWith(QLatin1String("pipe:"))
+        && !args.contains(QStringLiteral("null"));
+
+    logger.log(QByteArray(), "info", "Input #0, matroska,webm, from 'fake':");
+    logger.log(QByteArray(), "info", "  Duration: " + timecode(durationMs).left(11).toUtf8() + ", start: 0.000000, bitrate: 4215 kb/s");
+
+    const auto intervalUs = static_cast<unsigned long>(1000000.0 / rateHz);
+    const auto stepMs = static_cast<qint64>(std::max(1.0, 1000.0 * speed / rateHz));
+    qint64 reports = 0;
+    for (qint64 outMs = 0;; outMs = std::min(outMs + stepMs, durationMs)) {
+        if (failAtMs >= 0 && outMs >= failAtMs) {
+            switch (failure) {
+            case Failure::Exit:
+                logger.log("libx264 @ 0x55d0c8a3c2c0", "error", "Error while encoding: Invalid data found when processing input");
+                return 1;
+            case Failure::Crash:
+                std::abort();
+            case Failure::Hang:
+                // Stops reporting but stays alive, like a wedged hardware session.
+                for (;;) {
+                    QThread::sleep(60);
+                }
+            case Failure::None:
+                break;
+            }
+        }
+        const bool done = outMs >= durationMs;
+        const qint64 frame = outMs * 24000 / 1001 / 1000;
+        writeOut(QStringLiteral("frame=%1\nfps=%2\nstream_0_0_q=28.0\nbitrate=2215.4kbits/s\ntotal_size=%3\n"
+                                "out_time_us=%4\nout_time_ms=%4\nout_time=%5\ndup_frames=0\ndrop_frames=0\n"
+                                "speed=%6x\nprogress=%7\n")
+                     .arg(frame)
+                     .arg(24.0 * speed, 0, 'f', 2)
+                     .arg(outMs * 277)
+                     .arg(outMs * 1000)
+                     .arg(timecode(outMs))
+                     .arg(speed, 0, 'f', 2)
+                     .arg(done ? QStringLiteral("end") : QStringLiteral("continue"))
+                     .toUtf8(),
+                 splitBytes);
+        if (++reports % logEvery == 0) {
+            logger.log("libx264 @ 0x55d0c8a3c2c0", "info", "frame I:12 Avg QP:18.42 size: 93211");
+        }
+        if (done) {
+            break;
+        }
+        QThread::usleep(intervalUs);
+    }
+
+    if (writesFile) {
+        QFile file(output);
+        if (!file.open(QIODevice::WriteOnly)) {
+            logger.log(QByteArray(), "error", output.toUtf8() + ": Permission denied");
+            return 1;
+        }
+        file.write(QByteArray(64 * 1024, '\0'));
+    }
+    return 0;
+}
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QStringList args;
+    for (int i = 1; i < argc; ++i) {
+        args << QString::fromLocal8Bit(argv[i]);
+    }
+    const qint64 durationMs = envInteger("NISEYUKI_FAKE_DURATION_MS", 60000);
+    if (args.contains(QStringLiteral("-show_entries"))) {
+        return runProbe(args, durationMs);
+    }
+    if (args.contains(QStringLiteral("-encoders")) || args.contains(QStringLiteral("-filters"))
+        || args.contains(QStringLiteral("-hwaccels"))) {
+        return runListing(args);
+    }
+    return runEncode(args, durationMs);
+}
@@ -0,0 +1,344 @@
+// Queue load driver: runs hundreds of simulated jobs through the GUI's
+// QueueScheduler and Encoder instances against niseyuki-fake-ffmpeg, and reports
+// scheduling overhead and event load as JSON, e.g.
+// `niseyuki-loadtest --jobs 500 --encoders 4 --split 7 --fail exit:5`.
+// The first encoder stands in for the local one, the others for worker slots.
+// Exits non-zero when a job is left unfinished, a local-only job reaches a worker
+// slot, or (without --fail) a job fails.
+
+#include "EncodeJob.h"
+#include "Encoder.h"
+#include "QueueScheduler.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QTimer>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+namespace {
+// The driver's own tick; how late it fires is the event-loop latency a GUI would feel.
+constexpr int kTickMs = 10;
+
+enum class JobState {
+    Pending,
+    Running,
+    Done,
+    Failed
+};
+
+struct QueuedJob {
+    EncodeJob job;
+    JobState state = JobState::Pending;
+    bool localOnly = false;
+};
+
+struct Slot {
+    std::unique_ptr<Encoder> encoder;
+    int row = -1; // queue row being encoded
+    qint64 startedAtMs = 0;
+    qint64 finishedAtMs = -1;
+    qint64 lastProgressMs = 0;
+};
+
+struct Stats {
+    qint64 succeeded = 0;
+    qint64 failed = 0;
+    qint64 stalled = 0;
+    qint64 remoteJobs = 0;
+    qint64 localOnlyOnRemote = 0;
+    qint64 prepared = 0;
+    qint64 progressSignals = 0;
+    qint64 etaSignals = 0;
+    qint64 statusSignals = 0;
+    qint64 messageSignals = 0;
+    QList<qint64> jobWallMs;
+    QList<qint64> startGapMs; // previous job finished -> next ffmpeg running on the same slot
+    QList<qint64> tickLateMs;
+};
+
+double percentile(QList<qint64> values, double fraction)
+{
+    if (values.isEmpty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const auto index = static_cast<qsizetype>(fraction * static_cast<double>(values.size() - 1));
+    return static_cast<double>(values.at(index));
+}
+
+QJsonObject distribution(const QList<qint64> &values)
+{
+    return {
+        {QStringLiteral("p50"), percentile(values, 0.50)},
+        {QStringLiteral("p95"), percentile(values, 0.95)},
+        {QStringLiteral("p99"), percentile(values, 0.99)},
+        {QStringLiteral("max"), percentile(values, 1.0)},
+    };
+}
+
+// The queue as QueueScheduler sees it; slot 0 is the local encoder.
+class LoadQueue : public QueueScheduler::Host
+{
+public:
+    LoadQueue(QList<QueuedJob> &jobs, std::vector<Slot> &slotList, Stats &stats, const QElapsedTimer &clock)
+        : m_jobs(jobs)
+        , m_slots(slotList)
+        , m_stats(stats)
+        , m_clock(clock)
+    {
+    }
+
+    int jobCount() const override { return static_cast<int>(m_jobs.size()); }
+    bool isPending(int row) const override { return m_jobs.at(row).state == JobState::Pending; }
+    bool isLocalOnly(int row) const override { return m_jobs.at(row).localOnly; }
+    bool takeJob(int) override { return true; }
+    bool localEncoderIdle() const override { return m_slots.front().encoder->state() == Encoder::State::Idle; }
+    void startLocal(int row) override { start(m_slots.front(), row); }
+
+    int freeRemoteSlots() const override
+    {
+        return static_cast<int>(std::count_if(m_slots.cbegin() + 1, m_slots.cend(), [](const Slot &slot) { return slot.row < 0; }));
+    }
+
+    bool startRemote(int row) override
+    {
+        const auto slot = std::find_if(m_slots.begin() + 1, m_slots.end(), [](const Slot &s) { return s.row < 0; });
+        if (slot == m_slots.end()) {
+            return false;
+        }
+        ++m_stats.remoteJobs;
+        if (m_jobs.at(row).localOnly) {
+            ++m_stats.localOnlyOnRemote;
+        }
+        start(*slot, row);
+        return true;
+    }
+
+    int activeRemoteJobs() const override { return static_cast<int>(m_slots.size()) - 1 - freeRemoteSlots(); }
+    void prepare(int) override { ++m_stats.prepared; }
+
+private:
+    void start(Slot &slot, int row)
+    {
+        m_jobs[row].state = JobState::Running;
+        slot.row = row;
+        slot.startedAtMs = m_clock.elapsed();
+        slot.lastProgressMs = slot.startedAtMs;
+        slot.encoder->startEncoding(m_jobs.at(row).job);
+    }
+
+    QList<QueuedJob> &m_jobs;
+    std::vector<Slot> &m_slots;
+    Stats &m_stats;
+    const QElapsedTimer &m_clock;
+};
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(QStringLiteral("Niseyuki Project"));
+    QCoreApplication::setApplicationName(QStringLiteral("Niseyuki Load Test"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs simulated jobs through the encoder against a fake ffmpeg."));
+    parser.addHelpOption();
+    QCommandLineOption jobsOption(QStringLiteral("jobs"), QStringLiteral("Number of jobs (default 200)."),
+                                  QStringLiteral("count"), QStringLiteral("200"));
+    QCommandLineOption encodersOption(QStringLiteral("encoders"), QStringLiteral("Concurrent encoders (default 1)."),
+                                      QStringLiteral("count"), QStringLiteral("1"));
+    QCommandLineOption fakeOption(QStringLiteral("fake"), QStringLiteral("Fake ffmpeg binary (default: next to this one)."),
+                                  QStringLiteral("path"));
+    QCommandLineOption durationOption(QStringLiteral("duration-ms"), QStringLiteral("Media duration per job (default 20000)."),
+                                      QStringLiteral("ms"), QStringLiteral("20000"));
+    QCommandLineOption speedOption(QStringLiteral("speed"), QStringLiteral("Simulated encode speed (default 40)."),
+                                   QStringLiteral("factor"), QStringLiteral("40"));
+    QCommandLineOption rateOption(QStringLiteral("rate"), QStringLiteral("Progress reports per second (default 2)."),
+                                  QStringLiteral("hz"), QStringLiteral("2"));
+    QCommandLineOption splitOption(QStringLiteral("split"), QStringLiteral("Split progress output into chunks of this many bytes."),
+                                   QStringLiteral("bytes"));
+    QCommandLineOption failOption(QStringLiteral("fail"), QStringLiteral("Failure modes, e.g. exit:5,crash:1."),
+                                  QStringLiteral("modes"));
+    QCommandLineOption stallOption(QStringLiteral("stall-ms"), QStringLiteral("Stop an encode that reports no progress for this long (default 30000)."),
+                                   QStringLiteral("ms"), QStringLiteral("30000"));
+    QCommandLineOption indexOption(QStringLiteral("index"), QStringLiteral("Build the source index before each encode."));
+    QCommandLineOption localOnlyOption(QStringLiteral("local-every"), QStringLiteral("Mark every Nth job local-only (default 0, none)."),
+                                       QStringLiteral("n"), QStringLiteral("0"));
+    parser.addOption(jobsOption);
+    parser.addOption(encodersOption);
+    parser.addOption(fakeOption);
+    parser.addOption(durationOption);
+    parser.addOption(speedOption);
+    parser.addOption(rateOption);
+    parser.addOption(splitOption);
+    parser.addOption(failOption);
+    parser.addOption(stallOption);
+    parser.addOption(indexOption);
+    parser.addOption(localOnlyOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const int jobCount = parser.value(jobsOption).toInt();
+    const int encoderCount = parser.value(encodersOption).toInt();
+    const qint64 stallMs = parser.value(stallOption).toLongLong();
+    const int localEvery = parser.value(localOnlyOption).toInt();
+    if (jobCount < 1 || encoderCount < 1 || stallMs < 1 || localEvery < 0) {
+        err << "Invalid --jobs, --encoders, --stall-ms or --local-every value" << Qt::endl;
+        return 2;
+    }
+    QString fake = parser.value(fakeOption);
+    if (fake.isEmpty()) {
+        fake = QDir(QCoreApplication::applicationDirPath()).filePath(QStringLiteral("niseyuki-fake-ffmpeg"));
+#ifdef Q_OS_WIN
+        fake.append(QStringLiteral(".exe"));
+#endif
+    }
+    if (!QFile::exists(fake)) {
+        err << "Fake ffmpeg not found: " << fake << Qt::endl;
+        return 2;
+    }
+
+    // Encoder resolves ffmpeg per job, and the fake reads its script from the inherited environment.
+    qputenv("NISEYUKI_FFMPEG", fake.toLocal8Bit());
+    qputenv("NISEYUKI_FFPROBE", fake.toLocal8Bit());
+    qputenv("NISEYUKI_FAKE_DURATION_MS", parser.value(durationOption).toLocal8Bit());
+    qputenv("NISEYUKI_FAKE_SPEED", parser.value(speedOption).toLocal8Bit());
+    qputenv("NISEYUKI_FAKE_RATE_HZ", parser.value(rateOption).toLocal8Bit());
+    qputenv("NISEYUKI_FAKE_SPLIT", parser.value(splitOption).toLocal8Bit());
+    qputenv("NISEYUKI_FAKE_FAIL", parser.value(failOption).toLocal8Bit());
+
+    QTemporaryDir workDir;
+    if (!workDir.isValid()) {
+        err << "Unable to create a working directory" << Qt::endl;
+        return 1;
+    }
+    const QString outputDir = workDir.filePath(QStringLiteral("out"));
+    QDir().mkpath(outputDir);
+
+    QList<QueuedJob> queue;
+    for (int i = 0; i < jobCount; ++i) {
+        EncodeJob job;
+        job.id = static_cast<quint64>(i + 1);
+        job.videoPath = workDir.filePath(QStringLiteral("source-%1.mkv").arg(i + 1, 4, 10, QLatin1Char('0')));
+        QFile source(job.videoPath);
+        if (!source.open(QIODevice::WriteOnly)) {
+            err << "Unable to create " << job.videoPath << Qt::endl;
+            return 1;
+        }
+        source.write(QByteArray(4096, '\0'));
+        job.profile.editVideo().encoder = QStringLiteral("x264");
+        job.profile.editVideo().preset = QStringLiteral("medium");
+        job.profile.editAudio().codec = QStringLiteral("AAC");
+        job.globalOutputFolder = outputDir;
+        queue.append({job, JobState::Pending, localEvery > 0 && (i + 1) % localEvery == 0});
+    }
+
+    Stats stats;
+    QElapsedTimer clock;
+    clock.start();
+    std::vector<Slot> slotList(static_cast<size_t>(encoderCount));
+    LoadQueue loadQueue(queue, slotList, stats, clock);
+    QueueScheduler scheduler(loadQueue);
+    QObject::connect(&scheduler, &QueueScheduler::queueFinished, &app, &QCoreApplication::quit);
+
+    for (Slot &slot : slotList) {
+        slot.encoder = std::make_unique<Encoder>();
+        slot.encoder->setSourceIndexingEnabled(parser.isSet(indexOption));
+        Encoder *encoder = slot.encoder.get();
+        QObject::connect(encoder, &Encoder::progressChanged, &app, [&stats, &slot, &clock](double) {
+            ++stats.progressSignals;
+            slot.lastProgressMs = clock.elapsed();
+        });
+        QObject::connect(encoder, &Encoder::etaChanged, &app, [&stats](qint64) { ++stats.etaSignals; });
+        QObject::connect(encoder, &Encoder::statusTextChanged, &app, [&stats](const QString &) { ++stats.statusSignals; });
+        QObject::connect(encoder, &Encoder::messageReceived, &app, [&stats](const QString &) { ++stats.messageSignals; });
+        QObject::connect(encoder, &Encoder::stateChanged, &app, [&stats, &slot, &clock](Encoder::State state) {
+            if (state == Encoder::State::Encoding && slot.finishedAtMs >= 0) {
+                stats.startGapMs.append(clock.elapsed() - slot.finishedAtMs);
+                slot.finishedAtMs = -1;
+            }
+        });
+        QObject::connect(encoder, &Encoder::finished, &app, [&stats, &slot, &clock, &queue, &scheduler](bool success) {
+            success ? ++stats.succeeded : ++stats.failed;
+            slot.finishedAtMs = clock.elapsed();
+            stats.jobWallMs.append(slot.finishedAtMs - slot.startedAtMs);
+            queue[slot.row].state = success ? JobState::Done : JobState::Failed;
+            slot.row = -1;
+            // Same hand-off as MainWindow::onEncoderFinished.
+            scheduler.continueQueue();
+        });
+    }
+
+    QElapsedTimer tickClock;
+    QTimer tick;
+    tick.setTimerType(Qt::PreciseTimer);
+    QObject::connect(&tick, &QTimer::timeout, &app, [&]() {
+        if (tickClock.isValid()) {
+            stats.tickLateMs.append(std::max<qint64>(0, tickClock.restart() - kTickMs));
+        } else {
+            tickClock.start();
+        }
+        // Encoder has no watchdog of its own, so a hung ffmpeg would otherwise hold its slot forever.
+        for (Slot &slot : slotList) {
+            if (slot.encoder->state() == Encoder::State::Encoding && clock.elapsed() - slot.lastProgressMs > stallMs) {
+                ++stats.stalled;
+                slot.encoder->stopEncoding();
+            }
+        }
+    });
+    tick.start(kTickMs);
+
+    QTimer::singleShot(0, &app, [&]() {
+        scheduler.setRunning(true);
+        if (!scheduler.startNext()) {
+            app.quit();
+        }
+    });
+    app.exec();
+
+    const auto unfinished = std::count_if(queue.cbegin(), queue.cend(), [](const QueuedJob &job) {
+        return job.state == JobState::Pending || job.state == JobState::Running;
+    });
+
+    const double seconds = std::max<qint64>(clock.elapsed(), 1) / 1000.0;
+    const qint64 signalTotal = stats.progressSignals + stats.etaSignals + stats.statusSignals + stats.messageSignals;
+    const QJsonObject summary{
+        {QStringLiteral("jobs"), jobCount},
+        {QStringLiteral("encoders"), encoderCount},
+        {QStringLiteral("succeeded"), stats.succeeded},
+        {QStringLiteral("failed"), stats.failed},
+        {QStringLiteral("stalled"), stats.stalled},
+        {QStringLiteral("unfinished"), static_cast<qint64>(unfinished)},
+        {QStringLiteral("remoteJobs"), stats.remoteJobs},
+        {QStringLiteral("localOnlyOnRemote"), stats.localOnlyOnRemote},
+        {QStringLiteral("prepared"), stats.prepared},
+        {QStringLiteral("wallSeconds"), seconds},
+        {QStringLiteral("jobsPerSecond"), jobCount / seconds},
+        {QStringLiteral("signals"), QJsonObject{
+            {QStringLiteral("progress"), stats.progressSignals},
+            {QStringLiteral("eta"), stats.etaSignals},
+            {QStringLiteral("status"), stats.statusSignals},
+            {QStringLiteral("message"), stats.messageSignals},
+            {QStringLiteral("perSecond"), signalTotal / seconds},
+        }},
+        {QStringLiteral("jobWallMs"), distribution(stats.jobWallMs)},
+        {QStringLiteral("startGapMs"), distribution(stats.startGapMs)},
+        {QStringLiteral("eventLoopLateMs"), distribution(stats.tickLateMs)},
+    };
+    QTextStream(stdout) << QJsonDocument(summary).toJson(QJsonDocument::Indented);
+    if (unfinished > 0 || stats.localOnlyOnRemote > 0) {
+        return 1;
+    }
+    return stats.failed > 0 && parser.value(failOption).isEmpty() ? 1 : 0;
+}
@@ -51,7 +51,13 @@ $windeployqt = Resolve-WindeployQt -QtBinDir $QtBinDir
 if ($null -eq $windeployqt) {
     Write-Warning "windeployqt.exe not found. Qt dependencies were not copied."
 } else {
-    & $windeployqt "--release" "--force" "--dir" $bundleDir $exePath
+    # The sound module is the only binary that uses Qt Multimedia; deploy its dependencies too.
+    $deployTargets = @($exePath)
+    $sfxPath = Join-Path $bundleDir "niseyuki-sfx.dll"
+    if (Test-Path $sfxPath) {
+        $deployTargets += $sfxPath
+    }
+    & $windeployqt "--release" "--force" "--dir" $bundleDir @deployTargets
 }
 
 if ($FfmpegDir) {
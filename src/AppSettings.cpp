@@ -0,0 +1,167 @@
+#include "AppSettings.h"
+
+#include <QSettings>
+#include <QVariantMap>
+
+namespace AppSettings {
+QStringList watchFolders()
+{
+    return QSettings().value(QStringLiteral("watchFolders/paths")).toStringList();
+}
+
+void setWatchFolders(const QStringList &folders)
+{
+    QSettings().setValue(QStringLiteral("watchFolders/paths"), folders);
+}
+
+QHash<QString, QString> watchFolderProfiles()
+{
+    QHash<QString, QString> profiles;
+    const QVariantMap stored = QSettings().value(QStringLiteral("watchFolders/profiles")).toMap();
+    for (auto it = stored.cbegin(); it != stored.cend(); ++it) {
+        profiles.insert(it.key(), it.value().toString());
+    }
+    return profiles;
+}
+
+void setWatchFolderProfiles(const QHash<QString, QString> &profiles)
+{
+    QVariantMap stored;
+    for (auto it = profiles.cbegin(); it != profiles.cend(); ++it) {
+        if (!it.value().isEmpty()) {
+            stored.insert(it.key(), it.value());
+        }
+    }
+    QSettings().setValue(QStringLiteral("watchFolders/profiles"), stored);
+}
+
+bool autoStartWatchedJobs()
+{
+    return QSettings().value(QStringLiteral("watchFolders/autoStart"), true).toBool();
+}
+
+void setAutoStartWatchedJobs(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("watchFolders/autoStart"), enabled);
+}
+
+bool outputCacheEnabled()
+{
+    return QSettings().value(QStringLiteral("encoding/outputCache"), true).toBool();
+}
+
+void setOutputCacheEnabled(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("encoding/outputCache"), enabled);
+}
+
+bool sourceIndexingEnabled()
+{
+    return QSettings().value(QStringLiteral("encoding/sourceIndex"), true).toBool();
+}
+
+void setSourceIndexingEnabled(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("encoding/sourceIndex"), enabled);
+}
+
+bool moovReservationEnabled()
+{
+    return QSettings().value(QStringLiteral("encoding/reserveMoov"), true).toBool();
+}
+
+void setMoovReservationEnabled(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("encoding/reserveMoov"), enabled);
+}
+
+QString scratchDirectory()
+{
+    return QSettings().value(QStringLiteral("encoding/scratchDir")).toString();
+}
+
+void setScratchDirectory(const QString &directory)
+{
+    QSettings().setValue(QStringLiteral("encoding/scratchDir"), directory);
+}
+
+bool lowOverheadUi()
+{
+    return QSettings().value(QStringLiteral("ui/lowOverhead"), true).toBool();
+}
+
+void setLowOverheadUi(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("ui/lowOverhead"), enabled);
+}
+
+QString ffmpegLogLevel()
+{
+    return QSettings().value(QStringLiteral("encoding/ffmpegLogLevel"), QStringLiteral("warning")).toString();
+}
+
+void setFfmpegLogLevel(const QString &level)
+{
+    QSettings().setValue(QStringLiteral("encoding/ffmpegLogLevel"), level);
+}
+
+bool attachSubtitleFonts()
+{
+    return QSettings().value(QStringLiteral("encoding/attachSubtitleFonts"), false).toBool();
+}
+
+void setAttachSubtitleFonts(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("encoding/attachSubtitleFonts"), enabled);
+}
+
+bool soundEffectsEnabled()
+{
+    return QSettings().value(QStringLiteral("ui/soundEffects"), false).toBool();
+}
+
+void setSoundEffectsEnabled(bool enabled)
+{
+    QSettings().setValue(QStringLiteral("ui/soundEffects"), enabled);
+}
+
+QStringList postEncodeHooks()
+{
+    return QSettings().value(QStringLiteral("hooks/commands")).toStringList();
+}
+
+void setPostEncodeHooks(const QStringList &commands)
+{
+    QSettings().setValue(QStringLiteral("hooks/commands"), commands);
+}
+
+int hookTimeoutSeconds()
+{
+    return QSettings().value(QStringLiteral("hooks/timeoutSec"), 300).toInt();
+}
+
+void setHookTimeoutSeconds(int seconds)
+{
+    QSettings().setValue(QStringLiteral("hooks/timeoutSec"), seconds);
+}
+
+int hookConcurrency()
+{
+    return QSettings().value(QStringLiteral("hooks/concurrency"), 2).toInt();
+}
+
+void setHookConcurrency(int jobs)
+{
+    QSettings().setValue(QStringLiteral("hooks/concurrency"), jobs);
+}
+
+QStringList workerEndpoints()
+{
+    return QSettings().value(QStringLiteral("workers/endpoints")).toStringList();
+}
+
+void setWorkerEndpoints(const QStringList &endpoints)
+{
+    QSettings().setValue(QStringLiteral("workers/endpoints"), endpoints);
+}
+}
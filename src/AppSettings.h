@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+// Typed accessors for the persistent application settings (QSettings).
+namespace AppSettings {
+QStringList watchFolders();
+void setWatchFolders(const QStringList &folders);
+// Named profile per watch folder; folders without one use the Main tab settings.
+QHash<QString, QString> watchFolderProfiles();
+void setWatchFolderProfiles(const QHash<QString, QString> &profiles);
+bool autoStartWatchedJobs();
+void setAutoStartWatchedJobs(bool enabled);
+bool outputCacheEnabled();
+void setOutputCacheEnabled(bool enabled);
+bool sourceIndexingEnabled();
+void setSourceIndexingEnabled(bool enabled);
+bool moovReservationEnabled();
+void setMoovReservationEnabled(bool enabled);
+QString scratchDirectory();
+void setScratchDirectory(const QString &directory);
+QStringList postEncodeHooks();
+void setPostEncodeHooks(const QStringList &commands);
+int hookTimeoutSeconds();
+void setHookTimeoutSeconds(int seconds);
+int hookConcurrency();
+void setHookConcurrency(int jobs);
+bool lowOverheadUi();
+void setLowOverheadUi(bool enabled);
+QString ffmpegLogLevel();
+void setFfmpegLogLevel(const QString &level);
+bool attachSubtitleFonts();
+void setAttachSubtitleFonts(bool enabled);
+bool soundEffectsEnabled();
+void setSoundEffectsEnabled(bool enabled);
+QStringList workerEndpoints();
+void setWorkerEndpoints(const QStringList &endpoints);
+}
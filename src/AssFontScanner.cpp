@@ -0,0 +1,241 @@
+#include "AssFontScanner.h"
+
+#include "FontIndex.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QRegularExpression>
+#include <QStringConverter>
+
+#include <algorithm>
+
+namespace {
+struct FontState {
+    QString family;
+    bool bold = false;
+    bool italic = false;
+};
+
+bool parseBold(const QString &value)
+{
+    // -1/1 in styles, 1 in \b, or an explicit weight.
+    const int number = value.trimmed().toInt();
+    return number == -1 || number == 1 || number >= 600;
+}
+
+QString cleanFamily(const QString &family)
+{
+    QString name = family.trimmed();
+    // A leading @ only asks for vertical layout.
+    if (name.startsWith(QLatin1Char('@'))) {
+        name.remove(0, 1);
+    }
+    return name;
+}
+
+QStringList splitFormat(const QString &value)
+{
+    QStringList fields = value.split(QLatin1Char(','));
+    for (QString &field : fields) {
+        field = field.trimmed();
+    }
+    return fields;
+}
+
+// Applies one {...} block to the running state.
+void applyOverrides(const QString &block, const QHash<QString, FontState> &styles, const FontState &lineStyle,
+                    FontState &state, bool &drawing)
+{
+    static const QRegularExpression numberTag(QStringLiteral("^([bip])(\\d*)$"));
+    const QStringList tags = block.split(QLatin1Char('\\'), Qt::SkipEmptyParts);
+    for (const QString &raw : tags) {
+        const QString tag = raw.trimmed();
+        if (tag.startsWith(QLatin1String("fn"))) {
+            const QString family = cleanFamily(tag.mid(2));
+            state.family = family.isEmpty() ? lineStyle.family : family;
+        } else if (tag.startsWith(QLatin1Char('r'))) {
+            const QString name = tag.mid(1).trimmed();
+            state = name.isEmpty() ? lineStyle : styles.value(name, lineStyle);
+        } else if (const QRegularExpressionMatch match = numberTag.match(tag); match.hasMatch()) {
+            const QString value = match.captured(2);
+            switch (match.captured(1).at(0).unicode()) {
+            case 'b':
+                state.bold = value.isEmpty() ? lineStyle.bold : parseBold(value);
+                break;
+            case 'i':
+                state.italic = value.isEmpty() ? lineStyle.italic : value.toInt() != 0;
+                break;
+            case 'p':
+                drawing = value.toInt() > 0;
+                break;
+            }
+        }
+    }
+}
+} // namespace
+
+namespace AssFontScanner {
+
+QList<AssFontRequest> scan(const QString &path, bool *readable)
+{
+    QFile file(path);
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    const bool opened = file.open(QIODevice::ReadOnly);
+    if (readable) {
+        *readable = opened;
+    }
+    if (!opened || (suffix != QLatin1String("ass") && suffix != QLatin1String("ssa"))) {
+        return {};
+    }
+
+    // Scripts saved as UTF-16 carry a byte order mark; everything else is read as UTF-8.
+    const QByteArray data = file.readAll();
+    auto decode = QStringDecoder(QStringConverter::encodingForData(data).value_or(QStringConverter::Utf8));
+    const QString text = decode(data);
+    const QStringList lines = text.split(QRegularExpression(QStringLiteral("\\r?\\n")));
+
+    QHash<QString, FontState> styles;
+    FontState firstStyle;
+    QList<AssFontRequest> requests;
+    QHash<QString, qsizetype> requestIndex;
+    const auto requestFor = [&](const FontState &state) -> AssFontRequest & {
+        const QString key = QStringLiteral("%1|%2|%3").arg(state.family.toLower()).arg(state.bold).arg(state.italic);
+        const auto it = requestIndex.constFind(key);
+        if (it != requestIndex.cend()) {
+            return requests[it.value()];
+        }
+        requestIndex.insert(key, requests.size());
+        requests.append({state.family, state.bold, state.italic, {}});
+        return requests.last();
+    };
+
+    QString section;
+    QStringList styleFormat;
+    QStringList eventFormat;
+    for (const QString &raw : lines) {
+        const QString line = raw.trimmed();
+        if (line.startsWith(QLatin1Char('[')) && line.endsWith(QLatin1Char(']'))) {
+            section = line.toLower();
+            continue;
+        }
+        const qsizetype colon = line.indexOf(QLatin1Char(':'));
+        if (colon < 0) {
+            continue;
+        }
+        const QString key = line.left(colon).trimmed();
+        const QString value = line.mid(colon + 1).trimmed();
+        if (section.endsWith(QLatin1String("styles]"))) {
+            if (key == QLatin1String("Format")) {
+                styleFormat = splitFormat(value);
+            } else if (key == QLatin1String("Style")) {
+                const QStringList fields = value.split(QLatin1Char(','));
+                const auto field = [&](const char *name) {
+                    const qsizetype index = styleFormat.indexOf(QLatin1String(name));
+                    return index >= 0 && index < fields.size() ? fields.at(index).trimmed() : QString();
+                };
+                const FontState style{cleanFamily(field("Fontname")), parseBold(field("Bold")), field("Italic").toInt() != 0};
+                if (styles.isEmpty()) {
+                    firstStyle = style;
+                }
+                styles.insert(field("Name"), style);
+            }
+        } else if (section == QLatin1String("[events]")) {
+            if (key == QLatin1String("Format")) {
+                eventFormat = splitFormat(value);
+                continue;
+            }
+            const qsizetype textIndex = eventFormat.indexOf(QStringLiteral("Text"));
+            const qsizetype styleIndex = eventFormat.indexOf(QStringLiteral("Style"));
+            if (key != QLatin1String("Dialogue") || textIndex < 0) {
+                continue;
+            }
+            // Text is the last field and may contain commas of its own.
+            const QString body = value.section(QLatin1Char(','), static_cast<int>(textIndex));
+            QString styleName;
+            if (styleIndex >= 0) {
+                styleName = value.section(QLatin1Char(','), static_cast<int>(styleIndex), static_cast<int>(styleIndex)).trimmed().remove(QLatin1Char('*'));
+            }
+            // libass falls back to the first style for names it does not know.
+            const FontState lineStyle = styles.value(styleName, firstStyle);
+            FontState state = lineStyle;
+            bool drawing = false;
+            for (qsizetype i = 0; i < body.size(); ++i) {
+                const QChar ch = body.at(i);
+                if (ch == QLatin1Char('{')) {
+                    const qsizetype close = body.indexOf(QLatin1Char('}'), i + 1);
+                    if (close < 0) {
+                        break;
+                    }
+                    applyOverrides(body.mid(i + 1, close - i - 1), styles, lineStyle, state, drawing);
+                    i = close;
+                    continue;
+                }
+                if (ch == QLatin1Char('\\') && i + 1 < body.size()
+                    && (body.at(i + 1) == QLatin1Char('N') || body.at(i + 1) == QLatin1Char('n') || body.at(i + 1) == QLatin1Char('h'))) {
+                    ++i;
+                    continue;
+                }
+                char32_t codePoint = ch.unicode();
+                if (ch.isHighSurrogate() && i + 1 < body.size() && body.at(i + 1).isLowSurrogate()) {
+                    codePoint = QChar::surrogateToUcs4(ch, body.at(i + 1));
+                    ++i;
+                }
+                if (drawing || state.family.isEmpty() || QChar::isSpace(codePoint) || codePoint < 0x20) {
+                    continue;
+                }
+                requestFor(state).characters.insert(codePoint);
+            }
+        }
+    }
+    return requests;
+}
+
+QList<AssFontResolution> resolve(const QList<AssFontRequest> &requests, const FontCatalog &catalog)
+{
+    QList<AssFontResolution> resolutions;
+    resolutions.reserve(requests.size());
+    for (const AssFontRequest &request : requests) {
+        AssFontResolution resolution;
+        resolution.request = request;
+        if (const FontFace *face = catalog.match(request.family, request.bold, request.italic)) {
+            resolution.fontPath = face->path;
+            resolution.matchedFace = QStringLiteral("%1 %2").arg(face->family, face->style).trimmed();
+            for (const char32_t codePoint : request.characters) {
+                if (!face->covers(codePoint)) {
+                    resolution.missingGlyphs.append(codePoint);
+                }
+            }
+            std::sort(resolution.missingGlyphs.begin(), resolution.missingGlyphs.end());
+        }
+        resolutions.append(resolution);
+    }
+    return resolutions;
+}
+
+QStringList fontFiles(const QList<AssFontResolution> &resolutions)
+{
+    QStringList files;
+    for (const AssFontResolution &resolution : resolutions) {
+        if (resolution.found() && !files.contains(resolution.fontPath)) {
+            files.append(resolution.fontPath);
+        }
+    }
+    return files;
+}
+
+QString describeCharacters(const QList<char32_t> &characters, int limit)
+{
+    QStringList shown;
+    for (qsizetype i = 0; i < characters.size() && i < limit; ++i) {
+        const char32_t codePoint = characters.at(i);
+        const QString hex = QStringLiteral("%1").arg(static_cast<uint>(codePoint), 4, 16, QLatin1Char('0')).toUpper();
+        shown << QStringLiteral("%1 (U+%2)").arg(QString::fromUcs4(&codePoint, 1), hex);
+    }
+    if (characters.size() > limit) {
+        shown << QStringLiteral("+%1").arg(characters.size() - limit);
+    }
+    return shown.join(QStringLiteral(", "));
+}
+
+} // namespace AssFontScanner
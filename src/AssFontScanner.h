@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class FontCatalog;
+
+// A font an ASS/SSA script renders text in, with every character drawn in it.
+struct AssFontRequest {
+    QString family;
+    bool bold = false;
+    bool italic = false;
+    QSet<char32_t> characters;
+};
+
+struct AssFontResolution {
+    AssFontRequest request;
+    QString fontPath; // empty when no installed face matches
+    QString matchedFace;
+    QList<char32_t> missingGlyphs; // sorted
+
+    [[nodiscard]] bool found() const noexcept { return !fontPath.isEmpty(); }
+};
+
+namespace AssFontScanner {
+// Walks the styles and every dialogue line, following \fn, \b, \i, \r and
+// drawing-mode tags the way libass does. Returns nothing for unreadable or
+// non-ASS files (readable reports which).
+QList<AssFontRequest> scan(const QString &path, bool *readable = nullptr);
+QList<AssFontResolution> resolve(const QList<AssFontRequest> &requests, const FontCatalog &catalog);
+// Distinct font files the resolutions need, for collecting or attaching them.
+QStringList fontFiles(const QList<AssFontResolution> &resolutions);
+QString describeCharacters(const QList<char32_t> &characters, int limit = 16);
+} // namespace AssFontScanner
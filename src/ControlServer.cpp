@@ -0,0 +1,226 @@
+#include "ControlServer.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QLocalServer>
+#include <QLocalSocket>
+
+#include <utility>
+
+namespace {
+constexpr int kProgressIntervalMs = 200;
+constexpr int kMaxLineBytes = 1 << 20;
+}
+
+ControlServer::ControlServer(QObject *parent)
+    : QObject(parent)
+{
+    m_progressTimer.setSingleShot(true);
+    m_progressTimer.setInterval(kProgressIntervalMs);
+    connect(&m_progressTimer, &QTimer::timeout, this, &ControlServer::flushProgress);
+}
+
+ControlServer::~ControlServer() = default;
+
+QString ControlServer::serverName()
+{
+    QString user = qEnvironmentVariable("USER");
+    if (user.isEmpty()) {
+        user = qEnvironmentVariable("USERNAME");
+    }
+    return user.isEmpty() ? QStringLiteral("niseyuki-control") : QStringLiteral("niseyuki-control-%1").arg(user);
+}
+
+bool ControlServer::listen(QString *errorMessage)
+{
+    if (!m_server) {
+        m_server = new QLocalServer(this);
+        m_server->setSocketOptions(QLocalServer::UserAccessOption);
+        connect(m_server, &QLocalServer::newConnection, this, &ControlServer::onNewConnection);
+    }
+
+    if (m_server->listen(serverName())) {
+        return true;
+    }
+    if (m_server->serverError() == QAbstractSocket::AddressInUseError) {
+        // A previous instance crashed and left its socket behind; callers only get
+        // here after failing to reach a live instance.
+        QLocalServer::removeServer(serverName());
+        if (m_server->listen(serverName())) {
+            return true;
+        }
+    }
+    if (errorMessage) {
+        *errorMessage = m_server->errorString();
+    }
+    return false;
+}
+
+bool ControlServer::sendToRunningInstance(const QList<QJsonObject> &requests, int timeoutMs)
+{
+    QLocalSocket socket;
+    socket.connectToServer(serverName());
+    if (!socket.waitForConnected(timeoutMs)) {
+        return false;
+    }
+
+    for (const QJsonObject &request : requests) {
+        QByteArray line = QJsonDocument(request).toJson(QJsonDocument::Compact);
+        line.append('\n');
+        socket.write(line);
+    }
+    socket.flush();
+
+    // Wait for one reply per request so the hand-off is confirmed before exiting.
+    int replies = 0;
+    QByteArray buffer;
+    while (replies < requests.size() && socket.waitForReadyRead(timeoutMs)) {
+        buffer.append(socket.readAll());
+        replies = static_cast<int>(buffer.count('\n'));
+    }
+    socket.disconnectFromServer();
+    // A running instance that never answers (hung, or a stale socket) must not swallow the files.
+    return replies >= requests.size();
+}
+
+void ControlServer::publishProgress(const QJsonObject &snapshot)
+{
+    m_pendingProgress = snapshot;
+    if (!m_progressTimer.isActive()) {
+        m_progressTimer.start();
+    }
+}
+
+void ControlServer::publishEvent(const QJsonObject &event)
+{
+    // Keep ordering: a pending progress snapshot goes out before the event that follows it.
+    if (m_progressTimer.isActive()) {
+        m_progressTimer.stop();
+        flushProgress();
+    }
+    for (Client &client : m_clients) {
+        if (client.subscribed && client.socket) {
+            write(client.socket, event);
+        }
+    }
+}
+
+void ControlServer::flushProgress()
+{
+    if (m_pendingProgress.isEmpty()) {
+        return;
+    }
+    QJsonObject event = std::exchange(m_pendingProgress, QJsonObject());
+    event.insert(QStringLiteral("event"), QStringLiteral("progress"));
+    for (Client &client : m_clients) {
+        if (client.subscribed && client.socket) {
+            write(client.socket, event);
+        }
+    }
+}
+
+void ControlServer::onNewConnection()
+{
+    while (QLocalSocket *socket = m_server->nextPendingConnection()) {
+        Client client;
+        client.socket = socket;
+        m_clients.append(client);
+        connect(socket, &QLocalSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QLocalSocket::disconnected, this, [this, socket]() {
+            for (int i = 0; i < m_clients.size(); ++i) {
+                if (m_clients.at(i).socket == socket) {
+                    m_clients.removeAt(i);
+                    break;
+                }
+            }
+            socket->deleteLater();
+        });
+    }
+}
+
+ControlServer::Client *ControlServer::clientFor(QLocalSocket *socket)
+{
+    for (Client &client : m_clients) {
+        if (client.socket == socket) {
+            return &client;
+        }
+    }
+    return nullptr;
+}
+
+void ControlServer::onReadyRead(QLocalSocket *socket)
+{
+    Client *client = clientFor(socket);
+    if (!client) {
+        return;
+    }
+    client->buffer.append(socket->readAll());
+    if (client->buffer.size() > kMaxLineBytes && !client->buffer.contains('\n')) {
+        socket->abort();
+        return;
+    }
+
+    int newline = -1;
+    while ((newline = client->buffer.indexOf('\n')) >= 0) {
+        const QByteArray line = client->buffer.left(newline).trimmed();
+        client->buffer.remove(0, newline + 1);
+        if (!line.isEmpty()) {
+            handleLine(*client, line);
+            // The handler may have caused the client list to change.
+            client = clientFor(socket);
+            if (!client) {
+                return;
+            }
+        }
+    }
+}
+
+void ControlServer::handleLine(Client &client, const QByteArray &line)
+{
+    QJsonParseError parseError;
+    const QJsonDocument doc = QJsonDocument::fromJson(line, &parseError);
+    if (!doc.isObject()) {
+        write(client.socket, {{QStringLiteral("ok"), false},
+                              {QStringLiteral("error"), tr("Invalid JSON: %1").arg(parseError.errorString())}});
+        return;
+    }
+
+    const QJsonObject request = doc.object();
+    const QString command = request.value(QStringLiteral("cmd")).toString();
+    QJsonObject reply;
+    if (command == QLatin1String("subscribe")) {
+        client.subscribed = true;
+        reply.insert(QStringLiteral("ok"), true);
+    } else if (command == QLatin1String("unsubscribe")) {
+        client.subscribed = false;
+        reply.insert(QStringLiteral("ok"), true);
+    } else if (m_handler) {
+        // The handler may run a nested event loop (e.g. a message box), so only the
+        // socket pointer is trusted afterwards, not the client entry.
+        QPointer<QLocalSocket> socket = client.socket;
+        reply = m_handler(request);
+        if (request.contains(QStringLiteral("id"))) {
+            reply.insert(QStringLiteral("id"), request.value(QStringLiteral("id")));
+        }
+        write(socket, reply);
+        return;
+    } else {
+        reply.insert(QStringLiteral("ok"), false);
+        reply.insert(QStringLiteral("error"), tr("Server is not ready"));
+    }
+
+    if (request.contains(QStringLiteral("id"))) {
+        reply.insert(QStringLiteral("id"), request.value(QStringLiteral("id")));
+    }
+    write(client.socket, reply);
+}
+
+void ControlServer::write(QLocalSocket *socket, const QJsonObject &message)
+{
+    if (!socket || socket->state() != QLocalSocket::ConnectedState) {
+        return;
+    }
+    QByteArray line = QJsonDocument(message).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    socket->write(line);
+}
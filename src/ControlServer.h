@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+
+#include <functional>
+
+class QLocalServer;
+class QLocalSocket;
+
+// Local IPC endpoint speaking newline-delimited JSON. Each request is an object
+// with a "cmd" field (and optional "id" echoed in the reply); subscribed clients
+// additionally receive {"event": ...} messages.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    using RequestHandler = std::function<QJsonObject(const QJsonObject &request)>;
+
+    explicit ControlServer(QObject *parent = nullptr);
+    ~ControlServer() override;
+
+    bool listen(QString *errorMessage = nullptr);
+    void setRequestHandler(RequestHandler handler) { m_handler = std::move(handler); }
+
+    // Progress events are coalesced so a fast ffmpeg stream cannot flood clients.
+    void publishProgress(const QJsonObject &snapshot);
+    void publishEvent(const QJsonObject &event);
+
+    static QString serverName();
+    // True only once the running instance has answered every request.
+    static bool sendToRunningInstance(const QList<QJsonObject> &requests, int timeoutMs = 2000);
+
+private:
+    struct Client {
+        QPointer<QLocalSocket> socket;
+        QByteArray buffer;
+        bool subscribed = false;
+    };
+
+    void onNewConnection();
+    void onReadyRead(QLocalSocket *socket);
+    void handleLine(Client &client, const QByteArray &line);
+    void write(QLocalSocket *socket, const QJsonObject &message);
+    void flushProgress();
+    Client *clientFor(QLocalSocket *socket);
+
+    QLocalServer *m_server = nullptr;
+    QList<Client> m_clients;
+    RequestHandler m_handler;
+    QJsonObject m_pendingProgress;
+    QTimer m_progressTimer;
+};
@@ -0,0 +1,436 @@
+#include "CrfSearch.h"
+
+#include "Encoder.h"
+#include "FfmpegLocator.h"
+#include "OutputCache.h"
+#include "TimeUtils.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+constexpr int kMinQuality = 14;
+constexpr int kMaxQuality = 36;
+// A series hit is re-checked within this distance instead of searching the whole range.
+constexpr int kSeriesBracket = 3;
+constexpr qint64 kSliceMs = 6000;
+constexpr int kMaxCacheEntries = 500;
+
+QString metricLabel(const QString &metric)
+{
+    if (metric == QLatin1String("vmaf")) {
+        return QStringLiteral("VMAF");
+    }
+    return metric.toUpper();
+}
+
+// Episode numbers, release tags and versions are dropped so every file of a
+// series in the same folder shares one name.
+QString seriesName(const QString &videoPath)
+{
+    const QFileInfo info(videoPath);
+    QString name = info.completeBaseName().toLower();
+    static const QRegularExpression bracketed(QStringLiteral("\\[[^\\]]*\\]|\\([^)]*\\)"));
+    static const QRegularExpression digits(QStringLiteral("\\d+"));
+    static const QRegularExpression separators(QStringLiteral("[\\s._-]+"));
+    name.remove(bracketed);
+    name.replace(digits, QStringLiteral("#"));
+    name.replace(separators, QStringLiteral(" "));
+    return info.absolutePath() + QLatin1Char('/') + name.trimmed();
+}
+
+// Everything besides the source that moves the CRF needed for a given score.
+QByteArray settingsSignature(const EncodeJob &job)
+{
+    const QStringList parts{
+        job.profile.video().targetMetric.toLower(),
+        QString::number(job.profile.video().targetValue, 'f', 4),
+        Encoder::videoCodecForJob(job),
+        Encoder::presetForJob(job),
+        job.profile.video().resizeMode.toLower(),
+        QStringLiteral("%1x%2").arg(job.profile.video().customSize.width()).arg(job.profile.video().customSize.height()),
+        job.telegramMode ? QStringLiteral("telegram") : QString(),
+        job.subtitlePath.isEmpty() ? QString() : QStringLiteral("subtitled")
+    };
+    return parts.join(QLatin1Char('|')).toUtf8();
+}
+
+QByteArray hashKey(const QByteArray &kind, const QByteArray &subject, const QByteArray &settings)
+{
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    hash.addData(kind);
+    hash.addData(QByteArrayView("\0", 1));
+    hash.addData(subject);
+    hash.addData(QByteArrayView("\0", 1));
+    hash.addData(settings);
+    return hash.result().toHex();
+}
+
+QJsonObject loadCache()
+{
+    QFile file(CrfSearch::cachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QJsonObject();
+    }
+    return QJsonDocument::fromJson(file.readAll()).object();
+}
+
+void saveCache(const QJsonObject &root)
+{
+    QDir().mkpath(QFileInfo(CrfSearch::cachePath()).absolutePath());
+    QSaveFile file(CrfSearch::cachePath());
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
+
+int cachedQuality(const QJsonObject &cache, const QByteArray &key)
+{
+    if (key.isEmpty()) {
+        return -1;
+    }
+    return cache.value(QString::fromLatin1(key)).toObject().value(QStringLiteral("quality")).toInt(-1);
+}
+} // namespace
+
+double CrfSearch::parseScore(const QString &metric, const QString &output)
+{
+    static const QRegularExpression ssim(QStringLiteral("All:([0-9.]+)"));
+    static const QRegularExpression psnr(QStringLiteral("average:([0-9.]+|inf)"));
+    static const QRegularExpression vmaf(QStringLiteral("VMAF score[:=]\\s*([0-9.]+)"));
+    const QRegularExpression &pattern = metric == QLatin1String("ssim") ? ssim
+        : metric == QLatin1String("psnr")                              ? psnr
+                                                                        : vmaf;
+    // The summary is printed last; per-frame lines never match these patterns.
+    QRegularExpressionMatch last;
+    for (auto it = pattern.globalMatch(output); it.hasNext();) {
+        last = it.next();
+    }
+    if (!last.hasMatch()) {
+        return -1.0;
+    }
+    if (last.captured(1) == QLatin1String("inf")) {
+        return 100.0;
+    }
+    return last.captured(1).toDouble();
+}
+
+CrfSearch::CrfSearch(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_samples, &SampleEncoder::messageReceived, this, &CrfSearch::messageReceived);
+    connect(&m_samples, &SampleEncoder::finished, this, &CrfSearch::onSamplesFinished);
+}
+
+CrfSearch::~CrfSearch()
+{
+    m_samples.disconnect(this);
+    cancel();
+}
+
+bool CrfSearch::isSupportedMetric(const QString &metric)
+{
+    const QString lower = metric.toLower();
+    return lower == QLatin1String("ssim") || lower == QLatin1String("psnr") || lower == QLatin1String("vmaf");
+}
+
+QString CrfSearch::cachePath()
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return QDir(dir).filePath(QStringLiteral("crf-cache.json"));
+}
+
+bool CrfSearch::start(const EncodeJob &job)
+{
+    if (m_running || !isSupportedMetric(job.profile.video().targetMetric) || job.profile.video().targetValue <= 0.0) {
+        return false;
+    }
+    m_ffmpegPath = locateFfmpeg();
+    if (m_ffmpegPath.isEmpty()) {
+        return false;
+    }
+
+    m_job = job;
+    m_metric = job.profile.video().targetMetric.toLower();
+    m_target = job.profile.video().targetValue;
+    m_scores.clear();
+    m_best = -1;
+    m_probe = -1;
+    m_steps = 0;
+    m_running = true;
+
+    const QByteArray settings = settingsSignature(m_job);
+    QByteArray cut;
+    if (m_job.cutSettings.enabled) {
+        cut = (m_job.cutSettings.startTime + QLatin1Char('-') + m_job.cutSettings.endTime).toUtf8();
+    }
+    const QByteArray sourceHash = OutputCache::sampledFileHash(m_job.videoPath);
+    m_sourceKey = sourceHash.isEmpty() ? QByteArray() : hashKey("source", sourceHash + cut, settings);
+    m_seriesKey = hashKey("series", seriesName(m_job.videoPath).toUtf8() + QByteArray::number(m_job.sourceHeight), settings);
+
+    const QJsonObject cache = loadCache();
+    const int sourceHit = cachedQuality(cache, m_sourceKey);
+    if (sourceHit >= 0) {
+        emit messageReceived(tr("Using cached CRF %1 for %2 %3").arg(sourceHit).arg(metricLabel(m_metric)).arg(m_target));
+        QTimer::singleShot(0, this, [this, sourceHit]() {
+            if (m_running) {
+                finishSearch(sourceHit, QString());
+            }
+        });
+        return true;
+    }
+
+    const int seriesHit = cachedQuality(cache, m_seriesKey);
+    if (seriesHit >= 0) {
+        m_bracketLow = std::max(kMinQuality, seriesHit - kSeriesBracket);
+        m_bracketHigh = std::min(kMaxQuality, seriesHit + kSeriesBracket);
+        emit messageReceived(tr("Series CRF %1 found; searching %2-%3").arg(seriesHit).arg(m_bracketLow).arg(m_bracketHigh));
+    } else {
+        m_bracketLow = kMinQuality;
+        m_bracketHigh = kMaxQuality;
+    }
+    m_low = m_bracketLow;
+    m_high = m_bracketHigh;
+
+    QDir().mkpath(SampleEncoder::sampleDirectory());
+    m_workDir = std::make_unique<QTemporaryDir>(QDir(SampleEncoder::sampleDirectory()).filePath(QStringLiteral("crf-XXXXXX")));
+    m_samples.setOutputDirectory(m_workDir->isValid() ? m_workDir->path() : SampleEncoder::sampleDirectory());
+
+    emit messageReceived(tr("Searching CRF for %1 >= %2").arg(metricLabel(m_metric)).arg(m_target));
+    QTimer::singleShot(0, this, &CrfSearch::nextProbe);
+    return true;
+}
+
+void CrfSearch::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    m_samples.cancel();
+    for (QProcess *process : std::as_const(m_metricProcesses)) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(1000);
+        delete process;
+    }
+    m_metricProcesses.clear();
+    m_metricsRunning = 0;
+    m_workDir.reset();
+}
+
+void CrfSearch::nextProbe()
+{
+    if (!m_running) {
+        return;
+    }
+
+    while (true) {
+        if (m_low > m_high) {
+            // The answer may sit outside a series bracket; widen towards it once.
+            if (m_best == m_bracketHigh && m_bracketHigh < kMaxQuality) {
+                m_low = m_bracketHigh + 1;
+                m_high = m_bracketHigh = kMaxQuality;
+            } else if (m_best < 0 && m_bracketLow > kMinQuality) {
+                m_high = m_bracketLow - 1;
+                m_low = m_bracketLow = kMinQuality;
+            } else {
+                break;
+            }
+            continue;
+        }
+        const int mid = (m_low + m_high + 1) / 2;
+        if (!m_scores.contains(mid)) {
+            m_probe = mid;
+            break;
+        }
+        if (m_scores.value(mid) >= m_target) {
+            m_best = mid;
+            m_low = mid + 1;
+        } else {
+            m_high = mid - 1;
+        }
+    }
+
+    if (m_low > m_high) {
+        if (m_best < 0) {
+            emit messageReceived(tr("[warn] No CRF down to %1 reaches %2 %3; using %1.")
+                                     .arg(kMinQuality)
+                                     .arg(metricLabel(m_metric))
+                                     .arg(m_target));
+            finishSearch(kMinQuality, QString());
+            return;
+        }
+        const QJsonObject entry{
+            {QStringLiteral("quality"), m_best},
+            {QStringLiteral("score"), m_scores.value(m_best)},
+            {QStringLiteral("updated"), QDateTime::currentMSecsSinceEpoch()}
+        };
+        QJsonObject cache = loadCache();
+        if (!m_sourceKey.isEmpty()) {
+            cache.insert(QString::fromLatin1(m_sourceKey), entry);
+        }
+        cache.insert(QString::fromLatin1(m_seriesKey), entry);
+        while (cache.size() > kMaxCacheEntries) {
+            auto oldest = cache.begin();
+            for (auto it = cache.begin(); it != cache.end(); ++it) {
+                if (it.value().toObject().value(QStringLiteral("updated")).toInteger()
+                    < oldest.value().toObject().value(QStringLiteral("updated")).toInteger()) {
+                    oldest = it;
+                }
+            }
+            cache.erase(oldest);
+        }
+        saveCache(cache);
+        emit messageReceived(tr("Chose CRF %1 (%2 %3) after %n sample round(s)", nullptr, m_steps)
+                                 .arg(m_best)
+                                 .arg(metricLabel(m_metric))
+                                 .arg(m_scores.value(m_best), 0, 'f', 4));
+        finishSearch(m_best, QString());
+        return;
+    }
+
+    ++m_steps;
+    emit statusChanged(tr("Tuning CRF %1").arg(m_probe));
+    EncodeJob probe = m_job;
+    probe.profile.editVideo().qualityValue = m_probe;
+    if (!m_samples.start(probe, {0.1, 0.5, 0.9}, kSliceMs)) {
+        finishSearch(-1.0, tr("Sample encodes for the CRF search could not be started."));
+    }
+}
+
+void CrfSearch::onSamplesFinished(bool success)
+{
+    if (!m_running) {
+        return;
+    }
+    if (!success) {
+        finishSearch(-1.0, tr("Sample encodes at CRF %1 failed.").arg(m_probe));
+        return;
+    }
+
+    const QVector<SampleResult> &results = m_samples.results();
+    m_sampleScores = QVector<double>(results.size(), -1.0);
+    m_metricError.clear();
+    m_metricsRunning = 0;
+    // Metric runs share the CPU, and libvmaf would otherwise start one thread per core each.
+    const int threads = std::max(1, QThread::idealThreadCount() / std::max<int>(1, results.size()));
+    for (int i = 0; i < results.size(); ++i) {
+        if (!results.at(i).success) {
+            continue;
+        }
+        auto *process = new QProcess(this);
+        process->setProgram(m_ffmpegPath);
+        process->setArguments(metricArguments(results.at(i), threads));
+        process->setProcessChannelMode(QProcess::MergedChannels);
+        connect(process, &QProcess::finished, this, [this, i, process]() { onMetricFinished(i, process); });
+        m_metricProcesses.append(process);
+        ++m_metricsRunning;
+        process->start();
+    }
+    if (m_metricsRunning == 0) {
+        finishSearch(-1.0, tr("No sample encode at CRF %1 could be scored.").arg(m_probe));
+    }
+}
+
+QStringList CrfSearch::metricArguments(const SampleResult &sample, int threads) const
+{
+    // The reference goes through the encode's own filter chain, so scaling and
+    // burned subtitles match and only the compression loss is measured.
+    EncodeJob slice = m_job;
+    slice.cutSettings.enabled = true;
+    slice.cutSettings.startTime = formatSeconds(static_cast<double>(sample.startMs) / 1000.0);
+    slice.cutSettings.endTime = formatSeconds(static_cast<double>(sample.startMs + sample.lengthMs) / 1000.0);
+    QStringList referenceFilters = Encoder::videoFiltersForJob(slice);
+    referenceFilters << QStringLiteral("setpts=PTS-STARTPTS") << QStringLiteral("format=yuv420p");
+
+    const QString metricFilter = m_metric == QLatin1String("vmaf")
+        ? QStringLiteral("libvmaf=n_threads=%1").arg(threads)
+        : m_metric;
+    const QString graph = QStringLiteral("[0:v]setpts=PTS-STARTPTS,format=yuv420p[dist];[1:v]%1[ref];[dist][ref]%2")
+                              .arg(referenceFilters.join(QLatin1Char(',')), metricFilter);
+
+    return {
+        QStringLiteral("-hide_banner"),
+        QStringLiteral("-nostats"),
+        QStringLiteral("-i"), QDir::toNativeSeparators(sample.outputPath),
+        QStringLiteral("-ss"), slice.cutSettings.startTime,
+        QStringLiteral("-t"), formatSeconds(static_cast<double>(sample.lengthMs) / 1000.0),
+        QStringLiteral("-i"), m_job.videoPath,
+        QStringLiteral("-lavfi"), graph,
+        QStringLiteral("-f"), QStringLiteral("null"),
+        QStringLiteral("-")
+    };
+}
+
+void CrfSearch::onMetricFinished(int index, QProcess *process)
+{
+    const QString output = QString::fromUtf8(process->readAll());
+    m_metricProcesses.removeOne(process);
+    process->deleteLater();
+    if (!m_running) {
+        return;
+    }
+
+    const double score = parseScore(m_metric, output);
+    m_sampleScores[index] = score;
+    if (score < 0.0) {
+        const QStringList lines = output.trimmed().split(QLatin1Char('\n'));
+        m_metricError = lines.isEmpty() ? QString() : lines.constLast().trimmed();
+    }
+    if (--m_metricsRunning > 0) {
+        return;
+    }
+
+    // The weakest slice decides: the target has to hold in hard scenes too.
+    double worst = std::numeric_limits<double>::max();
+    for (double value : std::as_const(m_sampleScores)) {
+        if (value >= 0.0) {
+            worst = std::min(worst, value);
+        }
+    }
+    if (worst == std::numeric_limits<double>::max()) {
+        finishSearch(-1.0, tr("%1 could not be measured: %2").arg(metricLabel(m_metric), m_metricError));
+        return;
+    }
+    evaluate(m_probe, worst);
+}
+
+void CrfSearch::evaluate(int quality, double score)
+{
+    m_scores.insert(quality, score);
+    const qint64 projected = m_samples.projectedBytes();
+    emit messageReceived(tr("CRF %1: %2 %3 (%4), projected %5 MiB")
+                             .arg(quality)
+                             .arg(metricLabel(m_metric))
+                             .arg(score, 0, 'f', 4)
+                             .arg(score >= m_target ? tr("meets target") : tr("below target"))
+                             .arg(projected > 0 ? projected / (1024.0 * 1024.0) : 0.0, 0, 'f', 1));
+    for (const SampleResult &sample : m_samples.results()) {
+        QFile::remove(sample.outputPath);
+    }
+    // Deferred so the sample encoders are not replaced from inside their own signals.
+    QTimer::singleShot(0, this, &CrfSearch::nextProbe);
+}
+
+void CrfSearch::finishSearch(double quality, const QString &errorMessage)
+{
+    cancel();
+    emit finished(quality, errorMessage);
+}
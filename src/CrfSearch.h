@@ -0,0 +1,74 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "SampleEncoder.h"
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+class QProcess;
+class QTemporaryDir;
+
+// Target-quality mode: finds the highest CRF/CQ whose sample encodes still
+// meet the job's SSIM, PSNR or VMAF target. Each step encodes short slices in
+// parallel, scores them against the identically filtered source and halves
+// the remaining range. Results are cached per source and per series, so later
+// episodes start from a narrow bracket or skip the search entirely.
+class CrfSearch : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CrfSearch(QObject *parent = nullptr);
+    ~CrfSearch() override;
+
+    bool start(const EncodeJob &job);
+    void cancel();
+    [[nodiscard]] bool isRunning() const noexcept { return m_running; }
+
+    static bool isSupportedMetric(const QString &metric);
+    static QString cachePath();
+    // Summary score from ffmpeg's ssim/psnr/libvmaf output, or -1 when none was printed.
+    static double parseScore(const QString &metric, const QString &output);
+
+signals:
+    void statusChanged(const QString &text);
+    void messageReceived(const QString &message);
+    // quality is negative when the search failed.
+    void finished(double quality, const QString &errorMessage);
+
+private:
+    void nextProbe();
+    void onSamplesFinished(bool success);
+    void onMetricFinished(int index, QProcess *process);
+    void evaluate(int quality, double score);
+    void finishSearch(double quality, const QString &errorMessage);
+    QStringList metricArguments(const SampleResult &sample, int threads) const;
+
+    EncodeJob m_job;
+    QString m_metric;
+    double m_target = 0.0;
+    QString m_ffmpegPath;
+    QByteArray m_sourceKey;
+    QByteArray m_seriesKey;
+    int m_bracketLow = 0;
+    int m_bracketHigh = 0;
+    int m_low = 0;
+    int m_high = 0;
+    int m_best = -1;
+    int m_probe = -1;
+    int m_steps = 0;
+    QHash<int, double> m_scores;
+    SampleEncoder m_samples;
+    QList<QProcess *> m_metricProcesses;
+    QVector<double> m_sampleScores;
+    QString m_metricError;
+    int m_metricsRunning = 0;
+    std::unique_ptr<QTemporaryDir> m_workDir;
+    bool m_running = false;
+};
@@ -0,0 +1,151 @@
+#include "DurationModel.h"
+
+#include "Encoder.h"
+
+#include <QFile>
+#include <QFileInfo>
+
+#include <algorithm>
+
+namespace {
+double median(QVector<double> values)
+{
+    if (values.isEmpty()) {
+        return 0.0;
+    }
+    const int middle = values.size() / 2;
+    std::nth_element(values.begin(), values.begin() + middle, values.end());
+    return values.at(middle);
+}
+} // namespace
+
+void DurationModel::train(const QVector<JobTelemetry> &records)
+{
+    m_speeds.clear();
+    m_sampleCount = 0;
+    for (const JobTelemetry &record : records) {
+        addSample(record);
+    }
+}
+
+void DurationModel::addSample(const JobTelemetry &record)
+{
+    if (!record.success || record.encodedDurationMs <= 0 || record.wallTimeMs <= 0) {
+        return;
+    }
+    const double speed = static_cast<double>(record.encodedDurationMs) / static_cast<double>(record.wallTimeMs);
+    const QStringList keys = keysFor(record.encoder, record.passes, record.preset, heightClass(record.outputHeight), record.subtitleComplexity);
+    for (const QString &key : keys) {
+        m_speeds[key].append(speed);
+    }
+    ++m_sampleCount;
+}
+
+qint64 DurationModel::predictWallMs(const EncodeJob &job) const
+{
+    const qint64 mediaMs = job.effectiveDurationMs();
+    if (mediaMs <= 0) {
+        return -1;
+    }
+
+    const QStringList keys = keysFor(Encoder::videoCodecForJob(job),
+                                     job.rateControl.twoPass ? 2 : 1,
+                                     Encoder::presetForJob(job),
+                                     heightClass(outputHeight(job)),
+                                     // Scripts the pipeline has not read yet count as plain; no file I/O here.
+                                     job.subtitleComplexity >= 0 ? job.subtitleComplexity
+                                                                 : (job.subtitlePath.isEmpty() ? NoSubtitles : PlainSubtitles));
+    for (const QString &key : keys) {
+        const auto it = m_speeds.constFind(key);
+        if (it == m_speeds.constEnd() || it->isEmpty()) {
+            continue;
+        }
+        const double speed = median(*it);
+        if (speed > 0.0) {
+            return static_cast<qint64>(static_cast<double>(mediaMs) / speed);
+        }
+    }
+    return -1;
+}
+
+int DurationModel::outputHeight(const EncodeJob &job)
+{
+    const QString resizeMode = job.profile.video().resizeMode.toLower();
+    if (resizeMode == QLatin1String("1080p")) {
+        return 1080;
+    }
+    if (resizeMode == QLatin1String("720p")) {
+        return 720;
+    }
+    if (resizeMode == QLatin1String("480p")) {
+        return 480;
+    }
+    if (resizeMode == QLatin1String("custom") && job.profile.video().customSize.isValid()) {
+        return job.profile.video().customSize.height();
+    }
+    return job.sourceHeight;
+}
+
+int DurationModel::heightClass(int height)
+{
+    if (height <= 0) {
+        return 0;
+    }
+    if (height <= 480) {
+        return 480;
+    }
+    if (height <= 720) {
+        return 720;
+    }
+    if (height <= 1080) {
+        return 1080;
+    }
+    return 2160;
+}
+
+int DurationModel::subtitleComplexity(const EncodeJob &job)
+{
+    return job.subtitleComplexity >= 0 ? job.subtitleComplexity : subtitleComplexity(job.subtitlePath);
+}
+
+int DurationModel::subtitleComplexity(const QString &subtitlePath)
+{
+    if (subtitlePath.isEmpty()) {
+        return NoSubtitles;
+    }
+    const QString suffix = QFileInfo(subtitlePath).suffix().toLower();
+    if (suffix != QLatin1String("ass") && suffix != QLatin1String("ssa")) {
+        return PlainSubtitles;
+    }
+
+    QFile file(subtitlePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return PlainSubtitles;
+    }
+    // Typesetting-heavy scripts are dominated by positioned/animated override blocks,
+    // which is what makes libass rendering expensive.
+    qint64 overrideBlocks = 0;
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine();
+        if (!line.startsWith("Dialogue:")) {
+            continue;
+        }
+        if (line.contains("\\pos") || line.contains("\\move") || line.contains("\\clip") || line.contains("\\t(")) {
+            ++overrideBlocks;
+        }
+    }
+    return overrideBlocks > 200 ? TypesetSubtitles : PlainSubtitles;
+}
+
+QStringList DurationModel::keysFor(const QString &encoderName, int passes, const QString &preset, int heightClass, int subtitleClass)
+{
+    // Two-pass speeds never stand in for single-pass ones, not even in the fallbacks.
+    const QString encoder = passes > 1 ? QStringLiteral("%1/%2pass").arg(encoderName).arg(passes) : encoderName;
+    // Most specific first; later keys are fallbacks when history is sparse.
+    return {
+        QStringLiteral("%1|%2|%3|%4").arg(encoder, preset).arg(heightClass).arg(subtitleClass),
+        QStringLiteral("%1|%2|%3").arg(encoder, preset).arg(heightClass),
+        QStringLiteral("%1|%2").arg(encoder, preset),
+        encoder
+    };
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "JobTelemetry.h"
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+// Predicts wall-clock encode time from historical telemetry, keyed by encoder,
+// preset, pass count, output resolution class and subtitle complexity.
+class DurationModel
+{
+public:
+    enum SubtitleComplexity {
+        NoSubtitles = 0,
+        PlainSubtitles = 1,
+        TypesetSubtitles = 2
+    };
+
+    void train(const QVector<JobTelemetry> &records);
+    void addSample(const JobTelemetry &record);
+
+    // Returns -1 when there is no usable history for the job.
+    [[nodiscard]] qint64 predictWallMs(const EncodeJob &job) const;
+    [[nodiscard]] int sampleCount() const noexcept { return m_sampleCount; }
+
+    static int outputHeight(const EncodeJob &job);
+    static int heightClass(int height);
+    // Reads the whole script; callers cache the result on the job.
+    static int subtitleComplexity(const QString &subtitlePath);
+    static int subtitleComplexity(const EncodeJob &job);
+
+private:
+    static QStringList keysFor(const QString &encoder, int passes, const QString &preset, int heightClass, int subtitleClass);
+
+    QHash<QString, QVector<double>> m_speeds;
+    int m_sampleCount = 0;
+};
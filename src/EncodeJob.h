@@ -1,13 +1,14 @@
 #pragma once
 
+#include "EncodeProfile.h"
+#include "TimeUtils.h"
+
 #include <QDir>
 #include <QFileInfo>
-#include <QPoint>
-#include <QSize>
-
 #include <QString>
 #include <QStringList>
 #include <QVector>
+#include <algorithm>
 #include <optional>
 
 struct SubtitleInfo {
@@ -21,56 +22,46 @@ struct IntroOutroInfo {
     QString thumbnailPath;
 };
 
-struct AudioSettings {
-    QString codec; // AAC, FLAC
-    int bitrateKbps = 192;
-    QString preferredTrackId;
-    float volumeSource = 1.0f;
-    float volumeIntro = 1.0f;
-    float volumeOutro = 1.0f;
-};
-
-struct VideoSettings {
-    QString encoder; // x264, x265, etc
-    QString preset;
-    double qualityValue = 20.0; // CRF or CQ
-    QString resizeMode; // None, 1080p, etc
-    QSize customSize;
-};
-
-struct LogoSettings {
-    QString imagePath;
-    QString placement; // corners / custom
-    QPoint customPosition;
-    float opacity = 1.0f;
-    QString visibility; // always, intro, outro, timed
-    int visibleDuration = 0;
-    int visibleInterval = 0;
-};
-
 struct CutSettings {
     bool enabled = false;
     QString startTime;
     QString endTime;
 };
 
+// Bitrate limits resolved by the size-budget planner; all zero means quality-based rate control.
+struct RateControl {
+    int bitrateKbps = 0; // average target; replaces CRF/CQ when set
+    int maxrateKbps = 0;
+    int bufsizeKbps = 0;
+    bool twoPass = false;
+};
+
 struct EncodeJob {
+    quint64 id = 0;
     QString videoPath;
     QString subtitlePath;
     SubtitleInfo subtitleInfo;
     QStringList additionalSubtitles;
+    QStringList fontAttachments; // font files muxed into MKV outputs
+    int subtitleComplexity = -1; // DurationModel::SubtitleComplexity of subtitlePath; -1 until computed
     IntroOutroInfo introOutroInfo;
-    AudioSettings audioSettings;
-    VideoSettings videoSettings;
-    LogoSettings logoSettings;
+    EncodeProfile profile; // video, audio and logo settings, shared between jobs until edited
     CutSettings cutSettings;
     QString rendererMode = QStringLiteral("Auto");
     bool telegramMode = false;
+    qint64 maxOutputBytes = 0; // size budget; 0 disables it
+    RateControl rateControl;
     QString outputFile;
     QString globalOutputFolder;
+    QStringList postEncodeHooks; // command lines run on the host after a successful encode
     qint64 durationMs = 0;
+    int sourceHeight = 0;
+    double sourceFrameRate = 0.0;
 
     QString resolvedOutputPath() const;
+    qint64 effectiveDurationMs() const;
+    // Whether fontAttachments apply: a burned-in subtitle and an MKV output.
+    bool canAttachFonts() const;
 };
 
 inline QString EncodeJob::resolvedOutputPath() const
@@ -93,3 +84,32 @@ inline QString EncodeJob::resolvedOutputPath() const
     QString extension = telegramMode ? QStringLiteral(".mp4") : QStringLiteral(".mkv");
     return QDir(fi.absolutePath()).filePath(fi.completeBaseName() + extension);
 }
+
+inline bool EncodeJob::canAttachFonts() const
+{
+    return !subtitlePath.isEmpty() && QFileInfo(resolvedOutputPath()).suffix().compare(QLatin1String("mkv"), Qt::CaseInsensitive) == 0;
+}
+
+inline qint64 EncodeJob::effectiveDurationMs() const
+{
+    if (!cutSettings.enabled) {
+        return durationMs;
+    }
+
+    // Mirrors how Encoder turns the cut into -ss/-t/-to arguments.
+    double startSeconds = 0.0;
+    double endSeconds = 0.0;
+    const bool hasStart = parseTimeToSeconds(cutSettings.startTime, startSeconds) && startSeconds > 0.0;
+    const bool hasEnd = parseTimeToSeconds(cutSettings.endTime, endSeconds) && endSeconds > 0.0;
+
+    const qint64 startMs = hasStart ? static_cast<qint64>(startSeconds * 1000.0) : 0;
+    qint64 endMs = durationMs;
+    if (hasEnd && (!hasStart || endSeconds > startSeconds)) {
+        const qint64 cutEndMs = static_cast<qint64>(endSeconds * 1000.0);
+        endMs = durationMs > 0 ? std::min(cutEndMs, durationMs) : cutEndMs;
+    }
+    if (endMs <= 0) {
+        return 0;
+    }
+    return std::max<qint64>(endMs - startMs, 0);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <QPoint>
+#include <QSharedData>
+#include <QSharedDataPointer>
+#include <QSize>
+#include <QString>
+#include <QStringList>
+
+struct AudioSettings {
+    QString codec; // AAC, FLAC
+    int bitrateKbps = 192;
+    QString preferredTrackId;
+    float volumeSource = 1.0f;
+    float volumeIntro = 1.0f;
+    float volumeOutro = 1.0f;
+};
+
+struct VideoSettings {
+    QString encoder; // x264, x265, etc
+    QString preset;
+    double qualityValue = 20.0; // CRF or CQ
+    QString targetMetric; // empty for a fixed quality value; ssim, psnr or vmaf picks it by search
+    double targetValue = 0.0;
+    QString resizeMode; // None, 1080p, etc
+    QSize customSize;
+    int threads = 0; // encoder thread budget; 0 lets ffmpeg decide
+};
+
+struct LogoSettings {
+    QString imagePath;
+    QString placement; // corners / custom
+    QPoint customPosition;
+    float opacity = 1.0f;
+    QString visibility; // always, intro, outro, timed
+    int visibleDuration = 0;
+    int visibleInterval = 0;
+};
+
+// Video, audio and logo settings as one implicitly shared value. Copies share a
+// single block until one of them is edited, so every job queued with the same
+// tab settings or named profile costs a pointer, and a per-job override
+// detaches only that job. Saved profiles carry their name and post-encode hooks;
+// tab settings have neither.
+class EncodeProfile
+{
+public:
+    EncodeProfile()
+        : d(new Data)
+    {
+    }
+
+    EncodeProfile(const VideoSettings &video, const AudioSettings &audio, const LogoSettings &logo)
+        : d(new Data)
+    {
+        d->video = video;
+        d->audio = audio;
+        d->logo = logo;
+    }
+
+    [[nodiscard]] const VideoSettings &video() const noexcept { return d->video; }
+    [[nodiscard]] const AudioSettings &audio() const noexcept { return d->audio; }
+    [[nodiscard]] const LogoSettings &logo() const noexcept { return d->logo; }
+    [[nodiscard]] const QString &name() const noexcept { return d->name; }
+    [[nodiscard]] const QStringList &postEncodeHooks() const noexcept { return d->postEncodeHooks; }
+
+    // Detach from other holders before returning a writable reference.
+    [[nodiscard]] VideoSettings &editVideo() { return d->video; }
+    [[nodiscard]] AudioSettings &editAudio() { return d->audio; }
+    [[nodiscard]] LogoSettings &editLogo() { return d->logo; }
+    void setName(const QString &name) { d->name = name; }
+    void setPostEncodeHooks(const QStringList &hooks) { d->postEncodeHooks = hooks; }
+
+    [[nodiscard]] bool isSharedWith(const EncodeProfile &other) const noexcept { return d.constData() == other.d.constData(); }
+
+private:
+    struct Data : QSharedData {
+        QString name;
+        QStringList postEncodeHooks;
+        VideoSettings video;
+        AudioSettings audio;
+        LogoSettings logo;
+    };
+
+    QSharedDataPointer<Data> d;
+};
@@ -1,73 +1,42 @@
 #include "Encoder.h"
 
+#include "AssFontScanner.h"
+#include "DurationModel.h"
+#include "FfmpegLocator.h"
+#include "FontIndex.h"
+#include "MediaProbe.h"
+#include "ProcessStats.h"
+#include "SizeBudget.h"
+#include "TimeUtils.h"
+
 #include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDateTime>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
+#include <QPointer>
 #include <QProcessEnvironment>
-#include <QRegularExpression>
 #include <QStringList>
+#include <QThreadPool>
 #include <QtGlobal>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <utility>
 
-namespace {
-QString formatTimecode(qint64 ms)
-{
-    if (ms <= 0) {
-        return QStringLiteral("00:00:00");
-    }
-    const qint64 totalSeconds = ms / 1000;
-    const qint64 hours = totalSeconds / 3600;
-    const int minutes = static_cast<int>((totalSeconds % 3600) / 60);
-    const int seconds = static_cast<int>(totalSeconds % 60);
-    return QStringLiteral("%1:%2:%3")
-        .arg(hours, 2, 10, QLatin1Char('0'))
-        .arg(minutes, 2, 10, QLatin1Char('0'))
-        .arg(seconds, 2, 10, QLatin1Char('0'));
-}
-
-QString formatSeconds(double seconds)
-{
-    if (seconds < 0.0) {
-        seconds = 0.0;
-    }
-    return QString::number(seconds, 'f', seconds >= 10.0 ? 2 : 3);
-}
-
-bool parseTimeToSeconds(const QString &text, double &secondsOut)
-{
-    const QString trimmed = text.trimmed();
-    if (trimmed.isEmpty()) {
-        return false;
-    }
-
-    bool ok = false;
-    double numeric = trimmed.toDouble(&ok);
-    if (ok) {
-        secondsOut = numeric;
-        return true;
-    }
-
-    const QStringList parts = trimmed.split(QLatin1Char(':'));
-    if (parts.isEmpty()) {
-        return false;
-    }
-
-    double multiplier = 1.0;
-    double total = 0.0;
-    for (int i = parts.size() - 1; i >= 0; --i) {
-        const double value = parts.at(i).toDouble(&ok);
-        if (!ok) {
-            return false;
-        }
-        total += value * multiplier;
-        multiplier *= 60.0;
-    }
-    secondsOut = total;
-    return true;
-}
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <signal.h>
+#include <sys/types.h>
+#endif
 
+namespace {
 QString sanitizeFilterPath(const QString &path)
 {
     QString sanitized = QDir::toNativeSeparators(path);
@@ -76,81 +45,48 @@ QString sanitizeFilterPath(const QString &path)
     return sanitized;
 }
 
-QString videoCodecForJob(const EncodeJob &job)
+bool suspendProcess(qint64 pid, bool suspend)
 {
-    if (job.telegramMode) {
-        return QStringLiteral("libx264");
-    }
-    const QString encoder = job.videoSettings.encoder.toLower();
-    if (encoder == QLatin1String("x265")) {
-        return QStringLiteral("libx265");
+    if (pid <= 0) {
+        return false;
     }
-    if (encoder == QLatin1String("qsv")) {
-        return QStringLiteral("h264_qsv");
+#if defined(Q_OS_WIN)
+    using NtProcessFunction = LONG(NTAPI *)(HANDLE);
+    HMODULE ntdll = GetModuleHandleW(L"ntdll.dll");
+    if (!ntdll) {
+        return false;
     }
-    if (encoder == QLatin1String("nvenc")) {
-        return QStringLiteral("h264_nvenc");
+    const auto function = reinterpret_cast<NtProcessFunction>(
+        GetProcAddress(ntdll, suspend ? "NtSuspendProcess" : "NtResumeProcess"));
+    if (!function) {
+        return false;
     }
-    if (encoder == QLatin1String("amd")) {
-        return QStringLiteral("h264_amf");
+    HANDLE process = OpenProcess(PROCESS_SUSPEND_RESUME, FALSE, static_cast<DWORD>(pid));
+    if (!process) {
+        return false;
     }
-    return QStringLiteral("libx264");
+    const bool ok = function(process) >= 0;
+    CloseHandle(process);
+    return ok;
+#elif defined(Q_OS_UNIX)
+    return ::kill(static_cast<pid_t>(pid), suspend ? SIGSTOP : SIGCONT) == 0;
+#else
+    Q_UNUSED(suspend);
+    return false;
+#endif
 }
 
-QString presetForJob(const EncodeJob &job)
+void removePassLogs(const QString &prefix)
 {
-    const QString encoder = job.videoSettings.encoder.toLower();
-    const QString preset = job.videoSettings.preset;
-
-    if (encoder == QLatin1String("nvenc")) {
-        if (preset == QLatin1String("veryslow") || preset == QLatin1String("slower")) {
-            return QStringLiteral("p1");
-        }
-        if (preset == QLatin1String("slow")) {
-            return QStringLiteral("p2");
-        }
-        if (preset == QLatin1String("medium")) {
-            return QStringLiteral("p4");
-        }
-        if (preset == QLatin1String("fast")) {
-            return QStringLiteral("p5");
-        }
-        if (preset == QLatin1String("faster")) {
-            return QStringLiteral("p6");
-        }
-        if (preset == QLatin1String("veryfast")) {
-            return QStringLiteral("p7");
-        }
-        return QStringLiteral("p4");
-    }
-
-    if (encoder == QLatin1String("amd")) {
-        if (preset == QLatin1String("veryslow") || preset == QLatin1String("slower") || preset == QLatin1String("slow")) {
-            return QStringLiteral("quality");
-        }
-        if (preset == QLatin1String("medium") || preset == QLatin1String("fast")) {
-            return QStringLiteral("balanced");
-        }
-        return QStringLiteral("speed");
+    if (prefix.isEmpty()) {
+        return;
     }
-
-    if (encoder == QLatin1String("qsv")) {
-        if (preset == QLatin1String("veryslow") || preset == QLatin1String("slower")) {
-            return QStringLiteral("veryslow");
-        }
-        if (preset == QLatin1String("slow")) {
-            return QStringLiteral("slow");
-        }
-        if (preset == QLatin1String("fast")) {
-            return QStringLiteral("fast");
-        }
-        if (preset == QLatin1String("faster") || preset == QLatin1String("veryfast")) {
-            return QStringLiteral("veryfast");
-        }
-        return QStringLiteral("medium");
+    const QFileInfo info(prefix);
+    QDir dir = info.absoluteDir();
+    const QStringList logs = dir.entryList({info.fileName() + QLatin1Char('*')}, QDir::Files);
+    for (const QString &log : logs) {
+        dir.remove(log);
     }
-
-    return preset.isEmpty() ? QStringLiteral("medium") : preset;
 }
 
 QStringList quoteArguments(const QStringList &args)
@@ -168,14 +104,175 @@ QStringList quoteArguments(const QStringList &args)
     }
     return quoted;
 }
+
+// ffmpeg's levels, most severe first, as tagged by -loglevel level+<level>.
+enum class LogSeverity {
+    Fatal,
+    Error,
+    Warning,
+    Info,
+    Verbose,
+    Debug
+};
+
+struct LogLine {
+    LogSeverity severity = LogSeverity::Warning;
+    QByteArray text; // the line without its level tag
+};
+
+// The tag follows an optional "[context @ 0x...]" prefix. Untagged lines (builds
+// without level+ support, continuation lines of multi-line messages) count as
+// info: they still go to the job log, but only tagged warnings reach the log view.
+LogLine classifyLogLine(const QByteArray &line)
+{
+    static const std::pair<QByteArrayView, LogSeverity> kLevels[] = {
+        {"panic", LogSeverity::Fatal},
+        {"fatal", LogSeverity::Fatal},
+        {"error", LogSeverity::Error},
+        {"warning", LogSeverity::Warning},
+        {"info", LogSeverity::Info},
+        {"verbose", LogSeverity::Verbose},
+        {"debug", LogSeverity::Debug},
+        {"trace", LogSeverity::Debug},
+    };
+    qsizetype open = 0;
+    for (int group = 0; group < 2 && line.size() > open && line.at(open) == '['; ++group) {
+        const qsizetype close = line.indexOf(']', open);
+        if (close < 0) {
+            break;
+        }
+        const QByteArrayView tag = QByteArrayView(line).sliced(open + 1, close - open - 1);
+        for (const auto &[name, severity] : kLevels) {
+            if (tag == name) {
+                const qsizetype end = close + 1 < line.size() && line.at(close + 1) == ' ' ? close + 2 : close + 1;
+                return {severity, QByteArray(line).remove(open, end - open)};
+            }
+        }
+        open = close + 1;
+        while (open < line.size() && line.at(open) == ' ') {
+            ++open;
+        }
+    }
+    return {LogSeverity::Info, line};
+}
+
+// Matroska players look fonts up by attachment MIME type.
+QString fontMimeType(const QString &path)
+{
+    return QFileInfo(path).suffix().compare(QLatin1String("otf"), Qt::CaseInsensitive) == 0
+        ? QStringLiteral("application/vnd.ms-opentype")
+        : QStringLiteral("application/x-truetype-font");
+}
+
+// What the output cache key covers; collected on the UI thread, hashed on the pool.
+struct CacheKeyRequest {
+    QStringList plan;   // ffmpeg arguments with every path replaced by a placeholder
+    QStringList inputs; // sampled: sources can be many GiB
+    QStringList files;  // hashed whole: attached fonts and the subtitle
+    QString container;
+    QString ffmpegPath;
+};
+
+CacheKeyRequest cacheKeyRequest(const EncodeJob &job, const QStringList &arguments, const QString &ffmpegPath)
+{
+    // The plan is made location-independent: inputs, attachments, subtitle and output
+    // paths are covered by content hashes or the container suffix instead.
+    CacheKeyRequest request;
+    request.plan = arguments;
+    if (!request.plan.isEmpty()) {
+        request.plan.removeLast();
+    }
+    for (int i = 0; i + 1 < request.plan.size(); ++i) {
+        const QString &option = request.plan.at(i);
+        if (option == QLatin1String("-i")) {
+            request.inputs << request.plan.at(i + 1);
+            request.plan[++i] = QStringLiteral("<input%1>").arg(request.inputs.size());
+        } else if (option == QLatin1String("-attach")) {
+            request.files << request.plan.at(i + 1);
+            request.plan[++i] = QStringLiteral("<attachment%1>").arg(request.files.size());
+        } else if (option == QLatin1String("-passlogfile")) {
+            request.plan[++i] = QStringLiteral("<passlog>");
+        }
+    }
+    // Verbosity does not change the output.
+    const int logLevelIndex = request.plan.indexOf(QStringLiteral("-loglevel"));
+    if (logLevelIndex >= 0 && logLevelIndex + 1 < request.plan.size()) {
+        request.plan.remove(logLevelIndex, 2);
+    }
+    if (!job.subtitlePath.isEmpty()) {
+        request.files << job.subtitlePath;
+        const QString subtitleToken = sanitizeFilterPath(job.subtitlePath);
+        for (QString &argument : request.plan) {
+            argument.replace(subtitleToken, QStringLiteral("<subtitle>"));
+        }
+    }
+    request.container = QFileInfo(job.resolvedOutputPath()).suffix().toLower();
+    request.ffmpegPath = ffmpegPath;
+    return request;
+}
+
+// Empty when an input cannot be read; such a job is simply not cached.
+QByteArray outputCacheKey(const CacheKeyRequest &request)
+{
+    if (request.inputs.isEmpty()) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    hash.addData(QByteArrayLiteral("niseyuki-output-cache-v2"));
+    for (const QString &input : request.inputs) {
+        const QByteArray inputHash = OutputCache::sampledFileHash(input);
+        if (inputHash.isEmpty()) {
+            return QByteArray();
+        }
+        hash.addData(inputHash);
+    }
+    for (const QString &file : request.files) {
+        const QByteArray fileHash = OutputCache::fileHash(file);
+        if (fileHash.isEmpty()) {
+            return QByteArray();
+        }
+        hash.addData(fileHash);
+    }
+    hash.addData(request.plan.join(QChar(0)).toUtf8());
+    hash.addData(request.container.toUtf8());
+    // A different ffmpeg build can produce different bytes from the same plan.
+    const QFileInfo ffmpeg(request.ffmpegPath);
+    hash.addData(QByteArray::number(ffmpeg.size()));
+    hash.addData(QByteArray::number(ffmpeg.lastModified().toMSecsSinceEpoch()));
+    return hash.result();
+}
 } // namespace
 
 Encoder::Encoder(QObject *parent)
     : QObject(parent)
 {
-    connect(&m_process, &QProcess::readyReadStandardError, this, &Encoder::handleProcessOutput);
-    connect(&m_process, &QProcess::readyReadStandardOutput, this, &Encoder::handleProcessOutput);
+    connect(&m_process, &QProcess::readyReadStandardError, this, &Encoder::handleLogOutput);
+    connect(&m_process, &QProcess::readyReadStandardOutput, this, &Encoder::handleProgressOutput);
     connect(&m_process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &Encoder::handleProcessFinished);
+    connect(&m_indexer, &SourceIndexer::progressChanged, this, [this](double progress) {
+        if (m_state == State::Indexing) {
+            m_statusText = tr("Indexing %1%").arg(QString::number(progress * 100.0, 'f', 0));
+            emit statusTextChanged(m_statusText);
+        }
+    });
+    connect(&m_indexer, &SourceIndexer::finished, this, &Encoder::onIndexFinished);
+    connect(&m_crfSearch, &CrfSearch::statusChanged, this, [this](const QString &text) {
+        if (m_state == State::Indexing) {
+            m_statusText = text;
+            emit statusTextChanged(m_statusText);
+        }
+    });
+    connect(&m_crfSearch, &CrfSearch::messageReceived, this, &Encoder::messageReceived);
+    connect(&m_crfSearch, &CrfSearch::finished, this, &Encoder::onCrfSearchFinished);
+    connect(&m_sizePlanner, &SizeBudgetPlanner::statusChanged, this, [this](const QString &text) {
+        if (m_state == State::Indexing) {
+            m_statusText = text;
+            emit statusTextChanged(m_statusText);
+        }
+    });
+    connect(&m_sizePlanner, &SizeBudgetPlanner::messageReceived, this, &Encoder::messageReceived);
+    connect(&m_sizePlanner, &SizeBudgetPlanner::finished, this, &Encoder::onSizePlanFinished);
+    connect(&m_publisher, &OutputPublisher::finished, this, &Encoder::onPublishFinished);
 }
 
 void Encoder::startEncoding(const EncodeJob &job)
@@ -189,44 +286,313 @@ void Encoder::startEncoding(const EncodeJob &job)
     m_statusText = tr("Indexing");
     m_state = State::Indexing;
     m_totalDurationMs = 0;
+    m_telemetry = JobTelemetry();
+    m_sourceIndex = SourceIndex();
+    m_wallTimer.invalidate();
+    m_qualityResolved = false;
+    m_sizePlanned = false;
+    m_fontsResolved = false;
+    m_pass = 0;
     emit stateChanged(m_state);
     emit progressChanged(m_progress);
     emit statusTextChanged(m_statusText);
 
-    m_ffmpegPath = resolveFfmpegExecutable();
+    m_ffmpegPath = locateFfmpeg();
     if (m_ffmpegPath.isEmpty()) {
         emitWarning(tr("Unable to locate bundled ffmpeg executable."));
-        m_state = State::Idle;
-        emit stateChanged(m_state);
-        emit finished(false);
+        finishWithoutProcess(false, tr("Failed"));
         return;
     }
 
-    m_ffprobePath = resolveFfprobeExecutable();
-    if (m_currentJob.durationMs > 0) {
-        m_totalDurationMs = m_currentJob.durationMs;
-    } else if (!m_ffprobePath.isEmpty()) {
-        m_totalDurationMs = probeDurationMs(m_currentJob.videoPath, m_ffprobePath);
-        m_currentJob.durationMs = m_totalDurationMs;
-    } else {
-        emitWarning(tr("ffprobe not found; progress percentage may be limited."));
+    applyCapabilityFallbacks();
+
+    m_ffprobePath = locateFfprobe();
+    if (m_currentJob.durationMs <= 0) {
+        if (!m_ffprobePath.isEmpty()) {
+            QString probeError;
+            const MediaInfo info = MediaProbe::probeBlocking(m_ffprobePath, m_currentJob.videoPath, 8000, &probeError);
+            if (!probeError.isEmpty()) {
+                emitWarning(probeError);
+            }
+            m_currentJob.durationMs = info.durationMs;
+            if (info.height > 0) {
+                m_currentJob.sourceHeight = info.height;
+            }
+            if (info.frameRate > 0.0) {
+                m_currentJob.sourceFrameRate = info.frameRate;
+            }
+        } else {
+            emitWarning(tr("ffprobe not found; progress percentage may be limited."));
+        }
+    }
+    // Progress and ETA are measured against what will actually be encoded, so cuts count.
+    m_totalDurationMs = m_currentJob.effectiveDurationMs();
+    m_eta.reset(m_totalDurationMs);
+
+    if (m_sourceIndexingEnabled && !m_ffprobePath.isEmpty()) {
+        m_sourceIndex = SourceIndex::load(m_currentJob.videoPath);
+        if (!m_sourceIndex.isValid()) {
+            emit messageReceived(tr("Building frame index for %1").arg(QDir::toNativeSeparators(m_currentJob.videoPath)));
+            m_indexer.start(m_ffprobePath, m_currentJob.videoPath, m_currentJob.durationMs);
+            return;
+        }
+        emit messageReceived(tr("Loaded frame index: %n frame(s)", nullptr, m_sourceIndex.frameCount()));
+    }
+    prepareAndLaunch();
+}
+
+void Encoder::applyCapabilityFallbacks()
+{
+    if (!m_capabilities.valid || QFileInfo(m_capabilities.ffmpegPath) != QFileInfo(m_ffmpegPath)) {
+        return;
+    }
+    const QString codec = videoCodecForJob(m_currentJob);
+    if (!m_capabilities.hasEncoder(codec) && m_capabilities.hasEncoder(QStringLiteral("libx264"))) {
+        emitWarning(tr("%1 is not available with this ffmpeg build or hardware; encoding with libx264.").arg(codec));
+        m_currentJob.profile.editVideo().encoder = QStringLiteral("x264");
+    }
+    if (m_currentJob.profile.video().targetMetric == QLatin1String("vmaf") && !m_capabilities.hasFilter(QStringLiteral("libvmaf"))) {
+        emitWarning(tr("This ffmpeg build has no libvmaf; encoding at CRF %1 instead of searching for VMAF %2.")
+                        .arg(m_currentJob.profile.video().qualityValue, 0, 'f', 1)
+                        .arg(m_currentJob.profile.video().targetValue));
+        m_currentJob.profile.editVideo().targetMetric.clear();
     }
+}
 
+void Encoder::onIndexFinished(const SourceIndex &index, const QString &errorMessage)
+{
+    if (m_state != State::Indexing && m_state != State::Paused) {
+        return;
+    }
+    if (!errorMessage.isEmpty()) {
+        emitWarning(errorMessage);
+    }
+    m_sourceIndex = index;
+    if (m_sourceIndex.isValid()) {
+        emit messageReceived(tr("Indexed %n frame(s)", nullptr, m_sourceIndex.frameCount())
+                             + tr(", %n keyframe(s)", nullptr, m_sourceIndex.keyframeCount()));
+        if (m_currentJob.durationMs <= 0 && m_sourceIndex.durationUs() > 0) {
+            m_currentJob.durationMs = m_sourceIndex.durationUs() / 1000;
+            m_totalDurationMs = m_currentJob.effectiveDurationMs();
+            m_eta.reset(m_totalDurationMs);
+        }
+    }
+    if (m_state == State::Paused) {
+        // Resumed later by resumeEncoding().
+        return;
+    }
+    m_statusText = tr("Indexing");
+    emit statusTextChanged(m_statusText);
+    prepareAndLaunch();
+}
+
+void Encoder::prepareAndLaunch()
+{
+    // Each preparation step finishes asynchronously and comes back here for the next one.
+    if (m_fontCatalog && !m_fontsResolved && m_currentJob.fontAttachments.isEmpty() && m_currentJob.canAttachFonts()) {
+        m_fontsResolved = true;
+        resolveFontAttachments();
+        return;
+    }
+    if (!m_currentJob.profile.video().targetMetric.isEmpty() && !m_qualityResolved) {
+        m_qualityResolved = true;
+        if (m_crfSearch.start(m_currentJob)) {
+            return;
+        }
+        emitWarning(tr("Quality target %1 %2 is not usable; encoding at CRF %3.")
+                        .arg(m_currentJob.profile.video().targetMetric)
+                        .arg(m_currentJob.profile.video().targetValue)
+                        .arg(m_currentJob.profile.video().qualityValue, 0, 'f', 1));
+    }
+    if (m_currentJob.maxOutputBytes > 0 && !m_sizePlanned) {
+        m_sizePlanned = true;
+        if (m_sizePlanner.start(m_currentJob)) {
+            return;
+        }
+        // An output over the budget is useless for the upload it is meant for.
+        emitWarning(tr("The size budget could not be planned."));
+        finishWithoutProcess(false, tr("Failed"));
+        return;
+    }
+    launchFfmpeg();
+}
+
+void Encoder::resolveFontAttachments()
+{
+    // The queue resolves fonts ahead of time; this covers jobs started before it got to them.
+    m_prepareTaskRunning = true;
+    m_statusText = tr("Resolving subtitle fonts");
+    emit statusTextChanged(m_statusText);
+    const quint64 generation = ++m_prepareTaskGeneration;
+    QThreadPool::globalInstance()->start([self = QPointer<Encoder>(this), generation, catalog = m_fontCatalog,
+                                          subtitlePath = m_currentJob.subtitlePath]() {
+        const QStringList fonts = AssFontScanner::fontFiles(AssFontScanner::resolve(AssFontScanner::scan(subtitlePath), *catalog));
+        if (!self) {
+            return;
+        }
+        QMetaObject::invokeMethod(self, [self, generation, fonts]() {
+            if (!self || generation != self->m_prepareTaskGeneration || self->m_state != State::Indexing) {
+                return;
+            }
+            self->m_prepareTaskRunning = false;
+            self->m_currentJob.fontAttachments = fonts;
+            self->prepareAndLaunch();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void Encoder::onCrfSearchFinished(double quality, const QString &errorMessage)
+{
+    if (m_state != State::Indexing) {
+        return;
+    }
+    if (quality < 0.0) {
+        emitWarning(tr("CRF search failed: %1").arg(errorMessage));
+        finishWithoutProcess(false, tr("Failed"));
+        return;
+    }
+    m_currentJob.profile.editVideo().qualityValue = quality;
+    prepareAndLaunch();
+}
+
+void Encoder::onSizePlanFinished(const SizePlan &plan)
+{
+    if (m_state != State::Indexing) {
+        return;
+    }
+    m_currentJob.rateControl = plan.rateControl;
+    prepareAndLaunch();
+}
+
+void Encoder::finishWithoutProcess(bool success, const QString &statusText)
+{
+    m_jobLog.close();
+    m_cacheKey.clear();
+    removePassLogs(m_passLogPrefix);
+    m_passLogPrefix.clear();
+    m_pass = 0;
+    if (!m_stagingPath.isEmpty()) {
+        QFile::remove(m_stagingPath);
+        m_stagingPath.clear();
+    }
+    m_state = State::Idle;
+    m_progress = 0.0;
+    m_statusText = statusText;
+    m_ffmpegPath.clear();
+    m_ffprobePath.clear();
+    m_totalDurationMs = 0;
+    emit stateChanged(m_state);
+    emit progressChanged(m_progress);
+    emit statusTextChanged(m_statusText);
+    emit finished(success);
+}
+
+void Encoder::launchFfmpeg()
+{
     if (!m_currentJob.introOutroInfo.introPath.isEmpty() || !m_currentJob.introOutroInfo.outroPath.isEmpty()) {
         emitWarning(tr("Intro/outro stitching is not implemented yet and will be ignored."));
     }
     if (!m_currentJob.introOutroInfo.thumbnailPath.isEmpty()) {
         emitWarning(tr("Thumbnail injection is not implemented yet and will be ignored."));
     }
-    if (!m_currentJob.logoSettings.imagePath.isEmpty()) {
+    if (!m_currentJob.profile.logo().imagePath.isEmpty()) {
         emitWarning(tr("Logo overlay is not implemented yet and will be ignored."));
     }
     if (!m_currentJob.additionalSubtitles.isEmpty()) {
         emitWarning(tr("Additional subtitle tracks are not implemented yet and will be ignored."));
     }
 
-    const QStringList args = buildFfmpegArguments(m_currentJob);
+    const QString finalPath = m_currentJob.resolvedOutputPath();
+    // ffmpeg writes to a staging file; the final path only ever sees a complete output.
+    m_stagingPath = OutputPublisher::stagingPath(finalPath, m_scratchDirectory);
+    QDir().mkpath(QFileInfo(m_stagingPath).absolutePath());
+
+    const QString container = QFileInfo(finalPath).suffix().toLower();
+    const bool mp4 = container == QLatin1String("mp4") || container == QLatin1String("m4v") || container == QLatin1String("mov");
+    m_moovReserveBytes = m_moovReservationEnabled && m_currentJob.telegramMode && mp4
+        ? moovReserveBytes(m_currentJob, m_sourceIndex)
+        : 0;
+    m_moovTooSmall = false;
+
+    const bool twoPass = m_currentJob.rateControl.twoPass;
+    if (twoPass) {
+        const QString logDir = m_scratchDirectory.isEmpty() ? QDir::tempPath() : m_scratchDirectory;
+        m_passLogPrefix = QDir(logDir).filePath(QStringLiteral("niseyuki-2pass-%1-%2")
+                                                              .arg(QCoreApplication::applicationPid())
+                                                              .arg(reinterpret_cast<quintptr>(this), 0, 16));
+    }
+    const QStringList args = buildFfmpegArguments(m_currentJob, twoPass ? 2 : 0);
+    if (m_outputCacheEnabled) {
+        resolveCacheKey(args);
+        return;
+    }
+    startFfmpeg(args);
+}
+
+void Encoder::resolveCacheKey(const QStringList &args)
+{
+    // Hashing reads a few MiB of every input; it stays off the UI thread like the other preparation steps.
+    m_prepareTaskRunning = true;
+    m_statusText = tr("Checking output cache");
+    emit statusTextChanged(m_statusText);
+    const quint64 generation = ++m_prepareTaskGeneration;
+    QThreadPool::globalInstance()->start([self = QPointer<Encoder>(this), generation, args,
+                                          request = cacheKeyRequest(m_currentJob, args, m_ffmpegPath)]() {
+        const QByteArray key = outputCacheKey(request);
+        if (!self) {
+            return;
+        }
+        QMetaObject::invokeMethod(self, [self, generation, args, key]() {
+            if (!self || generation != self->m_prepareTaskGeneration || self->m_state != State::Indexing) {
+                return;
+            }
+            self->m_prepareTaskRunning = false;
+            self->m_cacheKey = key;
+            if (!key.isEmpty() && self->reuseCachedOutput(key)) {
+                return;
+            }
+            self->startFfmpeg(args);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void Encoder::startFfmpeg(const QStringList &args)
+{
+    const QString finalPath = m_currentJob.resolvedOutputPath();
+    const bool twoPass = m_currentJob.rateControl.twoPass;
+
+    // Checked up front: a full disk should not surface hours into the encode.
+    const qint64 predictedBytes = predictedOutputBytes(m_currentJob);
+    QString spaceError;
+    bool enoughSpace = OutputPublisher::hasSpaceFor(m_stagingPath, predictedBytes, &spaceError);
+    if (enoughSpace && !OutputPublisher::sameVolume(m_stagingPath, finalPath)) {
+        enoughSpace = OutputPublisher::hasSpaceFor(finalPath, predictedBytes, &spaceError);
+    }
+    if (!enoughSpace) {
+        emitWarning(tr("Not enough disk space: %1").arg(spaceError));
+        finishWithoutProcess(false, tr("Failed"));
+        return;
+    }
+    if (!m_scratchDirectory.isEmpty()) {
+        emit messageReceived(tr("Staging output in %1").arg(QDir::toNativeSeparators(m_stagingPath)));
+    }
+    openJobLog();
+
+    if (twoPass) {
+        // Progress and ETA cover both passes.
+        m_pass = 1;
+        m_eta.reset(2 * m_totalDurationMs);
+        startProcess(buildFfmpegArguments(m_currentJob, 1));
+    } else {
+        startProcess(args);
+    }
+}
 
+void Encoder::startProcess(const QStringList &args)
+{
+    m_lastReportMs = -1;
+    m_stdoutBuffer.clear();
+    m_stderrBuffer.clear();
     m_process.setProgram(m_ffmpegPath);
     m_process.setArguments(args);
     m_process.setProcessChannelMode(QProcess::SeparateChannels);
@@ -234,15 +600,21 @@ void Encoder::startEncoding(const EncodeJob &job)
     m_process.start();
     if (!m_process.waitForStarted(5000)) {
         emitWarning(tr("Failed to start ffmpeg: %1").arg(m_process.errorString()));
-        m_state = State::Idle;
-        emit stateChanged(m_state);
-        emit finished(false);
+        finishWithoutProcess(false, tr("Failed"));
         return;
     }
 
+    // A second pass or a faststart re-run adds to the telemetry of the job's first process.
+    if (!m_wallTimer.isValid()) {
+        beginTelemetry();
+    }
+    m_exitStats.begin(m_process.processId());
+
     QStringList printableArgs = args;
     printableArgs.prepend(QDir::toNativeSeparators(m_ffmpegPath));
-    emit messageReceived(tr("Starting ffmpeg: %1").arg(quoteArguments(printableArgs).join(QLatin1Char(' '))));
+    const QString commandLine = quoteArguments(printableArgs).join(QLatin1Char(' '));
+    m_jobLog.append("$ " + commandLine.toUtf8());
+    emit messageReceived(tr("Starting ffmpeg: %1").arg(commandLine));
 }
 
 void Encoder::stopEncoding()
@@ -251,6 +623,40 @@ void Encoder::stopEncoding()
         return;
     }
 
+    if (m_indexer.isRunning()) {
+        m_indexer.cancel();
+        emit messageReceived(tr("Indexing cancelled"));
+        finishWithoutProcess(false, tr("Stopped"));
+        return;
+    }
+    if (m_crfSearch.isRunning()) {
+        m_crfSearch.cancel();
+        emit messageReceived(tr("CRF search cancelled"));
+        finishWithoutProcess(false, tr("Stopped"));
+        return;
+    }
+    if (m_sizePlanner.isRunning()) {
+        m_sizePlanner.cancel();
+        emit messageReceived(tr("Size planning cancelled"));
+        finishWithoutProcess(false, tr("Stopped"));
+        return;
+    }
+    if (m_prepareTaskRunning) {
+        // The background step itself is left to finish; its result is dropped.
+        m_prepareTaskRunning = false;
+        ++m_prepareTaskGeneration;
+        finishWithoutProcess(false, tr("Stopped"));
+        return;
+    }
+    if (m_state == State::Paused && m_process.state() == QProcess::NotRunning) {
+        // Paused between indexing and the ffmpeg launch.
+        finishWithoutProcess(false, tr("Stopped"));
+        return;
+    }
+
+    if (m_state == State::Paused) {
+        suspendProcess(m_process.processId(), false);
+    }
     m_state = State::Stopping;
     emit stateChanged(m_state);
 
@@ -262,28 +668,194 @@ void Encoder::stopEncoding()
     }
 }
 
-void Encoder::handleProcessOutput()
+bool Encoder::pauseEncoding()
 {
-    auto forwardData = [&](const QByteArray &data) {
-        const QList<QByteArray> lines = data.split('\n');
-        for (const QByteArray &line : lines) {
-            if (line.trimmed().isEmpty()) {
-                continue;
-            }
-            const bool handled = parseProgressLine(line);
-            if (!handled) {
-                emit messageReceived(QString::fromUtf8(line));
-            }
+    if (m_state != State::Encoding && m_state != State::Indexing) {
+        return false;
+    }
+    if (m_prepareTaskRunning) {
+        // Nothing to suspend; the background step is over in a moment.
+        return false;
+    }
+    if (m_crfSearch.isRunning() || m_sizePlanner.isRunning()) {
+        // Sample encodes and metric runs are many short processes; they are not suspended one by one.
+        emitWarning(tr("Sample encodes cannot be paused; stop the job instead."));
+        return false;
+    }
+    if (m_publisher.isRunning()) {
+        // The output is complete; only the copy to its final folder remains.
+        return false;
+    }
+    const qint64 pid = m_indexer.isRunning() ? m_indexer.processId() : m_process.processId();
+    if (!suspendProcess(pid, true)) {
+        emitWarning(tr("Unable to pause ffmpeg on this platform."));
+        return false;
+    }
+    m_stateBeforePause = m_state;
+    m_state = State::Paused;
+    m_statusText = tr("Paused");
+    emit stateChanged(m_state);
+    emit statusTextChanged(m_statusText);
+    return true;
+}
+
+bool Encoder::resumeEncoding()
+{
+    if (m_state != State::Paused) {
+        return false;
+    }
+    if (m_process.state() == QProcess::NotRunning && !m_indexer.isRunning()) {
+        // Indexing finished while paused; the encode has not been launched yet.
+        m_state = State::Indexing;
+        emit stateChanged(m_state);
+        prepareAndLaunch();
+        return true;
+    }
+    const qint64 pid = m_indexer.isRunning() ? m_indexer.processId() : m_process.processId();
+    if (!suspendProcess(pid, false)) {
+        emitWarning(tr("Unable to resume ffmpeg."));
+        return false;
+    }
+    m_eta.restartSampling();
+    m_state = m_stateBeforePause;
+    emit stateChanged(m_state);
+    return true;
+}
+
+void Encoder::handleProgressOutput()
+{
+    processOutput(Channel::Progress, m_process.readAllStandardOutput());
+}
+
+void Encoder::handleLogOutput()
+{
+    processOutput(Channel::Log, m_process.readAllStandardError());
+}
+
+void Encoder::processOutput(Channel channel, const QByteArray &data)
+{
+    // Pipe reads can end mid-line; the tail waits in the channel's buffer for the next read.
+    QByteArray &pending = channel == Channel::Progress ? m_stdoutBuffer : m_stderrBuffer;
+    pending.append(data);
+    qsizetype start = 0;
+    qsizetype newline = -1;
+    while ((newline = pending.indexOf('\n', start)) >= 0) {
+        const QByteArray line = QByteArrayView(pending).mid(start, newline - start).trimmed().toByteArray();
+        start = newline + 1;
+        if (line.isEmpty()) {
+            continue;
         }
-    };
+        if (channel == Channel::Progress) {
+            parseProgressLine(line);
+        } else {
+            processLogLine(line);
+        }
+    }
+    pending.remove(0, start);
+}
+
+void Encoder::flushOutput()
+{
+    processOutput(Channel::Progress, m_process.readAllStandardOutput() + '\n');
+    processOutput(Channel::Log, m_process.readAllStandardError() + '\n');
+}
+
+void Encoder::processLogLine(const QByteArray &line)
+{
+    m_jobLog.append(line);
+    if (line.contains("reserved_moov_size is too small")) {
+        m_moovTooSmall = true;
+    }
+    const LogLine entry = classifyLogLine(line);
+    if (entry.severity <= LogSeverity::Warning) {
+        emit messageReceived(QString::fromUtf8(entry.text));
+    }
+}
 
-    forwardData(m_process.readAllStandardOutput());
-    forwardData(m_process.readAllStandardError());
+void Encoder::openJobLog()
+{
+    // Sample slices start several Encoders for the same job within the same second;
+    // the per-process sequence number keeps their files apart.
+    static std::atomic<quint32> sequence{0};
+    const QString name = QStringLiteral("%1-job%2-%3-%4.log")
+                             .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-HHmmss")))
+                             .arg(m_currentJob.id)
+                             .arg(QFileInfo(m_currentJob.resolvedOutputPath()).completeBaseName())
+                             .arg(++sequence);
+    const QString path = QDir(m_jobLogDirectory).filePath(name);
+    m_jobLog.open(path);
+    emit messageReceived(tr("ffmpeg log: %1").arg(QDir::toNativeSeparators(path)));
 }
 
 void Encoder::handleProcessFinished(int exitCode, QProcess::ExitStatus status)
 {
+    flushOutput();
+    sampleExitedProcess();
     const bool success = (exitCode == 0 && status == QProcess::NormalExit);
+    if (success && m_pass == 1 && m_state != State::Stopping) {
+        m_pass = 2;
+        emit messageReceived(tr("First pass finished; starting the second pass"));
+        startProcess(buildFfmpegArguments(m_currentJob, 2));
+        return;
+    }
+    if (m_moovTooSmall && m_state != State::Stopping) {
+        // The muxer has already overwritten media data, and ffmpeg may still exit 0;
+        // only a fresh run gives a valid file.
+        emitWarning(tr("Reserved MP4 index space was too small; encoding again with faststart."));
+        m_moovReserveBytes = 0;
+        m_moovTooSmall = false;
+        startProcess(buildFfmpegArguments(m_currentJob, m_pass));
+        return;
+    }
+    if (success && m_lastReportMs >= 0 && m_wallTimer.isValid()) {
+        // The last periodic report comes right before the trailer is written.
+        m_telemetry.finalizeMs = std::max<qint64>(m_wallTimer.elapsed() - m_lastReportMs, 0);
+        QString method = tr("trailer only");
+        if (m_moovReserveBytes > 0) {
+            method = tr("index written into %1 KiB reserved up front").arg(m_moovReserveBytes / 1024);
+        } else if (m_currentJob.telegramMode) {
+            method = tr("faststart rewrite");
+        }
+        emit messageReceived(tr("Finalized output in %1 s (%2)")
+                                 .arg(m_telemetry.finalizeMs / 1000.0, 0, 'f', 1)
+                                 .arg(method));
+    }
+    removePassLogs(m_passLogPrefix);
+    m_passLogPrefix.clear();
+    m_pass = 0;
+    finalizeTelemetry(success);
+    if (success && !m_stagingPath.isEmpty()) {
+        m_statusText = tr("Publishing");
+        emit statusTextChanged(m_statusText);
+        m_publisher.publish(m_stagingPath, m_currentJob.resolvedOutputPath());
+        return;
+    }
+    completeJob(success);
+}
+
+void Encoder::onPublishFinished(bool success, const QString &errorMessage)
+{
+    if (success) {
+        m_stagingPath.clear();
+        emit messageReceived(tr("Published %1").arg(QDir::toNativeSeparators(m_currentJob.resolvedOutputPath())));
+    } else {
+        emitWarning(tr("Publishing the output failed: %1").arg(errorMessage));
+        m_telemetry.success = false;
+    }
+    completeJob(success);
+}
+
+void Encoder::completeJob(bool success)
+{
+    m_jobLog.close();
+    if (!m_stagingPath.isEmpty()) {
+        QFile::remove(m_stagingPath);
+        m_stagingPath.clear();
+    }
+    if (success && !m_cacheKey.isEmpty()) {
+        m_outputCache.insert(m_cacheKey, m_currentJob.resolvedOutputPath());
+    }
+    m_cacheKey.clear();
     m_state = State::Idle;
     m_progress = 0.0;
     m_statusText = success ? tr("Completed") : tr("Failed");
@@ -293,13 +865,95 @@ void Encoder::handleProcessFinished(int exitCode, QProcess::ExitStatus status)
     emit stateChanged(m_state);
     emit progressChanged(m_progress);
     emit statusTextChanged(m_statusText);
+    if (m_telemetry.wallTimeMs > 0) {
+        emit telemetryReady(m_telemetry);
+    }
     emit finished(success);
 }
 
-QStringList Encoder::buildFfmpegArguments(const EncodeJob &job) const
+QString Encoder::videoCodecForJob(const EncodeJob &job)
+{
+    if (job.telegramMode) {
+        return QStringLiteral("libx264");
+    }
+    const QString encoder = job.profile.video().encoder.toLower();
+    if (encoder == QLatin1String("x265")) {
+        return QStringLiteral("libx265");
+    }
+    if (encoder == QLatin1String("qsv")) {
+        return QStringLiteral("h264_qsv");
+    }
+    if (encoder == QLatin1String("nvenc")) {
+        return QStringLiteral("h264_nvenc");
+    }
+    if (encoder == QLatin1String("amd")) {
+        return QStringLiteral("h264_amf");
+    }
+    return QStringLiteral("libx264");
+}
+
+QString Encoder::presetForJob(const EncodeJob &job)
+{
+    const QString encoder = job.profile.video().encoder.toLower();
+    const QString preset = job.profile.video().preset;
+
+    if (encoder == QLatin1String("nvenc")) {
+        if (preset == QLatin1String("veryslow") || preset == QLatin1String("slower")) {
+            return QStringLiteral("p1");
+        }
+        if (preset == QLatin1String("slow")) {
+            return QStringLiteral("p2");
+        }
+        if (preset == QLatin1String("medium")) {
+            return QStringLiteral("p4");
+        }
+        if (preset == QLatin1String("fast")) {
+            return QStringLiteral("p5");
+        }
+        if (preset == QLatin1String("faster")) {
+            return QStringLiteral("p6");
+        }
+        if (preset == QLatin1String("veryfast")) {
+            return QStringLiteral("p7");
+        }
+        return QStringLiteral("p4");
+    }
+
+    if (encoder == QLatin1String("amd")) {
+        if (preset == QLatin1String("veryslow") || preset == QLatin1String("slower") || preset == QLatin1String("slow")) {
+            return QStringLiteral("quality");
+        }
+        if (preset == QLatin1String("medium") || preset == QLatin1String("fast")) {
+            return QStringLiteral("balanced");
+        }
+        return QStringLiteral("speed");
+    }
+
+    if (encoder == QLatin1String("qsv")) {
+        if (preset == QLatin1String("veryslow") || preset == QLatin1String("slower")) {
+            return QStringLiteral("veryslow");
+        }
+        if (preset == QLatin1String("slow")) {
+            return QStringLiteral("slow");
+        }
+        if (preset == QLatin1String("fast")) {
+            return QStringLiteral("fast");
+        }
+        if (preset == QLatin1String("faster") || preset == QLatin1String("veryfast")) {
+            return QStringLiteral("veryfast");
+        }
+        return QStringLiteral("medium");
+    }
+
+    return preset.isEmpty() ? QStringLiteral("medium") : preset;
+}
+
+QStringList Encoder::buildFfmpegArguments(const EncodeJob &job, int pass) const
 {
     QStringList args;
     args << QStringLiteral("-hide_banner");
+    // The level+ prefix tags every stderr line with its severity for processLogLine.
+    args << QStringLiteral("-loglevel") << QStringLiteral("level+%1").arg(m_logLevel);
     args << QStringLiteral("-y");
     args << QStringLiteral("-progress") << QStringLiteral("pipe:1");
     args << QStringLiteral("-nostats");
@@ -332,8 +986,8 @@ QStringList Encoder::buildFfmpegArguments(const EncodeJob &job) const
     args << QStringLiteral("-map") << QStringLiteral("0:v:0");
 
     QString audioMap = QStringLiteral("0:a:0");
-    if (!job.audioSettings.preferredTrackId.trimmed().isEmpty()) {
-        audioMap = job.audioSettings.preferredTrackId.trimmed();
+    if (!job.profile.audio().preferredTrackId.trimmed().isEmpty()) {
+        audioMap = job.profile.audio().preferredTrackId.trimmed();
         if (!audioMap.startsWith(QStringLiteral("0:"))) {
             audioMap = QStringLiteral("0:%1").arg(audioMap);
         }
@@ -361,13 +1015,39 @@ QStringList Encoder::buildFfmpegArguments(const EncodeJob &job) const
             args << QStringLiteral("-preset") << preset;
         }
     }
+    if (job.profile.video().threads > 0) {
+        args << QStringLiteral("-threads") << QString::number(job.profile.video().threads);
+    }
 
-    const double quality = std::clamp(job.videoSettings.qualityValue, 0.0, 51.0);
+    const double quality = std::clamp(job.profile.video().qualityValue, 0.0, 51.0);
+    const RateControl &rc = job.rateControl;
+    const QString maxrate = QStringLiteral("%1k").arg(rc.maxrateKbps);
+    const QString bufsize = QStringLiteral("%1k").arg(rc.bufsizeKbps);
     if (videoCodec == QLatin1String("libx264") || videoCodec == QLatin1String("libx265")) {
-        args << QStringLiteral("-crf") << QString::number(quality, 'f', 1);
+        if (rc.bitrateKbps > 0) {
+            args << QStringLiteral("-b:v") << QStringLiteral("%1k").arg(rc.bitrateKbps);
+        } else {
+            args << QStringLiteral("-crf") << QString::number(quality, 'f', 1);
+        }
+        if (rc.maxrateKbps > 0) {
+            args << QStringLiteral("-maxrate") << maxrate << QStringLiteral("-bufsize") << bufsize;
+        }
+        if (pass > 0) {
+            args << QStringLiteral("-pass") << QString::number(pass);
+            args << QStringLiteral("-passlogfile") << QDir::toNativeSeparators(m_passLogPrefix);
+        }
     } else if (videoCodec == QLatin1String("h264_nvenc")) {
         args << QStringLiteral("-cq") << QString::number(quality, 'f', 1);
-        args << QStringLiteral("-b:v") << QStringLiteral("0");
+        if (rc.maxrateKbps > 0) {
+            args << QStringLiteral("-b:v") << maxrate << QStringLiteral("-maxrate") << maxrate;
+            args << QStringLiteral("-bufsize") << bufsize;
+        } else {
+            args << QStringLiteral("-b:v") << QStringLiteral("0");
+        }
+    } else if (rc.maxrateKbps > 0) {
+        // QSV ICQ and AMF constant-QP modes ignore bitrate limits; a capped job uses peak-limited VBR.
+        args << QStringLiteral("-b:v") << maxrate << QStringLiteral("-maxrate") << maxrate;
+        args << QStringLiteral("-bufsize") << bufsize;
     } else if (videoCodec == QLatin1String("h264_qsv")) {
         args << QStringLiteral("-global_quality") << QString::number(static_cast<int>(std::round(quality)));
         args << QStringLiteral("-look_ahead") << QStringLiteral("1");
@@ -375,20 +1055,29 @@ QStringList Encoder::buildFfmpegArguments(const EncodeJob &job) const
         args << QStringLiteral("-q:v") << QString::number(quality, 'f', 1);
     }
 
-    QString audioCodec = job.audioSettings.codec.isEmpty() ? QStringLiteral("aac") : job.audioSettings.codec.toLower();
+    QString audioCodec = job.profile.audio().codec.isEmpty() ? QStringLiteral("aac") : job.profile.audio().codec.toLower();
     if (job.telegramMode) {
         audioCodec = QStringLiteral("aac");
     }
-    args << QStringLiteral("-c:a") << audioCodec;
+    if (pass == 1) {
+        // The first pass only gathers video statistics.
+        args << QStringLiteral("-an");
+    } else {
+        args << QStringLiteral("-c:a") << audioCodec;
+    }
 
-    if (audioCodec == QLatin1String("aac")) {
-        const int bitrate = job.audioSettings.bitrateKbps > 0 ? job.audioSettings.bitrateKbps : 192;
+    if (audioCodec == QLatin1String("aac") && pass != 1) {
+        const int bitrate = job.profile.audio().bitrateKbps > 0 ? job.profile.audio().bitrateKbps : 192;
         args << QStringLiteral("-b:a") << QStringLiteral("%1k").arg(bitrate);
         args << QStringLiteral("-profile:a") << QStringLiteral("aac_low");
     }
 
     if (job.telegramMode) {
-        args << QStringLiteral("-movflags") << QStringLiteral("+faststart");
+        if (pass != 1 && m_moovReserveBytes > 0) {
+            args << QStringLiteral("-moov_size") << QString::number(m_moovReserveBytes);
+        } else if (pass != 1) {
+            args << QStringLiteral("-movflags") << QStringLiteral("+faststart");
+        }
         args << QStringLiteral("-pix_fmt") << QStringLiteral("yuv420p");
         args << QStringLiteral("-profile:v") << QStringLiteral("high");
         args << QStringLiteral("-level:v") << QStringLiteral("4.1");
@@ -397,15 +1086,60 @@ QStringList Encoder::buildFfmpegArguments(const EncodeJob &job) const
     args << QStringLiteral("-map_metadata") << QStringLiteral("-1");
     args << QStringLiteral("-sn");
 
-    args << QDir::toNativeSeparators(job.resolvedOutputPath());
+    if (pass != 1 && QFileInfo(job.resolvedOutputPath()).suffix().compare(QLatin1String("mkv"), Qt::CaseInsensitive) == 0) {
+        int attachment = 0;
+        for (const QString &font : job.fontAttachments) {
+            if (!QFileInfo::exists(font)) {
+                continue;
+            }
+            args << QStringLiteral("-attach") << QDir::toNativeSeparators(font);
+            args << QStringLiteral("-metadata:s:t:%1").arg(attachment++) << QStringLiteral("mimetype=%1").arg(fontMimeType(font));
+        }
+    }
+
+    if (pass == 1) {
+        args << QStringLiteral("-f") << QStringLiteral("null") << QStringLiteral("-");
+    } else {
+        args << QDir::toNativeSeparators(m_stagingPath.isEmpty() ? job.resolvedOutputPath() : m_stagingPath);
+    }
     return args;
 }
 
+bool Encoder::reuseCachedOutput(const QByteArray &key)
+{
+    const QString cachedPath = m_outputCache.lookup(key);
+    if (cachedPath.isEmpty()) {
+        return false;
+    }
+
+    const QString outputPath = m_currentJob.resolvedOutputPath();
+    QString error;
+    if (!OutputCache::materialize(cachedPath, outputPath, &error)) {
+        emitWarning(tr("Cached output %1 could not be reused (%2); encoding instead.")
+                        .arg(QDir::toNativeSeparators(cachedPath), error));
+        return false;
+    }
+    m_outputCache.insert(key, outputPath);
+    emit messageReceived(tr("Identical encode found; reused %1").arg(QDir::toNativeSeparators(cachedPath)));
+    finishWithoutProcess(true, tr("Completed (cached)"));
+    return true;
+}
+
 QStringList Encoder::buildVideoFilters(const EncodeJob &job) const
+{
+    QStringList warnings;
+    const QStringList filters = videoFiltersForJob(job, &warnings);
+    for (const QString &warning : std::as_const(warnings)) {
+        emitWarning(warning);
+    }
+    return filters;
+}
+
+QStringList Encoder::videoFiltersForJob(const EncodeJob &job, QStringList *warnings)
 {
     QStringList filters;
 
-    const QString resizeMode = job.videoSettings.resizeMode.toLower();
+    const QString resizeMode = job.profile.video().resizeMode.toLower();
     if (resizeMode == QLatin1String("1080p")) {
         filters << QStringLiteral("scale=-2:1080:flags=lanczos");
     } else if (resizeMode == QLatin1String("720p")) {
@@ -413,114 +1147,172 @@ QStringList Encoder::buildVideoFilters(const EncodeJob &job) const
     } else if (resizeMode == QLatin1String("480p")) {
         filters << QStringLiteral("scale=-2:480:flags=lanczos");
     } else if (resizeMode == QLatin1String("custom")) {
-        if (job.videoSettings.customSize.isValid()) {
+        if (job.profile.video().customSize.isValid()) {
             filters << QStringLiteral("scale=%1:%2:flags=lanczos")
-                          .arg(job.videoSettings.customSize.width())
-                          .arg(job.videoSettings.customSize.height());
-        } else {
-            emitWarning(tr("Custom resize requested but size is invalid; keeping source resolution."));
+                          .arg(job.profile.video().customSize.width())
+                          .arg(job.profile.video().customSize.height());
+        } else if (warnings) {
+            warnings->append(tr("Custom resize requested but size is invalid; keeping source resolution."));
         }
     }
 
     if (!job.subtitlePath.isEmpty()) {
         const QString renderer = job.rendererMode.isEmpty() ? QStringLiteral("Auto") : job.rendererMode;
-        if (renderer == QLatin1String("VSFilter") || renderer == QLatin1String("VSFilterMod")) {
-            emitWarning(tr("%1 renderer is unavailable; using libass via ffmpeg subtitles filter.").arg(renderer));
+        if ((renderer == QLatin1String("VSFilter") || renderer == QLatin1String("VSFilterMod")) && warnings) {
+            warnings->append(tr("%1 renderer is unavailable; using libass via ffmpeg subtitles filter.").arg(renderer));
+        }
+        // Input seeking (-ss before -i) restarts timestamps at zero, so a cut would burn
+        // the wrong events; shift onto the source timeline for the filter and back after.
+        double cutStartSeconds = 0.0;
+        const bool shifted = job.cutSettings.enabled && parseTimeToSeconds(job.cutSettings.startTime, cutStartSeconds)
+            && cutStartSeconds > 0.0;
+        if (shifted) {
+            filters << QStringLiteral("setpts=PTS+%1/TB").arg(QString::number(cutStartSeconds, 'f', 3));
         }
         filters << QStringLiteral("subtitles='%1'").arg(sanitizeFilterPath(job.subtitlePath));
+        if (shifted) {
+            filters << QStringLiteral("setpts=PTS-STARTPTS");
+        }
     }
 
     return filters;
 }
 
-QStringList Encoder::buildAudioFilters(const EncodeJob &job) const
+qint64 Encoder::predictedOutputBytes(const EncodeJob &job)
 {
-    QStringList filters;
-    if (std::fabs(static_cast<double>(job.audioSettings.volumeSource) - 1.0) > 0.01) {
-        filters << QStringLiteral("volume=%1").arg(QString::number(job.audioSettings.volumeSource, 'f', 2));
+    const qint64 durationMs = job.effectiveDurationMs();
+    const RateControl &rc = job.rateControl;
+    const int videoKbps = rc.bitrateKbps > 0 ? rc.bitrateKbps : rc.maxrateKbps;
+    if (videoKbps > 0 && durationMs > 0) {
+        return (static_cast<qint64>(videoKbps) + SizeBudgetPlanner::audioKbpsForJob(job)) * durationMs / 8;
     }
-    return filters;
+    // Quality-based re-encodes rarely outgrow their source, so its share of the window is the bound.
+    const qint64 sourceBytes = QFileInfo(job.videoPath).size();
+    if (job.durationMs > 0 && durationMs > 0 && durationMs < job.durationMs) {
+        return sourceBytes * durationMs / job.durationMs;
+    }
+    return sourceBytes;
 }
 
-QString Encoder::resolveFfmpegExecutable() const
+qint64 Encoder::moovReserveBytes(const EncodeJob &job, const SourceIndex &index)
 {
-    const QByteArray overrideValue = qgetenv("NISEYUKI_FFMPEG");
-    if (!overrideValue.isEmpty()) {
-        const QFileInfo overrideInfo(QString::fromLocal8Bit(overrideValue));
-        if (overrideInfo.exists() && overrideInfo.isFile()) {
-            return overrideInfo.absoluteFilePath();
-        }
+    const qint64 durationMs = job.effectiveDurationMs();
+    if (durationMs <= 0) {
+        return 0;
     }
-    return resolveExecutable(QStringLiteral("ffmpeg"));
-}
 
-QString Encoder::resolveFfprobeExecutable() const
-{
-    const QByteArray overrideValue = qgetenv("NISEYUKI_FFPROBE");
-    if (!overrideValue.isEmpty()) {
-        const QFileInfo overrideInfo(QString::fromLocal8Bit(overrideValue));
-        if (overrideInfo.exists() && overrideInfo.isFile()) {
-            return overrideInfo.absoluteFilePath();
-        }
+    qint64 videoFrames = 0;
+    if (index.isValid()) {
+        double startSeconds = 0.0;
+        const qint64 startUs = job.cutSettings.enabled && parseTimeToSeconds(job.cutSettings.startTime, startSeconds)
+            ? static_cast<qint64>(startSeconds * 1000000.0)
+            : 0;
+        const int first = std::max(index.frameAt(startUs), 0);
+        const int last = index.frameAt(startUs + durationMs * 1000);
+        videoFrames = last - first + 1;
+    } else if (job.sourceFrameRate > 0.0) {
+        // Variable frame rate sources can run above the nominal rate in places.
+        videoFrames = static_cast<qint64>(static_cast<double>(durationMs) / 1000.0 * job.sourceFrameRate * 1.1);
+    }
+    if (videoFrames <= 0) {
+        return 0;
     }
-    return resolveExecutable(QStringLiteral("ffprobe"));
+
+    // AAC at up to 48 kHz, 1024 samples per frame.
+    const qint64 audioFrames = durationMs * 48 / 1024 + 1;
+    // Worst case per sample: stsz, stts and ctts entries plus a chunk of its own
+    // (stsc + co64); video keyframes add an stss entry.
+    const qint64 tableBytes = videoFrames * (4 + 8 + 8 + 12 + 8 + 4) + audioFrames * (4 + 8 + 12 + 8);
+    return 64 * 1024 + tableBytes * 5 / 4;
 }
 
-QString Encoder::resolveExecutable(const QString &program) const
+QStringList Encoder::buildAudioFilters(const EncodeJob &job) const
 {
-    QString baseName = program;
-#ifdef Q_OS_WIN
-    if (!baseName.endsWith(QStringLiteral(".exe"), Qt::CaseInsensitive)) {
-        baseName.append(QStringLiteral(".exe"));
+    QStringList filters;
+    if (std::fabs(static_cast<double>(job.profile.audio().volumeSource) - 1.0) > 0.01) {
+        filters << QStringLiteral("volume=%1").arg(QString::number(job.profile.audio().volumeSource, 'f', 2));
     }
-#endif
+    return filters;
+}
 
-    const QString appDir = QCoreApplication::applicationDirPath();
-    const QStringList candidates{
-        QDir(appDir).filePath(QStringLiteral("ffmpeg/bin/%1").arg(baseName)),
-        QDir(appDir).filePath(QStringLiteral("ffmpeg/%1").arg(baseName)),
-        QDir(appDir).filePath(baseName),
-        program,
-        baseName
-    };
+void Encoder::beginTelemetry()
+{
+    m_telemetry = JobTelemetry();
+    m_telemetry.videoPath = m_currentJob.videoPath;
+    m_telemetry.outputPath = m_currentJob.resolvedOutputPath();
+    m_telemetry.encoder = videoCodecForJob(m_currentJob);
+    m_telemetry.preset = presetForJob(m_currentJob);
+    m_telemetry.qualityValue = m_currentJob.profile.video().qualityValue;
+    m_telemetry.resizeMode = m_currentJob.profile.video().resizeMode;
+    m_telemetry.outputHeight = DurationModel::outputHeight(m_currentJob);
+    m_telemetry.subtitleComplexity = DurationModel::subtitleComplexity(m_currentJob);
+    m_telemetry.telegramMode = m_currentJob.telegramMode;
+    m_telemetry.passes = m_currentJob.rateControl.twoPass ? 2 : 1;
+    m_fpsSamples.clear();
+    m_lastOutTimeMs = 0;
+    m_speedText.clear();
+    m_finishedCpuUserMs = 0;
+    m_finishedCpuSystemMs = 0;
+    m_wallTimer.start();
+}
 
-    for (const QString &candidate : candidates) {
-        const QFileInfo info(candidate);
-        if (info.exists() && info.isFile()) {
-            return info.absoluteFilePath();
-        }
+void Encoder::sampleProcessStats()
+{
+    const ProcessSample sample = m_exitStats.sample();
+    if (!sample.valid) {
+        return;
     }
-    return QString();
+    // Earlier processes of the job (the first pass, a faststart re-run) are already in the totals.
+    m_telemetry.cpuUserMs = m_finishedCpuUserMs + sample.cpuUserMs;
+    m_telemetry.cpuSystemMs = m_finishedCpuSystemMs + sample.cpuSystemMs;
+    m_telemetry.peakRssKb = std::max(m_telemetry.peakRssKb, sample.peakRssKb);
 }
 
-qint64 Encoder::probeDurationMs(const QString &videoPath, const QString &ffprobePath) const
+void Encoder::sampleExitedProcess()
 {
-    if (ffprobePath.isEmpty()) {
-        return 0;
+    const ProcessSample sample = m_exitStats.finish();
+    if (!sample.valid) {
+        return;
     }
+    m_finishedCpuUserMs += sample.cpuUserMs;
+    m_finishedCpuSystemMs += sample.cpuSystemMs;
+    m_telemetry.cpuUserMs = m_finishedCpuUserMs;
+    m_telemetry.cpuSystemMs = m_finishedCpuSystemMs;
+    m_telemetry.peakRssKb = std::max(m_telemetry.peakRssKb, sample.peakRssKb);
+}
 
-    QProcess probe;
-    QStringList args{
-        QStringLiteral("-v"), QStringLiteral("error"),
-        QStringLiteral("-show_entries"), QStringLiteral("format=duration"),
-        QStringLiteral("-of"), QStringLiteral("default=noprint_wrappers=1:nokey=1"),
-        videoPath
-    };
-    probe.start(ffprobePath, args);
-    if (!probe.waitForFinished(8000)) {
-        probe.kill();
-        probe.waitForFinished();
-        emitWarning(tr("ffprobe timed out while reading duration."));
-        return 0;
+void Encoder::finalizeTelemetry(bool success)
+{
+    if (!m_wallTimer.isValid()) {
+        return;
+    }
+    m_telemetry.success = success;
+    m_telemetry.finishedAt = QDateTime::currentDateTime();
+    m_telemetry.wallTimeMs = std::max<qint64>(m_wallTimer.elapsed(), 1);
+    m_telemetry.encodedDurationMs = m_lastOutTimeMs;
+    m_wallTimer.invalidate();
+
+    if (!m_fpsSamples.isEmpty()) {
+        double sum = 0.0;
+        for (double fps : std::as_const(m_fpsSamples)) {
+            sum += fps;
+        }
+        m_telemetry.averageFps = sum / m_fpsSamples.size();
+        QVector<double> sorted = m_fpsSamples;
+        const int index = static_cast<int>(std::floor(0.05 * (sorted.size() - 1)));
+        std::nth_element(sorted.begin(), sorted.begin() + index, sorted.end());
+        m_telemetry.p5Fps = sorted.at(index);
     }
 
-    const QString output = QString::fromUtf8(probe.readAllStandardOutput()).trimmed();
-    bool ok = false;
-    const double seconds = output.toDouble(&ok);
-    if (ok && seconds > 0.0) {
-        return static_cast<qint64>(seconds * 1000.0);
+    // Measured before publishing, while the output still sits at its staging path.
+    const QFileInfo outputInfo(m_stagingPath.isEmpty() ? m_telemetry.outputPath : m_stagingPath);
+    if (outputInfo.exists()) {
+        m_telemetry.outputBytes = outputInfo.size();
+        if (m_telemetry.encodedDurationMs > 0) {
+            m_telemetry.bitrateKbps = static_cast<double>(m_telemetry.outputBytes) * 8.0
+                / static_cast<double>(m_telemetry.encodedDurationMs);
+        }
     }
-    return 0;
 }
 
 void Encoder::emitWarning(const QString &message) const
@@ -529,6 +1321,45 @@ void Encoder::emitWarning(const QString &message) const
     emit self->messageReceived(QStringLiteral("[warn] %1").arg(message));
 }
 
+void Encoder::applyOutTime(qint64 outTimeMs)
+{
+    m_lastOutTimeMs = outTimeMs;
+    if (m_state == State::Indexing) {
+        m_state = State::Encoding;
+        emit stateChanged(m_state);
+    }
+    // Each pass of a two-pass encode reports from zero; progress and ETA span both.
+    const qint64 doneMs = (m_pass == 2 ? m_totalDurationMs : 0) + outTimeMs;
+    const qint64 plannedMs = m_pass > 0 ? 2 * m_totalDurationMs : m_totalDurationMs;
+    if (plannedMs > 0) {
+        const double ratio = static_cast<double>(doneMs) / static_cast<double>(plannedMs);
+        const double newProgress = std::clamp(ratio, 0.0, 1.0);
+        if (std::fabs(newProgress - m_progress) > 0.0005) {
+            m_progress = newProgress;
+            emit progressChanged(m_progress);
+        }
+    }
+
+    qint64 remainingMs = -1;
+    if (m_wallTimer.isValid()) {
+        m_eta.update(doneMs, m_wallTimer.elapsed());
+        remainingMs = m_eta.remainingMs();
+        emit etaChanged(remainingMs);
+    }
+
+    QString label = m_pass > 0 ? tr("Pass %1/2").arg(m_pass) : tr("Encoding");
+    if (!m_speedText.isEmpty()) {
+        // From the previous report; speed comes after out_time in each block.
+        label = tr("%1 at %2").arg(label, m_speedText);
+    }
+    if (remainingMs >= 0) {
+        m_statusText = tr("%1 (%2, ETA %3)").arg(label, formatTimecode(outTimeMs), formatTimecode(remainingMs));
+    } else {
+        m_statusText = tr("%1 (%2)").arg(label, formatTimecode(outTimeMs));
+    }
+    emit statusTextChanged(m_statusText);
+}
+
 bool Encoder::parseProgressLine(const QByteArray &line)
 {
     const QString text = QString::fromUtf8(line).trimmed();
@@ -545,49 +1376,22 @@ bool Encoder::parseProgressLine(const QByteArray &line)
             bool ok = false;
             const qint64 outTimeMicro = value.toLongLong(&ok);
             if (ok) {
-                const qint64 outTimeMs = outTimeMicro / 1000;
-                if (m_state == State::Indexing) {
-                    m_state = State::Encoding;
-                    emit stateChanged(m_state);
-                }
-                if (m_totalDurationMs > 0) {
-                    const double ratio = static_cast<double>(outTimeMs) / static_cast<double>(m_totalDurationMs);
-                    const double newProgress = std::clamp(ratio, 0.0, 1.0);
-                    if (std::fabs(newProgress - m_progress) > 0.0005) {
-                        m_progress = newProgress;
-                        emit progressChanged(m_progress);
-                    }
-                }
-                m_statusText = tr("Encoding (%1)").arg(formatTimecode(outTimeMs));
-                emit statusTextChanged(m_statusText);
+                applyOutTime(outTimeMicro / 1000);
             }
             return true;
         }
 
-        if (key == QLatin1String("out_time")) {
-            double seconds = 0.0;
-            if (parseTimeToSeconds(value, seconds)) {
-                if (m_state == State::Indexing) {
-                    m_state = State::Encoding;
-                    emit stateChanged(m_state);
-                }
-                const qint64 outTimeMs = static_cast<qint64>(seconds * 1000.0);
-                if (m_totalDurationMs > 0) {
-                    const double ratio = static_cast<double>(outTimeMs) / static_cast<double>(m_totalDurationMs);
-                    const double newProgress = std::clamp(ratio, 0.0, 1.0);
-                    if (std::fabs(newProgress - m_progress) > 0.0005) {
-                        m_progress = newProgress;
-                        emit progressChanged(m_progress);
-                    }
-                }
-                m_statusText = tr("Encoding (%1)").arg(formatTimecode(outTimeMs));
-                emit statusTextChanged(m_statusText);
-            }
+        if (key == QLatin1String("out_time") || key == QLatin1String("out_time_us")) {
+            // Every report carries out_time_ms as well; one of them is enough.
             return true;
         }
 
         if (key == QLatin1String("progress")) {
-            if (value == QLatin1String("end")) {
+            sampleProcessStats();
+            if (value == QLatin1String("continue") && m_wallTimer.isValid()) {
+                m_lastReportMs = m_wallTimer.elapsed();
+            }
+            if (value == QLatin1String("end") && m_pass != 1) {
                 m_progress = 1.0;
                 emit progressChanged(m_progress);
             }
@@ -595,6 +1399,9 @@ bool Encoder::parseProgressLine(const QByteArray &line)
         }
 
         if (key == QLatin1String("frame")) {
+            if (m_telemetry.timeToFirstFrameMs < 0 && m_wallTimer.isValid() && value.toLongLong() > 0) {
+                m_telemetry.timeToFirstFrameMs = m_wallTimer.elapsed();
+            }
             if (m_state == State::Indexing) {
                 m_state = State::Encoding;
                 emit stateChanged(m_state);
@@ -606,53 +1413,47 @@ bool Encoder::parseProgressLine(const QByteArray &line)
             return true;
         }
 
-        if (key == QLatin1String("speed")) {
-            m_statusText = tr("Encoding speed %1").arg(value);
-            emit statusTextChanged(m_statusText);
+        if (key == QLatin1String("fps")) {
+            bool ok = false;
+            const double fps = value.toDouble(&ok);
+            if (ok && fps > 0.0) {
+                m_fpsSamples.append(fps);
+            }
             return true;
         }
 
-        return false;
-    }
-
-    static const QRegularExpression frameRegex(QStringLiteral("frame=\\s*(\\d+)"));
-    static const QRegularExpression timeRegex(QStringLiteral("time=([0-9:.]+)"));
-
-    const QRegularExpressionMatch matchFrame = frameRegex.match(text);
-    const QRegularExpressionMatch matchTime = timeRegex.match(text);
-
-    bool handled = false;
-    if (matchTime.hasMatch()) {
-        double seconds = 0.0;
-        if (parseTimeToSeconds(matchTime.captured(1), seconds)) {
-            if (m_state == State::Indexing) {
-                m_state = State::Encoding;
-                emit stateChanged(m_state);
-            }
-            const qint64 outTimeMs = static_cast<qint64>(seconds * 1000.0);
-            if (m_totalDurationMs > 0) {
-                const double ratio = static_cast<double>(outTimeMs) / static_cast<double>(m_totalDurationMs);
-                m_progress = std::clamp(ratio, 0.0, 1.0);
-                emit progressChanged(m_progress);
+        if (key == QLatin1String("bitrate")) {
+            QString number = value;
+            number.remove(QStringLiteral("kbits/s"));
+            bool ok = false;
+            const double kbps = number.toDouble(&ok);
+            if (ok) {
+                m_telemetry.bitrateKbps = kbps;
             }
-            m_statusText = tr("Encoding (%1)").arg(formatTimecode(outTimeMs));
-            emit statusTextChanged(m_statusText);
-            handled = true;
+            return true;
         }
-    }
 
-    if (matchFrame.hasMatch()) {
-        handled = true;
-        if (m_state == State::Indexing) {
-            m_state = State::Encoding;
-            emit stateChanged(m_state);
+        if (key == QLatin1String("total_size")) {
+            bool ok = false;
+            const qint64 bytes = value.toLongLong(&ok);
+            if (ok) {
+                m_telemetry.outputBytes = bytes;
+            }
+            return true;
         }
-        if (m_totalDurationMs == 0) {
-            m_statusText = tr("Encoding (frame %1)").arg(matchFrame.captured(1));
-            emit statusTextChanged(m_statusText);
+
+        if (key == QLatin1String("speed")) {
+            QString number = value;
+            number.remove(QLatin1Char('x'));
+            bool ok = false;
+            const double speed = number.toDouble(&ok);
+            if (ok) {
+                m_telemetry.speed = speed;
+                m_speedText = value;
+            }
+            return true;
         }
     }
-
-    return handled;
+    return false;
 }
 
@@ -1,20 +1,41 @@
 #pragma once
 
+#include "CrfSearch.h"
 #include "EncodeJob.h"
+#include "EtaEstimator.h"
+#include "FfmpegCapabilities.h"
+#include "JobLogWriter.h"
+#include "JobTelemetry.h"
+#include "OutputCache.h"
+#include "OutputPublisher.h"
+#include "ProcessStats.h"
+#include "SizeBudget.h"
+#include "SourceIndex.h"
 
+#include <QElapsedTimer>
 #include <QObject>
 #include <QProcess>
 #include <QString>
 #include <QStringList>
+#include <QVector>
+
+#include <memory>
+#include <utility>
+
+class FontCatalog;
 
 class Encoder : public QObject
 {
     Q_OBJECT
+    // Drives the output parsing and argument planning directly (bench/EncoderBench.cpp).
+    friend class EncoderBench;
+
 public:
     enum class State {
         Idle,
         Indexing,
         Encoding,
+        Paused,
         Stopping
     };
 
@@ -22,39 +43,147 @@ public:
 
     void startEncoding(const EncodeJob &job);
     void stopEncoding();
+    bool pauseEncoding();
+    bool resumeEncoding();
+    // When enabled, a job whose source, plan and subtitle match an earlier
+    // successful encode reuses that output instead of running ffmpeg.
+    void setOutputCacheEnabled(bool enabled) { m_outputCacheEnabled = enabled; }
+    // When enabled, the Indexing state builds (or loads) the packet index of the source before encoding.
+    void setSourceIndexingEnabled(bool enabled) { m_sourceIndexingEnabled = enabled; }
+    // When enabled, Telegram MP4s reserve room for the index up front (-moov_size)
+    // instead of rewriting the whole file for +faststart after encoding.
+    void setMoovReservationEnabled(bool enabled) { m_moovReservationEnabled = enabled; }
+    // In-progress outputs and two-pass logs go here (a fast local disk); empty stages beside the output.
+    void setScratchDirectory(const QString &directory) { m_scratchDirectory = directory; }
+    // Jobs asking for an encoder or metric the probed ffmpeg lacks fall back instead of failing.
+    void setCapabilities(const FfmpegCapabilities &capabilities) { m_capabilities = capabilities; }
+    // ffmpeg's -loglevel (error, warning, info, verbose, debug). Everything at that level goes to
+    // the job's log file; only warnings and errors are forwarded through messageReceived.
+    void setLogLevel(const QString &level) { m_logLevel = level; }
+    // Where the job's ffmpeg log is written; auxiliary encodes (samples, CRF probes,
+    // benchmarks) use JobLogWriter::auxiliaryLogDirectory() so they never push real
+    // job logs out of retention.
+    void setJobLogDirectory(const QString &directory) { m_jobLogDirectory = directory; }
+    // With a catalog, jobs that can attach fonts and arrive without any resolve them
+    // in the Indexing state; null leaves fontAttachments as queued.
+    void setFontCatalog(std::shared_ptr<const FontCatalog> catalog) { m_fontCatalog = std::move(catalog); }
 
     [[nodiscard]] State state() const noexcept { return m_state; }
     [[nodiscard]] double progress() const noexcept { return m_progress; }
     [[nodiscard]] QString statusText() const { return m_statusText; }
+    [[nodiscard]] const JobTelemetry &lastTelemetry() const noexcept { return m_telemetry; }
+    [[nodiscard]] qint64 totalDurationMs() const noexcept { return m_totalDurationMs; }
+    [[nodiscard]] const SourceIndex &sourceIndex() const noexcept { return m_sourceIndex; }
+
+    static QString videoCodecForJob(const EncodeJob &job);
+    static QString presetForJob(const EncodeJob &job);
+    // The -vf chain the encode applies (scale, subtitle burn-in), shared with the preview.
+    static QStringList videoFiltersForJob(const EncodeJob &job, QStringList *warnings = nullptr);
+    // Generous size of the MP4 index for the job's frame count, or 0 when the count is unknown.
+    static qint64 moovReserveBytes(const EncodeJob &job, const SourceIndex &index);
+    // Expected output size for the free-space check: the planned bitrate when set, else the source's share.
+    static qint64 predictedOutputBytes(const EncodeJob &job);
 
 signals:
     void stateChanged(Encoder::State state);
     void progressChanged(double progress);
+    void etaChanged(qint64 remainingMs);
     void statusTextChanged(const QString &text);
     void messageReceived(const QString &message);
+    void telemetryReady(const JobTelemetry &telemetry);
     void finished(bool success);
 
 private slots:
-    void handleProcessOutput();
+    void handleProgressOutput();
+    void handleLogOutput();
     void handleProcessFinished(int exitCode, QProcess::ExitStatus status);
 
 private:
-    QStringList buildFfmpegArguments(const EncodeJob &job) const;
+    // stdout carries only -progress key=value reports; stderr carries the log.
+    enum class Channel {
+        Progress,
+        Log
+    };
+
+    void prepareAndLaunch();
+    void launchFfmpeg();
+    void resolveCacheKey(const QStringList &args);
+    void startFfmpeg(const QStringList &args);
+    void startProcess(const QStringList &args);
+    void onPublishFinished(bool success, const QString &errorMessage);
+    void completeJob(bool success);
+    void onIndexFinished(const SourceIndex &index, const QString &errorMessage);
+    void onCrfSearchFinished(double quality, const QString &errorMessage);
+    void onSizePlanFinished(const SizePlan &plan);
+    void resolveFontAttachments();
+    void finishWithoutProcess(bool success, const QString &statusText);
+    void applyCapabilityFallbacks();
+    // pass is 1 or 2 for the passes of a two-pass encode, 0 otherwise.
+    QStringList buildFfmpegArguments(const EncodeJob &job, int pass = 0) const;
+    bool reuseCachedOutput(const QByteArray &key);
+    void processOutput(Channel channel, const QByteArray &data);
+    void processLogLine(const QByteArray &line);
+    void openJobLog();
+    // Parses what is left of both channels once ffmpeg has exited, including unterminated last lines.
+    void flushOutput();
+    // Applies one -progress key=value report line; false for keys it does not use.
     bool parseProgressLine(const QByteArray &line);
-    QString resolveFfmpegExecutable() const;
-    QString resolveFfprobeExecutable() const;
-    QString resolveExecutable(const QString &program) const;
-    qint64 probeDurationMs(const QString &videoPath, const QString &ffprobePath) const;
+    void applyOutTime(qint64 outTimeMs);
     QStringList buildVideoFilters(const EncodeJob &job) const;
     QStringList buildAudioFilters(const EncodeJob &job) const;
     void emitWarning(const QString &message) const;
+    void beginTelemetry();
+    void sampleProcessStats();
+    // Picks up the CPU time spent after the last -progress report.
+    void sampleExitedProcess();
+    void finalizeTelemetry(bool success);
 
     QProcess m_process;
+    QByteArray m_stdoutBuffer;
+    QByteArray m_stderrBuffer;
     EncodeJob m_currentJob;
     State m_state = State::Idle;
+    State m_stateBeforePause = State::Encoding;
     double m_progress = 0.0;
     QString m_statusText;
     QString m_ffmpegPath;
     QString m_ffprobePath;
     qint64 m_totalDurationMs = 0;
+    qint64 m_lastOutTimeMs = 0;
+    QString m_speedText; // ffmpeg's last speed= value, e.g. "1.5x"
+    QElapsedTimer m_wallTimer;
+    EtaEstimator m_eta;
+    JobTelemetry m_telemetry;
+    QVector<double> m_fpsSamples;
+    ExitedProcessStats m_exitStats;
+    // CPU time of the job's ffmpeg processes that have already exited.
+    qint64 m_finishedCpuUserMs = 0;
+    qint64 m_finishedCpuSystemMs = 0;
+    OutputCache m_outputCache;
+    QByteArray m_cacheKey;
+    bool m_outputCacheEnabled = false;
+    SourceIndexer m_indexer;
+    SourceIndex m_sourceIndex;
+    bool m_sourceIndexingEnabled = false;
+    CrfSearch m_crfSearch;
+    bool m_qualityResolved = false;
+    SizeBudgetPlanner m_sizePlanner;
+    bool m_sizePlanned = false;
+    std::shared_ptr<const FontCatalog> m_fontCatalog;
+    bool m_fontsResolved = false;
+    bool m_prepareTaskRunning = false;
+    quint64 m_prepareTaskGeneration = 0;
+    int m_pass = 0;
+    QString m_passLogPrefix;
+    bool m_moovReservationEnabled = false;
+    qint64 m_moovReserveBytes = 0;
+    bool m_moovTooSmall = false;
+    qint64 m_lastReportMs = -1;
+    QString m_scratchDirectory;
+    QString m_logLevel = QStringLiteral("warning");
+    QString m_jobLogDirectory = JobLogWriter::logDirectory();
+    JobLogWriter m_jobLog;
+    QString m_stagingPath;
+    OutputPublisher m_publisher;
+    FfmpegCapabilities m_capabilities;
 };
@@ -0,0 +1,44 @@
+#include "EtaEstimator.h"
+
+#include <algorithm>
+
+namespace {
+constexpr qint64 kMinSampleSpanMs = 500;
+constexpr double kSmoothing = 0.2;
+}
+
+void EtaEstimator::reset(qint64 totalMs)
+{
+    m_totalMs = totalMs;
+    m_lastOutTimeMs = -1;
+    m_lastElapsedMs = 0;
+    m_speed = 0.0;
+}
+
+void EtaEstimator::update(qint64 outTimeMs, qint64 elapsedMs)
+{
+    if (m_lastOutTimeMs < 0) {
+        m_lastOutTimeMs = outTimeMs;
+        m_lastElapsedMs = elapsedMs;
+        return;
+    }
+
+    const qint64 wallDelta = elapsedMs - m_lastElapsedMs;
+    if (wallDelta < kMinSampleSpanMs) {
+        return;
+    }
+    const qint64 mediaDelta = std::max<qint64>(outTimeMs - m_lastOutTimeMs, 0);
+    const double sampleSpeed = static_cast<double>(mediaDelta) / static_cast<double>(wallDelta);
+    m_speed = m_speed <= 0.0 ? sampleSpeed : (kSmoothing * sampleSpeed + (1.0 - kSmoothing) * m_speed);
+    m_lastOutTimeMs = outTimeMs;
+    m_lastElapsedMs = elapsedMs;
+}
+
+qint64 EtaEstimator::remainingMs() const
+{
+    if (m_totalMs <= 0 || m_speed <= 0.0 || m_lastOutTimeMs < 0) {
+        return -1;
+    }
+    const qint64 remainingMedia = std::max<qint64>(m_totalMs - m_lastOutTimeMs, 0);
+    return static_cast<qint64>(static_cast<double>(remainingMedia) / m_speed);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QtGlobal>
+
+// Smooths the encode speed (media time per wall time) from successive progress
+// samples and turns it into a remaining-time estimate.
+class EtaEstimator
+{
+public:
+    void reset(qint64 totalMs);
+    void update(qint64 outTimeMs, qint64 elapsedMs);
+    // Keeps the smoothed speed but discards the last sample, e.g. after a pause.
+    void restartSampling() { m_lastOutTimeMs = -1; }
+
+    [[nodiscard]] qint64 remainingMs() const;
+    [[nodiscard]] double smoothedSpeed() const noexcept { return m_speed; }
+
+private:
+    qint64 m_totalMs = 0;
+    qint64 m_lastOutTimeMs = -1;
+    qint64 m_lastElapsedMs = 0;
+    double m_speed = 0.0;
+};
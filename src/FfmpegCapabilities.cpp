@@ -0,0 +1,327 @@
+#include "FfmpegCapabilities.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+// Listing encoders/filters is instant; a hardware session may take a few seconds to open or fail.
+constexpr int kListTimeoutMs = 15000;
+constexpr int kHardwareTestTimeoutMs = 20000;
+
+const QStringList &hardwareEncoders()
+{
+    static const QStringList encoders{QStringLiteral("h264_nvenc"), QStringLiteral("h264_qsv"), QStringLiteral("h264_amf")};
+    return encoders;
+}
+
+QJsonArray toJsonArray(const QStringList &values)
+{
+    QJsonArray array;
+    for (const QString &value : values) {
+        array.append(value);
+    }
+    return array;
+}
+
+QStringList fromJsonArray(const QJsonValue &value)
+{
+    QStringList list;
+    for (const QJsonValue &entry : value.toArray()) {
+        list << entry.toString();
+    }
+    return list;
+}
+
+QStringList sorted(const QSet<QString> &values)
+{
+    QStringList list(values.cbegin(), values.cend());
+    list.sort();
+    return list;
+}
+
+QString cacheKey(const QString &ffmpegPath)
+{
+    return QDir::cleanPath(QFileInfo(ffmpegPath).absoluteFilePath());
+}
+} // namespace
+
+bool FfmpegCapabilities::hasEncoder(const QString &name) const
+{
+    if (!encoders.contains(name)) {
+        return false;
+    }
+    return !isHardwareEncoder(name) || workingHardwareEncoders.contains(name);
+}
+
+bool FfmpegCapabilities::isHardwareEncoder(const QString &name)
+{
+    return name.endsWith(QLatin1String("_nvenc")) || name.endsWith(QLatin1String("_qsv"))
+        || name.endsWith(QLatin1String("_amf")) || name.endsWith(QLatin1String("_vaapi"))
+        || name.endsWith(QLatin1String("_videotoolbox"));
+}
+
+QSet<QString> FfmpegCapabilities::parseEncoders(const QByteArray &output)
+{
+    // e.g. " V....D libx264              libx264 H.264 / AVC ..." after the " ------" separator.
+    static const QRegularExpression line(QStringLiteral("^\\s*[VAS][A-Z.]{5}\\s+(\\S+)\\s"));
+    QSet<QString> names;
+    bool listing = false;
+    for (const QByteArray &raw : output.split('\n')) {
+        const QString text = QString::fromUtf8(raw);
+        if (!listing) {
+            listing = text.trimmed().startsWith(QLatin1String("------"));
+            continue;
+        }
+        const QRegularExpressionMatch match = line.match(text);
+        if (match.hasMatch()) {
+            names.insert(match.captured(1));
+        }
+    }
+    return names;
+}
+
+QSet<QString> FfmpegCapabilities::parseFilters(const QByteArray &output)
+{
+    // e.g. " ... ssim              VV->V      Calculate the SSIM between two video streams."
+    static const QRegularExpression line(QStringLiteral("^\\s*[TSC.]{2,3}\\s+(\\S+)\\s+\\S*->\\S*\\s"));
+    QSet<QString> names;
+    for (const QByteArray &raw : output.split('\n')) {
+        const QRegularExpressionMatch match = line.match(QString::fromUtf8(raw));
+        if (match.hasMatch()) {
+            names.insert(match.captured(1));
+        }
+    }
+    return names;
+}
+
+QStringList FfmpegCapabilities::parseHwaccels(const QByteArray &output)
+{
+    QStringList names;
+    bool listing = false;
+    for (const QByteArray &raw : output.split('\n')) {
+        const QString text = QString::fromUtf8(raw).trimmed();
+        if (!listing) {
+            listing = text.startsWith(QLatin1String("Hardware acceleration methods"));
+            continue;
+        }
+        if (!text.isEmpty()) {
+            names << text;
+        }
+    }
+    return names;
+}
+
+CapabilityProbe::CapabilityProbe(QObject *parent)
+    : QObject(parent)
+{
+}
+
+CapabilityProbe::~CapabilityProbe()
+{
+    for (QProcess *process : std::as_const(m_processes)) {
+        process->disconnect(this);
+        process->kill();
+        process->waitForFinished(1000);
+    }
+}
+
+QString CapabilityProbe::cachePath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath(QStringLiteral("ffmpeg-capabilities.json"));
+}
+
+void CapabilityProbe::start(const QString &ffmpegPath)
+{
+    if (m_running) {
+        return;
+    }
+    m_running = true;
+    m_capabilities = FfmpegCapabilities();
+    m_capabilities.ffmpegPath = ffmpegPath;
+    const QFileInfo binary(ffmpegPath);
+    m_binaryModified = binary.lastModified();
+    m_binarySize = binary.size();
+    m_listingsCached = false;
+    if (ffmpegPath.isEmpty() || !binary.exists()) {
+        QTimer::singleShot(0, this, [this]() { finish(); });
+        return;
+    }
+    m_listingsCached = loadCached();
+    if (m_listingsCached) {
+        // Drivers and GPUs change without touching the binary, so sessions are tested every start.
+        QTimer::singleShot(0, this, [this]() { testHardwareEncoders(); });
+        return;
+    }
+    runStep(Step::Encoders);
+}
+
+void CapabilityProbe::runStep(Step step)
+{
+    QStringList args{QStringLiteral("-hide_banner")};
+    switch (step) {
+    case Step::Encoders:
+        args << QStringLiteral("-encoders");
+        break;
+    case Step::Filters:
+        args << QStringLiteral("-filters");
+        break;
+    case Step::Hwaccels:
+        args << QStringLiteral("-hwaccels");
+        break;
+    }
+    auto *process = new QProcess(this);
+    m_processes.append(process);
+    connect(process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+            [this, step, process]() { onStepFinished(step, process); });
+    connect(process, &QProcess::errorOccurred, this, [this, step, process](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            QTimer::singleShot(0, this, [this, step, process]() { onStepFinished(step, process); });
+        }
+    });
+    QTimer::singleShot(kListTimeoutMs, process, [process]() { process->kill(); });
+    process->start(m_capabilities.ffmpegPath, args);
+}
+
+void CapabilityProbe::onStepFinished(Step step, QProcess *process)
+{
+    if (!m_processes.removeOne(process)) {
+        return;
+    }
+    const QByteArray output = process->readAllStandardOutput();
+    const bool ok = process->exitStatus() == QProcess::NormalExit && process->exitCode() == 0;
+    process->disconnect(this);
+    process->deleteLater();
+
+    switch (step) {
+    case Step::Encoders:
+        if (!ok) {
+            // Not a usable ffmpeg; leave the capabilities invalid so nothing gets filtered.
+            finish();
+            return;
+        }
+        m_capabilities.encoders = FfmpegCapabilities::parseEncoders(output);
+        runStep(Step::Filters);
+        return;
+    case Step::Filters:
+        m_capabilities.filters = FfmpegCapabilities::parseFilters(output);
+        runStep(Step::Hwaccels);
+        return;
+    case Step::Hwaccels:
+        m_capabilities.hwaccels = FfmpegCapabilities::parseHwaccels(output);
+        m_capabilities.valid = !m_capabilities.encoders.isEmpty();
+        testHardwareEncoders();
+        return;
+    }
+}
+
+void CapabilityProbe::testHardwareEncoders()
+{
+    // A listed hardware encoder only means it was compiled in; opening a session proves the GPU and driver exist.
+    for (const QString &encoder : hardwareEncoders()) {
+        if (!m_capabilities.encoders.contains(encoder)) {
+            continue;
+        }
+        auto *process = new QProcess(this);
+        process->setProcessChannelMode(QProcess::MergedChannels);
+        m_processes.append(process);
+        ++m_pendingTests;
+        connect(process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+                [this, encoder, process]() { onHardwareTestFinished(encoder, process); });
+        connect(process, &QProcess::errorOccurred, this, [this, encoder, process](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                QTimer::singleShot(0, this, [this, encoder, process]() { onHardwareTestFinished(encoder, process); });
+            }
+        });
+        QTimer::singleShot(kHardwareTestTimeoutMs, process, [process]() { process->kill(); });
+        process->start(m_capabilities.ffmpegPath, {
+            QStringLiteral("-hide_banner"), QStringLiteral("-v"), QStringLiteral("error"),
+            QStringLiteral("-f"), QStringLiteral("lavfi"), QStringLiteral("-i"), QStringLiteral("color=c=black:s=256x256:r=25"),
+            QStringLiteral("-frames:v"), QStringLiteral("5"),
+            QStringLiteral("-c:v"), encoder,
+            QStringLiteral("-f"), QStringLiteral("null"), QStringLiteral("-")
+        });
+    }
+    if (m_pendingTests == 0) {
+        finish();
+    }
+}
+
+void CapabilityProbe::onHardwareTestFinished(const QString &encoder, QProcess *process)
+{
+    if (!m_processes.removeOne(process)) {
+        return;
+    }
+    if (process->exitStatus() == QProcess::NormalExit && process->exitCode() == 0) {
+        m_capabilities.workingHardwareEncoders.insert(encoder);
+    }
+    process->disconnect(this);
+    process->deleteLater();
+    if (--m_pendingTests == 0) {
+        finish();
+    }
+}
+
+void CapabilityProbe::finish()
+{
+    if (!m_listingsCached && m_capabilities.valid) {
+        saveCached();
+    }
+    m_running = false;
+    emit finished(m_capabilities);
+}
+
+bool CapabilityProbe::loadCached()
+{
+    QFile file(cachePath());
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QJsonObject entry = QJsonDocument::fromJson(file.readAll()).object().value(cacheKey(m_capabilities.ffmpegPath)).toObject();
+    if (entry.isEmpty()
+        || entry.value(QStringLiteral("size")).toInteger() != m_binarySize
+        || entry.value(QStringLiteral("mtime")).toInteger() != m_binaryModified.toMSecsSinceEpoch()) {
+        return false;
+    }
+    const QStringList encoders = fromJsonArray(entry.value(QStringLiteral("encoders")));
+    const QStringList filters = fromJsonArray(entry.value(QStringLiteral("filters")));
+    m_capabilities.encoders = QSet<QString>(encoders.cbegin(), encoders.cend());
+    m_capabilities.filters = QSet<QString>(filters.cbegin(), filters.cend());
+    m_capabilities.hwaccels = fromJsonArray(entry.value(QStringLiteral("hwaccels")));
+    m_capabilities.valid = !m_capabilities.encoders.isEmpty();
+    return m_capabilities.valid;
+}
+
+void CapabilityProbe::saveCached() const
+{
+    QJsonObject root;
+    QFile existing(cachePath());
+    if (existing.open(QIODevice::ReadOnly)) {
+        root = QJsonDocument::fromJson(existing.readAll()).object();
+        existing.close();
+    }
+    QJsonObject entry;
+    entry.insert(QStringLiteral("size"), m_binarySize);
+    entry.insert(QStringLiteral("mtime"), m_binaryModified.toMSecsSinceEpoch());
+    entry.insert(QStringLiteral("encoders"), toJsonArray(sorted(m_capabilities.encoders)));
+    entry.insert(QStringLiteral("filters"), toJsonArray(sorted(m_capabilities.filters)));
+    entry.insert(QStringLiteral("hwaccels"), toJsonArray(m_capabilities.hwaccels));
+    root.insert(cacheKey(m_capabilities.ffmpegPath), entry);
+
+    QDir().mkpath(QFileInfo(cachePath()).absolutePath());
+    QSaveFile file(cachePath());
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QByteArray>
+#include <QDateTime>
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+
+class QProcess;
+
+// What an ffmpeg binary can actually do: compiled-in encoders, filters and
+// hwaccels, plus which hardware encoders opened a session on this machine.
+struct FfmpegCapabilities {
+    bool valid = false;
+    QString ffmpegPath;
+    QSet<QString> encoders;
+    QSet<QString> filters;
+    QStringList hwaccels;
+    // Hardware encoders that completed a short test encode; the rest are listed but unusable.
+    QSet<QString> workingHardwareEncoders;
+
+    [[nodiscard]] bool hasEncoder(const QString &name) const;
+    [[nodiscard]] bool hasFilter(const QString &name) const { return filters.contains(name); }
+
+    static bool isHardwareEncoder(const QString &name);
+    static QSet<QString> parseEncoders(const QByteArray &output);
+    static QSet<QString> parseFilters(const QByteArray &output);
+    static QStringList parseHwaccels(const QByteArray &output);
+};
+
+// Probes an ffmpeg binary (-encoders, -filters, -hwaccels, then a tiny test
+// encode per hardware encoder in parallel). The listings only depend on the
+// binary and are cached keyed by its path, size and modification time, so
+// later starts skip them; replacing the binary re-probes it. Hardware sessions
+// depend on drivers and GPUs as well and are tested on every start.
+class CapabilityProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit CapabilityProbe(QObject *parent = nullptr);
+    ~CapabilityProbe() override;
+
+    // Emits finished() asynchronously, also on a cache hit.
+    void start(const QString &ffmpegPath);
+    [[nodiscard]] bool isRunning() const noexcept { return m_running; }
+    [[nodiscard]] const FfmpegCapabilities &capabilities() const noexcept { return m_capabilities; }
+
+    static QString cachePath();
+
+signals:
+    void finished(const FfmpegCapabilities &capabilities);
+
+private:
+    enum class Step {
+        Encoders,
+        Filters,
+        Hwaccels
+    };
+
+    void runStep(Step step);
+    void onStepFinished(Step step, QProcess *process);
+    void testHardwareEncoders();
+    void onHardwareTestFinished(const QString &encoder, QProcess *process);
+    void finish();
+    bool loadCached();
+    void saveCached() const;
+
+    FfmpegCapabilities m_capabilities;
+    QDateTime m_binaryModified;
+    qint64 m_binarySize = 0;
+    QList<QProcess *> m_processes;
+    int m_pendingTests = 0;
+    bool m_listingsCached = false;
+    bool m_running = false;
+};
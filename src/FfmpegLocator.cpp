@@ -0,0 +1,75 @@
+#include "FfmpegLocator.h"
+
+#include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QMetaObject>
+#include <QPointer>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <utility>
+
+namespace {
+QString locateExecutable(const QString &program)
+{
+    QString baseName = program;
+#ifdef Q_OS_WIN
+    if (!baseName.endsWith(QStringLiteral(".exe"), Qt::CaseInsensitive)) {
+        baseName.append(QStringLiteral(".exe"));
+    }
+#endif
+
+    const QString appDir = QCoreApplication::applicationDirPath();
+    const QStringList candidates{
+        QDir(appDir).filePath(QStringLiteral("ffmpeg/bin/%1").arg(baseName)),
+        QDir(appDir).filePath(QStringLiteral("ffmpeg/%1").arg(baseName)),
+        QDir(appDir).filePath(baseName),
+        program,
+        baseName
+    };
+
+    for (const QString &candidate : candidates) {
+        const QFileInfo info(candidate);
+        if (info.exists() && info.isFile()) {
+            return info.absoluteFilePath();
+        }
+    }
+    return QStandardPaths::findExecutable(program);
+}
+
+QString locateWithOverride(const char *variable, const QString &program)
+{
+    const QByteArray overrideValue = qgetenv(variable);
+    if (!overrideValue.isEmpty()) {
+        const QFileInfo overrideInfo(QString::fromLocal8Bit(overrideValue));
+        if (overrideInfo.exists() && overrideInfo.isFile()) {
+            return overrideInfo.absoluteFilePath();
+        }
+    }
+    return locateExecutable(program);
+}
+} // namespace
+
+QString locateFfmpeg()
+{
+    return locateWithOverride("NISEYUKI_FFMPEG", QStringLiteral("ffmpeg"));
+}
+
+QString locateFfprobe()
+{
+    return locateWithOverride("NISEYUKI_FFPROBE", QStringLiteral("ffprobe"));
+}
+
+void locateFfmpegAsync(QObject *context, std::function<void(const QString &ffmpegPath, const QString &ffprobePath)> done)
+{
+    QThreadPool::globalInstance()->start([context = QPointer<QObject>(context), done = std::move(done)]() {
+        const QString ffmpegPath = locateFfmpeg();
+        const QString ffprobePath = locateFfprobe();
+        if (!context) {
+            return;
+        }
+        QMetaObject::invokeMethod(context, [done, ffmpegPath, ffprobePath]() { done(ffmpegPath, ffprobePath); }, Qt::QueuedConnection);
+    });
+}
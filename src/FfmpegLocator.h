@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QString>
+
+#include <functional>
+
+class QObject;
+
+// Resolution order: NISEYUKI_FFMPEG / NISEYUKI_FFPROBE, the bundled ffmpeg folder
+// next to the executable, then the system PATH.
+QString locateFfmpeg();
+QString locateFfprobe();
+
+// Resolves both on the global thread pool, since a PATH scan can stall on slow or
+// network drives, and calls done on context's thread. Nothing is called if context is gone.
+void locateFfmpegAsync(QObject *context, std::function<void(const QString &ffmpegPath, const QString &ffprobePath)> done);
@@ -0,0 +1,610 @@
+#include "FontIndex.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSet>
+#include <QStandardPaths>
+#include <QStringDecoder>
+#include <QThread>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+constexpr char kMagic[8] = {'N', 'S', 'Y', 'F', 'N', 'T', '0', '1'};
+constexpr char32_t kMaxCodePoint = 0x10FFFF;
+
+struct CacheHeader {
+    char magic[8];
+    quint32 fileCount;
+    quint32 reserved;
+};
+
+// A font file as last seen on disk; files that hold no usable face are kept
+// too, so they are not parsed again on every refresh.
+struct FontFile {
+    QString path;
+    qint64 size = 0;
+    qint64 modified = 0;
+    QList<FontFace> faces;
+};
+
+using CoverageRanges = QList<std::pair<char32_t, char32_t>>;
+
+quint16 readU16(const uchar *p)
+{
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+quint32 readU32(const uchar *p)
+{
+    return (static_cast<quint32>(p[0]) << 24) | (static_cast<quint32>(p[1]) << 16) | (static_cast<quint32>(p[2]) << 8) | p[3];
+}
+
+constexpr quint32 tag(const char (&name)[5])
+{
+    return (static_cast<quint32>(name[0]) << 24) | (static_cast<quint32>(name[1]) << 16) | (static_cast<quint32>(name[2]) << 8)
+        | static_cast<quint32>(name[3]);
+}
+
+struct Table {
+    const uchar *data = nullptr;
+    quint32 length = 0;
+};
+
+// Looks a table up in the directory of the face starting at faceOffset.
+Table findTable(const uchar *file, qint64 fileSize, quint32 faceOffset, quint32 wanted)
+{
+    if (static_cast<qint64>(faceOffset) + 12 > fileSize) {
+        return {};
+    }
+    const quint16 tableCount = readU16(file + faceOffset + 4);
+    for (quint16 i = 0; i < tableCount; ++i) {
+        const qint64 record = static_cast<qint64>(faceOffset) + 12 + i * 16;
+        if (record + 16 > fileSize) {
+            break;
+        }
+        if (readU32(file + record) != wanted) {
+            continue;
+        }
+        const quint32 offset = readU32(file + record + 8);
+        const quint32 length = readU32(file + record + 12);
+        if (static_cast<qint64>(offset) + length > fileSize) {
+            return {};
+        }
+        return {file + offset, length};
+    }
+    return {};
+}
+
+void addRange(CoverageRanges &ranges, char32_t first, char32_t last)
+{
+    if (!ranges.isEmpty() && ranges.last().second + 1 == first) {
+        ranges.last().second = last;
+    } else {
+        ranges.append({first, last});
+    }
+}
+
+CoverageRanges mergeRanges(CoverageRanges ranges)
+{
+    std::sort(ranges.begin(), ranges.end());
+    CoverageRanges merged;
+    for (const auto &range : std::as_const(ranges)) {
+        if (!merged.isEmpty() && range.first <= merged.last().second + 1) {
+            merged.last().second = std::max(merged.last().second, range.second);
+        } else {
+            merged.append(range);
+        }
+    }
+    return merged;
+}
+
+CoverageRanges parseCmapFormat4(const uchar *sub, quint32 length)
+{
+    CoverageRanges ranges;
+    if (length < 14) {
+        return ranges;
+    }
+    const quint16 segCount = readU16(sub + 6) / 2;
+    const quint32 endCodes = 14;
+    const quint32 startCodes = endCodes + segCount * 2 + 2;
+    const quint32 deltas = startCodes + segCount * 2;
+    const quint32 rangeOffsets = deltas + segCount * 2;
+    if (rangeOffsets + segCount * 2 > length) {
+        return ranges;
+    }
+    for (quint16 seg = 0; seg < segCount; ++seg) {
+        const quint16 end = readU16(sub + endCodes + seg * 2);
+        const quint16 start = readU16(sub + startCodes + seg * 2);
+        const quint16 delta = readU16(sub + deltas + seg * 2);
+        const quint32 rangeOffsetPos = rangeOffsets + seg * 2;
+        const quint16 rangeOffset = readU16(sub + rangeOffsetPos);
+        for (quint32 c = start; c <= end && c < 0xFFFF; ++c) {
+            quint16 glyph = 0;
+            if (rangeOffset == 0) {
+                glyph = static_cast<quint16>(c + delta);
+            } else {
+                const quint32 address = rangeOffsetPos + rangeOffset + (c - start) * 2;
+                if (address + 2 > length) {
+                    break;
+                }
+                glyph = readU16(sub + address);
+                if (glyph != 0) {
+                    glyph = static_cast<quint16>(glyph + delta);
+                }
+            }
+            if (glyph != 0) {
+                addRange(ranges, c, c);
+            }
+        }
+    }
+    return ranges;
+}
+
+CoverageRanges parseCmapFormat12(const uchar *sub, quint32 length)
+{
+    CoverageRanges ranges;
+    if (length < 16) {
+        return ranges;
+    }
+    const quint32 groups = readU32(sub + 12);
+    for (quint32 i = 0; i < groups && 16 + (i + 1) * 12 <= length; ++i) {
+        const char32_t first = readU32(sub + 16 + i * 12);
+        const char32_t last = readU32(sub + 16 + i * 12 + 4);
+        if (first <= last && last <= kMaxCodePoint) {
+            ranges.append({first, last});
+        }
+    }
+    return ranges;
+}
+
+CoverageRanges parseCmap(const Table &cmap)
+{
+    if (cmap.length < 4) {
+        return {};
+    }
+    // Full-repertoire Unicode subtables first, then BMP ones, then the symbol encoding.
+    const uchar *best = nullptr;
+    quint32 bestLength = 0;
+    int bestRank = 0;
+    bool symbol = false;
+    const quint16 count = readU16(cmap.data + 2);
+    for (quint16 i = 0; i < count && 4 + (i + 1) * 8 <= cmap.length; ++i) {
+        const uchar *record = cmap.data + 4 + i * 8;
+        const quint16 platform = readU16(record);
+        const quint16 encoding = readU16(record + 2);
+        const quint32 offset = readU32(record + 4);
+        if (static_cast<qint64>(offset) + 4 > cmap.length) {
+            continue;
+        }
+        const quint16 format = readU16(cmap.data + offset);
+        int rank = 0;
+        if (format == 12 && (platform == 0 || (platform == 3 && encoding == 10))) {
+            rank = 3;
+        } else if (format == 4 && (platform == 0 || (platform == 3 && encoding == 1))) {
+            rank = 2;
+        } else if (format == 4 && platform == 3 && encoding == 0) {
+            rank = 1;
+        }
+        if (rank > bestRank) {
+            bestRank = rank;
+            best = cmap.data + offset;
+            bestLength = cmap.length - offset;
+            symbol = rank == 1;
+        }
+    }
+    if (!best) {
+        return {};
+    }
+    CoverageRanges ranges = bestRank == 3 ? parseCmapFormat12(best, bestLength) : parseCmapFormat4(best, bestLength);
+    if (symbol) {
+        // Symbol fonts map their glyphs at U+F0xx; libass also looks plain 8-bit codes up there.
+        const qsizetype mapped = ranges.size();
+        for (qsizetype i = 0; i < mapped; ++i) {
+            const auto range = ranges.at(i);
+            if (range.first >= 0xF000 && range.second <= 0xF0FF) {
+                ranges.append({range.first - 0xF000, range.second - 0xF000});
+            }
+        }
+    }
+    return mergeRanges(std::move(ranges));
+}
+
+struct FaceNames {
+    QString family;
+    QString style;
+    QStringList names;
+};
+
+FaceNames parseNames(const Table &name)
+{
+    constexpr quint16 kFamily = 1;
+    constexpr quint16 kSubfamily = 2;
+    constexpr quint16 kFullName = 4;
+    constexpr quint16 kPostScript = 6;
+    constexpr quint16 kTypographicFamily = 16;
+    constexpr quint16 kTypographicSubfamily = 17;
+
+    FaceNames result;
+    if (name.length < 6) {
+        return result;
+    }
+    const quint16 count = readU16(name.data + 2);
+    const quint16 storage = readU16(name.data + 4);
+    QHash<quint16, QString> english;
+    QHash<quint16, QString> any;
+    QSet<QString> names;
+    for (quint16 i = 0; i < count && 6 + (i + 1) * 12 <= name.length; ++i) {
+        const uchar *record = name.data + 6 + i * 12;
+        const quint16 platform = readU16(record);
+        const quint16 encoding = readU16(record + 2);
+        const quint16 language = readU16(record + 4);
+        const quint16 id = readU16(record + 6);
+        const quint16 length = readU16(record + 8);
+        const quint32 offset = storage + readU16(record + 10);
+        if (offset + length > name.length) {
+            continue;
+        }
+        if (id != kFamily && id != kSubfamily && id != kFullName && id != kPostScript && id != kTypographicFamily
+            && id != kTypographicSubfamily) {
+            continue;
+        }
+        const char *bytes = reinterpret_cast<const char *>(name.data + offset);
+        QString value;
+        if (platform == 0 || platform == 3) {
+            auto decode = QStringDecoder(QStringDecoder::Utf16BE);
+            value = decode(QByteArrayView(bytes, length));
+        } else if (platform == 1 && encoding == 0) {
+            value = QString::fromLatin1(bytes, length);
+        } else {
+            continue;
+        }
+        value = value.trimmed();
+        if (value.isEmpty()) {
+            continue;
+        }
+        const bool isEnglish = (platform == 3 && language == 0x0409) || (platform == 1 && language == 0);
+        if (isEnglish && !english.contains(id)) {
+            english.insert(id, value);
+        }
+        if (!any.contains(id)) {
+            any.insert(id, value);
+        }
+        if (id != kSubfamily && id != kTypographicSubfamily) {
+            names.insert(value.toLower());
+        }
+    }
+    const auto pick = [&](quint16 preferred, quint16 fallback) {
+        for (const quint16 id : {preferred, fallback}) {
+            if (english.contains(id)) {
+                return english.value(id);
+            }
+            if (any.contains(id)) {
+                return any.value(id);
+            }
+        }
+        return QString();
+    };
+    result.family = pick(kTypographicFamily, kFamily);
+    result.style = pick(kTypographicSubfamily, kSubfamily);
+    result.names = names.values();
+    return result;
+}
+
+QList<FontFace> parseFontFile(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() < 12) {
+        return {};
+    }
+    const qint64 size = file.size();
+    QByteArray contents;
+    const uchar *data = file.map(0, size);
+    if (!data) {
+        contents = file.readAll();
+        data = reinterpret_cast<const uchar *>(contents.constData());
+    }
+
+    QList<quint32> faceOffsets;
+    if (readU32(data) == tag("ttcf")) {
+        const quint32 faces = readU32(data + 8);
+        for (quint32 i = 0; i < faces && 12 + (i + 1) * 4 <= size; ++i) {
+            faceOffsets.append(readU32(data + 12 + i * 4));
+        }
+    } else {
+        faceOffsets.append(0);
+    }
+
+    QList<FontFace> faces;
+    for (qsizetype i = 0; i < faceOffsets.size(); ++i) {
+        const quint32 offset = faceOffsets.at(i);
+        const FaceNames names = parseNames(findTable(data, size, offset, tag("name")));
+        if (names.family.isEmpty()) {
+            continue;
+        }
+        FontFace face;
+        face.path = path;
+        face.faceIndex = static_cast<int>(i);
+        face.family = names.family;
+        face.style = names.style;
+        face.names = names.names;
+        const Table os2 = findTable(data, size, offset, tag("OS/2"));
+        const Table head = findTable(data, size, offset, tag("head"));
+        if (os2.length >= 64) {
+            face.weight = readU16(os2.data + 4);
+            face.italic = (readU16(os2.data + 62) & 0x0201) != 0; // ITALIC or OBLIQUE
+        } else if (head.length >= 46) {
+            const quint16 macStyle = readU16(head.data + 44);
+            face.weight = (macStyle & 0x1) ? 700 : 400;
+            face.italic = (macStyle & 0x2) != 0;
+        }
+        face.coverage = parseCmap(findTable(data, size, offset, tag("cmap")));
+        faces.append(face);
+    }
+    return faces;
+}
+
+QDataStream &operator<<(QDataStream &out, const FontFace &face)
+{
+    out << qint32(face.faceIndex) << face.family << face.style << face.names << qint32(face.weight) << face.italic
+        << quint32(face.coverage.size());
+    for (const auto &range : face.coverage) {
+        out << quint32(range.first) << quint32(range.second);
+    }
+    return out;
+}
+
+QDataStream &operator>>(QDataStream &in, FontFace &face)
+{
+    qint32 faceIndex = 0;
+    qint32 weight = 0;
+    quint32 ranges = 0;
+    in >> faceIndex >> face.family >> face.style >> face.names >> weight >> face.italic >> ranges;
+    face.faceIndex = faceIndex;
+    face.weight = weight;
+    face.coverage.clear();
+    for (quint32 i = 0; i < ranges && in.status() == QDataStream::Ok; ++i) {
+        quint32 first = 0;
+        quint32 last = 0;
+        in >> first >> last;
+        face.coverage.append({first, last});
+    }
+    return in;
+}
+
+QHash<QString, FontFile> loadCache(const QString &path)
+{
+    QHash<QString, FontFile> files;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return files;
+    }
+    CacheHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != static_cast<qint64>(sizeof(header))
+        || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0) {
+        return files;
+    }
+    // The catalog keeps its own copy of every face, so entries are streamed from the file.
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_6_5);
+    for (quint32 i = 0; i < header.fileCount && in.status() == QDataStream::Ok; ++i) {
+        FontFile entry;
+        quint32 faceCount = 0;
+        in >> entry.path >> entry.size >> entry.modified >> faceCount;
+        for (quint32 f = 0; f < faceCount && in.status() == QDataStream::Ok; ++f) {
+            FontFace face;
+            in >> face;
+            face.path = entry.path;
+            entry.faces.append(face);
+        }
+        files.insert(entry.path, entry);
+    }
+    if (in.status() != QDataStream::Ok) {
+        files.clear();
+    }
+    return files;
+}
+
+bool saveCache(const QString &path, const QList<FontFile> &files)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    CacheHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.fileCount = static_cast<quint32>(files.size());
+    header.reserved = 0;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_6_5);
+    for (const FontFile &entry : files) {
+        out << entry.path << entry.size << entry.modified << quint32(entry.faces.size());
+        for (const FontFace &face : entry.faces) {
+            out << face;
+        }
+    }
+    return file.commit();
+}
+
+QStringList enumerateFontFiles(const QStringList &directories)
+{
+    const QStringList filters{QStringLiteral("*.ttf"), QStringLiteral("*.otf"), QStringLiteral("*.ttc"), QStringLiteral("*.otc")};
+    QSet<QString> seen;
+    QStringList paths;
+    for (const QString &directory : directories) {
+        QDirIterator it(directory, filters, QDir::Files | QDir::Readable, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            const QString path = QFileInfo(it.next()).canonicalFilePath();
+            if (!path.isEmpty() && !seen.contains(path)) {
+                seen.insert(path);
+                paths.append(path);
+            }
+        }
+    }
+    return paths;
+}
+} // namespace
+
+bool FontFace::covers(char32_t codePoint) const
+{
+    const auto it = std::upper_bound(coverage.cbegin(), coverage.cend(), codePoint,
+                                     [](char32_t value, const std::pair<char32_t, char32_t> &range) { return value < range.first; });
+    return it != coverage.cbegin() && codePoint <= (it - 1)->second;
+}
+
+FontCatalog::FontCatalog(QList<FontFace> faces)
+    : m_faces(std::move(faces))
+{
+    for (int i = 0; i < m_faces.size(); ++i) {
+        for (const QString &name : m_faces.at(i).names) {
+            m_byName[name].append(i);
+        }
+    }
+}
+
+const FontFace *FontCatalog::match(const QString &name, bool bold, bool italic) const
+{
+    const auto it = m_byName.constFind(name.trimmed().toLower());
+    if (it == m_byName.cend()) {
+        return nullptr;
+    }
+    // Slant outweighs weight: libass fakes bold more convincingly than italic.
+    const int wantedWeight = bold ? 700 : 400;
+    const FontFace *best = nullptr;
+    int bestScore = 0;
+    for (const int index : it.value()) {
+        const FontFace &face = m_faces.at(index);
+        const int score = (face.italic == italic ? 0 : 1000) + std::abs(face.weight - wantedWeight);
+        if (!best || score < bestScore) {
+            best = &face;
+            bestScore = score;
+        }
+    }
+    return best;
+}
+
+FontIndex::FontIndex(QObject *parent)
+    : QObject(parent)
+{
+}
+
+FontIndex::~FontIndex()
+{
+    if (m_cancelled) {
+        *m_cancelled = true;
+    }
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+QStringList FontIndex::fontDirectories()
+{
+    QStringList candidates = QStandardPaths::standardLocations(QStandardPaths::FontsLocation);
+#if defined(Q_OS_WIN)
+    candidates << QDir(qEnvironmentVariable("WINDIR", QStringLiteral("C:/Windows"))).filePath(QStringLiteral("Fonts"));
+    const QString localAppData = qEnvironmentVariable("LOCALAPPDATA");
+    if (!localAppData.isEmpty()) {
+        // Per-user installs since Windows 10 1809.
+        candidates << QDir(localAppData).filePath(QStringLiteral("Microsoft/Windows/Fonts"));
+    }
+#elif defined(Q_OS_MACOS)
+    candidates << QStringLiteral("/System/Library/Fonts") << QStringLiteral("/Library/Fonts") << QDir::home().filePath(QStringLiteral("Library/Fonts"));
+#else
+    candidates << QStringLiteral("/usr/share/fonts") << QStringLiteral("/usr/local/share/fonts")
+               << QDir::home().filePath(QStringLiteral(".local/share/fonts")) << QDir::home().filePath(QStringLiteral(".fonts"));
+#endif
+    QStringList directories;
+    for (const QString &candidate : std::as_const(candidates)) {
+        const QString canonical = QFileInfo(candidate).canonicalFilePath();
+        if (!canonical.isEmpty() && QFileInfo(canonical).isDir() && !directories.contains(canonical)) {
+            directories.append(canonical);
+        }
+    }
+    return directories;
+}
+
+QString FontIndex::cachePath()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath(QStringLiteral("fonts.nfidx"));
+}
+
+void FontIndex::refresh()
+{
+    if (m_thread) {
+        return;
+    }
+    m_cancelled = std::make_shared<std::atomic_bool>(false);
+    m_thread = QThread::create([this, cancelled = m_cancelled]() {
+        const QString indexPath = cachePath();
+        const QHash<QString, FontFile> cached = loadCache(indexPath);
+        const QStringList paths = enumerateFontFiles(fontDirectories());
+
+        QList<FontFile> files(paths.size());
+        QList<int> stale;
+        for (int i = 0; i < paths.size(); ++i) {
+            const QFileInfo info(paths.at(i));
+            FontFile &entry = files[i];
+            entry.path = paths.at(i);
+            entry.size = info.size();
+            entry.modified = info.lastModified().toMSecsSinceEpoch();
+            const auto hit = cached.constFind(entry.path);
+            if (hit != cached.cend() && hit->size == entry.size && hit->modified == entry.modified) {
+                entry.faces = hit->faces;
+            } else {
+                stale.append(i);
+            }
+        }
+
+        // Each task fills its own slot, so the workers never touch shared state.
+        FontFile *slots = files.data();
+        QThreadPool pool;
+        pool.setMaxThreadCount(std::max(1, QThread::idealThreadCount()));
+        for (const int i : std::as_const(stale)) {
+            pool.start([slots, i, cancelled]() {
+                if (!*cancelled) {
+                    slots[i].faces = parseFontFile(slots[i].path);
+                }
+            });
+        }
+        pool.waitForDone();
+        if (*cancelled) {
+            return;
+        }
+        if (!stale.isEmpty() || files.size() != cached.size()) {
+            saveCache(indexPath, files);
+        }
+
+        QList<FontFace> faces;
+        for (const FontFile &entry : std::as_const(files)) {
+            faces.append(entry.faces);
+        }
+        auto catalog = std::make_shared<const FontCatalog>(std::move(faces));
+        const int parsed = static_cast<int>(stale.size());
+        QMetaObject::invokeMethod(this, [this, catalog, parsed]() { onRefreshed(catalog, parsed); }, Qt::QueuedConnection);
+    });
+    m_thread->setObjectName(QStringLiteral("FontIndex"));
+    m_thread->start(QThread::LowPriority);
+}
+
+void FontIndex::onRefreshed(std::shared_ptr<const FontCatalog> catalog, int parsedFiles)
+{
+    if (m_thread) {
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    m_catalog = std::move(catalog);
+    emit refreshed(m_catalog->faceCount(), parsedFiles);
+}
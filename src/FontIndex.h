@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+class QThread;
+
+// One face of an installed font file (collections hold several).
+struct FontFace {
+    QString path;
+    int faceIndex = 0;
+    QString family;
+    QString style;
+    QStringList names; // lower-case family, full and PostScript names in every language the font carries
+    int weight = 400;
+    bool italic = false;
+    QList<std::pair<char32_t, char32_t>> coverage; // sorted, merged code point ranges from the cmap
+
+    [[nodiscard]] bool covers(char32_t codePoint) const;
+    [[nodiscard]] bool isBold() const noexcept { return weight >= 600; }
+};
+
+// Immutable lookup over every indexed face; shared between threads once built.
+class FontCatalog
+{
+public:
+    FontCatalog() = default;
+    explicit FontCatalog(QList<FontFace> faces);
+
+    [[nodiscard]] int faceCount() const noexcept { return static_cast<int>(m_faces.size()); }
+    [[nodiscard]] bool contains(const QString &name) const { return m_byName.contains(name.toLower()); }
+    // The face libass would most likely pick for a family (or full name) with the given style, or null.
+    [[nodiscard]] const FontFace *match(const QString &name, bool bold, bool italic) const;
+
+private:
+    QList<FontFace> m_faces;
+    QHash<QString, QList<int>> m_byName;
+};
+
+// Indexes the system and user font directories on a background thread, reading
+// each file's name, OS/2 and cmap tables directly (collections included) several
+// files at a time. The result is cached on disk; a refresh only parses files
+// whose size or modification time changed.
+class FontIndex : public QObject
+{
+    Q_OBJECT
+public:
+    explicit FontIndex(QObject *parent = nullptr);
+    ~FontIndex() override;
+
+    void refresh();
+    [[nodiscard]] bool isRefreshing() const noexcept { return m_thread != nullptr; }
+    // Null until the first refresh finishes.
+    [[nodiscard]] std::shared_ptr<const FontCatalog> catalog() const { return m_catalog; }
+
+    static QStringList fontDirectories();
+    static QString cachePath();
+
+signals:
+    void refreshed(int faces, int parsedFiles);
+
+private:
+    void onRefreshed(std::shared_ptr<const FontCatalog> catalog, int parsedFiles);
+
+    QThread *m_thread = nullptr;
+    std::shared_ptr<std::atomic_bool> m_cancelled;
+    std::shared_ptr<const FontCatalog> m_catalog;
+};
@@ -0,0 +1,190 @@
+#include "HookRunner.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QProcess>
+#include <QProcessEnvironment>
+#include <QTimer>
+
+#include <algorithm>
+
+namespace {
+QString hookName(const QString &command)
+{
+    const QStringList parts = QProcess::splitCommand(command);
+    return parts.isEmpty() ? command : QFileInfo(parts.constFirst()).fileName();
+}
+} // namespace
+
+HookRunner::HookRunner(QObject *parent)
+    : QObject(parent)
+{
+}
+
+HookRunner::~HookRunner()
+{
+    for (Chain &chain : m_running) {
+        if (chain.process) {
+            chain.process->disconnect(this);
+            chain.process->kill();
+            chain.process->waitForFinished(1000);
+        }
+    }
+}
+
+void HookRunner::setConcurrency(int jobs)
+{
+    m_concurrency = std::max(jobs, 1);
+    schedule();
+}
+
+QStringList HookRunner::expandCommand(const QString &command, const EncodeJob &job)
+{
+    // Split first, so paths with spaces stay one argument after substitution.
+    QStringList args = QProcess::splitCommand(command);
+    for (QString &arg : args) {
+        arg.replace(QStringLiteral("{output}"), QDir::toNativeSeparators(job.resolvedOutputPath()));
+        arg.replace(QStringLiteral("{source}"), QDir::toNativeSeparators(job.videoPath));
+        arg.replace(QStringLiteral("{subtitle}"), QDir::toNativeSeparators(job.subtitlePath));
+        arg.replace(QStringLiteral("{job}"), QString::number(job.id));
+    }
+    return args;
+}
+
+void HookRunner::run(const EncodeJob &job)
+{
+    if (job.postEncodeHooks.isEmpty() || isRunning(job.id)) {
+        return;
+    }
+    m_pending.append(job.id);
+    m_pendingJobs.insert(job.id, job);
+    schedule();
+}
+
+void HookRunner::schedule()
+{
+    while (m_running.size() < m_concurrency && !m_pending.isEmpty()) {
+        const quint64 jobId = m_pending.takeFirst();
+        Chain chain;
+        chain.job = m_pendingJobs.take(jobId);
+        m_running.insert(jobId, chain);
+        startNext(jobId);
+    }
+}
+
+void HookRunner::startNext(quint64 jobId)
+{
+    Chain &chain = m_running[jobId];
+    if (chain.next >= chain.job.postEncodeHooks.size()) {
+        finishChain(jobId, true, tr("%n hook(s) finished", nullptr, static_cast<int>(chain.job.postEncodeHooks.size())));
+        return;
+    }
+    const QString command = chain.job.postEncodeHooks.at(chain.next);
+    QStringList args = expandCommand(command, chain.job);
+    if (args.isEmpty()) {
+        ++chain.next;
+        startNext(jobId);
+        return;
+    }
+    const QString program = args.takeFirst();
+
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("NISEYUKI_OUTPUT"), QDir::toNativeSeparators(chain.job.resolvedOutputPath()));
+    environment.insert(QStringLiteral("NISEYUKI_SOURCE"), QDir::toNativeSeparators(chain.job.videoPath));
+    environment.insert(QStringLiteral("NISEYUKI_SUBTITLE"), QDir::toNativeSeparators(chain.job.subtitlePath));
+    environment.insert(QStringLiteral("NISEYUKI_JOB_ID"), QString::number(jobId));
+
+    chain.process = new QProcess(this);
+    chain.process->setProcessEnvironment(environment);
+    chain.process->setProcessChannelMode(QProcess::MergedChannels);
+    chain.process->setWorkingDirectory(QFileInfo(chain.job.resolvedOutputPath()).absolutePath());
+    chain.buffer.clear();
+    chain.timedOut = false;
+    connect(chain.process, &QProcess::readyReadStandardOutput, this, [this, jobId]() { readOutput(jobId, false); });
+    connect(chain.process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+            [this, jobId](int exitCode, QProcess::ExitStatus status) { onHookFinished(jobId, exitCode, status == QProcess::CrashExit); });
+    connect(chain.process, &QProcess::errorOccurred, this, [this, jobId](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            // Queued: this can fire from inside start().
+            QMetaObject::invokeMethod(this, [this, jobId]() { onHookFinished(jobId, -1, true); }, Qt::QueuedConnection);
+        }
+    });
+
+    if (m_timeoutMs > 0) {
+        chain.timer = new QTimer(this);
+        chain.timer->setSingleShot(true);
+        connect(chain.timer, &QTimer::timeout, this, [this, jobId]() {
+            const auto it = m_running.find(jobId);
+            if (it != m_running.end() && it->process) {
+                it->timedOut = true;
+                it->process->kill();
+            }
+        });
+        chain.timer->start(m_timeoutMs);
+    }
+    emit outputReceived(jobId, tr("Running hook: %1").arg(command));
+    chain.process->start(program, args);
+}
+
+void HookRunner::readOutput(quint64 jobId, bool flush)
+{
+    const auto it = m_running.find(jobId);
+    if (it == m_running.end() || !it->process) {
+        return;
+    }
+    it->buffer.append(it->process->readAllStandardOutput());
+    int start = 0;
+    int newline = -1;
+    while ((newline = it->buffer.indexOf('\n', start)) >= 0) {
+        const QString line = QString::fromLocal8Bit(it->buffer.mid(start, newline - start)).trimmed();
+        start = newline + 1;
+        if (!line.isEmpty()) {
+            emit outputReceived(jobId, line);
+        }
+    }
+    it->buffer.remove(0, start);
+    if (flush && !it->buffer.trimmed().isEmpty()) {
+        emit outputReceived(jobId, QString::fromLocal8Bit(it->buffer).trimmed());
+        it->buffer.clear();
+    }
+}
+
+void HookRunner::onHookFinished(quint64 jobId, int exitCode, bool crashed)
+{
+    const auto it = m_running.find(jobId);
+    if (it == m_running.end() || !it->process) {
+        return;
+    }
+    readOutput(jobId, true);
+    const QString command = it->job.postEncodeHooks.at(it->next);
+    const bool timedOut = it->timedOut;
+    const QString errorString = it->process->errorString();
+    it->process->disconnect(this);
+    it->process->deleteLater();
+    it->process = nullptr;
+    if (it->timer) {
+        it->timer->stop();
+        it->timer->deleteLater();
+        it->timer = nullptr;
+    }
+
+    if (timedOut) {
+        finishChain(jobId, false, tr("Hook %1 timed out after %2 s").arg(hookName(command)).arg(m_timeoutMs / 1000));
+        return;
+    }
+    if (crashed || exitCode != 0) {
+        // Later hooks usually depend on earlier ones (checksum before move), so the chain stops here.
+        finishChain(jobId, false, crashed ? tr("Hook %1 failed: %2").arg(hookName(command), errorString)
+                                          : tr("Hook %1 exited with code %2").arg(hookName(command)).arg(exitCode));
+        return;
+    }
+    ++it->next;
+    startNext(jobId);
+}
+
+void HookRunner::finishChain(quint64 jobId, bool success, const QString &message)
+{
+    m_running.remove(jobId);
+    emit finished(jobId, success, message);
+    schedule();
+}
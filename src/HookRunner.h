@@ -0,0 +1,62 @@
+#pragma once
+
+#include "EncodeJob.h"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class QProcess;
+class QTimer;
+
+// Runs a finished job's post-encode hooks (checksums, renames, moves to a
+// sync folder) as separate processes. A job's hooks run in order and stop at
+// the first failure; hooks of different jobs run in parallel up to the
+// concurrency cap, next to whatever the encoder is doing.
+//
+// Each hook is a command line; {output}, {source}, {subtitle} and {job} are
+// replaced per argument, and the same values are exported as
+// NISEYUKI_OUTPUT, NISEYUKI_SOURCE, NISEYUKI_SUBTITLE and NISEYUKI_JOB_ID.
+class HookRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HookRunner(QObject *parent = nullptr);
+    ~HookRunner() override;
+
+    void setConcurrency(int jobs);
+    void setTimeoutMs(int timeoutMs) { m_timeoutMs = timeoutMs; }
+
+    void run(const EncodeJob &job);
+    [[nodiscard]] bool isRunning(quint64 jobId) const { return m_running.contains(jobId) || m_pending.contains(jobId); }
+
+    static QStringList expandCommand(const QString &command, const EncodeJob &job);
+
+signals:
+    void outputReceived(quint64 jobId, const QString &line);
+    void finished(quint64 jobId, bool success, const QString &message);
+
+private:
+    struct Chain {
+        EncodeJob job;
+        int next = 0;
+        QProcess *process = nullptr;
+        QTimer *timer = nullptr;
+        QByteArray buffer;
+        bool timedOut = false;
+    };
+
+    void schedule();
+    void startNext(quint64 jobId);
+    void readOutput(quint64 jobId, bool flush);
+    void onHookFinished(quint64 jobId, int exitCode, bool crashed);
+    void finishChain(quint64 jobId, bool success, const QString &message);
+
+    QHash<quint64, Chain> m_running;
+    QList<quint64> m_pending;
+    QHash<quint64, EncodeJob> m_pendingJobs;
+    int m_concurrency = 2;
+    int m_timeoutMs = 300000;
+};
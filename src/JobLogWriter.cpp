@@ -0,0 +1,128 @@
+#include "JobLogWriter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <utility>
+
+namespace {
+constexpr int kKeptLogs = 200;
+
+void pruneOldLogs(const QString &directory)
+{
+    const QFileInfoList logs = QDir(directory).entryInfoList({QStringLiteral("*.log")}, QDir::Files, QDir::Time);
+    for (qsizetype i = kKeptLogs; i < logs.size(); ++i) {
+        QFile::remove(logs.at(i).absoluteFilePath());
+    }
+}
+} // namespace
+
+JobLogWriter::~JobLogWriter()
+{
+    if (!m_thread) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_stopping = true;
+        m_wake.wakeOne();
+    }
+    // Whatever is still queued gets written before the thread exits.
+    m_thread->wait();
+    delete m_thread;
+}
+
+QString JobLogWriter::logDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation)).filePath(QStringLiteral("logs"));
+}
+
+QString JobLogWriter::auxiliaryLogDirectory()
+{
+    return QDir(logDirectory()).filePath(QStringLiteral("auxiliary"));
+}
+
+void JobLogWriter::open(const QString &path)
+{
+    m_path = path;
+    if (!m_thread) {
+        m_thread = QThread::create([this]() { run(); });
+        m_thread->setObjectName(QStringLiteral("JobLogWriter"));
+        m_thread->start(QThread::LowPriority);
+    }
+    enqueue(Command::Kind::Open, path.toUtf8());
+}
+
+void JobLogWriter::append(const QByteArray &line)
+{
+    if (!m_path.isEmpty()) {
+        enqueue(Command::Kind::Write, line);
+    }
+}
+
+void JobLogWriter::close()
+{
+    if (!m_path.isEmpty()) {
+        m_path.clear();
+        enqueue(Command::Kind::Close, QByteArray());
+    }
+}
+
+void JobLogWriter::enqueue(Command::Kind kind, const QByteArray &payload)
+{
+    QMutexLocker locker(&m_mutex);
+    if (kind == Command::Kind::Write && !m_commands.isEmpty() && m_commands.last().kind == Command::Kind::Write) {
+        // Lines queued while the writer is busy go out in one write.
+        m_commands.last().payload.append(payload).append('\n');
+        return;
+    }
+    m_commands.append({kind, kind == Command::Kind::Write ? payload + '\n' : payload});
+    m_wake.wakeOne();
+}
+
+void JobLogWriter::run()
+{
+    QFile file;
+    for (;;) {
+        QList<Command> commands;
+        {
+            QMutexLocker locker(&m_mutex);
+            while (m_commands.isEmpty() && !m_stopping) {
+                m_wake.wait(&m_mutex);
+            }
+            if (m_commands.isEmpty()) {
+                break;
+            }
+            commands = std::exchange(m_commands, {});
+        }
+        for (const Command &command : std::as_const(commands)) {
+            switch (command.kind) {
+            case Command::Kind::Open: {
+                file.close();
+                const QString path = QString::fromUtf8(command.payload);
+                QDir().mkpath(QFileInfo(path).absolutePath());
+                file.setFileName(path);
+                if (file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+                    pruneOldLogs(QFileInfo(path).absolutePath());
+                }
+                break;
+            }
+            case Command::Kind::Write:
+                if (file.isOpen()) {
+                    file.write(command.payload);
+                }
+                break;
+            case Command::Kind::Close:
+                file.close();
+                break;
+            }
+        }
+        // Flushed per batch so a crash loses at most what was queued since the last one.
+        file.flush();
+    }
+    file.close();
+}
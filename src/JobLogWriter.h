@@ -0,0 +1,53 @@
+#pragma once
+
+#include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <QString>
+#include <QWaitCondition>
+
+class QThread;
+
+// Appends ffmpeg's stderr to one log file per job. Callers only queue lines;
+// opening, writing and flushing happen on a low-priority thread, so a slow disk
+// never holds up the thread parsing ffmpeg's output.
+class JobLogWriter
+{
+public:
+    JobLogWriter() = default;
+    ~JobLogWriter();
+    JobLogWriter(const JobLogWriter &) = delete;
+    JobLogWriter &operator=(const JobLogWriter &) = delete;
+
+    // Starts a new file, closing the previous one once its queued lines are written.
+    void open(const QString &path);
+    void append(const QByteArray &line);
+    void close();
+    [[nodiscard]] QString path() const { return m_path; }
+
+    // Per-job logs live here; only the most recent ones are kept.
+    static QString logDirectory();
+    // Sample, CRF-probe and benchmark encodes log here, with their own retention.
+    static QString auxiliaryLogDirectory();
+
+private:
+    struct Command {
+        enum class Kind {
+            Open,
+            Write,
+            Close
+        };
+        Kind kind;
+        QByteArray payload;
+    };
+
+    void enqueue(Command::Kind kind, const QByteArray &payload);
+    void run();
+
+    QThread *m_thread = nullptr;
+    QMutex m_mutex;
+    QWaitCondition m_wake;
+    QList<Command> m_commands;
+    bool m_stopping = false;
+    QString m_path;
+};
@@ -0,0 +1,347 @@
+#include "JobPipeline.h"
+
+#include "AssFontScanner.h"
+#include "DurationModel.h"
+#include "FfmpegLocator.h"
+#include "FontIndex.h"
+#include "SourceIndex.h"
+#include "TimeUtils.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace {
+// A verified output may differ from the encoded window by this much (rounding, final GOP).
+constexpr qint64 kDurationToleranceMs = 1000;
+constexpr double kDurationToleranceRatio = 0.01;
+
+JobPipeline::Stage nextStage(JobPipeline::Stage stage)
+{
+    switch (stage) {
+    case JobPipeline::Stage::Probe:
+        return JobPipeline::Stage::Index;
+    case JobPipeline::Stage::Index:
+        return JobPipeline::Stage::Assets;
+    default:
+        return JobPipeline::Stage::Ready;
+    }
+}
+
+int slotOf(JobPipeline::Stage stage)
+{
+    return static_cast<int>(stage);
+}
+
+void discardWorker(QObject *worker)
+{
+    if (auto *indexer = qobject_cast<SourceIndexer *>(worker)) {
+        indexer->cancel();
+    }
+    worker->disconnect();
+    worker->deleteLater();
+}
+} // namespace
+
+JobPipeline::JobPipeline(QObject *parent)
+    : QObject(parent)
+{
+}
+
+JobPipeline::~JobPipeline()
+{
+    clear();
+    for (MediaProbe *probe : std::as_const(m_verifyProbes)) {
+        probe->disconnect(this);
+        delete probe;
+    }
+}
+
+void JobPipeline::setStageLimit(Stage stage, int limit)
+{
+    m_limits[slotOf(stage)] = std::max(limit, 1);
+    schedule();
+    scheduleVerify();
+}
+
+QString JobPipeline::ffprobePath()
+{
+    if (m_ffprobePath.isEmpty()) {
+        m_ffprobePath = locateFfprobe();
+    }
+    return m_ffprobePath;
+}
+
+void JobPipeline::prepare(const EncodeJob &job)
+{
+    if (job.id == 0 || m_entries.contains(job.id)) {
+        return;
+    }
+    Entry entry;
+    entry.job = job;
+    m_entries.insert(job.id, entry);
+    m_order.append(job.id);
+    advance(job.id);
+}
+
+bool JobPipeline::isPrepared(quint64 jobId) const
+{
+    const auto it = m_entries.constFind(jobId);
+    return it != m_entries.constEnd() && it->stage == Stage::Ready;
+}
+
+void JobPipeline::cancel(quint64 jobId)
+{
+    const auto it = m_entries.find(jobId);
+    if (it == m_entries.end()) {
+        return;
+    }
+    if (it->running) {
+        --m_active[slotOf(it->stage)];
+    }
+    if (QObject *worker = m_workers.take(jobId)) {
+        discardWorker(worker);
+    }
+    m_entries.erase(it);
+    m_order.removeOne(jobId);
+    schedule();
+}
+
+void JobPipeline::clear()
+{
+    for (QObject *worker : std::as_const(m_workers)) {
+        discardWorker(worker);
+    }
+    m_workers.clear();
+    m_entries.clear();
+    m_order.clear();
+    std::fill(std::begin(m_active), std::begin(m_active) + slotOf(Stage::Verify), 0);
+}
+
+void JobPipeline::schedule()
+{
+    // A copy: stages that finish synchronously may cancel entries from signal handlers.
+    const QList<quint64> order = m_order;
+    for (const quint64 id : order) {
+        const auto it = m_entries.constFind(id);
+        if (it != m_entries.constEnd() && !it->running && it->stage != Stage::Ready) {
+            advance(id);
+        }
+    }
+}
+
+void JobPipeline::advance(quint64 jobId)
+{
+    auto it = m_entries.find(jobId);
+    while (it != m_entries.end() && it->stage != Stage::Ready) {
+        const int slot = slotOf(it->stage);
+        if (m_active[slot] >= m_limits[slot]) {
+            // Picked up again by schedule() once a slot frees.
+            return;
+        }
+        if (startStage(jobId, *it)) {
+            return;
+        }
+        it->stage = nextStage(it->stage);
+    }
+    if (it != m_entries.end()) {
+        emit jobPrepared(jobId);
+    }
+}
+
+bool JobPipeline::startStage(quint64 jobId, Entry &entry)
+{
+    const Stage stage = entry.stage;
+    switch (stage) {
+    case Stage::Probe: {
+        if (entry.job.durationMs > 0 || ffprobePath().isEmpty()) {
+            return false;
+        }
+        auto *probe = new MediaProbe(this);
+        connect(probe, &MediaProbe::finished, this, [this, jobId](const QString &, const MediaInfo &info) {
+            if (QObject *worker = m_workers.take(jobId)) {
+                worker->deleteLater();
+            }
+            const auto it = m_entries.find(jobId);
+            if (it != m_entries.end() && info.valid) {
+                it->job.durationMs = info.durationMs;
+                it->job.sourceHeight = info.height;
+                it->job.sourceFrameRate = info.frameRate;
+                emit sourceProbed(jobId, info);
+            }
+            finishStage(jobId, Stage::Probe);
+        });
+        // Bookkeeping first: a process that fails to start reports back from inside start().
+        entry.running = true;
+        ++m_active[slotOf(stage)];
+        m_workers.insert(jobId, probe);
+        probe->start(m_ffprobePath, entry.job.videoPath);
+        return true;
+    }
+    case Stage::Index: {
+        if (!m_indexingEnabled || ffprobePath().isEmpty()) {
+            return false;
+        }
+        const QString cachePath = SourceIndex::cachePath(entry.job.videoPath);
+        if (cachePath.isEmpty() || QFileInfo::exists(cachePath)) {
+            return false;
+        }
+        auto *indexer = new SourceIndexer(this);
+        connect(indexer, &SourceIndexer::finished, this, [this, jobId](const SourceIndex &, const QString &errorMessage) {
+            if (QObject *worker = m_workers.take(jobId)) {
+                worker->deleteLater();
+            }
+            if (!errorMessage.isEmpty()) {
+                emit messageReceived(tr("[warn] Job %1: %2").arg(jobId).arg(errorMessage));
+            }
+            finishStage(jobId, Stage::Index);
+        });
+        entry.running = true;
+        ++m_active[slotOf(stage)];
+        m_workers.insert(jobId, indexer);
+        indexer->start(m_ffprobePath, entry.job.videoPath, entry.job.durationMs);
+        return true;
+    }
+    case Stage::Assets:
+        checkAssets(entry.job);
+        if (!m_fontCatalog || !entry.job.canAttachFonts()) {
+            return false;
+        }
+        entry.running = true;
+        ++m_active[slotOf(stage)];
+        resolveFonts(jobId, entry.job);
+        return true;
+    default:
+        return false;
+    }
+}
+
+void JobPipeline::finishStage(quint64 jobId, Stage stage)
+{
+    --m_active[slotOf(stage)];
+    const auto it = m_entries.find(jobId);
+    if (it != m_entries.end()) {
+        it->running = false;
+        it->stage = nextStage(stage);
+    }
+    schedule();
+}
+
+void JobPipeline::checkAssets(const EncodeJob &job)
+{
+    QStringList missing;
+    const auto check = [&missing](const QString &path) {
+        if (!path.isEmpty() && !QFileInfo::exists(path)) {
+            missing << QDir::toNativeSeparators(path);
+        }
+    };
+    check(job.subtitlePath);
+    for (const QString &path : job.additionalSubtitles) {
+        check(path);
+    }
+    check(job.introOutroInfo.introPath);
+    check(job.introOutroInfo.outroPath);
+    check(job.introOutroInfo.thumbnailPath);
+    check(job.profile.logo().imagePath);
+    if (!missing.isEmpty()) {
+        emit messageReceived(tr("[warn] %1 references missing files: %2")
+                                 .arg(QFileInfo(job.videoPath).fileName(), missing.join(QStringLiteral(", "))));
+    }
+    QDir().mkpath(QFileInfo(job.resolvedOutputPath()).absolutePath());
+}
+
+void JobPipeline::resolveFonts(quint64 jobId, const EncodeJob &job)
+{
+    // Parsing a large script takes a while; it stays off the UI thread.
+    QThreadPool::globalInstance()->start([self = QPointer<JobPipeline>(this), jobId, catalog = m_fontCatalog, subtitlePath = job.subtitlePath]() {
+        const QStringList fonts = AssFontScanner::fontFiles(AssFontScanner::resolve(AssFontScanner::scan(subtitlePath), *catalog));
+        if (!self) {
+            return;
+        }
+        QMetaObject::invokeMethod(self, [self, jobId, subtitlePath, fonts]() {
+            if (!self) {
+                return;
+            }
+            // Dropped when the job was cancelled (or cleared) while its script was parsed.
+            const auto it = self->m_entries.constFind(jobId);
+            if (it == self->m_entries.constEnd() || !it->running || it->stage != Stage::Assets) {
+                return;
+            }
+            emit self->fontsResolved(jobId, subtitlePath, fonts);
+            self->finishStage(jobId, Stage::Assets);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void JobPipeline::measureSubtitle(quint64 jobId, const QString &subtitlePath)
+{
+    QThreadPool::globalInstance()->start([self = QPointer<JobPipeline>(this), jobId, subtitlePath]() {
+        const int complexity = DurationModel::subtitleComplexity(subtitlePath);
+        if (!self) {
+            return;
+        }
+        QMetaObject::invokeMethod(self, [self, jobId, subtitlePath, complexity]() {
+            if (self) {
+                emit self->subtitleMeasured(jobId, subtitlePath, complexity);
+            }
+        }, Qt::QueuedConnection);
+    });
+}
+
+void JobPipeline::verify(const EncodeJob &job)
+{
+    if (job.id == 0 || m_verifications.contains(job.id)) {
+        return;
+    }
+    m_verifications.insert(job.id, job);
+    m_verifyOrder.append(job.id);
+    scheduleVerify();
+}
+
+void JobPipeline::scheduleVerify()
+{
+    const int slot = slotOf(Stage::Verify);
+    while (m_active[slot] < m_limits[slot] && !m_verifyOrder.isEmpty()) {
+        const quint64 jobId = m_verifyOrder.takeFirst();
+        if (ffprobePath().isEmpty()) {
+            // Nothing to check with; later finalize steps still run.
+            const EncodeJob job = m_verifications.take(jobId);
+            emit verified(jobId, true, tr("Skipped verify of %1: ffprobe not found").arg(QFileInfo(job.resolvedOutputPath()).fileName()));
+            continue;
+        }
+        auto *probe = new MediaProbe(this);
+        connect(probe, &MediaProbe::finished, this, [this, jobId](const QString &, const MediaInfo &info) {
+            onVerifyProbed(jobId, info);
+        });
+        ++m_active[slot];
+        m_verifyProbes.insert(jobId, probe);
+        probe->start(m_ffprobePath, m_verifications.value(jobId).resolvedOutputPath());
+    }
+}
+
+void JobPipeline::onVerifyProbed(quint64 jobId, const MediaInfo &info)
+{
+    if (MediaProbe *probe = m_verifyProbes.take(jobId)) {
+        probe->deleteLater();
+    }
+    --m_active[slotOf(Stage::Verify)];
+    const EncodeJob job = m_verifications.take(jobId);
+    const QString name = QFileInfo(job.resolvedOutputPath()).fileName();
+    const qint64 expectedMs = job.effectiveDurationMs();
+    if (!info.valid || info.durationMs <= 0) {
+        emit verified(jobId, false, tr("%1 could not be read back").arg(name));
+    } else if (expectedMs > 0
+               && std::abs(info.durationMs - expectedMs)
+                   > std::max(kDurationToleranceMs, static_cast<qint64>(expectedMs * kDurationToleranceRatio))) {
+        emit verified(jobId, false, tr("%1 is %2 long, expected %3")
+                                        .arg(name, formatTimecode(info.durationMs), formatTimecode(expectedMs)));
+    } else {
+        emit verified(jobId, true, tr("Verified %1 (%2)").arg(name, formatTimecode(info.durationMs)));
+    }
+    scheduleVerify();
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "MediaProbe.h"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+#include <utility>
+
+class FontCatalog;
+
+// Runs the cheap, I/O-bound stages of upcoming jobs while the current job
+// encodes: probe, source index, asset checks (resolving the fonts MKV outputs
+// attach), and after the encode a verify
+// of the output. Every stage has its own small concurrency limit; the encode
+// itself stays with Encoder and is the only stage that uses the full core budget.
+class JobPipeline : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Stage {
+        Probe,
+        Index,
+        Assets,
+        Ready,
+        Verify
+    };
+
+    explicit JobPipeline(QObject *parent = nullptr);
+    ~JobPipeline() override;
+
+    void setStageLimit(Stage stage, int limit);
+    void setIndexingEnabled(bool enabled) { m_indexingEnabled = enabled; }
+    // With a catalog, the assets stage resolves the fonts each job's subtitle uses; null skips it.
+    void setFontCatalog(std::shared_ptr<const FontCatalog> catalog) { m_fontCatalog = std::move(catalog); }
+
+    // Queues the preparation stages for a job that will encode later; jobs already queued are ignored.
+    void prepare(const EncodeJob &job);
+    // Drops a job's preparation, e.g. once the encoder takes it over.
+    void cancel(quint64 jobId);
+    void clear();
+    // Probes a finished output in the background and compares it with the job.
+    void verify(const EncodeJob &job);
+    // Reads a queued job's subtitle on the thread pool and reports its DurationModel complexity.
+    void measureSubtitle(quint64 jobId, const QString &subtitlePath);
+
+    [[nodiscard]] bool isQueued(quint64 jobId) const { return m_entries.contains(jobId); }
+    [[nodiscard]] bool isPrepared(quint64 jobId) const;
+
+signals:
+    void sourceProbed(quint64 jobId, const MediaInfo &info);
+    void jobPrepared(quint64 jobId);
+    void messageReceived(const QString &message);
+    void fontsResolved(quint64 jobId, const QString &subtitlePath, const QStringList &fontFiles);
+    void subtitleMeasured(quint64 jobId, const QString &subtitlePath, int complexity);
+    void verified(quint64 jobId, bool ok, const QString &message);
+
+private:
+    struct Entry {
+        EncodeJob job;
+        Stage stage = Stage::Probe;
+        bool running = false;
+    };
+
+    void schedule();
+    void advance(quint64 jobId);
+    // Starts the entry's current stage; false when the stage has nothing to do for this job.
+    bool startStage(quint64 jobId, Entry &entry);
+    void finishStage(quint64 jobId, Stage stage);
+    void checkAssets(const EncodeJob &job);
+    void resolveFonts(quint64 jobId, const EncodeJob &job);
+    void scheduleVerify();
+    void onVerifyProbed(quint64 jobId, const MediaInfo &info);
+    QString ffprobePath();
+
+    QHash<quint64, Entry> m_entries;
+    QList<quint64> m_order;
+    QHash<quint64, QObject *> m_workers;
+    QHash<quint64, EncodeJob> m_verifications;
+    QList<quint64> m_verifyOrder;
+    QHash<quint64, MediaProbe *> m_verifyProbes;
+    // Indexed by Stage; only stages that run a process or a background scan are limited.
+    int m_limits[5] = {2, 1, 2, 0, 1};
+    int m_active[5] = {0, 0, 0, 0, 0};
+    QString m_ffprobePath;
+    bool m_indexingEnabled = false;
+    std::shared_ptr<const FontCatalog> m_fontCatalog;
+};
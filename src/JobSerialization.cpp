@@ -0,0 +1,169 @@
+#include "JobSerialization.h"
+
+#include <QJsonArray>
+
+namespace {
+QJsonArray toArray(const QStringList &list)
+{
+    QJsonArray array;
+    for (const QString &value : list) {
+        array.append(value);
+    }
+    return array;
+}
+
+QStringList toStringList(const QJsonValue &value)
+{
+    QStringList list;
+    const QJsonArray array = value.toArray();
+    for (const QJsonValue &entry : array) {
+        list.append(entry.toString());
+    }
+    return list;
+}
+} // namespace
+
+QJsonObject encodeJobToJson(const EncodeJob &job)
+{
+    QJsonObject obj;
+    obj.insert(QStringLiteral("id"), static_cast<qint64>(job.id));
+    obj.insert(QStringLiteral("video"), job.videoPath);
+    obj.insert(QStringLiteral("subtitle"), job.subtitlePath);
+    obj.insert(QStringLiteral("subtitle_renderer"), job.subtitleInfo.rendererOverride);
+    obj.insert(QStringLiteral("additional_subtitles"), toArray(job.additionalSubtitles));
+    obj.insert(QStringLiteral("font_attachments"), toArray(job.fontAttachments));
+    obj.insert(QStringLiteral("subtitle_complexity"), job.subtitleComplexity);
+    obj.insert(QStringLiteral("intro"), job.introOutroInfo.introPath);
+    obj.insert(QStringLiteral("outro"), job.introOutroInfo.outroPath);
+    obj.insert(QStringLiteral("thumbnail"), job.introOutroInfo.thumbnailPath);
+
+    const QJsonObject profile = encodeProfileToJson(job.profile);
+    for (auto it = profile.constBegin(); it != profile.constEnd(); ++it) {
+        obj.insert(it.key(), it.value());
+    }
+
+    obj.insert(QStringLiteral("cut"), QJsonObject{
+        {QStringLiteral("enabled"), job.cutSettings.enabled},
+        {QStringLiteral("start"), job.cutSettings.startTime},
+        {QStringLiteral("end"), job.cutSettings.endTime}
+    });
+
+    obj.insert(QStringLiteral("renderer"), job.rendererMode);
+    obj.insert(QStringLiteral("telegram"), job.telegramMode);
+    obj.insert(QStringLiteral("max_output_bytes"), job.maxOutputBytes);
+    obj.insert(QStringLiteral("output"), job.outputFile);
+    obj.insert(QStringLiteral("output_folder"), job.globalOutputFolder);
+    obj.insert(QStringLiteral("duration_ms"), job.durationMs);
+    obj.insert(QStringLiteral("source_height"), job.sourceHeight);
+    obj.insert(QStringLiteral("source_fps"), job.sourceFrameRate);
+    return obj;
+}
+
+EncodeJob encodeJobFromJson(const QJsonObject &obj)
+{
+    EncodeJob job;
+    job.id = static_cast<quint64>(obj.value(QStringLiteral("id")).toInteger());
+    job.videoPath = obj.value(QStringLiteral("video")).toString();
+    job.subtitlePath = obj.value(QStringLiteral("subtitle")).toString();
+    job.subtitleInfo.path = job.subtitlePath;
+    job.subtitleInfo.rendererOverride = obj.value(QStringLiteral("subtitle_renderer")).toString();
+    job.additionalSubtitles = toStringList(obj.value(QStringLiteral("additional_subtitles")));
+    job.fontAttachments = toStringList(obj.value(QStringLiteral("font_attachments")));
+    job.subtitleComplexity = obj.value(QStringLiteral("subtitle_complexity")).toInt(-1);
+    job.introOutroInfo.introPath = obj.value(QStringLiteral("intro")).toString();
+    job.introOutroInfo.outroPath = obj.value(QStringLiteral("outro")).toString();
+    job.introOutroInfo.thumbnailPath = obj.value(QStringLiteral("thumbnail")).toString();
+
+    job.profile = encodeProfileFromJson(obj);
+
+    const QJsonObject cut = obj.value(QStringLiteral("cut")).toObject();
+    job.cutSettings.enabled = cut.value(QStringLiteral("enabled")).toBool();
+    job.cutSettings.startTime = cut.value(QStringLiteral("start")).toString();
+    job.cutSettings.endTime = cut.value(QStringLiteral("end")).toString();
+
+    job.rendererMode = obj.value(QStringLiteral("renderer")).toString(job.rendererMode);
+    job.telegramMode = obj.value(QStringLiteral("telegram")).toBool();
+    job.maxOutputBytes = obj.value(QStringLiteral("max_output_bytes")).toInteger();
+    job.outputFile = obj.value(QStringLiteral("output")).toString();
+    job.globalOutputFolder = obj.value(QStringLiteral("output_folder")).toString();
+    job.durationMs = obj.value(QStringLiteral("duration_ms")).toInteger();
+    job.sourceHeight = obj.value(QStringLiteral("source_height")).toInt();
+    job.sourceFrameRate = obj.value(QStringLiteral("source_fps")).toDouble();
+    return job;
+}
+
+QJsonObject encodeProfileToJson(const EncodeProfile &profile)
+{
+    QJsonObject obj;
+    obj.insert(QStringLiteral("audio"), QJsonObject{
+        {QStringLiteral("codec"), profile.audio().codec},
+        {QStringLiteral("bitrate_kbps"), profile.audio().bitrateKbps},
+        {QStringLiteral("track"), profile.audio().preferredTrackId},
+        {QStringLiteral("volume_source"), profile.audio().volumeSource},
+        {QStringLiteral("volume_intro"), profile.audio().volumeIntro},
+        {QStringLiteral("volume_outro"), profile.audio().volumeOutro}
+    });
+    obj.insert(QStringLiteral("video_settings"), QJsonObject{
+        {QStringLiteral("encoder"), profile.video().encoder},
+        {QStringLiteral("preset"), profile.video().preset},
+        {QStringLiteral("quality"), profile.video().qualityValue},
+        {QStringLiteral("target_metric"), profile.video().targetMetric},
+        {QStringLiteral("target_value"), profile.video().targetValue},
+        {QStringLiteral("resize"), profile.video().resizeMode},
+        {QStringLiteral("custom_width"), profile.video().customSize.width()},
+        {QStringLiteral("custom_height"), profile.video().customSize.height()},
+        {QStringLiteral("threads"), profile.video().threads}
+    });
+    obj.insert(QStringLiteral("logo"), QJsonObject{
+        {QStringLiteral("image"), profile.logo().imagePath},
+        {QStringLiteral("placement"), profile.logo().placement},
+        {QStringLiteral("x"), profile.logo().customPosition.x()},
+        {QStringLiteral("y"), profile.logo().customPosition.y()},
+        {QStringLiteral("opacity"), profile.logo().opacity},
+        {QStringLiteral("visibility"), profile.logo().visibility},
+        {QStringLiteral("duration"), profile.logo().visibleDuration},
+        {QStringLiteral("interval"), profile.logo().visibleInterval}
+    });
+    if (!profile.name().isEmpty()) {
+        obj.insert(QStringLiteral("profile"), profile.name());
+    }
+    return obj;
+}
+
+EncodeProfile encodeProfileFromJson(const QJsonObject &obj)
+{
+    const QJsonObject audio = obj.value(QStringLiteral("audio")).toObject();
+    AudioSettings audioSettings;
+    audioSettings.codec = audio.value(QStringLiteral("codec")).toString();
+    audioSettings.bitrateKbps = audio.value(QStringLiteral("bitrate_kbps")).toInt(audioSettings.bitrateKbps);
+    audioSettings.preferredTrackId = audio.value(QStringLiteral("track")).toString();
+    audioSettings.volumeSource = static_cast<float>(audio.value(QStringLiteral("volume_source")).toDouble(1.0));
+    audioSettings.volumeIntro = static_cast<float>(audio.value(QStringLiteral("volume_intro")).toDouble(1.0));
+    audioSettings.volumeOutro = static_cast<float>(audio.value(QStringLiteral("volume_outro")).toDouble(1.0));
+
+    const QJsonObject video = obj.value(QStringLiteral("video_settings")).toObject();
+    VideoSettings videoSettings;
+    videoSettings.encoder = video.value(QStringLiteral("encoder")).toString();
+    videoSettings.preset = video.value(QStringLiteral("preset")).toString();
+    videoSettings.qualityValue = video.value(QStringLiteral("quality")).toDouble(videoSettings.qualityValue);
+    videoSettings.targetMetric = video.value(QStringLiteral("target_metric")).toString();
+    videoSettings.targetValue = video.value(QStringLiteral("target_value")).toDouble();
+    videoSettings.resizeMode = video.value(QStringLiteral("resize")).toString();
+    videoSettings.customSize = QSize(video.value(QStringLiteral("custom_width")).toInt(-1),
+                                     video.value(QStringLiteral("custom_height")).toInt(-1));
+    videoSettings.threads = video.value(QStringLiteral("threads")).toInt();
+
+    const QJsonObject logo = obj.value(QStringLiteral("logo")).toObject();
+    LogoSettings logoSettings;
+    logoSettings.imagePath = logo.value(QStringLiteral("image")).toString();
+    logoSettings.placement = logo.value(QStringLiteral("placement")).toString();
+    logoSettings.customPosition = QPoint(logo.value(QStringLiteral("x")).toInt(), logo.value(QStringLiteral("y")).toInt());
+    logoSettings.opacity = static_cast<float>(logo.value(QStringLiteral("opacity")).toDouble(1.0));
+    logoSettings.visibility = logo.value(QStringLiteral("visibility")).toString();
+    logoSettings.visibleDuration = logo.value(QStringLiteral("duration")).toInt();
+    logoSettings.visibleInterval = logo.value(QStringLiteral("interval")).toInt();
+
+    EncodeProfile profile(videoSettings, audioSettings, logoSettings);
+    profile.setName(obj.value(QStringLiteral("profile")).toString());
+    return profile;
+}
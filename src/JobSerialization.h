@@ -0,0 +1,12 @@
+#pragma once
+
+#include "EncodeJob.h"
+
+#include <QJsonObject>
+
+// Lossless JSON form of an EncodeJob, used to hand jobs to worker processes.
+QJsonObject encodeJobToJson(const EncodeJob &job);
+EncodeJob encodeJobFromJson(const QJsonObject &obj);
+// The "audio", "video_settings" and "logo" members of a job, also used for saved profiles.
+QJsonObject encodeProfileToJson(const EncodeProfile &profile);
+EncodeProfile encodeProfileFromJson(const QJsonObject &obj);
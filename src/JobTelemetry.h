@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QDateTime>
+#include <QString>
+
+struct JobTelemetry {
+    QString videoPath;
+    QString outputPath;
+    QString encoder;
+    QString preset;
+    double qualityValue = 0.0;
+    QString resizeMode;
+    int outputHeight = 0;
+    int subtitleComplexity = 0;
+    bool telegramMode = false;
+    int passes = 1; // two-pass encodes spend twice the wall time on the same media
+    bool success = false;
+    QDateTime finishedAt;
+
+    qint64 wallTimeMs = 0;
+    qint64 timeToFirstFrameMs = -1;
+    qint64 encodedDurationMs = 0;
+    double averageFps = 0.0;
+    double p5Fps = 0.0;
+    double speed = 0.0;
+    double bitrateKbps = 0.0;
+    qint64 outputBytes = 0;
+    // Time between the last progress report and ffmpeg's exit: trailer, index and faststart rewrite.
+    qint64 finalizeMs = 0;
+
+    // Resource usage of the ffmpeg child, sampled from the OS while it runs.
+    qint64 cpuUserMs = 0;
+    qint64 cpuSystemMs = 0;
+    qint64 peakRssKb = 0;
+};
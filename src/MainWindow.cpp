@@ -1,5 +1,12 @@
 #include "MainWindow.h"
 
+#include "AppSettings.h"
+#include "AssFontScanner.h"
+#include "FfmpegLocator.h"
+#include "ProcessStats.h"
+#include "SettingsDialog.h"
+#include "TimeUtils.h"
+
 #include <QAction>
 #include <QAbstractItemView>
 #include <QApplication>
@@ -7,6 +14,8 @@
 #include <QComboBox>
 #include <QDateTime>
 #include <QDir>
+#include <QEvent>
+#include <QFile>
 #include <QFileDialog>
 #include <QFileInfo>
 #include <QFormLayout>
@@ -14,6 +23,8 @@
 #include <QGridLayout>
 #include <QHeaderView>
 #include <QHBoxLayout>
+#include <QInputDialog>
+#include <QJsonArray>
 #include <QLabel>
 #include <QLineEdit>
 #include <QList>
@@ -21,45 +32,305 @@
 #include <QPair>
 #include <QPushButton>
 #include <QRegularExpression>
+#include <QScreen>
+#include <QScrollBar>
 #include <QSlider>
 #include <QSpinBox>
 #include <QSplitter>
+#include <QStandardItemModel>
 #include <QStatusBar>
 #include <QTableWidget>
 #include <QTabWidget>
+#include <QTextCursor>
 #include <QTextEdit>
+#include <QThreadPool>
+#include <QTimer>
 #include <QToolBar>
 #include <QVBoxLayout>
 #include <QVariant>
 
+#include <algorithm>
+#include <cmath>
 #include <utility>
 
 namespace {
+// Lines held for the log view between flushes or until the Log tab is first
+// opened; older ones are dropped (the per-job ffmpeg logs keep everything).
+constexpr int kMaxPendingLogLines = 5000;
+
 QString formatTimestampedLine(const QString &line)
 {
     const QString timestamp = QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd HH:mm:ss"));
     return QStringLiteral("[%1] %2").arg(timestamp, line);
 }
+
+// Resolves a "hooks" override to configured hook command lines. Entries are
+// 1-based positions in the job's hook list (its named profile's, otherwise
+// Settings → Hooks) or exact configured command lines, so a control client can
+// pick hooks but never supply commands of its own.
+// Returns the entries that match nothing.
+QStringList selectConfiguredHooks(const QJsonValue &value, const QStringList &configured, QStringList *selected)
+{
+    const QJsonArray entries = value.isArray() ? value.toArray() : QJsonArray{value};
+    QStringList unknown;
+    for (const QJsonValue &entry : entries) {
+        QString hook;
+        if (entry.isDouble()) {
+            const int index = entry.toInt() - 1;
+            hook = index >= 0 && index < configured.size() ? configured.at(index) : QString();
+        } else if (configured.contains(entry.toString())) {
+            hook = entry.toString();
+        }
+        if (hook.isEmpty()) {
+            unknown << (entry.isDouble() ? QString::number(entry.toDouble()) : entry.toString());
+        } else if (!selected->contains(hook)) {
+            selected->append(hook);
+        }
+    }
+    return unknown;
+}
+
+// Identity of a source file for duplicate checks, compared the way QFileInfo::operator== does.
+QString sourceKey(const QString &path)
+{
+    const QFileInfo info(path);
+    QString key = info.canonicalFilePath();
+    if (key.isEmpty()) {
+        key = QDir::cleanPath(info.absoluteFilePath());
+    }
+#if defined(Q_OS_WIN)
+    key = key.toLower();
+#endif
+    return key;
+}
+
+void applyJobOverrides(EncodeJob &job, const QJsonObject &overrides)
+{
+    if (overrides.contains(QStringLiteral("output"))) {
+        job.outputFile = overrides.value(QStringLiteral("output")).toString();
+    }
+    if (overrides.contains(QStringLiteral("subtitle"))) {
+        job.subtitlePath = overrides.value(QStringLiteral("subtitle")).toString();
+        job.subtitleInfo.path = job.subtitlePath;
+    }
+    if (overrides.contains(QStringLiteral("telegram"))) {
+        job.telegramMode = overrides.value(QStringLiteral("telegram")).toBool();
+    }
+    if (overrides.contains(QStringLiteral("max_size_mb"))) {
+        job.maxOutputBytes = static_cast<qint64>(overrides.value(QStringLiteral("max_size_mb")).toDouble() * 1024.0 * 1024.0);
+    }
+    if (overrides.contains(QStringLiteral("encoder"))) {
+        job.profile.editVideo().encoder = overrides.value(QStringLiteral("encoder")).toString();
+    }
+    if (overrides.contains(QStringLiteral("preset"))) {
+        job.profile.editVideo().preset = overrides.value(QStringLiteral("preset")).toString();
+    }
+    if (overrides.contains(QStringLiteral("quality"))) {
+        job.profile.editVideo().qualityValue = overrides.value(QStringLiteral("quality")).toDouble(job.profile.video().qualityValue);
+    }
+    if (overrides.contains(QStringLiteral("target_metric"))) {
+        job.profile.editVideo().targetMetric = overrides.value(QStringLiteral("target_metric")).toString().toLower();
+        job.profile.editVideo().targetValue = overrides.value(QStringLiteral("target_value")).toDouble();
+    }
+    if (overrides.contains(QStringLiteral("resize"))) {
+        job.profile.editVideo().resizeMode = overrides.value(QStringLiteral("resize")).toString();
+    }
+    if (overrides.contains(QStringLiteral("audio_codec"))) {
+        job.profile.editAudio().codec = overrides.value(QStringLiteral("audio_codec")).toString();
+    }
+    if (overrides.contains(QStringLiteral("audio_bitrate"))) {
+        job.profile.editAudio().bitrateKbps = overrides.value(QStringLiteral("audio_bitrate")).toInt(job.profile.audio().bitrateKbps);
+    }
+    if (overrides.contains(QStringLiteral("hooks"))) {
+        // A subset of the configured hooks (job.postEncodeHooks holds them on entry);
+        // an empty array disables them. Hooks removed from the profile or Settings since are dropped.
+        QStringList selected;
+        selectConfiguredHooks(overrides.value(QStringLiteral("hooks")), job.postEncodeHooks, &selected);
+        job.postEncodeHooks = selected;
+    }
+    if (overrides.contains(QStringLiteral("cut_start")) || overrides.contains(QStringLiteral("cut_end"))) {
+        job.cutSettings.enabled = true;
+        job.cutSettings.startTime = overrides.value(QStringLiteral("cut_start")).toString();
+        job.cutSettings.endTime = overrides.value(QStringLiteral("cut_end")).toString();
+    }
+}
+
+QString jobStatusName(int status)
+{
+    switch (status) {
+    case 0:
+        return QStringLiteral("pending");
+    case 1:
+        return QStringLiteral("running");
+    case 2:
+        return QStringLiteral("done");
+    default:
+        return QStringLiteral("failed");
+    }
+}
 }
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
 {
+    m_startupClock.start();
     setWindowTitle(tr("Niseyuki"));
     resize(1280, 800);
 
     createToolBar();
+    markStartupPhase(QStringLiteral("toolbar"));
     setCentralWidget(createCentral());
+    markStartupPhase(QStringLiteral("tabs"));
 
+    m_queueEstimateLabel = new QLabel(this);
+    statusBar()->addPermanentWidget(m_queueEstimateLabel);
+    m_uiCpuLabel = new QLabel(this);
+    m_uiCpuLabel->setToolTip(tr("CPU used by the interface thread over the last few seconds, as a share of one core"));
+    statusBar()->addPermanentWidget(m_uiCpuLabel);
     statusBar()->showMessage(tr("Ready"));
 
+    m_uiFlushTimer.setSingleShot(true);
+    connect(&m_uiFlushTimer, &QTimer::timeout, this, &MainWindow::flushUiUpdates);
+    m_uiCpuLabel->setVisible(currentThreadCpuMs() >= 0);
+    m_uiCpuTimer.setInterval(2000);
+    connect(&m_uiCpuTimer, &QTimer::timeout, this, &MainWindow::updateUiCpuLabel);
+
+    // The history grows with every job; it is parsed on the pool, and until the model
+    // arrives the queue shows no predictions and encodes use the rate-based ETA.
+    QThreadPool::globalInstance()->start([self = QPointer<MainWindow>(this), store = m_telemetryStore]() {
+        DurationModel model;
+        model.train(store.load());
+        QMetaObject::invokeMethod(self, [self, model]() {
+            if (self) {
+                self->onDurationModelTrained(model);
+            }
+        }, Qt::QueuedConnection);
+    });
+    connect(&m_mediaProbe, &MediaProbe::finished, this, &MainWindow::onSourceProbed);
+    connect(&m_capabilityProbe, &CapabilityProbe::finished, this, &MainWindow::onCapabilitiesProbed);
+    locateFfmpegAsync(this, [this](const QString &ffmpegPath, const QString &ffprobePath) {
+        appendLog(tr("Startup: ffmpeg located after %1 ms").arg(m_startupClock.elapsed()));
+        if (m_ffprobePath.isEmpty()) {
+            m_ffprobePath = ffprobePath;
+        }
+        m_capabilityProbe.start(ffmpegPath);
+    });
+
     connect(&m_encoder, &Encoder::stateChanged, this, &MainWindow::onEncoderStateChanged);
     connect(&m_encoder, &Encoder::progressChanged, this, &MainWindow::onEncoderProgressChanged);
+    connect(&m_encoder, &Encoder::etaChanged, this, &MainWindow::onEncoderEtaChanged);
     connect(&m_encoder, &Encoder::statusTextChanged, this, &MainWindow::onEncoderStatusChanged);
     connect(&m_encoder, &Encoder::messageReceived, this, &MainWindow::onEncoderMessageReceived);
+    connect(&m_encoder, &Encoder::telemetryReady, this, &MainWindow::onEncoderTelemetry);
     connect(&m_encoder, &Encoder::finished, this, &MainWindow::onEncoderFinished);
 
+    connect(&m_pipeline, &JobPipeline::sourceProbed, this, [this](quint64 jobId, const MediaInfo &info) {
+        const int row = rowForJobId(jobId);
+        if (row < 0 || row >= m_jobs.size()) {
+            return;
+        }
+        EncodeJob &job = m_jobs[row];
+        job.durationMs = info.durationMs;
+        job.sourceHeight = info.height;
+        job.sourceFrameRate = info.frameRate;
+        updateQueueRowDisplay(row);
+        updateQueueEstimate();
+    });
+    connect(&m_pipeline, &JobPipeline::jobPrepared, this, [this](quint64 jobId) {
+        const int row = rowForJobId(jobId);
+        if (row >= 0 && rowStatus(row) == JobStatus::Pending) {
+            setRowStatus(row, JobStatus::Pending, tr("Prepared"));
+        }
+    });
+    connect(&m_pipeline, &JobPipeline::messageReceived, this, &MainWindow::appendLog);
+    connect(&m_pipeline, &JobPipeline::subtitleMeasured, this, [this](quint64 jobId, const QString &subtitlePath, int complexity) {
+        const int row = rowForJobId(jobId);
+        if (row < 0 || m_jobs.at(row).subtitlePath != subtitlePath) {
+            return;
+        }
+        m_jobs[row].subtitleComplexity = complexity;
+        updateQueueRowDisplay(row);
+        updateQueueEstimate();
+    });
+    connect(&m_pipeline, &JobPipeline::fontsResolved, this, [this](quint64 jobId, const QString &subtitlePath, const QStringList &fontFiles) {
+        m_resolvedFonts.insert(jobId, {subtitlePath, fontFiles});
+    });
+    connect(&m_hookRunner, &HookRunner::outputReceived, this, [this](quint64 jobId, const QString &line) {
+        appendLog(QStringLiteral("[hook %1] %2").arg(jobId).arg(line));
+    });
+    connect(&m_hookRunner, &HookRunner::finished, this, [this](quint64 jobId, bool success, const QString &message) {
+        appendLog(success ? QStringLiteral("[hook %1] %2").arg(jobId).arg(message)
+                          : tr("[warn] Hooks for job %1 failed: %2").arg(jobId).arg(message));
+        const int row = rowForJobId(jobId);
+        if (row >= 0 && rowStatus(row) == JobStatus::Done) {
+            setRowStatus(row, success ? JobStatus::Done : JobStatus::Failed, success ? tr("Done") : tr("Hook failed"));
+        }
+        m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("hooks_finished")},
+                                      {QStringLiteral("job"), static_cast<qint64>(jobId)},
+                                      {QStringLiteral("success"), success},
+                                      {QStringLiteral("message"), message}});
+    });
+    connect(&m_pipeline, &JobPipeline::verified, this, [this](quint64 jobId, bool ok, const QString &message) {
+        if (ok) {
+            appendLog(message);
+            runPostEncodeHooks(jobId);
+            return;
+        }
+        appendLog(tr("[warn] Verify failed: %1").arg(message));
+        const int row = rowForJobId(jobId);
+        if (row >= 0 && rowStatus(row) == JobStatus::Done) {
+            setRowStatus(row, JobStatus::Failed, tr("Verify failed"));
+        }
+    });
+
+    connect(&m_watchService, &WatchFolderService::fileReady, this, &MainWindow::onWatchedFileReady);
+    connect(&m_watchService, &WatchFolderService::folderError, this, [this](const QString &folder, const QString &message) {
+        appendLog(tr("[warn] Watch folder %1: %2").arg(QDir::toNativeSeparators(folder), message));
+    });
+    connect(&m_sampleEncoder, &SampleEncoder::messageReceived, this, &MainWindow::appendLog);
+    connect(&m_sampleEncoder, &SampleEncoder::progressChanged, this, [this](double progress) {
+        statusBar()->showMessage(tr("Encoding samples... %1%").arg(QString::number(progress * 100.0, 'f', 0)));
+    });
+    connect(&m_sampleEncoder, &SampleEncoder::finished, this, &MainWindow::onSamplesFinished);
+    connect(&m_preflight, &QueuePreflight::jobChecked, this, &MainWindow::onPreflightJobChecked);
+    connect(&m_preflight, &QueuePreflight::finished, this, &MainWindow::onPreflightFinished);
+    connect(&m_fontIndex, &FontIndex::refreshed, this, &MainWindow::onFontIndexRefreshed);
+
+    connect(&m_scheduler, &QueueScheduler::scheduled, this, &MainWindow::updateStartStopAvailability);
+    connect(&m_scheduler, &QueueScheduler::remoteJobsDispatched, this, [this]() {
+        updateQueueEstimate();
+        updateStartStopAvailability();
+    });
+    connect(&m_scheduler, &QueueScheduler::queueFinished, this, [this]() { appendLog(tr("Queue finished")); });
+    connect(&m_workerPool, &WorkerPool::capacityChanged, this, [this]() {
+        if (m_scheduler.isRunning()) {
+            m_scheduler.dispatchRemote();
+        }
+    });
+    connect(&m_workerPool, &WorkerPool::jobProgress, this, &MainWindow::onRemoteJobProgress);
+    connect(&m_workerPool, &WorkerPool::jobMessage, this, [this](quint64 jobId, const QString &line) {
+        appendLog(QStringLiteral("[job %1] %2").arg(jobId).arg(line));
+    });
+    connect(&m_workerPool, &WorkerPool::jobFinished, this, &MainWindow::onRemoteJobFinished);
+    connect(&m_workerPool, &WorkerPool::jobReturned, this, &MainWindow::onRemoteJobReturned);
+    connect(&m_workerPool, &WorkerPool::workerMessage, this, &MainWindow::appendLog);
+    applySettings();
+    markStartupPhase(QStringLiteral("services"));
+
+    m_controlServer.setRequestHandler([this](const QJsonObject &request) { return handleControlRequest(request); });
+    QString controlError;
+    if (!m_controlServer.listen(&controlError)) {
+        appendLog(tr("[warn] Control API unavailable: %1").arg(controlError));
+    }
+
+    updateQueueEstimate();
     updateStartStopAvailability();
+    markStartupPhase(QStringLiteral("control server"));
+    // Runs once the window has been shown and the first paint is queued.
+    QTimer::singleShot(0, this, [this]() {
+        markStartupPhase(QStringLiteral("first show"));
+        appendLog(tr("Startup: %1 (total %2 ms)").arg(m_startupPhases.join(QStringLiteral(", "))).arg(m_startupClock.elapsed()));
+    });
 }
 
 void MainWindow::createToolBar()
@@ -74,6 +345,14 @@ void MainWindow::createToolBar()
     auto *removeAction = toolbar->addAction(tr("- Remove file"));
     connect(removeAction, &QAction::triggered, this, &MainWindow::onRemoveSelected);
 
+    m_sampleAction = toolbar->addAction(tr("Sample"));
+    m_sampleAction->setToolTip(tr("Encode short slices at 10%, 50% and 90% of the selected job to check quality and size"));
+    connect(m_sampleAction, &QAction::triggered, this, &MainWindow::onSampleClicked);
+
+    m_preflightAction = toolbar->addAction(tr("Preflight"));
+    m_preflightAction->setToolTip(tr("Check every pending job (source, subtitles, fonts, output folder, encoder) before a long run"));
+    connect(m_preflightAction, &QAction::triggered, this, &MainWindow::onPreflightClicked);
+
     toolbar->addSeparator();
 
     m_priorityCombo = new QComboBox(toolbar);
@@ -88,6 +367,7 @@ void MainWindow::createToolBar()
 
     auto *settingsAction = toolbar->addAction(tr("⚙️ Settings"));
     settingsAction->setToolTip(tr("Open application settings"));
+    connect(settingsAction, &QAction::triggered, this, &MainWindow::onSettingsClicked);
 
     auto *aboutAction = toolbar->addAction(tr("ℹ️ About"));
     aboutAction->setToolTip(tr("Show about information"));
@@ -126,12 +406,16 @@ QWidget *MainWindow::createCentral()
     rightLayout->setContentsMargins(0, 0, 0, 0);
     rightLayout->setSpacing(8);
 
+    // Every job is built from the settings tabs, so only the Log and Stats views wait until opened.
     m_tabWidget = new QTabWidget(rightSide);
     m_tabWidget->addTab(createMainTab(), tr("Main"));
     m_tabWidget->addTab(createVideoTab(), tr("Video"));
     m_tabWidget->addTab(createAudioTab(), tr("Audio"));
     m_tabWidget->addTab(createLogoTab(), tr("Logo"));
-    m_tabWidget->addTab(createLogTab(), tr("Log"));
+    m_tabWidget->addTab(createLazyTab([this]() { return createLogTab(); }), tr("Log"));
+    m_tabWidget->addTab(createLazyTab([this]() { return createStatsTab(); }), tr("Stats"));
+    connect(m_tabWidget, &QTabWidget::currentChanged, this, &MainWindow::ensureTabBuilt);
+    watchProfileControls();
     rightLayout->addWidget(m_tabWidget, 1);
 
     rightLayout->addWidget(createPreviewPanel());
@@ -151,29 +435,75 @@ QWidget *MainWindow::createQueuePanel()
     auto *layout = new QVBoxLayout(panel);
 
     m_queueTable = new QTableWidget(panel);
-    m_queueTable->setColumnCount(3);
-    m_queueTable->setHorizontalHeaderLabels({tr("File"), tr("Status"), tr("Output")});
+    m_queueTable->setColumnCount(4);
+    m_queueTable->setHorizontalHeaderLabels({tr("File"), tr("Status"), tr("Estimate"), tr("Output")});
     m_queueTable->horizontalHeader()->setStretchLastSection(true);
     m_queueTable->setSelectionBehavior(QAbstractItemView::SelectRows);
     m_queueTable->setSelectionMode(QAbstractItemView::ExtendedSelection);
     m_queueTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
     layout->addWidget(m_queueTable);
+    connect(m_queueTable, &QTableWidget::currentCellChanged, this, [this](int row) { showPreviewForRow(row); });
 
     return panel;
 }
 
+QWidget *MainWindow::createLazyTab(std::function<QWidget *()> factory)
+{
+    auto *placeholder = new QWidget(this);
+    auto *layout = new QVBoxLayout(placeholder);
+    layout->setContentsMargins(0, 0, 0, 0);
+    m_lazyTabs.insert(placeholder, std::move(factory));
+    return placeholder;
+}
+
+void MainWindow::ensureTabBuilt(int index)
+{
+    QWidget *placeholder = m_tabWidget->widget(index);
+    const auto it = m_lazyTabs.find(placeholder);
+    if (it == m_lazyTabs.end()) {
+        return;
+    }
+    const std::function<QWidget *()> factory = std::move(it.value());
+    m_lazyTabs.erase(it);
+    placeholder->layout()->addWidget(factory());
+    if (m_logView) {
+        // Lines logged before the Log tab existed.
+        flushUiUpdates();
+    }
+}
+
+void MainWindow::markStartupPhase(const QString &phase)
+{
+    const qint64 nowMs = m_startupClock.elapsed();
+    m_startupPhases << QStringLiteral("%1 %2 ms").arg(phase).arg(nowMs - std::exchange(m_lastStartupMarkMs, nowMs));
+}
+
 QWidget *MainWindow::createPreviewPanel()
 {
-    auto *panel = new QGroupBox(tr("Preview"), this);
-    auto *layout = new QVBoxLayout(panel);
+    m_previewPanel = new QGroupBox(tr("Preview"), this);
+    auto *layout = new QVBoxLayout(m_previewPanel);
     layout->setContentsMargins(8, 8, 8, 8);
     layout->setSpacing(6);
+    m_previewPlaceholder = new QLabel(tr("Select a job to preview"), m_previewPanel);
+    m_previewPlaceholder->setAlignment(Qt::AlignCenter);
+    m_previewPlaceholder->setMinimumHeight(160);
+    layout->addWidget(m_previewPlaceholder, 1);
+    return m_previewPanel;
+}
+
+void MainWindow::ensurePreviewPanel()
+{
+    if (m_previewView) {
+        return;
+    }
+    QGroupBox *panel = m_previewPanel;
+    auto *layout = static_cast<QVBoxLayout *>(panel->layout());
+    delete m_previewPlaceholder;
+    m_previewPlaceholder = nullptr;
 
-    auto *placeholder = new QLabel(tr("Preview player will appear here"), panel);
-    placeholder->setAlignment(Qt::AlignCenter);
-    placeholder->setMinimumHeight(180);
-    placeholder->setStyleSheet(QStringLiteral("QLabel { background-color: palette(base); border: 1px dashed palette(mid); }"));
-    layout->addWidget(placeholder, 1);
+    m_previewView = new PreviewView(panel);
+    m_previewView->setMessage(tr("Select a job to preview"));
+    layout->addWidget(m_previewView, 1);
 
     auto *controlsRow = new QHBoxLayout;
     controlsRow->setSpacing(4);
@@ -182,10 +512,425 @@ QWidget *MainWindow::createPreviewPanel()
         auto *btn = new QPushButton(label, panel);
         btn->setEnabled(false);
         controlsRow->addWidget(btn);
+        if (label == tr("Prev")) {
+            m_previewPrevButton = btn;
+        } else if (label == tr("Next")) {
+            m_previewNextButton = btn;
+        } else if (label == tr("Go to")) {
+            m_previewGotoButton = btn;
+        }
     }
+    m_previewVariantCombo = new QComboBox(panel);
+    m_previewVariantCombo->addItem(tr("Source + filters"));
+    m_previewVariantCombo->setToolTip(tr("Switch between the filtered source and encoded samples at the same position"));
+    controlsRow->addWidget(m_previewVariantCombo);
+    m_previewTimeLabel = new QLabel(QStringLiteral("--:--:--.---"), panel);
+    controlsRow->addWidget(m_previewTimeLabel);
     layout->addLayout(controlsRow);
 
-    return panel;
+    connect(m_previewPrevButton, &QPushButton::clicked, this, [this]() {
+        showPreviewAt(m_previewRenderer.previousFrameTime(m_previewTimeUs));
+    });
+    connect(m_previewNextButton, &QPushButton::clicked, this, [this]() {
+        showPreviewAt(m_previewRenderer.nextFrameTime(m_previewTimeUs));
+    });
+    connect(m_previewGotoButton, &QPushButton::clicked, this, [this]() {
+        bool ok = false;
+        const QString text = QInputDialog::getText(this, tr("Go to"), tr("Time (hh:mm:ss.mmm or seconds):"),
+                                                   QLineEdit::Normal, formatTimecode(m_previewTimeUs / 1000), &ok);
+        double seconds = 0.0;
+        if (ok && parseTimeToSeconds(text, seconds)) {
+            showPreviewAt(static_cast<qint64>(seconds * 1000000.0));
+        }
+    });
+    connect(m_previewVariantCombo, qOverload<int>(&QComboBox::currentIndexChanged), this, [this](int index) {
+        const int sample = index - 1;
+        const QVector<SampleResult> &results = m_sampleEncoder.results();
+        if (sample < 0 || sample >= results.size()) {
+            m_previewRenderer.clearAlternateSource();
+        } else {
+            const SampleResult &result = results.at(sample);
+            m_previewRenderer.setAlternateSource(result.outputPath, result.startMs * 1000);
+            const qint64 startUs = result.startMs * 1000;
+            if (m_previewTimeUs < startUs || m_previewTimeUs >= startUs + result.lengthMs * 1000) {
+                m_previewTimeUs = startUs + result.lengthMs * 500;
+            }
+        }
+        showPreviewAt(m_previewTimeUs);
+    });
+    connect(&m_previewRenderer, &PreviewRenderer::frameReady, this, [this](qint64 timeUs, const QImage &image) {
+        if (timeUs == m_previewTimeUs) {
+            m_previewView->setImage(image);
+        }
+    });
+    connect(&m_previewRenderer, &PreviewRenderer::renderFailed, this, [this](qint64 timeUs, const QString &message) {
+        if (timeUs == m_previewTimeUs) {
+            m_previewView->setMessage(tr("Preview failed: %1").arg(message));
+        }
+    });
+    connect(&m_previewRenderer, &PreviewRenderer::timelineChanged, this, [this]() {
+        if (m_previewPrevButton->isEnabled()) {
+            showPreviewAt(m_previewTimeUs);
+        }
+    });
+}
+
+void MainWindow::showPreviewForRow(int row)
+{
+    ensurePreviewPanel();
+    const bool valid = row >= 0 && row < m_jobs.size() && row < m_queueTable->rowCount();
+    for (QPushButton *button : {m_previewPrevButton, m_previewNextButton, m_previewGotoButton}) {
+        button->setEnabled(valid);
+    }
+    if (!valid) {
+        m_previewView->setMessage(tr("Select a job to preview"));
+        m_previewTimeLabel->setText(QStringLiteral("--:--:--.---"));
+        return;
+    }
+
+    const EncodeJob job = jobForRow(row);
+    if (QFileInfo(job.videoPath) != QFileInfo(m_previewSource)) {
+        m_previewSource = job.videoPath;
+        m_previewTimeUs = 0;
+        m_previewVariantCombo->setCurrentIndex(0);
+    }
+    m_previewRenderer.setJob(job);
+    showPreviewAt(m_previewTimeUs);
+}
+
+void MainWindow::onSampleClicked()
+{
+    if (m_sampleEncoder.isRunning()) {
+        appendLog(tr("Cancelling sample encodes"));
+        m_sampleEncoder.cancel();
+        return;
+    }
+
+    int row = m_queueTable->currentRow();
+    if (row < 0 && !m_jobs.isEmpty()) {
+        row = 0;
+    }
+    if (row < 0 || row >= m_jobs.size()) {
+        QMessageBox::information(this, tr("No jobs"), tr("Add a file before running a sample encode."));
+        return;
+    }
+
+    // Samples from a previous run are about to be overwritten.
+    ensurePreviewPanel();
+    m_previewVariantCombo->setCurrentIndex(0);
+    while (m_previewVariantCombo->count() > 1) {
+        m_previewVariantCombo->removeItem(1);
+    }
+
+    const EncodeJob job = jobForRow(row);
+    appendLog(tr("Sample encode: %1").arg(QDir::toNativeSeparators(job.videoPath)));
+    if (m_sampleEncoder.start(job)) {
+        m_sampleAction->setText(tr("Cancel sample"));
+        statusBar()->showMessage(tr("Encoding samples..."));
+    }
+}
+
+void MainWindow::onSamplesFinished(bool success)
+{
+    m_sampleAction->setText(tr("Sample"));
+    ensurePreviewPanel();
+    const QVector<SampleResult> &results = m_sampleEncoder.results();
+    const EncodeJob &job = m_sampleEncoder.job();
+
+    for (int i = 0; i < results.size(); ++i) {
+        const SampleResult &result = results.at(i);
+        if (!result.success) {
+            appendLog(tr("Sample %1 at %2 failed").arg(i + 1).arg(formatTimecode(result.startMs)));
+            continue;
+        }
+        const double minutes = static_cast<double>(result.lengthMs) / 60000.0;
+        appendLog(tr("Sample %1 at %2 (%3%): %4 MiB, %5 MiB/min, %6 fps")
+                      .arg(i + 1)
+                      .arg(formatTimecode(result.startMs))
+                      .arg(qRound(result.position * 100.0))
+                      .arg(QString::number(result.outputBytes / (1024.0 * 1024.0), 'f', 2),
+                           QString::number(result.outputBytes / (1024.0 * 1024.0) / minutes, 'f', 1),
+                           QString::number(result.averageFps, 'f', 1)));
+        m_previewVariantCombo->addItem(tr("Sample %1 (%2%)").arg(i + 1).arg(qRound(result.position * 100.0)));
+    }
+
+    const qint64 projected = m_sampleEncoder.projectedBytes();
+    if (!success || projected < 0) {
+        statusBar()->showMessage(tr("Sample encode failed"), 5000);
+        return;
+    }
+    const QString summary = tr("Projected output: %1 MiB for %2 (samples encoded concurrently; fps is per sample)")
+                                .arg(QString::number(projected / (1024.0 * 1024.0), 'f', 1),
+                                     formatTimecode(job.effectiveDurationMs()));
+    appendLog(summary);
+    statusBar()->showMessage(summary, 10000);
+}
+
+void MainWindow::onPreflightClicked()
+{
+    if (m_preflight.isRunning()) {
+        appendLog(tr("Cancelling preflight"));
+        m_preflight.cancel();
+        return;
+    }
+    if (!startPreflight()) {
+        QMessageBox::information(this, tr("No jobs"), tr("There are no pending jobs to check."));
+    }
+}
+
+bool MainWindow::startPreflight()
+{
+    QList<EncodeJob> jobs;
+    for (int row = 0; row < m_jobs.size() && row < m_queueTable->rowCount(); ++row) {
+        if (rowStatus(row) == JobStatus::Pending || m_preflightFailedJobs.contains(m_jobs.at(row).id)) {
+            jobs.append(jobForRow(row));
+        }
+    }
+    if (!m_preflight.start(jobs)) {
+        return false;
+    }
+    appendLog(tr("Preflight: checking %n job(s)", nullptr, static_cast<int>(jobs.size())));
+    m_preflightAction->setText(tr("Cancel preflight"));
+    statusBar()->showMessage(tr("Preflight running..."));
+    return true;
+}
+
+void MainWindow::onPreflightJobChecked(const PreflightReport &report)
+{
+    const int row = rowForJobId(report.jobId);
+    if (row < 0) {
+        return;
+    }
+    const QString name = QFileInfo(m_jobs.at(row).videoPath).fileName();
+    for (const QString &warning : report.warnings) {
+        appendLog(tr("[warn] Preflight %1: %2").arg(name, warning));
+    }
+    if (!report.ok()) {
+        for (const QString &error : report.errors) {
+            appendLog(tr("[warn] Preflight %1 failed: %2").arg(name, error));
+        }
+        // Only jobs that have not started are held back.
+        if (rowStatus(row) == JobStatus::Pending || m_preflightFailedJobs.contains(report.jobId)) {
+            m_pipeline.cancel(report.jobId);
+            setRowStatus(row, JobStatus::Failed, tr("Preflight: %1").arg(report.errors.constFirst()));
+            m_preflightFailedJobs.insert(report.jobId);
+        }
+        m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("preflight_failed")},
+                                      {QStringLiteral("job"), static_cast<qint64>(report.jobId)},
+                                      {QStringLiteral("errors"), QJsonArray::fromStringList(report.errors)}});
+    } else if (m_preflightFailedJobs.remove(report.jobId) && rowStatus(row) == JobStatus::Failed) {
+        setRowStatus(row, JobStatus::Pending, tr("Pending"));
+    }
+}
+
+void MainWindow::onPreflightFinished(int checked, int failed, bool cancelled)
+{
+    m_preflightAction->setText(tr("Preflight"));
+    const QString summary = cancelled
+        ? tr("Preflight cancelled after %n job(s), %1 held back", nullptr, checked).arg(failed)
+        : failed > 0
+        ? tr("Preflight: %1 of %n job(s) held back", nullptr, checked).arg(failed)
+        : tr("Preflight: all %n job(s) passed", nullptr, checked);
+    appendLog(summary);
+    statusBar()->showMessage(summary, 10000);
+    m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("preflight_finished")},
+                                  {QStringLiteral("checked"), checked},
+                                  {QStringLiteral("failed"), failed},
+                                  {QStringLiteral("cancelled"), cancelled}});
+    updateStartStopAvailability();
+}
+
+void MainWindow::onFontFinderClicked()
+{
+    if (fontFinderSubtitles().isEmpty()) {
+        QMessageBox::information(this, tr("Font Finder"), tr("There is no ASS/SSA subtitle to check."));
+        return;
+    }
+    if (m_fontFinderRunning) {
+        return;
+    }
+    // Refreshing only parses font files that changed, so newly installed fonts are always seen.
+    m_fontFinderPending = true;
+    if (!m_fontIndex.isRefreshing()) {
+        statusBar()->showMessage(tr("Indexing installed fonts..."));
+        m_fontIndex.refresh();
+    }
+}
+
+void MainWindow::onFontIndexRefreshed(int faces, int parsedFiles)
+{
+    appendLog(tr("Font index: %n face(s), %1 file(s) parsed", nullptr, faces).arg(parsedFiles));
+    statusBar()->clearMessage();
+    m_preflight.setFontCatalog(m_fontIndex.catalog());
+    updateFontAttachmentCatalog();
+    if (std::exchange(m_fontFinderPending, false)) {
+        reportSubtitleFonts(fontFinderSubtitles());
+    }
+}
+
+QStringList MainWindow::fontFinderSubtitles() const
+{
+    QStringList candidates;
+    if (m_mainControls.autoSubtitlePath) {
+        candidates << m_mainControls.autoSubtitlePath->text().trimmed();
+    }
+    if (m_mainControls.additionalSubtitleList) {
+        candidates << m_mainControls.additionalSubtitleList->toPlainText().split(QRegularExpression(QStringLiteral("[\\r\\n]+")),
+                                                                                  Qt::SkipEmptyParts);
+    }
+    QStringList subtitles;
+    for (const QString &candidate : std::as_const(candidates)) {
+        const QString path = candidate.trimmed();
+        const QString suffix = QFileInfo(path).suffix().toLower();
+        if ((suffix == QLatin1String("ass") || suffix == QLatin1String("ssa")) && !subtitles.contains(path)) {
+            subtitles << path;
+        }
+    }
+    return subtitles;
+}
+
+void MainWindow::reportSubtitleFonts(const QStringList &subtitlePaths)
+{
+    const std::shared_ptr<const FontCatalog> catalog = m_fontIndex.catalog();
+    if (!catalog) {
+        return;
+    }
+    // Scanning, resolving and the glyph checks read every subtitle and font file involved.
+    m_fontFinderRunning = true;
+    statusBar()->showMessage(tr("Resolving subtitle fonts..."));
+    QThreadPool::globalInstance()->start([self = QPointer<MainWindow>(this), subtitlePaths, catalog]() {
+        const FontFinderReport report = buildFontFinderReport(subtitlePaths, *catalog);
+        if (!self) {
+            return;
+        }
+        QMetaObject::invokeMethod(self, [self, report]() {
+            if (!self) {
+                return;
+            }
+            self->m_fontFinderRunning = false;
+            self->statusBar()->clearMessage();
+            self->showFontFinderReport(report);
+        }, Qt::QueuedConnection);
+    });
+}
+
+MainWindow::FontFinderReport MainWindow::buildFontFinderReport(const QStringList &subtitlePaths, const FontCatalog &catalog)
+{
+    FontFinderReport report;
+    QStringList &details = report.details;
+    QStringList &fontFiles = report.fontFiles;
+    int resolved = 0;
+    int missingFonts = 0;
+    int incompleteFonts = 0;
+    for (const QString &path : subtitlePaths) {
+        details << QFileInfo(path).fileName();
+        bool readable = false;
+        const QList<AssFontRequest> requests = AssFontScanner::scan(path, &readable);
+        if (!readable) {
+            details << tr("  unreadable");
+            continue;
+        }
+        const QList<AssFontResolution> resolutions = AssFontScanner::resolve(requests, catalog);
+        for (const AssFontResolution &resolution : resolutions) {
+            QStringList style;
+            if (resolution.request.bold) {
+                style << tr("bold");
+            }
+            if (resolution.request.italic) {
+                style << tr("italic");
+            }
+            const QString wanted = style.isEmpty() ? resolution.request.family
+                                                   : QStringLiteral("%1 (%2)").arg(resolution.request.family, style.join(QLatin1Char(' ')));
+            if (!resolution.found()) {
+                ++missingFonts;
+                details << tr("  %1: not installed").arg(wanted);
+                continue;
+            }
+            ++resolved;
+            details << tr("  %1: %2 [%3]").arg(wanted, resolution.matchedFace, QDir::toNativeSeparators(resolution.fontPath));
+            if (!resolution.missingGlyphs.isEmpty()) {
+                ++incompleteFonts;
+                details << tr("    missing %n glyph(s): %1", nullptr, static_cast<int>(resolution.missingGlyphs.size()))
+                               .arg(AssFontScanner::describeCharacters(resolution.missingGlyphs));
+            }
+        }
+        for (const QString &file : AssFontScanner::fontFiles(resolutions)) {
+            if (!fontFiles.contains(file)) {
+                fontFiles << file;
+            }
+        }
+    }
+
+    report.summary = tr("Fonts: %1 resolved, %2 not installed, %3 missing glyphs").arg(resolved).arg(missingFonts).arg(incompleteFonts);
+    report.incomplete = missingFonts + incompleteFonts > 0;
+    return report;
+}
+
+void MainWindow::showFontFinderReport(const FontFinderReport &report)
+{
+    appendLog(report.summary);
+    for (const QString &line : report.details) {
+        appendLog(QStringLiteral("[fonts] %1").arg(line));
+    }
+
+    QMessageBox box(this);
+    box.setWindowTitle(tr("Font Finder"));
+    box.setIcon(report.incomplete ? QMessageBox::Warning : QMessageBox::Information);
+    box.setText(report.incomplete
+                    ? tr("%1\n\nlibass will substitute other fonts for what is missing.").arg(report.summary)
+                    : report.summary);
+    box.setDetailedText(report.details.join(QLatin1Char('\n')));
+    const QStringList &fontFiles = report.fontFiles;
+    QPushButton *collectButton = fontFiles.isEmpty() ? nullptr : box.addButton(tr("Copy Fonts..."), QMessageBox::ActionRole);
+    box.addButton(QMessageBox::Close);
+    box.exec();
+    if (!collectButton || box.clickedButton() != collectButton) {
+        return;
+    }
+    const QString folder = QFileDialog::getExistingDirectory(this, tr("Copy fonts to"));
+    if (folder.isEmpty()) {
+        return;
+    }
+    int copied = 0;
+    for (const QString &file : fontFiles) {
+        const QString target = QDir(folder).filePath(QFileInfo(file).fileName());
+        if (QFileInfo::exists(target) || QFile::copy(file, target)) {
+            ++copied;
+        } else {
+            appendLog(tr("[warn] Could not copy %1").arg(QDir::toNativeSeparators(file)));
+        }
+    }
+    appendLog(tr("Copied %1 of %n font file(s) to %2", nullptr, static_cast<int>(fontFiles.size())).arg(copied).arg(QDir::toNativeSeparators(folder)));
+}
+
+void MainWindow::updateFontAttachmentCatalog()
+{
+    const std::shared_ptr<const FontCatalog> catalog = AppSettings::attachSubtitleFonts() ? m_fontIndex.catalog() : nullptr;
+    m_pipeline.setFontCatalog(catalog);
+    m_encoder.setFontCatalog(catalog);
+}
+
+void MainWindow::attachSubtitleFonts(EncodeJob &job)
+{
+    const std::pair<QString, QStringList> fonts = m_resolvedFonts.take(job.id);
+    if (!AppSettings::attachSubtitleFonts() || !job.canAttachFonts()) {
+        return;
+    }
+    if (!m_fontIndex.catalog()) {
+        appendLog(tr("[warn] Font index is not ready; %1 is encoded without font attachments").arg(QFileInfo(job.videoPath).fileName()));
+        return;
+    }
+    // Resolved by the pipeline's assets stage; the encoder resolves jobs it did not reach.
+    if (fonts.first == job.subtitlePath) {
+        job.fontAttachments = fonts.second;
+    }
+}
+
+void MainWindow::showPreviewAt(qint64 timeUs)
+{
+    m_previewTimeUs = std::max<qint64>(timeUs, 0);
+    m_previewTimeLabel->setText(formatTimecode(m_previewTimeUs / 1000));
+    m_previewRenderer.requestFrame(m_previewTimeUs);
 }
 
 QWidget *MainWindow::createMainTab()
@@ -210,11 +955,8 @@ QWidget *MainWindow::createMainTab()
 
     auto *fontFinderButton = new QPushButton(tr("Font Finder"), subtitleGroup);
     subtitleLayout->addWidget(fontFinderButton, 2, 0);
-    connect(fontFinderButton, &QPushButton::clicked, this, [this]() {
-        QMessageBox::information(this,
-                                 tr("Font Finder"),
-                                 tr("Font gathering is not implemented yet."));
-    });
+    fontFinderButton->setToolTip(tr("Resolve every font the ASS subtitles use to an installed file and list missing fonts and glyphs"));
+    connect(fontFinderButton, &QPushButton::clicked, this, &MainWindow::onFontFinderClicked);
 
     subtitleLayout->addWidget(new QLabel(tr("Renderer:"), subtitleGroup), 2, 1);
     m_mainControls.rendererCombo = new QComboBox(subtitleGroup);
@@ -247,8 +989,20 @@ QWidget *MainWindow::createMainTab()
     cutLayout->addWidget(m_mainControls.cutEnd, 1, 3);
     layout->addWidget(cutGroup);
 
+    auto *telegramLayout = new QHBoxLayout;
     m_mainControls.telegramToggle = new QCheckBox(tr("Telegram Mode (MP4 + AAC)"), widget);
-    layout->addWidget(m_mainControls.telegramToggle);
+    telegramLayout->addWidget(m_mainControls.telegramToggle);
+    telegramLayout->addStretch(1);
+    telegramLayout->addWidget(new QLabel(tr("Size budget:"), widget));
+    m_mainControls.sizeBudget = new QSpinBox(widget);
+    m_mainControls.sizeBudget->setRange(0, 1024 * 1024);
+    m_mainControls.sizeBudget->setSuffix(tr(" MiB"));
+    m_mainControls.sizeBudget->setSpecialValueText(tr("Off"));
+    m_mainControls.sizeBudget->setToolTip(
+        tr("Maximum output size. Capped sample encodes predict the bitrate before a single capped or two-pass encode; "
+           "Telegram uploads are limited to 2000 MiB"));
+    telegramLayout->addWidget(m_mainControls.sizeBudget);
+    layout->addLayout(telegramLayout);
 
     auto *outputLayout = new QHBoxLayout;
     outputLayout->addWidget(new QLabel(tr("Output file:"), widget));
@@ -258,6 +1012,75 @@ QWidget *MainWindow::createMainTab()
     outputLayout->addWidget(outputBrowse);
     layout->addLayout(outputLayout);
 
+    auto *profileLayout = new QHBoxLayout;
+    profileLayout->addWidget(new QLabel(tr("Profile:"), widget));
+    m_mainControls.profileCombo = new QComboBox(widget);
+    m_mainControls.profileCombo->setToolTip(
+        tr("Video, audio and logo settings for new jobs. Choosing a saved profile loads it into those tabs, and "
+           "editing a tab switches back to the tab settings. Jobs queued with a saved profile share it; "
+           "saving the profile again updates all of them before they start"));
+    profileLayout->addWidget(m_mainControls.profileCombo, 1);
+    auto *profileSave = new QPushButton(tr("Save as..."), widget);
+    profileSave->setToolTip(tr("Save the current Video, Audio and Logo tab settings as a named profile"));
+    profileLayout->addWidget(profileSave);
+    auto *profileDelete = new QPushButton(tr("Delete"), widget);
+    profileLayout->addWidget(profileDelete);
+    layout->addLayout(profileLayout);
+    reloadProfileCombo(QString());
+    connect(m_mainControls.profileCombo, &QComboBox::currentIndexChanged, this, [this]() {
+        const QString name = m_mainControls.profileCombo->currentData().toString();
+        if (!name.isEmpty() && m_profileStore.contains(name)) {
+            loadProfileIntoTabs(m_profileStore.profile(name));
+        }
+    });
+
+    connect(profileSave, &QPushButton::clicked, this, [this]() {
+        bool ok = false;
+        const QString name = QInputDialog::getText(this, tr("Save profile"), tr("Profile name:"), QLineEdit::Normal,
+                                                   m_mainControls.profileCombo->currentData().toString(), &ok).trimmed();
+        if (!ok || name.isEmpty()) {
+            return;
+        }
+        if (m_profileStore.contains(name)
+            && QMessageBox::question(this, tr("Save profile"),
+                                     tr("Replace profile \"%1\"? Queued jobs using it will encode with the new settings.").arg(name))
+                   != QMessageBox::Yes) {
+            return;
+        }
+        const QStringList currentHooks = m_profileStore.contains(name) ? m_profileStore.profile(name).postEncodeHooks() : m_postEncodeHooks;
+        const QString hookText = QInputDialog::getMultiLineText(this, tr("Save profile"),
+                                                                tr("Post-encode hooks for jobs using this profile, one command line per line:"),
+                                                                currentHooks.join(QLatin1Char('\n')), &ok);
+        if (!ok) {
+            return;
+        }
+        QStringList hooks;
+        for (const QString &line : hookText.split(QLatin1Char('\n'))) {
+            if (!line.trimmed().isEmpty()) {
+                hooks << line.trimmed();
+            }
+        }
+        EncodeProfile profile = tabProfile();
+        profile.setPostEncodeHooks(hooks);
+        m_profileStore.save(name, profile);
+        reloadProfileCombo(name);
+        appendLog(tr("Saved profile %1").arg(name));
+        updateQueueEstimate();
+    });
+    connect(profileDelete, &QPushButton::clicked, this, [this]() {
+        const QString name = m_mainControls.profileCombo->currentData().toString();
+        if (name.isEmpty()
+            || QMessageBox::question(this, tr("Delete profile"),
+                                     tr("Delete profile \"%1\"? Queued jobs using it fall back to the tab settings.").arg(name))
+                   != QMessageBox::Yes) {
+            return;
+        }
+        m_profileStore.remove(name);
+        reloadProfileCombo(QString());
+        appendLog(tr("Deleted profile %1").arg(name));
+        updateQueueEstimate();
+    });
+
     connect(outputBrowse, &QPushButton::clicked, this, [this]() {
         if (!m_mainControls.outputFile) {
             return;
@@ -312,6 +1135,42 @@ QWidget *MainWindow::createVideoTab()
     m_videoControls.qualitySlider->setToolTip(tr("Drag for CRF/CQ (0.0 – 51.0)"));
     layout->addRow(tr("Quality (CRF/CQ):"), m_videoControls.qualitySlider);
 
+    m_videoControls.qualityModeCombo = new QComboBox(widget);
+    m_videoControls.qualityModeCombo->addItem(tr("Fixed CRF/CQ"), QString());
+    m_videoControls.qualityModeCombo->addItem(tr("Target SSIM"), QStringLiteral("ssim"));
+    m_videoControls.qualityModeCombo->addItem(tr("Target PSNR"), QStringLiteral("psnr"));
+    m_videoControls.qualityModeCombo->addItem(tr("Target VMAF"), QStringLiteral("vmaf"));
+    m_videoControls.qualityModeCombo->setToolTip(
+        tr("Target modes search for the highest CRF whose sample encodes still reach the score"));
+    layout->addRow(tr("Quality mode:"), m_videoControls.qualityModeCombo);
+
+    m_videoControls.targetSpin = new QDoubleSpinBox(widget);
+    m_videoControls.targetSpin->setEnabled(false);
+    layout->addRow(tr("Target score:"), m_videoControls.targetSpin);
+
+    connect(m_videoControls.qualityModeCombo, &QComboBox::currentIndexChanged, this, [this]() {
+        const QString metric = m_videoControls.qualityModeCombo->currentData().toString();
+        QDoubleSpinBox *spin = m_videoControls.targetSpin;
+        spin->setEnabled(!metric.isEmpty());
+        m_videoControls.qualitySlider->setEnabled(metric.isEmpty());
+        if (metric == QLatin1String("ssim")) {
+            spin->setDecimals(4);
+            spin->setRange(0.9, 1.0);
+            spin->setSingleStep(0.001);
+            spin->setValue(0.98);
+        } else if (metric == QLatin1String("psnr")) {
+            spin->setDecimals(1);
+            spin->setRange(30.0, 60.0);
+            spin->setSingleStep(0.5);
+            spin->setValue(42.0);
+        } else if (metric == QLatin1String("vmaf")) {
+            spin->setDecimals(1);
+            spin->setRange(50.0, 100.0);
+            spin->setSingleStep(0.5);
+            spin->setValue(93.0);
+        }
+    });
+
     m_videoControls.resizeCombo = new QComboBox(widget);
     m_videoControls.resizeCombo->addItem(tr("None"), QStringLiteral("none"));
     m_videoControls.resizeCombo->addItem(tr("1080p"), QStringLiteral("1080p"));
@@ -464,11 +1323,45 @@ QWidget *MainWindow::createLogTab()
 
     m_logView = new QTextEdit(widget);
     m_logView->setReadOnly(true);
+    // A read-only log has nothing to undo, and the undo stack would grow with every line.
+    m_logView->document()->setUndoRedoEnabled(false);
     layout->addWidget(m_logView);
 
     return widget;
 }
 
+QWidget *MainWindow::createStatsTab()
+{
+    auto *widget = new QWidget(this);
+    auto *layout = new QVBoxLayout(widget);
+    layout->setContentsMargins(0, 0, 0, 0);
+
+    m_statsTable = new QTableWidget(widget);
+    m_statsTable->setColumnCount(15);
+    m_statsTable->setHorizontalHeaderLabels({tr("Finished"), tr("File"), tr("Encoder"), tr("Preset"), tr("CRF/CQ"),
+                                             tr("Result"), tr("Wall"), tr("First frame"), tr("Avg fps"), tr("P5 fps"),
+                                             tr("Speed"), tr("Bitrate"), tr("Size (MiB)"), tr("CPU user/sys (s)"),
+                                             tr("Peak RSS (MiB)")});
+    m_statsTable->horizontalHeader()->setStretchLastSection(true);
+    m_statsTable->setSelectionBehavior(QAbstractItemView::SelectRows);
+    m_statsTable->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    m_statsTable->setSortingEnabled(true);
+    layout->addWidget(m_statsTable, 1);
+
+    auto *buttonRow = new QHBoxLayout;
+    buttonRow->addStretch(1);
+    auto *refreshButton = new QPushButton(tr("Refresh"), widget);
+    connect(refreshButton, &QPushButton::clicked, this, &MainWindow::refreshStatsTable);
+    buttonRow->addWidget(refreshButton);
+    auto *exportButton = new QPushButton(tr("Export CSV"), widget);
+    connect(exportButton, &QPushButton::clicked, this, &MainWindow::onExportStats);
+    buttonRow->addWidget(exportButton);
+    layout->addLayout(buttonRow);
+
+    refreshStatsTable();
+    return widget;
+}
+
 EncodeJob MainWindow::buildJobFromUi(const QString &videoPath) const
 {
     EncodeJob job;
@@ -518,22 +1411,67 @@ EncodeJob MainWindow::buildJobFromUi(const QString &videoPath) const
     }
 
     job.telegramMode = m_mainControls.telegramToggle && m_mainControls.telegramToggle->isChecked();
+    if (m_mainControls.sizeBudget) {
+        job.maxOutputBytes = static_cast<qint64>(m_mainControls.sizeBudget->value()) * 1024 * 1024;
+    }
     if (m_mainControls.outputFile) {
         job.outputFile = m_mainControls.outputFile->text().trimmed();
     }
 
-    if (m_videoControls.encoderCombo) {
-        job.videoSettings.encoder = m_videoControls.encoderCombo->currentData().toString();
-    }
-    if (m_videoControls.presetCombo) {
-        job.videoSettings.preset = m_videoControls.presetCombo->currentData().toString();
-    }
-    if (m_videoControls.qualitySlider) {
-        job.videoSettings.qualityValue = m_videoControls.qualitySlider->value() / 10.0;
+    job.profile = tabProfile();
+    job.postEncodeHooks = m_postEncodeHooks;
+
+    return job;
+}
+
+void MainWindow::reloadProfileCombo(const QString &selected)
+{
+    QComboBox *combo = m_mainControls.profileCombo;
+    const QSignalBlocker blocker(combo);
+    combo->clear();
+    combo->addItem(tr("Tab settings"), QString());
+    for (const QString &name : m_profileStore.names()) {
+        combo->addItem(name, name);
+    }
+    combo->setCurrentIndex(std::max(combo->findData(selected), 0));
+}
+
+void MainWindow::applyNamedProfile(EncodeJob &job, const QString &name) const
+{
+    // Jobs whose profile was deleted since fall back to the tab settings.
+    if (!name.isEmpty() && m_profileStore.contains(name)) {
+        job.profile = m_profileStore.profile(name);
+        // Named profiles carry their own hooks; tab settings use Settings → Hooks.
+        job.postEncodeHooks = job.profile.postEncodeHooks();
+    }
+}
+
+EncodeProfile MainWindow::tabProfile() const
+{
+    if (!m_tabProfileDirty) {
+        return m_tabProfile;
+    }
+
+    VideoSettings video;
+    AudioSettings audio;
+    LogoSettings logo;
+
+    if (m_videoControls.encoderCombo) {
+        video.encoder = m_videoControls.encoderCombo->currentData().toString();
+    }
+    if (m_videoControls.presetCombo) {
+        video.preset = m_videoControls.presetCombo->currentData().toString();
+    }
+    if (m_videoControls.qualitySlider) {
+        video.qualityValue = m_videoControls.qualitySlider->value() / 10.0;
+    }
+    if (m_videoControls.qualityModeCombo && m_videoControls.targetSpin) {
+        video.targetMetric = m_videoControls.qualityModeCombo->currentData().toString();
+        video.targetValue = video.targetMetric.isEmpty() ? 0.0 : m_videoControls.targetSpin->value();
     }
     if (m_videoControls.resizeCombo) {
-        job.videoSettings.resizeMode = m_videoControls.resizeCombo->currentData().toString();
-        if (job.videoSettings.resizeMode == QStringLiteral("custom") && m_videoControls.customSize) {
+        video.resizeMode = m_videoControls.resizeCombo->currentData().toString();
+        if (video.resizeMode == QStringLiteral("custom") && m_videoControls.customSize) {
             const QString text = m_videoControls.customSize->text().trimmed();
             QRegularExpression re(QStringLiteral("^(\\d+)\\s*[xX]\\s*(\\d+)$"));
             const auto match = re.match(text);
@@ -543,39 +1481,111 @@ EncodeJob MainWindow::buildJobFromUi(const QString &videoPath) const
                 const int width = match.captured(1).toInt(&okW);
                 const int height = match.captured(2).toInt(&okH);
                 if (okW && okH && width > 0 && height > 0) {
-                    job.videoSettings.customSize = QSize(width, height);
+                    video.customSize = QSize(width, height);
                 } else {
-                    job.videoSettings.resizeMode = QStringLiteral("none");
+                    video.resizeMode = QStringLiteral("none");
                 }
             } else {
-                job.videoSettings.resizeMode = QStringLiteral("none");
+                video.resizeMode = QStringLiteral("none");
             }
         }
     }
 
     if (m_audioControls.codecCombo) {
-        job.audioSettings.codec = m_audioControls.codecCombo->currentData().toString();
+        audio.codec = m_audioControls.codecCombo->currentData().toString();
     }
     if (m_audioControls.bitrateCombo) {
-        job.audioSettings.bitrateKbps = m_audioControls.bitrateCombo->currentData().toInt();
+        audio.bitrateKbps = m_audioControls.bitrateCombo->currentData().toInt();
     }
     if (m_audioControls.trackCombo) {
-        job.audioSettings.preferredTrackId = m_audioControls.trackCombo->currentText().trimmed();
+        audio.preferredTrackId = m_audioControls.trackCombo->currentText().trimmed();
     }
-    job.audioSettings.volumeSource = m_audioControls.sourceVolume ? static_cast<float>(m_audioControls.sourceVolume->value()) / 100.0f : 1.0f;
-    job.audioSettings.volumeIntro = m_audioControls.introVolume ? static_cast<float>(m_audioControls.introVolume->value()) / 100.0f : 1.0f;
-    job.audioSettings.volumeOutro = m_audioControls.outroVolume ? static_cast<float>(m_audioControls.outroVolume->value()) / 100.0f : 1.0f;
+    audio.volumeSource = m_audioControls.sourceVolume ? static_cast<float>(m_audioControls.sourceVolume->value()) / 100.0f : 1.0f;
+    audio.volumeIntro = m_audioControls.introVolume ? static_cast<float>(m_audioControls.introVolume->value()) / 100.0f : 1.0f;
+    audio.volumeOutro = m_audioControls.outroVolume ? static_cast<float>(m_audioControls.outroVolume->value()) / 100.0f : 1.0f;
 
     if (m_logoControls.imagePath) {
-        job.logoSettings.imagePath = m_logoControls.imagePath->text().trimmed();
+        logo.imagePath = m_logoControls.imagePath->text().trimmed();
     }
-    job.logoSettings.placement = m_logoControls.placementCombo ? m_logoControls.placementCombo->currentData().toString() : QStringLiteral("top-left");
-    job.logoSettings.opacity = m_logoControls.opacitySlider ? static_cast<float>(m_logoControls.opacitySlider->value()) / 100.0f : 0.8f;
-    job.logoSettings.visibility = m_logoControls.visibilityCombo ? m_logoControls.visibilityCombo->currentData().toString() : QStringLiteral("always");
-    job.logoSettings.visibleDuration = m_logoControls.durationSpin ? m_logoControls.durationSpin->value() : 0;
-    job.logoSettings.visibleInterval = m_logoControls.intervalSpin ? m_logoControls.intervalSpin->value() : 0;
+    logo.placement = m_logoControls.placementCombo ? m_logoControls.placementCombo->currentData().toString() : QStringLiteral("top-left");
+    logo.opacity = m_logoControls.opacitySlider ? static_cast<float>(m_logoControls.opacitySlider->value()) / 100.0f : 0.8f;
+    logo.visibility = m_logoControls.visibilityCombo ? m_logoControls.visibilityCombo->currentData().toString() : QStringLiteral("always");
+    logo.visibleDuration = m_logoControls.durationSpin ? m_logoControls.durationSpin->value() : 0;
+    logo.visibleInterval = m_logoControls.intervalSpin ? m_logoControls.intervalSpin->value() : 0;
+
+    m_tabProfile = EncodeProfile(video, audio, logo);
+    m_tabProfileDirty = false;
+    return m_tabProfile;
+}
 
-    return job;
+void MainWindow::loadProfileIntoTabs(const EncodeProfile &profile)
+{
+    const auto select = [](QComboBox *combo, const QVariant &value) {
+        const int index = combo->findData(value);
+        if (index >= 0) {
+            combo->setCurrentIndex(index);
+        }
+    };
+    m_loadingProfile = true;
+    const VideoSettings &video = profile.video();
+    select(m_videoControls.encoderCombo, video.encoder);
+    select(m_videoControls.presetCombo, video.preset);
+    m_videoControls.qualitySlider->setValue(static_cast<int>(std::lround(video.qualityValue * 10.0)));
+    // The mode change resets the target to the metric's default, so the target is set after it.
+    select(m_videoControls.qualityModeCombo, video.targetMetric);
+    if (!video.targetMetric.isEmpty()) {
+        m_videoControls.targetSpin->setValue(video.targetValue);
+    }
+    select(m_videoControls.resizeCombo, video.resizeMode);
+    m_videoControls.customSize->setText(video.customSize.isValid()
+                                            ? QStringLiteral("%1x%2").arg(video.customSize.width()).arg(video.customSize.height())
+                                            : QString());
+
+    const AudioSettings &audio = profile.audio();
+    select(m_audioControls.codecCombo, audio.codec);
+    select(m_audioControls.bitrateCombo, audio.bitrateKbps);
+    m_audioControls.trackCombo->setEditText(audio.preferredTrackId);
+    m_audioControls.sourceVolume->setValue(static_cast<int>(std::lround(audio.volumeSource * 100.0f)));
+    m_audioControls.introVolume->setValue(static_cast<int>(std::lround(audio.volumeIntro * 100.0f)));
+    m_audioControls.outroVolume->setValue(static_cast<int>(std::lround(audio.volumeOutro * 100.0f)));
+
+    const LogoSettings &logo = profile.logo();
+    m_logoControls.imagePath->setText(logo.imagePath);
+    select(m_logoControls.placementCombo, logo.placement);
+    m_logoControls.opacitySlider->setValue(static_cast<int>(std::lround(logo.opacity * 100.0f)));
+    select(m_logoControls.visibilityCombo, logo.visibility);
+    m_logoControls.durationSpin->setValue(logo.visibleDuration);
+    m_logoControls.intervalSpin->setValue(logo.visibleInterval);
+    m_loadingProfile = false;
+    m_tabProfileDirty = true;
+}
+
+void MainWindow::watchProfileControls()
+{
+    const auto invalidate = [this]() {
+        m_tabProfileDirty = true;
+        // Edited settings are no longer the saved profile; new jobs take them from the tabs.
+        if (!m_loadingProfile && m_mainControls.profileCombo->currentIndex() > 0) {
+            m_mainControls.profileCombo->setCurrentIndex(0);
+        }
+    };
+    for (QComboBox *combo : {m_videoControls.encoderCombo, m_videoControls.presetCombo, m_videoControls.qualityModeCombo,
+                             m_videoControls.resizeCombo, m_audioControls.codecCombo, m_audioControls.bitrateCombo,
+                             m_audioControls.trackCombo, m_logoControls.placementCombo, m_logoControls.visibilityCombo}) {
+        connect(combo, &QComboBox::currentIndexChanged, this, invalidate);
+        connect(combo, &QComboBox::editTextChanged, this, invalidate);
+    }
+    for (QSlider *slider : {m_videoControls.qualitySlider, m_audioControls.sourceVolume, m_audioControls.introVolume,
+                            m_audioControls.outroVolume, m_logoControls.opacitySlider}) {
+        connect(slider, &QSlider::valueChanged, this, invalidate);
+    }
+    for (QSpinBox *spin : {m_logoControls.durationSpin, m_logoControls.intervalSpin}) {
+        connect(spin, &QSpinBox::valueChanged, this, invalidate);
+    }
+    for (QLineEdit *edit : {m_videoControls.customSize, m_logoControls.imagePath}) {
+        connect(edit, &QLineEdit::textChanged, this, invalidate);
+    }
+    connect(m_videoControls.targetSpin, &QDoubleSpinBox::valueChanged, this, invalidate);
 }
 
 QString MainWindow::detectSubtitleFor(const QString &videoPath) const
@@ -607,24 +1617,296 @@ void MainWindow::updateQueueRowDisplay(int row)
         return;
     }
 
-    auto *outputItem = m_queueTable->item(row, 2);
+    auto *outputItem = m_queueTable->item(row, 3);
     if (!outputItem) {
         outputItem = new QTableWidgetItem;
-        m_queueTable->setItem(row, 2, outputItem);
+        m_queueTable->setItem(row, 3, outputItem);
     }
     const QString outputPath = m_jobs.at(row).resolvedOutputPath();
     outputItem->setText(outputPath);
     outputItem->setToolTip(outputPath);
+
+    if (row != m_activeRow) {
+        auto *estimateItem = m_queueTable->item(row, 2);
+        if (!estimateItem) {
+            estimateItem = new QTableWidgetItem;
+            m_queueTable->setItem(row, 2, estimateItem);
+        }
+        const qint64 predictedMs = m_durationModel.predictWallMs(m_jobs.at(row));
+        estimateItem->setData(Qt::UserRole, predictedMs);
+        estimateItem->setText(predictedMs >= 0 ? QStringLiteral("~%1").arg(formatTimecode(predictedMs)) : QStringLiteral("-"));
+        estimateItem->setToolTip(predictedMs >= 0
+                                     ? tr("Predicted from %n previous encode(s)", nullptr, m_durationModel.sampleCount())
+                                     : tr("Not enough history for this encoder/preset yet"));
+    }
+}
+
+void MainWindow::updateQueueEstimate()
+{
+    if (!m_queueEstimateLabel) {
+        return;
+    }
+
+    qint64 totalMs = std::max<qint64>(m_activeEtaMs, 0);
+    int pending = 0;
+    int unknown = 0;
+    for (int row = 0; row < m_jobs.size(); ++row) {
+        if (row == m_activeRow) {
+            continue;
+        }
+        if (rowStatus(row) != JobStatus::Pending) {
+            continue;
+        }
+        ++pending;
+        const QTableWidgetItem *estimateItem = m_queueTable->item(row, 2);
+        const qint64 predictedMs = estimateItem ? estimateItem->data(Qt::UserRole).toLongLong() : -1;
+        if (predictedMs >= 0) {
+            totalMs += predictedMs;
+        } else {
+            ++unknown;
+        }
+    }
+
+    QString text = tr("Queue: %n pending", nullptr, pending);
+    if (totalMs > 0) {
+        text += tr(", est. %1").arg(formatTimecode(totalMs));
+        if (unknown > 0) {
+            text += tr(" (+%n unknown)", nullptr, unknown);
+        }
+    }
+    m_queueEstimateLabel->setText(text);
+}
+
+void MainWindow::probeNextQueuedSource()
+{
+    if (m_mediaProbe.isRunning() || m_probeQueue.isEmpty()) {
+        return;
+    }
+    if (m_ffprobePath.isEmpty()) {
+        m_ffprobePath = locateFfprobe();
+        if (m_ffprobePath.isEmpty()) {
+            m_probeQueue.clear();
+            return;
+        }
+    }
+    m_mediaProbe.start(m_ffprobePath, m_probeQueue.takeFirst());
+}
+
+void MainWindow::onCapabilitiesProbed(const FfmpegCapabilities &capabilities)
+{
+    m_encoder.setCapabilities(capabilities);
+    m_preflight.setCapabilities(capabilities);
+    if (!capabilities.valid) {
+        return;
+    }
+    QStringList hardware(capabilities.workingHardwareEncoders.cbegin(), capabilities.workingHardwareEncoders.cend());
+    hardware.sort();
+    appendLog(tr("ffmpeg: %n encoder(s)", nullptr, static_cast<int>(capabilities.encoders.size()))
+              + tr(", %n filter(s); working hardware encoders: %1", nullptr, static_cast<int>(capabilities.filters.size()))
+                    .arg(hardware.isEmpty() ? tr("none") : hardware.join(QStringLiteral(", "))));
+
+    auto *model = m_videoControls.encoderCombo ? qobject_cast<QStandardItemModel *>(m_videoControls.encoderCombo->model()) : nullptr;
+    if (!model) {
+        return;
+    }
+    for (int i = 0; i < m_videoControls.encoderCombo->count(); ++i) {
+        EncodeJob probe;
+        probe.profile.editVideo().encoder = m_videoControls.encoderCombo->itemData(i).toString();
+        const bool available = capabilities.hasEncoder(Encoder::videoCodecForJob(probe));
+        if (QStandardItem *item = model->item(i)) {
+            item->setEnabled(available);
+            item->setToolTip(available ? QString() : tr("Not available with this ffmpeg build or hardware"));
+        }
+    }
+    if (!model->item(m_videoControls.encoderCombo->currentIndex())->isEnabled()) {
+        m_videoControls.encoderCombo->setCurrentIndex(m_videoControls.encoderCombo->findData(QStringLiteral("x264")));
+    }
+}
+
+void MainWindow::onSourceProbed(const QString &videoPath, const MediaInfo &info)
+{
+    if (info.valid) {
+        for (int row = 0; row < m_jobs.size(); ++row) {
+            EncodeJob &job = m_jobs[row];
+            if (job.videoPath != videoPath) {
+                continue;
+            }
+            job.durationMs = info.durationMs;
+            job.sourceHeight = info.height;
+            job.sourceFrameRate = info.frameRate;
+            updateQueueRowDisplay(row);
+        }
+        updateQueueEstimate();
+    }
+    probeNextQueuedSource();
+}
+
+void MainWindow::refreshStatsTable()
+{
+    if (!m_statsTable) {
+        return;
+    }
+
+    const QVector<JobTelemetry> records = m_telemetryStore.load();
+    m_statsTable->setSortingEnabled(false);
+    m_statsTable->setRowCount(records.size());
+    for (int row = 0; row < records.size(); ++row) {
+        const JobTelemetry &record = records.at(row);
+        const QStringList cells{
+            record.finishedAt.toString(QStringLiteral("yyyy-MM-dd HH:mm")),
+            QFileInfo(record.videoPath).fileName(),
+            record.encoder,
+            record.preset,
+            QString::number(record.qualityValue, 'f', 1),
+            record.success ? tr("Done") : tr("Failed"),
+            formatTimecode(record.wallTimeMs),
+            record.timeToFirstFrameMs >= 0 ? QString::number(record.timeToFirstFrameMs / 1000.0, 'f', 1) : QStringLiteral("-"),
+            QString::number(record.averageFps, 'f', 1),
+            QString::number(record.p5Fps, 'f', 1),
+            QStringLiteral("%1x").arg(QString::number(record.speed, 'f', 2)),
+            QStringLiteral("%1 kb/s").arg(QString::number(record.bitrateKbps, 'f', 0)),
+            QString::number(record.outputBytes / (1024.0 * 1024.0), 'f', 1),
+            QStringLiteral("%1 / %2").arg(QString::number(record.cpuUserMs / 1000.0, 'f', 1),
+                                          QString::number(record.cpuSystemMs / 1000.0, 'f', 1)),
+            QString::number(record.peakRssKb / 1024.0, 'f', 1)
+        };
+        for (int column = 0; column < cells.size(); ++column) {
+            auto *item = new QTableWidgetItem(cells.at(column));
+            if (column == 1) {
+                item->setToolTip(record.videoPath);
+            }
+            m_statsTable->setItem(row, column, item);
+        }
+    }
+    m_statsTable->setSortingEnabled(true);
 }
 
 void MainWindow::appendLog(const QString &line)
 {
-    if (!m_logView) {
+    if (m_lowOverheadUi || !m_logView) {
+        // Held until the next flush, or until the Log tab is first opened.
+        if (m_pendingLogLines.capacity() == 0) {
+            m_pendingLogLines.setCapacity(kMaxPendingLogLines);
+        }
+        if (m_pendingLogLines.isFull()) {
+            ++m_droppedLogLines;
+        }
+        m_pendingLogLines.append(formatTimestampedLine(line));
+        if (m_logView) {
+            scheduleUiFlush();
+        }
         return;
     }
     m_logView->append(formatTimestampedLine(line));
 }
 
+void MainWindow::scheduleUiFlush()
+{
+    if (m_uiFlushTimer.isActive()) {
+        return;
+    }
+    // Nothing needs to be drawn faster than the screen refreshes, and nothing often while nobody is looking.
+    int intervalMs = 1000;
+    if (isVisible() && !isMinimized()) {
+        const qreal refreshRate = screen() ? screen()->refreshRate() : 60.0;
+        intervalMs = std::max(16, qRound(1000.0 / std::max<qreal>(refreshRate, 1.0)));
+    }
+    m_uiFlushTimer.start(intervalMs);
+}
+
+void MainWindow::flushUiUpdates()
+{
+    m_uiFlushTimer.stop();
+    if (m_progressPending) {
+        m_progressPending = false;
+        applyProgress(m_encoder.progress());
+    }
+    if (m_etaPending) {
+        m_etaPending = false;
+        applyEta(m_activeEtaMs);
+    }
+    if (m_statusPending) {
+        m_statusPending = false;
+        statusBar()->showMessage(m_pendingStatusText);
+    }
+    if (m_pendingLogLines.isEmpty() || !m_logView) {
+        return;
+    }
+    // One edit block per batch: a single layout pass instead of one per line.
+    QScrollBar *scrollBar = m_logView->verticalScrollBar();
+    const bool atBottom = scrollBar->value() == scrollBar->maximum();
+    QTextCursor cursor(m_logView->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.beginEditBlock();
+    const auto insertLine = [&](const QString &line) {
+        if (!m_logView->document()->isEmpty()) {
+            cursor.insertBlock();
+        }
+        cursor.insertText(line);
+    };
+    if (m_droppedLogLines > 0) {
+        insertLine(formatTimestampedLine(tr("[warn] %n earlier log line(s) were dropped", nullptr, m_droppedLogLines)));
+        m_droppedLogLines = 0;
+    }
+    for (qsizetype i = m_pendingLogLines.firstIndex(); i <= m_pendingLogLines.lastIndex(); ++i) {
+        insertLine(m_pendingLogLines.at(i));
+    }
+    cursor.endEditBlock();
+    m_pendingLogLines.clear();
+    if (atBottom) {
+        scrollBar->setValue(scrollBar->maximum());
+    }
+}
+
+void MainWindow::updateUiCpuLabel()
+{
+    const qint64 cpuMs = currentThreadCpuMs();
+    const qint64 wallMs = m_uiCpuClock.restart();
+    if (cpuMs < 0 || m_uiCpuLastMs < 0) {
+        return;
+    }
+    const qint64 usedMs = cpuMs - std::exchange(m_uiCpuLastMs, cpuMs);
+    if (isVisible() && !isMinimized() && wallMs > 0) {
+        m_uiCpuLabel->setText(tr("UI %1% CPU").arg(QString::number(100.0 * usedMs / wallMs, 'f', 1)));
+    }
+}
+
+void MainWindow::updateUiCpuTimer()
+{
+    // The reading only matters while something encodes and someone can see it.
+    if (!m_uiCpuLabel) {
+        return;
+    }
+    const bool busy = m_encoder.state() != Encoder::State::Idle || m_workerPool.activeJobCount() > 0;
+    const bool wanted = busy && !isMinimized() && !m_uiCpuLabel->isHidden();
+    if (wanted == m_uiCpuTimer.isActive()) {
+        return;
+    }
+    if (wanted) {
+        m_uiCpuLastMs = currentThreadCpuMs();
+        m_uiCpuClock.start();
+        m_uiCpuTimer.start();
+    } else {
+        m_uiCpuTimer.stop();
+        m_uiCpuLabel->clear();
+    }
+}
+
+void MainWindow::changeEvent(QEvent *event)
+{
+    QMainWindow::changeEvent(event);
+    if (event->type() != QEvent::WindowStateChange) {
+        return;
+    }
+    if (m_startButton) {
+        m_startButton->setAnimationSuspended(isMinimized());
+    }
+    updateUiCpuTimer();
+    if (!isMinimized()) {
+        flushUiUpdates();
+    }
+}
+
 void MainWindow::updateStartStopAvailability()
 {
     const bool hasJobs = m_queueTable && m_queueTable->rowCount() > 0 && !m_jobs.isEmpty();
@@ -633,8 +1915,9 @@ void MainWindow::updateStartStopAvailability()
         m_startButton->setEnabled(hasJobs && isIdle);
     }
     if (m_stopButton) {
-        m_stopButton->setEnabled(!isIdle);
+        m_stopButton->setEnabled(!isIdle || m_workerPool.activeJobCount() > 0);
     }
+    updateUiCpuTimer();
 }
 
 void MainWindow::onAddFile()
@@ -643,9 +1926,28 @@ void MainWindow::onAddFile()
     if (file.isEmpty()) {
         return;
     }
+    enqueueFile(file);
+}
 
+int MainWindow::enqueueFile(const QString &file, const QJsonObject &overrides, EnqueueOrigin origin)
+{
     EncodeJob job = buildJobFromUi(file);
-    if (m_mainControls.autoSubtitlePath) {
+    job.id = m_nextJobId++;
+    applyNamedProfile(job, overrides.contains(QStringLiteral("profile"))
+                               ? overrides.value(QStringLiteral("profile")).toString()
+                               : m_mainControls.profileCombo->currentData().toString());
+    if (!overrides.isEmpty()) {
+        applyJobOverrides(job, overrides);
+        m_jobOverrides.insert(job.id, overrides);
+    }
+    // Read once, in the background; queue estimates are refreshed for every row after each job.
+    if (job.subtitlePath.isEmpty()) {
+        job.subtitleComplexity = DurationModel::NoSubtitles;
+    } else {
+        m_pipeline.measureSubtitle(job.id, job.subtitlePath);
+    }
+    m_queuedSources.insert(sourceKey(file));
+    if (m_mainControls.autoSubtitlePath && origin == EnqueueOrigin::Interactive) {
         m_mainControls.autoSubtitlePath->setText(job.subtitlePath);
     }
 
@@ -657,13 +1959,260 @@ void MainWindow::onAddFile()
     fileItem->setToolTip(file);
     m_queueTable->setItem(row, 0, fileItem);
 
-    m_queueTable->setItem(row, 1, new QTableWidgetItem(tr("Pending")));
+    m_queueTable->setItem(row, 1, new QTableWidgetItem);
+    setRowStatus(row, JobStatus::Pending, tr("Pending"));
 
     m_jobs.append(std::move(job));
     updateQueueRowDisplay(row);
+    m_probeQueue.append(file);
+    probeNextQueuedSource();
+    updateQueueEstimate();
 
     appendLog(tr("Added job: %1").arg(file));
     updateStartStopAvailability();
+    m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("job_added")},
+                                  {QStringLiteral("job"), static_cast<qint64>(m_jobs.at(row).id)},
+                                  {QStringLiteral("path"), file}});
+    return row;
+}
+
+int MainWindow::rowForJobId(quint64 id) const
+{
+    for (int row = 0; row < m_jobs.size(); ++row) {
+        if (m_jobs.at(row).id == id) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+QJsonObject MainWindow::handleControlRequest(const QJsonObject &request)
+{
+    const QString command = request.value(QStringLiteral("cmd")).toString();
+    const auto error = [](const QString &message) {
+        return QJsonObject{{QStringLiteral("ok"), false}, {QStringLiteral("error"), message}};
+    };
+
+    if (command == QLatin1String("enqueue")) {
+        const QString path = request.value(QStringLiteral("path")).toString();
+        if (path.isEmpty() || !QFileInfo(path).isFile()) {
+            return error(tr("File not found: %1").arg(path));
+        }
+        QJsonObject overrides = request;
+        overrides.remove(QStringLiteral("cmd"));
+        overrides.remove(QStringLiteral("path"));
+        overrides.remove(QStringLiteral("id"));
+        overrides.remove(QStringLiteral("start"));
+        if (overrides.contains(QStringLiteral("profile")) && !m_profileStore.contains(overrides.value(QStringLiteral("profile")).toString())) {
+            return error(tr("Unknown profile: %1").arg(overrides.value(QStringLiteral("profile")).toString()));
+        }
+        if (overrides.contains(QStringLiteral("hooks"))) {
+            const QString profileName = overrides.contains(QStringLiteral("profile"))
+                ? overrides.value(QStringLiteral("profile")).toString()
+                : m_mainControls.profileCombo->currentData().toString();
+            const QStringList configured = m_profileStore.contains(profileName) ? m_profileStore.profile(profileName).postEncodeHooks()
+                                                                                : m_postEncodeHooks;
+            QStringList selected;
+            const QStringList unknown = selectConfiguredHooks(overrides.value(QStringLiteral("hooks")), configured, &selected);
+            if (!unknown.isEmpty()) {
+                return error(tr("Not a configured hook: %1").arg(unknown.join(QStringLiteral(", "))));
+            }
+            // Stored as command lines, so editing the hook list later cannot shift a selection.
+            overrides.insert(QStringLiteral("hooks"), QJsonArray::fromStringList(selected));
+        }
+        const int row = enqueueFile(QFileInfo(path).absoluteFilePath(), overrides, EnqueueOrigin::Background);
+        if (request.value(QStringLiteral("start")).toBool()) {
+            m_scheduler.setRunning(true);
+            m_scheduler.startNext();
+        }
+        return {{QStringLiteral("ok"), true}, {QStringLiteral("job"), static_cast<qint64>(m_jobs.at(row).id)}};
+    }
+
+    if (command == QLatin1String("list")) {
+        QJsonArray jobs;
+        for (int row = 0; row < m_jobs.size(); ++row) {
+            const EncodeJob &job = m_jobs.at(row);
+            QJsonObject entry{
+                {QStringLiteral("job"), static_cast<qint64>(job.id)},
+                {QStringLiteral("path"), job.videoPath},
+                {QStringLiteral("output"), job.resolvedOutputPath()},
+                {QStringLiteral("profile"), job.profile.name()},
+                {QStringLiteral("status"), jobStatusName(static_cast<int>(rowStatus(row)))},
+                {QStringLiteral("detail"), m_queueTable->item(row, 1) ? m_queueTable->item(row, 1)->text() : QString()}
+            };
+            if (row == m_activeRow) {
+                entry.insert(QStringLiteral("progress"), m_encoder.progress());
+                entry.insert(QStringLiteral("eta_ms"), m_activeEtaMs);
+            }
+            jobs.append(entry);
+        }
+        return {{QStringLiteral("ok"), true}, {QStringLiteral("jobs"), jobs}, {QStringLiteral("running"), m_scheduler.isRunning()}};
+    }
+
+    if (command == QLatin1String("profiles")) {
+        return {{QStringLiteral("ok"), true}, {QStringLiteral("profiles"), QJsonArray::fromStringList(m_profileStore.names())}};
+    }
+
+    if (command == QLatin1String("preflight")) {
+        if (m_preflight.isRunning()) {
+            return error(tr("Preflight is already running"));
+        }
+        if (!startPreflight()) {
+            return error(tr("There are no pending jobs to check"));
+        }
+        return {{QStringLiteral("ok"), true}};
+    }
+
+    if (command == QLatin1String("start")) {
+        m_scheduler.setRunning(true);
+        const bool started = m_scheduler.startNext() || m_encoder.state() != Encoder::State::Idle
+                             || m_workerPool.activeJobCount() > 0;
+        if (!started) {
+            m_scheduler.setRunning(false);
+        }
+        return {{QStringLiteral("ok"), started}};
+    }
+
+    const quint64 requestedId = static_cast<quint64>(request.value(QStringLiteral("job")).toInteger());
+    const quint64 activeId = (m_activeRow >= 0 && m_activeRow < m_jobs.size()) ? m_jobs.at(m_activeRow).id : 0;
+    const bool targetsActive = requestedId == 0 || requestedId == activeId;
+
+    if (command == QLatin1String("stop")) {
+        if (!targetsActive) {
+            const int row = rowForJobId(requestedId);
+            if (row < 0) {
+                return error(tr("Unknown job %1").arg(requestedId));
+            }
+            if (rowStatus(row) == JobStatus::Pending) {
+                setRowStatus(row, JobStatus::Failed, tr("Cancelled"));
+                updateQueueEstimate();
+            } else if (rowStatus(row) == JobStatus::Running) {
+                m_workerPool.cancel(requestedId);
+            }
+            return {{QStringLiteral("ok"), true}};
+        }
+        if (m_encoder.state() == Encoder::State::Idle) {
+            return error(tr("No job is running"));
+        }
+        onStopClicked();
+        return {{QStringLiteral("ok"), true}};
+    }
+
+    if (command == QLatin1String("pause") || command == QLatin1String("resume")) {
+        if (!targetsActive) {
+            return error(tr("Job %1 is not running").arg(requestedId));
+        }
+        const bool ok = command == QLatin1String("pause") ? m_encoder.pauseEncoding() : m_encoder.resumeEncoding();
+        return ok ? QJsonObject{{QStringLiteral("ok"), true}} : error(tr("Encoder cannot %1 in its current state").arg(command));
+    }
+
+    if (command == QLatin1String("activate")) {
+        setWindowState((windowState() & ~Qt::WindowMinimized) | Qt::WindowActive);
+        show();
+        raise();
+        activateWindow();
+        return {{QStringLiteral("ok"), true}};
+    }
+
+    return error(tr("Unknown command: %1").arg(command));
+}
+
+void MainWindow::publishProgressSnapshot()
+{
+    if (m_activeRow < 0 || m_activeRow >= m_jobs.size()) {
+        return;
+    }
+    m_controlServer.publishProgress({{QStringLiteral("job"), static_cast<qint64>(m_jobs.at(m_activeRow).id)},
+                                     {QStringLiteral("progress"), m_encoder.progress()},
+                                     {QStringLiteral("eta_ms"), m_activeEtaMs},
+                                     {QStringLiteral("status"), m_encoder.statusText()}});
+}
+
+void MainWindow::onWatchedFileReady(const QString &path, const QString &folder)
+{
+    if (m_queuedSources.contains(sourceKey(path))) {
+        return;
+    }
+
+    // The folder's own profile, never the Main-tab combo: changing that for an
+    // interactive job must not change what unattended encodes use.
+    QString profile;
+    const QHash<QString, QString> profiles = AppSettings::watchFolderProfiles();
+    for (auto it = profiles.cbegin(); it != profiles.cend(); ++it) {
+        if (QDir::cleanPath(QFileInfo(it.key()).absoluteFilePath()) == folder) {
+            profile = it.value();
+            break;
+        }
+    }
+    if (!profile.isEmpty() && !m_profileStore.contains(profile)) {
+        appendLog(tr("[warn] Watch folder %1: profile %2 no longer exists; using the Main tab settings")
+                      .arg(QDir::toNativeSeparators(folder), profile));
+        profile.clear();
+    }
+
+    appendLog(tr("Watch folder: %1 is complete").arg(QDir::toNativeSeparators(path)));
+    enqueueFile(path, QJsonObject{{QStringLiteral("profile"), profile}}, EnqueueOrigin::Background);
+    if (AppSettings::autoStartWatchedJobs()) {
+        m_scheduler.setRunning(true);
+        m_scheduler.startNext();
+    }
+}
+
+void MainWindow::onSettingsClicked()
+{
+    SettingsDialog dialog(m_profileStore.names(), this);
+    if (dialog.exec() == QDialog::Accepted) {
+        applySettings();
+    }
+}
+
+void MainWindow::applySettings()
+{
+    m_lowOverheadUi = AppSettings::lowOverheadUi();
+    m_soundEffects.setEnabled(AppSettings::soundEffectsEnabled());
+    if (!m_lowOverheadUi) {
+        flushUiUpdates();
+    }
+    m_encoder.setOutputCacheEnabled(AppSettings::outputCacheEnabled());
+    m_encoder.setSourceIndexingEnabled(AppSettings::sourceIndexingEnabled());
+    m_encoder.setMoovReservationEnabled(AppSettings::moovReservationEnabled());
+    m_encoder.setScratchDirectory(AppSettings::scratchDirectory());
+    m_preflight.setScratchDirectory(AppSettings::scratchDirectory());
+    if (AppSettings::attachSubtitleFonts() && !m_fontIndex.catalog()) {
+        // Built ahead of the first job so its fonts can be attached.
+        m_fontIndex.refresh();
+    }
+    updateFontAttachmentCatalog();
+    m_encoder.setLogLevel(AppSettings::ffmpegLogLevel());
+    m_pipeline.setIndexingEnabled(AppSettings::sourceIndexingEnabled());
+    m_postEncodeHooks = AppSettings::postEncodeHooks();
+    m_hookRunner.setTimeoutMs(AppSettings::hookTimeoutSeconds() * 1000);
+    m_hookRunner.setConcurrency(AppSettings::hookConcurrency());
+    m_watchService.setFolders(AppSettings::watchFolders());
+    m_workerPool.setEndpoints(AppSettings::workerEndpoints());
+}
+
+MainWindow::JobStatus MainWindow::rowStatus(int row) const
+{
+    const QTableWidgetItem *item = m_queueTable ? m_queueTable->item(row, 1) : nullptr;
+    if (!item) {
+        return JobStatus::Pending;
+    }
+    return static_cast<JobStatus>(item->data(Qt::UserRole).toInt());
+}
+
+void MainWindow::setRowStatus(int row, JobStatus status, const QString &text)
+{
+    if (!m_queueTable || row < 0 || row >= m_queueTable->rowCount()) {
+        return;
+    }
+    auto *item = m_queueTable->item(row, 1);
+    if (!item) {
+        item = new QTableWidgetItem;
+        m_queueTable->setItem(row, 1, item);
+    }
+    item->setData(Qt::UserRole, static_cast<int>(status));
+    item->setText(text);
 }
 
 void MainWindow::onRemoveSelected()
@@ -678,6 +2227,12 @@ void MainWindow::onRemoveSelected()
         appendLog(tr("Removed job: %1").arg(m_queueTable->item(row, 0)->text()));
         m_queueTable->removeRow(row);
         if (row >= 0 && row < m_jobs.size()) {
+            m_workerPool.cancel(m_jobs.at(row).id);
+            m_pipeline.cancel(m_jobs.at(row).id);
+            m_localOnlyJobs.remove(m_jobs.at(row).id);
+            m_jobOverrides.remove(m_jobs.at(row).id);
+            m_preflightFailedJobs.remove(m_jobs.at(row).id);
+            m_queuedSources.remove(sourceKey(m_jobs.at(row).videoPath));
             m_jobs.removeAt(row);
         }
         if (m_activeRow == row) {
@@ -686,6 +2241,7 @@ void MainWindow::onRemoveSelected()
             --m_activeRow;
         }
     }
+    updateQueueEstimate();
     updateStartStopAvailability();
 }
 
@@ -699,55 +2255,211 @@ void MainWindow::onStartClicked()
         return;
     }
 
-    const int row = 0;
-    if (!m_queueTable->item(row, 0)) {
-        QMessageBox::warning(this, tr("Missing file"), tr("The selected job has no source path."));
-        return;
+    m_scheduler.setRunning(true);
+    if (!m_scheduler.startNext()) {
+        m_scheduler.setRunning(false);
+        QMessageBox::information(this, tr("No jobs"), tr("Every job in the queue has already been processed."));
     }
+}
 
-    const QString sourcePath = m_queueTable->item(row, 0)->data(Qt::UserRole).toString();
-    if (sourcePath.isEmpty() || row >= m_jobs.size()) {
-        QMessageBox::warning(this, tr("Missing file"), tr("The selected job has no source path."));
-        return;
+EncodeJob MainWindow::jobForRow(int row) const
+{
+    // Jobs run with the tab settings current at start time plus any per-job overrides.
+    const EncodeJob &queued = m_jobs.at(row);
+    const QString sourcePath = m_queueTable->item(row, 0) ? m_queueTable->item(row, 0)->data(Qt::UserRole).toString() : queued.videoPath;
+    EncodeJob job = buildJobFromUi(sourcePath);
+    job.id = queued.id;
+    job.durationMs = queued.durationMs;
+    job.sourceHeight = queued.sourceHeight;
+    job.sourceFrameRate = queued.sourceFrameRate;
+    applyNamedProfile(job, queued.profile.name());
+    const auto overrides = m_jobOverrides.constFind(queued.id);
+    if (overrides != m_jobOverrides.constEnd()) {
+        applyJobOverrides(job, *overrides);
+    }
+    if (job.subtitlePath == queued.subtitlePath) {
+        job.subtitleComplexity = queued.subtitleComplexity;
     }
+    return job;
+}
+
+int MainWindow::jobCount() const
+{
+    return static_cast<int>(std::min<qsizetype>(m_jobs.size(), m_queueTable->rowCount()));
+}
 
-    m_jobs[row] = buildJobFromUi(sourcePath);
+bool MainWindow::isPending(int row) const
+{
+    return rowStatus(row) == JobStatus::Pending;
+}
+
+bool MainWindow::isLocalOnly(int row) const
+{
+    return m_localOnlyJobs.contains(m_jobs.at(row).id);
+}
+
+bool MainWindow::takeJob(int row)
+{
+    const QString sourcePath = m_queueTable->item(row, 0) ? m_queueTable->item(row, 0)->data(Qt::UserRole).toString() : QString();
+    if (sourcePath.isEmpty()) {
+        setRowStatus(row, JobStatus::Failed, tr("Missing source"));
+        appendLog(tr("[warn] Job in row %1 has no source path; skipping").arg(row + 1));
+        return false;
+    }
+
+    m_jobs[row] = jobForRow(row);
+    attachSubtitleFonts(m_jobs[row]);
     if (m_mainControls.autoSubtitlePath) {
         m_mainControls.autoSubtitlePath->setText(m_jobs[row].subtitlePath);
     }
     updateQueueRowDisplay(row);
+    return true;
+}
 
+bool MainWindow::localEncoderIdle() const
+{
+    return m_encoder.state() == Encoder::State::Idle;
+}
+
+void MainWindow::startLocal(int row)
+{
+    const QString sourcePath = m_jobs.at(row).videoPath;
     appendLog(tr("Starting encode: %1").arg(sourcePath));
-    if (auto *statusItem = m_queueTable->item(row, 1)) {
-        statusItem->setText(tr("Indexing"));
+    const qint64 predictedMs = m_durationModel.predictWallMs(m_jobs.at(row));
+    if (predictedMs >= 0) {
+        appendLog(tr("Predicted encode time: %1").arg(formatTimecode(predictedMs)));
     }
+    setRowStatus(row, JobStatus::Running, tr("Indexing"));
     m_activeRow = row;
+    m_jobUiCpuStartMs = currentThreadCpuMs();
+    m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("job_started")},
+                                  {QStringLiteral("job"), static_cast<qint64>(m_jobs.at(row).id)}});
+    // The encoder finishes whatever preparation is still outstanding itself.
+    m_pipeline.cancel(m_jobs.at(row).id);
     m_encoder.startEncoding(m_jobs.at(row));
+}
+
+int MainWindow::freeRemoteSlots() const
+{
+    return m_workerPool.freeSlots();
+}
+
+bool MainWindow::startRemote(int row)
+{
+    const EncodeJob &job = m_jobs.at(row);
+    if (!m_workerPool.dispatch(job)) {
+        return false;
+    }
+    const QString worker = m_workerPool.workerNameForJob(job.id);
+    appendLog(tr("Sent %1 to worker %2").arg(job.videoPath, worker));
+    setRowStatus(row, JobStatus::Running, tr("Queued on %1").arg(worker));
+    m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("job_started")},
+                                  {QStringLiteral("job"), static_cast<qint64>(job.id)},
+                                  {QStringLiteral("worker"), worker}});
+    return true;
+}
+
+int MainWindow::activeRemoteJobs() const
+{
+    return m_workerPool.activeJobCount();
+}
+
+void MainWindow::prepare(int row)
+{
+    m_pipeline.prepare(jobForRow(row));
+}
+
+void MainWindow::runPostEncodeHooks(quint64 jobId)
+{
+    const int row = rowForJobId(jobId);
+    if (row < 0 || row >= m_jobs.size() || m_jobs.at(row).postEncodeHooks.isEmpty()) {
+        return;
+    }
+    // Runs in the finalize stage, overlapping the next encode rather than delaying it.
+    setRowStatus(row, JobStatus::Done, tr("Running hooks"));
+    m_hookRunner.run(m_jobs.at(row));
+}
+
+void MainWindow::onRemoteJobProgress(quint64 jobId, double progress, qint64 remainingMs, const QString &status)
+{
+    const int row = rowForJobId(jobId);
+    if (row < 0) {
+        return;
+    }
+    const QString worker = m_workerPool.workerNameForJob(jobId);
+    setRowStatus(row, JobStatus::Running, tr("%1% on %2").arg(QString::number(progress * 100.0, 'f', 1), worker));
+    if (auto *item = m_queueTable->item(row, 1)) {
+        item->setToolTip(status);
+    }
+    if (auto *item = m_queueTable->item(row, 2)) {
+        item->setText(remainingMs >= 0 ? tr("ETA %1").arg(formatTimecode(remainingMs)) : QStringLiteral("-"));
+    }
+}
+
+void MainWindow::onRemoteJobFinished(quint64 jobId, bool success, const QString &error)
+{
+    const int row = rowForJobId(jobId);
+    if (row >= 0) {
+        appendLog(success ? tr("Remote encode complete: %1").arg(m_jobs.at(row).resolvedOutputPath())
+                          : tr("Remote encode failed: %1").arg(error));
+        setRowStatus(row, success ? JobStatus::Done : JobStatus::Failed, success ? tr("Done") : tr("Failed"));
+        if (auto *item = m_queueTable->item(row, 2)) {
+            item->setText(QString());
+        }
+        if (success) {
+            runPostEncodeHooks(jobId);
+        }
+    }
+    m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("job_finished")},
+                                  {QStringLiteral("job"), static_cast<qint64>(jobId)},
+                                  {QStringLiteral("success"), success}});
+    updateQueueEstimate();
+    updateStartStopAvailability();
+    m_scheduler.continueQueue();
+}
+
+void MainWindow::onRemoteJobReturned(quint64 jobId, bool retryRemotely, const QString &reason)
+{
+    const int row = rowForJobId(jobId);
+    if (row < 0) {
+        return;
+    }
+    appendLog(tr("[warn] Job %1 returned to the queue: %2").arg(jobId).arg(reason));
+    if (!retryRemotely) {
+        m_localOnlyJobs.insert(jobId);
+    }
+    setRowStatus(row, JobStatus::Pending, tr("Pending"));
+    updateQueueRowDisplay(row);
+    updateQueueEstimate();
     updateStartStopAvailability();
+    m_scheduler.continueQueue();
 }
 
 void MainWindow::onStopClicked()
 {
-    if (m_encoder.state() == Encoder::State::Idle) {
+    if (m_encoder.state() == Encoder::State::Idle && m_workerPool.activeJobCount() == 0) {
         return;
     }
     appendLog(tr("Stopping encode"));
-    m_encoder.stopEncoding();
+    m_scheduler.setRunning(false);
+    m_pipeline.clear();
+    m_resolvedFonts.clear();
+    m_workerPool.cancelAll();
+    if (m_encoder.state() != Encoder::State::Idle) {
+        m_encoder.stopEncoding();
+    }
 }
 
 void MainWindow::onEncoderStateChanged(Encoder::State state)
 {
+    // Batched updates still belong to the previous state (and row).
+    flushUiUpdates();
     switch (state) {
     case Encoder::State::Idle:
         m_startButton->setState(StartButton::State::Idle);
         m_startButton->setProgress(0.0);
         m_startButton->setToolTip(tr("Start encoding"));
         statusBar()->showMessage(tr("Idle"));
-        if (m_activeRow >= 0 && m_activeRow < m_queueTable->rowCount()) {
-            if (auto *item = m_queueTable->item(m_activeRow, 1)) {
-                item->setText(tr("Pending"));
-            }
-        }
         break;
     case Encoder::State::Indexing:
         m_startButton->setState(StartButton::State::Indexing);
@@ -769,6 +2481,15 @@ void MainWindow::onEncoderStateChanged(Encoder::State state)
             }
         }
         break;
+    case Encoder::State::Paused:
+        statusBar()->showMessage(tr("Paused"));
+        m_soundEffects.play(SoundEffects::Sound::Paused);
+        if (m_activeRow >= 0 && m_activeRow < m_queueTable->rowCount()) {
+            if (auto *item = m_queueTable->item(m_activeRow, 1)) {
+                item->setText(tr("Paused"));
+            }
+        }
+        break;
     case Encoder::State::Stopping:
         statusBar()->showMessage(tr("Stopping"));
         if (m_activeRow >= 0 && m_activeRow < m_queueTable->rowCount()) {
@@ -782,15 +2503,57 @@ void MainWindow::onEncoderStateChanged(Encoder::State state)
 }
 
 void MainWindow::onEncoderProgressChanged(double progress)
+{
+    if (m_lowOverheadUi) {
+        m_progressPending = true;
+        scheduleUiFlush();
+        return;
+    }
+    applyProgress(progress);
+}
+
+void MainWindow::applyProgress(double progress)
 {
     if (m_startButton) {
         m_startButton->setProgress(progress);
         m_startButton->setToolTip(tr("Encoding %1%").arg(QString::number(progress * 100.0, 'f', 1)));
     }
+    publishProgressSnapshot();
+}
+
+void MainWindow::onEncoderEtaChanged(qint64 remainingMs)
+{
+    m_activeEtaMs = remainingMs;
+    if (m_lowOverheadUi) {
+        m_etaPending = true;
+        scheduleUiFlush();
+        return;
+    }
+    applyEta(remainingMs);
+}
+
+void MainWindow::applyEta(qint64 remainingMs)
+{
+    if (m_activeRow >= 0 && m_activeRow < m_queueTable->rowCount()) {
+        auto *item = m_queueTable->item(m_activeRow, 2);
+        if (!item) {
+            item = new QTableWidgetItem;
+            m_queueTable->setItem(m_activeRow, 2, item);
+        }
+        item->setText(remainingMs >= 0 ? tr("ETA %1").arg(formatTimecode(remainingMs)) : QStringLiteral("-"));
+    }
+    updateQueueEstimate();
+    publishProgressSnapshot();
 }
 
 void MainWindow::onEncoderStatusChanged(const QString &text)
 {
+    if (m_lowOverheadUi) {
+        m_pendingStatusText = text;
+        m_statusPending = true;
+        scheduleUiFlush();
+        return;
+    }
     statusBar()->showMessage(text);
 }
 
@@ -799,14 +2562,96 @@ void MainWindow::onEncoderMessageReceived(const QString &message)
     appendLog(message);
 }
 
+void MainWindow::onDurationModelTrained(const DurationModel &model)
+{
+    m_durationModel = model;
+    // Jobs that finished while the history loaded; the file read may have missed them.
+    for (const JobTelemetry &record : std::as_const(m_untrainedTelemetry)) {
+        m_durationModel.addSample(record);
+    }
+    m_untrainedTelemetry.clear();
+    m_durationModelTrained = true;
+    appendLog(tr("Startup: duration model trained on %n encode(s) after %1 ms", nullptr, m_durationModel.sampleCount())
+                  .arg(m_startupClock.elapsed()));
+    for (int row = 0; row < m_jobs.size(); ++row) {
+        updateQueueRowDisplay(row);
+    }
+    updateQueueEstimate();
+}
+
+void MainWindow::onEncoderTelemetry(const JobTelemetry &telemetry)
+{
+    if (!m_telemetryStore.append(telemetry)) {
+        appendLog(tr("[warn] Unable to write telemetry to %1").arg(QDir::toNativeSeparators(m_telemetryStore.path())));
+    }
+    appendLog(tr("Job stats: %1 wall, %2 fps avg, %3 fps p5, %4 MiB, peak RSS %5 MiB")
+                  .arg(formatTimecode(telemetry.wallTimeMs),
+                       QString::number(telemetry.averageFps, 'f', 1),
+                       QString::number(telemetry.p5Fps, 'f', 1),
+                       QString::number(telemetry.outputBytes / (1024.0 * 1024.0), 'f', 1),
+                       QString::number(telemetry.peakRssKb / 1024.0, 'f', 1)));
+    if (m_jobUiCpuStartMs >= 0 && telemetry.wallTimeMs > 0) {
+        const qint64 uiCpuMs = currentThreadCpuMs() - m_jobUiCpuStartMs;
+        appendLog(tr("Interface thread: %1 s CPU during the job (%2% of one core)")
+                      .arg(QString::number(uiCpuMs / 1000.0, 'f', 2), QString::number(100.0 * uiCpuMs / telemetry.wallTimeMs, 'f', 2)));
+    }
+    if (m_durationModelTrained) {
+        m_durationModel.addSample(telemetry);
+    } else {
+        m_untrainedTelemetry.append(telemetry);
+    }
+    for (int row = 0; row < m_jobs.size(); ++row) {
+        updateQueueRowDisplay(row);
+    }
+    refreshStatsTable();
+}
+
+void MainWindow::onExportStats()
+{
+    const QString target = QFileDialog::getSaveFileName(this,
+                                                        tr("Export stats"),
+                                                        QStringLiteral("niseyuki-stats.csv"),
+                                                        tr("CSV files (*.csv);;All files (*.*)"));
+    if (target.isEmpty()) {
+        return;
+    }
+    QString error;
+    if (!m_telemetryStore.exportCsv(target, &error)) {
+        QMessageBox::warning(this, tr("Export stats"), tr("Unable to write %1: %2").arg(target, error));
+        return;
+    }
+    appendLog(tr("Exported stats to %1").arg(QDir::toNativeSeparators(target)));
+}
+
 void MainWindow::onEncoderFinished(bool success)
 {
+    flushUiUpdates();
     appendLog(success ? tr("Encode complete") : tr("Encode failed"));
+    // A stop from the user clears the running flag first and needs no failure cue.
+    if (success || m_scheduler.isRunning()) {
+        m_soundEffects.play(success ? SoundEffects::Sound::Done : SoundEffects::Sound::Failed);
+    }
+    if (m_activeRow >= 0 && m_activeRow < m_jobs.size()) {
+        m_controlServer.publishEvent({{QStringLiteral("event"), QStringLiteral("job_finished")},
+                                      {QStringLiteral("job"), static_cast<qint64>(m_jobs.at(m_activeRow).id)},
+                                      {QStringLiteral("success"), success}});
+    }
     if (m_activeRow >= 0 && m_activeRow < m_queueTable->rowCount()) {
-        if (auto *item = m_queueTable->item(m_activeRow, 1)) {
-            item->setText(success ? tr("Done") : tr("Failed"));
-        }
+        setRowStatus(m_activeRow, success ? JobStatus::Done : JobStatus::Failed, success ? tr("Done") : tr("Failed"));
+    }
+    const int finishedRow = m_activeRow;
+    if (success && finishedRow >= 0 && finishedRow < m_jobs.size()) {
+        // Runs alongside the next encode.
+        m_pipeline.verify(m_jobs.at(finishedRow));
     }
     m_activeRow = -1;
+    m_activeEtaMs = -1;
+    if (finishedRow >= 0 && finishedRow < m_queueTable->rowCount()) {
+        if (auto *item = m_queueTable->item(finishedRow, 2)) {
+            item->setText(QString());
+        }
+    }
+    updateQueueEstimate();
     updateStartStopAvailability();
+    m_scheduler.continueQueue();
 }
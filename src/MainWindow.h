@@ -1,14 +1,42 @@
 #pragma once
 
+#include "ControlServer.h"
+#include "DurationModel.h"
 #include "Encoder.h"
+#include "FontIndex.h"
+#include "HookRunner.h"
+#include "JobPipeline.h"
+#include "MediaProbe.h"
+#include "PreviewRenderer.h"
+#include "ProfileStore.h"
+#include "QueuePreflight.h"
+#include "QueueScheduler.h"
+#include "SampleEncoder.h"
+#include "SoundEffects.h"
+#include "TelemetryStore.h"
+#include "WatchFolderService.h"
+#include "WorkerPool.h"
+#include "widgets/PreviewView.h"
 #include "widgets/StartButton.h"
 
+#include <QContiguousCache>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QJsonObject>
 #include <QMainWindow>
 #include <QPointer>
+#include <QSet>
+#include <QStringList>
+#include <QTimer>
 #include <QVector>
 
+#include <functional>
+#include <utility>
+
+class QAction;
 class QCheckBox;
 class QComboBox;
+class QDoubleSpinBox;
 class QGroupBox;
 class QLabel;
 class QLineEdit;
@@ -19,15 +47,24 @@ class QTableWidget;
 class QTabWidget;
 class QTextEdit;
 class QToolBar;
-class QVideoWidget;
 
-class MainWindow : public QMainWindow
+class MainWindow : public QMainWindow, private QueueScheduler::Host
 {
     Q_OBJECT
 public:
     explicit MainWindow(QWidget *parent = nullptr);
     ~MainWindow() override = default;
 
+    // Background ingests (watch folders, the control API) leave the Main tab as it is.
+    enum class EnqueueOrigin {
+        Interactive,
+        Background
+    };
+    int enqueueFile(const QString &file, const QJsonObject &overrides = QJsonObject(), EnqueueOrigin origin = EnqueueOrigin::Interactive);
+
+protected:
+    void changeEvent(QEvent *event) override;
+
 private slots:
     void onAddFile();
     void onRemoveSelected();
@@ -36,11 +73,35 @@ private slots:
 
     void onEncoderStateChanged(Encoder::State state);
     void onEncoderProgressChanged(double progress);
+    void onEncoderEtaChanged(qint64 remainingMs);
     void onEncoderStatusChanged(const QString &text);
     void onEncoderMessageReceived(const QString &message);
+    void onEncoderTelemetry(const JobTelemetry &telemetry);
+    void onDurationModelTrained(const DurationModel &model);
     void onEncoderFinished(bool success);
+    void onExportStats();
+    void onSourceProbed(const QString &videoPath, const MediaInfo &info);
+    void onWatchedFileReady(const QString &path, const QString &folder);
+    void onSettingsClicked();
+    void onSampleClicked();
+    void onSamplesFinished(bool success);
+    void onPreflightClicked();
+    void onPreflightJobChecked(const PreflightReport &report);
+    void onPreflightFinished(int checked, int failed, bool cancelled);
+    void onFontFinderClicked();
+    void onFontIndexRefreshed(int faces, int parsedFiles);
+    void onRemoteJobProgress(quint64 jobId, double progress, qint64 remainingMs, const QString &status);
+    void onRemoteJobFinished(quint64 jobId, bool success, const QString &error);
+    void onRemoteJobReturned(quint64 jobId, bool retryRemotely, const QString &reason);
 
 private:
+    enum class JobStatus {
+        Pending,
+        Running,
+        Done,
+        Failed
+    };
+
     struct MainTabControls {
         QLineEdit *autoSubtitlePath = nullptr;
         QTextEdit *additionalSubtitleList = nullptr;
@@ -52,13 +113,17 @@ private:
         QLineEdit *cutStart = nullptr;
         QLineEdit *cutEnd = nullptr;
         QCheckBox *telegramToggle = nullptr;
+        QSpinBox *sizeBudget = nullptr;
         QLineEdit *outputFile = nullptr;
+        QComboBox *profileCombo = nullptr;
     };
 
     struct VideoTabControls {
         QComboBox *encoderCombo = nullptr;
         QComboBox *presetCombo = nullptr;
         QSlider *qualitySlider = nullptr;
+        QComboBox *qualityModeCombo = nullptr;
+        QDoubleSpinBox *targetSpin = nullptr;
         QComboBox *resizeCombo = nullptr;
         QLineEdit *customSize = nullptr;
     };
@@ -85,30 +150,161 @@ private:
     QWidget *createCentral();
     QWidget *createQueuePanel();
     QWidget *createPreviewPanel();
+    // Builds the preview controls the first time a job is selected or samples are listed.
+    void ensurePreviewPanel();
+    // A tab whose content is created the first time it is shown.
+    QWidget *createLazyTab(std::function<QWidget *()> factory);
+    void ensureTabBuilt(int index);
+    void markStartupPhase(const QString &phase);
+    void showPreviewForRow(int row);
+    bool startPreflight();
+    // ASS/SSA files on the Main tab: the detected subtitle and any additional tracks.
+    QStringList fontFinderSubtitles() const;
+    // Scans and resolves on the thread pool, then shows the report.
+    void reportSubtitleFonts(const QStringList &subtitlePaths);
+    struct FontFinderReport {
+        QString summary;
+        QStringList details;
+        QStringList fontFiles;
+        bool incomplete = false; // fonts not installed or glyphs missing
+    };
+    static FontFinderReport buildFontFinderReport(const QStringList &subtitlePaths, const FontCatalog &catalog);
+    void showFontFinderReport(const FontFinderReport &report);
+    // Hands the font catalog to the pipeline and encoder while font attachment is enabled.
+    void updateFontAttachmentCatalog();
+    void attachSubtitleFonts(EncodeJob &job);
+    void showPreviewAt(qint64 timeUs);
     QWidget *createMainTab();
     QWidget *createVideoTab();
     QWidget *createAudioTab();
     QWidget *createLogoTab();
     QWidget *createLogTab();
+    QWidget *createStatsTab();
 
     void appendLog(const QString &line);
+    // Low-overhead mode: encoder-driven updates are batched and applied once per display frame.
+    void scheduleUiFlush();
+    void flushUiUpdates();
+    void applyProgress(double progress);
+    void applyEta(qint64 remainingMs);
+    void updateUiCpuLabel();
+    void updateUiCpuTimer();
     void updateStartStopAvailability();
+    // Video/Audio/Logo tab settings, rebuilt only after one of their controls changed.
+    EncodeProfile tabProfile() const;
+    void applyNamedProfile(EncodeJob &job, const QString &name) const;
+    void reloadProfileCombo(const QString &selected);
+    // Shows a saved profile in the Video/Audio/Logo tabs.
+    void loadProfileIntoTabs(const EncodeProfile &profile);
+    void watchProfileControls();
     EncodeJob buildJobFromUi(const QString &videoPath) const;
     QString detectSubtitleFor(const QString &videoPath) const;
     void updateQueueRowDisplay(int row);
+    void refreshStatsTable();
+    void updateQueueEstimate();
+    EncodeJob jobForRow(int row) const;
+    void runPostEncodeHooks(quint64 jobId);
+    // QueueScheduler::Host, over the rows of the queue table.
+    int jobCount() const override;
+    bool isPending(int row) const override;
+    bool isLocalOnly(int row) const override;
+    bool takeJob(int row) override;
+    bool localEncoderIdle() const override;
+    void startLocal(int row) override;
+    int freeRemoteSlots() const override;
+    bool startRemote(int row) override;
+    int activeRemoteJobs() const override;
+    void prepare(int row) override;
+    JobStatus rowStatus(int row) const;
+    void setRowStatus(int row, JobStatus status, const QString &text);
+    void applySettings();
+    int rowForJobId(quint64 id) const;
+    QJsonObject handleControlRequest(const QJsonObject &request);
+    void publishProgressSnapshot();
+    void probeNextQueuedSource();
+    void onCapabilitiesProbed(const FfmpegCapabilities &capabilities);
 
     Encoder m_encoder;
     StartButton *m_startButton = nullptr;
     QPushButton *m_stopButton = nullptr;
     QComboBox *m_priorityCombo = nullptr;
     QTabWidget *m_tabWidget = nullptr;
+    QHash<QWidget *, std::function<QWidget *()>> m_lazyTabs;
+    QGroupBox *m_previewPanel = nullptr;
+    QLabel *m_previewPlaceholder = nullptr;
     QTableWidget *m_queueTable = nullptr;
     QTextEdit *m_logView = nullptr;
+    QTableWidget *m_statsTable = nullptr;
     QLabel *m_statusLabel = nullptr;
+    QLabel *m_queueEstimateLabel = nullptr;
+    PreviewView *m_previewView = nullptr;
+    QLabel *m_previewTimeLabel = nullptr;
+    QPushButton *m_previewPrevButton = nullptr;
+    QPushButton *m_previewNextButton = nullptr;
+    QPushButton *m_previewGotoButton = nullptr;
+    QComboBox *m_previewVariantCombo = nullptr;
+    QAction *m_sampleAction = nullptr;
+    QAction *m_preflightAction = nullptr;
+    PreviewRenderer m_previewRenderer;
+    SampleEncoder m_sampleEncoder;
+    QueuePreflight m_preflight;
+    // Jobs held back by preflight; a later clean preflight returns them to Pending.
+    QSet<quint64> m_preflightFailedJobs;
+    // Canonical source paths of every queued job, for the watch-folder duplicate check.
+    QSet<QString> m_queuedSources;
+    FontIndex m_fontIndex;
+    // Fonts the pipeline resolved ahead of each job, with the subtitle they were resolved for.
+    QHash<quint64, std::pair<QString, QStringList>> m_resolvedFonts;
+    ProfileStore m_profileStore;
+    bool m_fontFinderPending = false;
+    bool m_fontFinderRunning = false;
+    QString m_previewSource;
+    qint64 m_previewTimeUs = 0;
     MainTabControls m_mainControls;
     VideoTabControls m_videoControls;
     AudioTabControls m_audioControls;
     LogoTabControls m_logoControls;
+    TelemetryStore m_telemetryStore;
+    DurationModel m_durationModel;
+    bool m_durationModelTrained = false;
+    QVector<JobTelemetry> m_untrainedTelemetry;
+    MediaProbe m_mediaProbe;
+    CapabilityProbe m_capabilityProbe;
+    JobPipeline m_pipeline;
+    HookRunner m_hookRunner;
+    QStringList m_postEncodeHooks;
+    QStringList m_probeQueue;
+    WatchFolderService m_watchService;
+    ControlServer m_controlServer;
+    WorkerPool m_workerPool;
+    QSet<quint64> m_localOnlyJobs;
+    QHash<quint64, QJsonObject> m_jobOverrides;
+    quint64 m_nextJobId = 1;
+    QString m_ffprobePath;
     QVector<EncodeJob> m_jobs;
+    mutable EncodeProfile m_tabProfile;
+    mutable bool m_tabProfileDirty = true;
+    bool m_loadingProfile = false; // set while loadProfileIntoTabs() writes the controls
     int m_activeRow = -1;
+    QueueScheduler m_scheduler{*this};
+    qint64 m_activeEtaMs = -1;
+
+    bool m_lowOverheadUi = true;
+    QTimer m_uiFlushTimer;
+    QContiguousCache<QString> m_pendingLogLines;
+    int m_droppedLogLines = 0;
+    QString m_pendingStatusText;
+    bool m_progressPending = false;
+    bool m_etaPending = false;
+    bool m_statusPending = false;
+    QLabel *m_uiCpuLabel = nullptr;
+    QTimer m_uiCpuTimer;
+    QElapsedTimer m_uiCpuClock;
+    qint64 m_uiCpuLastMs = -1;
+    qint64 m_jobUiCpuStartMs = -1;
+
+    SoundEffects m_soundEffects;
+    QElapsedTimer m_startupClock;
+    qint64 m_lastStartupMarkMs = 0;
+    QStringList m_startupPhases;
 };
@@ -0,0 +1,90 @@
+#include "MediaProbe.h"
+
+#include <QList>
+
+MediaProbe::MediaProbe(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, [this](int, QProcess::ExitStatus) {
+        emit finished(m_videoPath, parseOutput(m_process.readAllStandardOutput()));
+    });
+    connect(&m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            emit finished(m_videoPath, MediaInfo());
+        }
+    });
+}
+
+void MediaProbe::start(const QString &ffprobePath, const QString &videoPath)
+{
+    if (isRunning()) {
+        return;
+    }
+    m_videoPath = videoPath;
+    m_process.start(ffprobePath, arguments(videoPath));
+}
+
+MediaInfo MediaProbe::probeBlocking(const QString &ffprobePath, const QString &videoPath, int timeoutMs, QString *errorMessage)
+{
+    if (ffprobePath.isEmpty()) {
+        return MediaInfo();
+    }
+
+    QProcess probe;
+    probe.start(ffprobePath, arguments(videoPath));
+    if (!probe.waitForFinished(timeoutMs)) {
+        probe.kill();
+        probe.waitForFinished();
+        if (errorMessage) {
+            *errorMessage = tr("ffprobe timed out while reading duration.");
+        }
+        return MediaInfo();
+    }
+    return parseOutput(probe.readAllStandardOutput());
+}
+
+QStringList MediaProbe::arguments(const QString &videoPath)
+{
+    return {
+        QStringLiteral("-v"), QStringLiteral("error"),
+        QStringLiteral("-select_streams"), QStringLiteral("v:0"),
+        QStringLiteral("-show_entries"), QStringLiteral("stream=width,height,avg_frame_rate:format=duration"),
+        QStringLiteral("-of"), QStringLiteral("default=noprint_wrappers=1"),
+        videoPath
+    };
+}
+
+MediaInfo MediaProbe::parseOutput(const QByteArray &output)
+{
+    MediaInfo info;
+    const QList<QByteArray> lines = output.split('\n');
+    for (const QByteArray &rawLine : lines) {
+        const QByteArray line = rawLine.trimmed();
+        const int equalsIndex = line.indexOf('=');
+        if (equalsIndex <= 0) {
+            continue;
+        }
+        const QByteArray key = line.left(equalsIndex);
+        const QByteArray value = line.mid(equalsIndex + 1);
+        bool ok = false;
+        if (key == "duration") {
+            const double seconds = value.toDouble(&ok);
+            if (ok && seconds > 0.0) {
+                info.durationMs = static_cast<qint64>(seconds * 1000.0);
+            }
+        } else if (key == "width") {
+            info.width = value.toInt();
+        } else if (key == "height") {
+            info.height = value.toInt();
+        } else if (key == "avg_frame_rate") {
+            const QList<QByteArray> parts = value.split('/');
+            const double numerator = parts.value(0).toDouble();
+            const double denominator = parts.size() > 1 ? parts.at(1).toDouble() : 1.0;
+            if (denominator > 0.0) {
+                info.frameRate = numerator / denominator;
+            }
+        }
+    }
+    info.valid = info.durationMs > 0;
+    return info;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QStringList>
+
+struct MediaInfo {
+    bool valid = false;
+    qint64 durationMs = 0;
+    int width = 0;
+    int height = 0;
+    double frameRate = 0.0;
+};
+
+class MediaProbe : public QObject
+{
+    Q_OBJECT
+public:
+    explicit MediaProbe(QObject *parent = nullptr);
+
+    void start(const QString &ffprobePath, const QString &videoPath);
+    [[nodiscard]] bool isRunning() const { return m_process.state() != QProcess::NotRunning; }
+
+    static MediaInfo probeBlocking(const QString &ffprobePath, const QString &videoPath, int timeoutMs, QString *errorMessage = nullptr);
+    static QStringList arguments(const QString &videoPath);
+    static MediaInfo parseOutput(const QByteArray &output);
+
+signals:
+    void finished(const QString &videoPath, const MediaInfo &info);
+
+private:
+    QProcess m_process;
+    QString m_videoPath;
+};
@@ -0,0 +1,267 @@
+#include "OutputCache.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimeZone>
+
+#include <algorithm>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#elif defined(Q_OS_MACOS)
+#include <sys/clonefile.h>
+#endif
+
+namespace {
+constexpr qint64 kEdgeBytes = 1 << 20;
+constexpr qint64 kStrideBlockBytes = 64 * 1024;
+constexpr int kStrideBlocks = 16;
+constexpr int kMaxEntries = 2000;
+
+bool hashRange(QFile &file, QCryptographicHash &hash, qint64 offset, qint64 length)
+{
+    if (length <= 0) {
+        return true;
+    }
+    if (uchar *data = file.map(offset, length)) {
+        hash.addData(QByteArrayView(reinterpret_cast<const char *>(data), length));
+        file.unmap(data);
+        return true;
+    }
+    // Some filesystems (network shares, FUSE) refuse mmap; plain reads still work.
+    if (!file.seek(offset)) {
+        return false;
+    }
+    const QByteArray block = file.read(length);
+    hash.addData(block);
+    return block.size() == length;
+}
+
+// Shares the source's extents with a new target file on copy-on-write
+// filesystems (Btrfs, XFS, APFS). The two files stay independent: writing to
+// either never changes the other, unlike a hard link.
+bool cloneFile(const QString &source, const QString &target)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    const int in = ::open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    const int out = ::open(QFile::encodeName(target).constData(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+    const bool cloned = ::ioctl(out, FICLONE, in) == 0;
+    ::close(out);
+    ::close(in);
+    if (!cloned) {
+        QFile::remove(target);
+    }
+    return cloned;
+#elif defined(Q_OS_MACOS)
+    return ::clonefile(QFile::encodeName(source).constData(), QFile::encodeName(target).constData(), 0) == 0;
+#else
+    // CopyFileW behind QFile::copy already block-clones on ReFS and Dev Drives.
+    Q_UNUSED(source);
+    Q_UNUSED(target);
+    return false;
+#endif
+}
+
+qint64 modifiedMSecs(const QFileInfo &info)
+{
+    return info.lastModified(QTimeZone::UTC).toMSecsSinceEpoch();
+}
+} // namespace
+
+OutputCache::OutputCache(const QString &indexPath)
+    : m_indexPath(indexPath)
+{
+}
+
+QString OutputCache::defaultPath()
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return QDir(dir).filePath(QStringLiteral("output-cache.json"));
+}
+
+QByteArray OutputCache::sampledFileHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+
+    const qint64 size = file.size();
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    hash.addData(QByteArray::number(size));
+
+    if (size <= 2 * kEdgeBytes + kStrideBlocks * kStrideBlockBytes) {
+        return hashRange(file, hash, 0, size) ? hash.result() : QByteArray();
+    }
+
+    bool ok = hashRange(file, hash, 0, kEdgeBytes);
+    const qint64 middle = size - 2 * kEdgeBytes;
+    const qint64 stride = middle / kStrideBlocks;
+    for (int i = 0; ok && i < kStrideBlocks; ++i) {
+        ok = hashRange(file, hash, kEdgeBytes + i * stride, kStrideBlockBytes);
+    }
+    ok = ok && hashRange(file, hash, size - kEdgeBytes, kEdgeBytes);
+    return ok ? hash.result() : QByteArray();
+}
+
+QByteArray OutputCache::fileHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    QCryptographicHash hash(QCryptographicHash::Blake2b_256);
+    return hash.addData(&file) ? hash.result() : QByteArray();
+}
+
+bool OutputCache::materialize(const QString &cachedPath, const QString &targetPath, QString *errorMessage)
+{
+    const QFileInfo cached(cachedPath);
+    const QFileInfo target(targetPath);
+    if (cached.canonicalFilePath() == target.canonicalFilePath() && target.exists()) {
+        return true;
+    }
+
+    QDir().mkpath(target.absolutePath());
+    if (target.exists() && !QFile::remove(targetPath)) {
+        if (errorMessage) {
+            *errorMessage = QObject::tr("Unable to replace %1").arg(QDir::toNativeSeparators(targetPath));
+        }
+        return false;
+    }
+    if (cloneFile(cachedPath, targetPath)) {
+        return true;
+    }
+    QFile source(cachedPath);
+    if (!source.copy(targetPath)) {
+        if (errorMessage) {
+            *errorMessage = source.errorString();
+        }
+        return false;
+    }
+    return true;
+}
+
+QString OutputCache::lookup(const QByteArray &key)
+{
+    load();
+    auto it = m_entries.find(key);
+    if (it == m_entries.end()) {
+        return QString();
+    }
+
+    // Outputs are user files; anything moved, deleted or rewritten since is dropped.
+    it->copies.erase(std::remove_if(it->copies.begin(), it->copies.end(), [&](const Copy &copy) {
+        const QFileInfo info(copy.path);
+        return !info.isFile() || info.size() != it->size || modifiedMSecs(info) != copy.modified;
+    }), it->copies.end());
+    if (it->copies.isEmpty()) {
+        m_entries.erase(it);
+        save();
+        return QString();
+    }
+    it->lastUsed = QDateTime::currentMSecsSinceEpoch();
+    return it->copies.constFirst().path;
+}
+
+void OutputCache::insert(const QByteArray &key, const QString &outputPath)
+{
+    const QFileInfo info(outputPath);
+    if (key.isEmpty() || !info.isFile()) {
+        return;
+    }
+    load();
+
+    Entry &entry = m_entries[key];
+    if (entry.size != info.size()) {
+        entry.copies.clear();
+        entry.size = info.size();
+    }
+    const QString path = info.absoluteFilePath();
+    entry.copies.removeIf([&](const Copy &copy) { return copy.path == path; });
+    entry.copies.prepend({path, modifiedMSecs(info)});
+    entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+
+    if (m_entries.size() > kMaxEntries) {
+        auto oldest = std::min_element(m_entries.begin(), m_entries.end(), [](const Entry &a, const Entry &b) {
+            return a.lastUsed < b.lastUsed;
+        });
+        m_entries.erase(oldest);
+    }
+    save();
+}
+
+void OutputCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    QFile file(m_indexPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        Entry entry;
+        // Entries written before modification times were recorded have no
+        // "copies" and are dropped; they cannot be verified.
+        for (const QJsonValue &value : obj.value(QStringLiteral("copies")).toArray()) {
+            const QJsonObject copy = value.toObject();
+            entry.copies.append({copy.value(QStringLiteral("path")).toString(),
+                                 copy.value(QStringLiteral("modified")).toInteger()});
+        }
+        entry.size = obj.value(QStringLiteral("size")).toInteger();
+        entry.lastUsed = obj.value(QStringLiteral("last_used")).toInteger();
+        if (!entry.copies.isEmpty()) {
+            m_entries.insert(QByteArray::fromHex(it.key().toLatin1()), entry);
+        }
+    }
+}
+
+void OutputCache::save() const
+{
+    QJsonObject root;
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        QJsonArray copies;
+        for (const Copy &copy : it->copies) {
+            copies.append(QJsonObject{
+                {QStringLiteral("path"), copy.path},
+                {QStringLiteral("modified"), copy.modified}
+            });
+        }
+        root.insert(QString::fromLatin1(it.key().toHex()), QJsonObject{
+            {QStringLiteral("copies"), copies},
+            {QStringLiteral("size"), it->size},
+            {QStringLiteral("last_used"), it->lastUsed}
+        });
+    }
+
+    QDir().mkpath(QFileInfo(m_indexPath).absolutePath());
+    QSaveFile file(m_indexPath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+        file.commit();
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+// Content-addressed index of finished outputs. Keys combine sampled hashes of
+// the inputs, the encode plan, the subtitle and attached fonts, so re-queued
+// duplicates can reuse an earlier result instead of encoding again.
+class OutputCache
+{
+public:
+    explicit OutputCache(const QString &indexPath = defaultPath());
+
+    // Returns an existing output recorded for the key, or an empty string.
+    [[nodiscard]] QString lookup(const QByteArray &key);
+    void insert(const QByteArray &key, const QString &outputPath);
+
+    // Hashes size, head, tail and evenly strided blocks through a memory map;
+    // a few MiB are read no matter how large the source is.
+    static QByteArray sampledFileHash(const QString &path);
+    static QByteArray fileHash(const QString &path);
+    // Copies the cached file to the target as an independent file, cloning its
+    // extents (reflink/clonefile) where the filesystem supports it.
+    static bool materialize(const QString &cachedPath, const QString &targetPath, QString *errorMessage = nullptr);
+
+    static QString defaultPath();
+
+private:
+    struct Copy {
+        QString path;
+        qint64 modified = 0; // msecs since epoch
+    };
+    struct Entry {
+        QList<Copy> copies;
+        qint64 size = 0;
+        qint64 lastUsed = 0;
+    };
+
+    void load();
+    void save() const;
+
+    QString m_indexPath;
+    QHash<QByteArray, Entry> m_entries;
+    bool m_loaded = false;
+};
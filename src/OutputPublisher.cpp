@@ -0,0 +1,145 @@
+#include "OutputPublisher.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStorageInfo>
+#include <QThread>
+
+#include <memory>
+
+#if defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(Q_OS_UNIX)
+#include <cstdio>
+#endif
+
+namespace {
+// Filesystem metadata, muxer overshoot and other writers on the volume.
+constexpr qint64 kFreeSpaceMarginBytes = 256LL * 1024 * 1024;
+
+// Replaces target in one step; fails across volumes.
+bool replaceFile(const QString &source, const QString &target)
+{
+#if defined(Q_OS_WIN)
+    return MoveFileExW(reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(source).utf16()),
+                       reinterpret_cast<LPCWSTR>(QDir::toNativeSeparators(target).utf16()),
+                       MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#elif defined(Q_OS_UNIX)
+    return std::rename(QFile::encodeName(source).constData(), QFile::encodeName(target).constData()) == 0;
+#else
+    QFile::remove(target);
+    return QFile::rename(source, target);
+#endif
+}
+} // namespace
+
+OutputPublisher::OutputPublisher(QObject *parent)
+    : QObject(parent)
+{
+}
+
+OutputPublisher::~OutputPublisher()
+{
+    if (m_thread) {
+        // A half-finished copy only exists under its temporary name; let it complete.
+        m_thread->disconnect(this);
+        m_thread->wait();
+        delete m_thread;
+    }
+}
+
+QString OutputPublisher::stagingPath(const QString &finalPath, const QString &scratchDir)
+{
+    const QFileInfo target(finalPath);
+    const QString name = QStringLiteral("%1.partial.%2").arg(target.completeBaseName(), target.suffix());
+    if (scratchDir.isEmpty()) {
+        return target.absoluteDir().filePath(name);
+    }
+    // Outputs with the same name in different folders must not share a scratch file.
+    const QByteArray tag = QCryptographicHash::hash(target.absoluteFilePath().toUtf8(), QCryptographicHash::Sha1).toHex().left(8);
+    return QDir(scratchDir).filePath(QString::fromLatin1(tag) + QLatin1Char('-') + name);
+}
+
+QString OutputPublisher::existingAncestor(const QString &path)
+{
+    const QFileInfo info(path);
+    QString dir = info.isDir() ? info.absoluteFilePath() : info.absolutePath();
+    // Walked by name: QDir::cdUp() refuses to step into a parent that is missing too.
+    while (!QFileInfo(dir).isDir()) {
+        const QString parent = QFileInfo(dir).absolutePath();
+        if (parent == dir) {
+            break;
+        }
+        dir = parent;
+    }
+    return dir;
+}
+
+bool OutputPublisher::hasSpaceFor(const QString &path, qint64 bytes, QString *errorMessage)
+{
+    const QStorageInfo storage(existingAncestor(path));
+    if (!storage.isValid() || !storage.isReady()) {
+        // Unknown volumes (some network shares) are not blocked on a guess.
+        return true;
+    }
+    const qint64 needed = bytes + kFreeSpaceMarginBytes;
+    if (storage.bytesAvailable() >= needed) {
+        return true;
+    }
+    if (errorMessage) {
+        *errorMessage = tr("%1 has %2 MiB free, the output needs about %3 MiB")
+                            .arg(QDir::toNativeSeparators(storage.rootPath()))
+                            .arg(storage.bytesAvailable() / (1024 * 1024))
+                            .arg(needed / (1024 * 1024));
+    }
+    return false;
+}
+
+bool OutputPublisher::sameVolume(const QString &a, const QString &b)
+{
+    const QStorageInfo first(existingAncestor(a));
+    const QStorageInfo second(existingAncestor(b));
+    return first.isValid() && second.isValid() && first.rootPath() == second.rootPath() && first.device() == second.device();
+}
+
+void OutputPublisher::publish(const QString &stagedPath, const QString &finalPath)
+{
+    if (m_thread) {
+        emit finished(false, tr("Another output is still being published."));
+        return;
+    }
+    QDir().mkpath(QFileInfo(finalPath).absolutePath());
+    if (replaceFile(stagedPath, finalPath)) {
+        emit finished(true, QString());
+        return;
+    }
+
+    auto error = std::make_shared<QString>();
+    m_thread = QThread::create([stagedPath, finalPath, error]() {
+        const QString temporary = finalPath + QStringLiteral(".publishing");
+        QFile::remove(temporary);
+        QFile source(stagedPath);
+        if (!source.copy(temporary)) {
+            *error = source.errorString();
+            QFile::remove(temporary);
+            return;
+        }
+        if (!replaceFile(temporary, finalPath)) {
+            *error = tr("Unable to replace %1").arg(QDir::toNativeSeparators(finalPath));
+            QFile::remove(temporary);
+            return;
+        }
+        QFile::remove(stagedPath);
+    });
+    connect(m_thread, &QThread::finished, this, [this, error]() {
+        m_thread->deleteLater();
+        m_thread = nullptr;
+        emit finished(error->isEmpty(), *error);
+    });
+    m_thread->start(QThread::LowPriority);
+}
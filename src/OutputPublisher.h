@@ -0,0 +1,36 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+class QThread;
+
+// Moves a finished output from its staging location to the final path. The
+// publish is a single atomic rename when both sit on one volume; otherwise the
+// file is copied on a background thread next to the target and renamed into
+// place, so the final path never holds a partial file.
+class OutputPublisher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit OutputPublisher(QObject *parent = nullptr);
+    ~OutputPublisher() override;
+
+    void publish(const QString &stagedPath, const QString &finalPath);
+    [[nodiscard]] bool isRunning() const noexcept { return m_thread != nullptr; }
+
+    // In-progress path for an output: inside scratchDir when set, otherwise beside
+    // the target. The container suffix is kept so ffmpeg still picks the muxer from it.
+    static QString stagingPath(const QString &finalPath, const QString &scratchDir);
+    // Checks that the volume holding path has room for bytes plus a safety margin.
+    static bool hasSpaceFor(const QString &path, qint64 bytes, QString *errorMessage = nullptr);
+    static bool sameVolume(const QString &a, const QString &b);
+    // The path itself when it is a directory, otherwise its nearest existing parent directory.
+    static QString existingAncestor(const QString &path);
+
+signals:
+    void finished(bool success, const QString &errorMessage);
+
+private:
+    QThread *m_thread = nullptr;
+};
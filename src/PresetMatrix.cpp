@@ -0,0 +1,255 @@
+#include "PresetMatrix.h"
+
+#include "CrfSearch.h"
+#include "Encoder.h"
+#include "FfmpegLocator.h"
+#include "SampleEncoder.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QTimer>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// True when a is at least as good as b on size, quality and speed, and better on one.
+bool dominates(const PresetMatrixEntry &a, const PresetMatrixEntry &b)
+{
+    const bool noWorse = a.outputBytes <= b.outputBytes && a.score >= b.score && a.averageFps >= b.averageFps;
+    const bool better = a.outputBytes < b.outputBytes || a.score > b.score || a.averageFps > b.averageFps;
+    return noWorse && better;
+}
+} // namespace
+
+PresetMatrix::PresetMatrix(QObject *parent)
+    : QObject(parent)
+{
+}
+
+PresetMatrix::~PresetMatrix()
+{
+    cancel();
+}
+
+void PresetMatrix::setParallelism(int jobs)
+{
+    if (!m_running) {
+        m_parallelism = std::max(jobs, 1);
+    }
+}
+
+bool PresetMatrix::start(const EncodeJob &reference, const QStringList &encoders, const QStringList &presets,
+                         const QList<double> &qualities, const QList<int> &threadBudgets)
+{
+    if (m_running || !CrfSearch::isSupportedMetric(m_metric) || !QFileInfo::exists(reference.videoPath)) {
+        return false;
+    }
+    m_ffmpegPath = locateFfmpeg();
+    if (m_ffmpegPath.isEmpty()) {
+        return false;
+    }
+
+    m_entries.clear();
+    for (const QString &encoder : encoders) {
+        for (const QString &preset : presets) {
+            for (double quality : qualities) {
+                for (int threads : threadBudgets) {
+                    PresetMatrixEntry entry;
+                    entry.encoder = encoder;
+                    entry.preset = preset;
+                    entry.quality = quality;
+                    entry.threads = threads;
+                    m_entries.append(entry);
+                }
+            }
+        }
+    }
+    if (m_entries.isEmpty()) {
+        return false;
+    }
+
+    QDir().mkpath(SampleEncoder::sampleDirectory());
+    m_workDir = std::make_unique<QTemporaryDir>(QDir(SampleEncoder::sampleDirectory()).filePath(QStringLiteral("matrix-XXXXXX")));
+    if (!m_workDir->isValid()) {
+        m_workDir.reset();
+        return false;
+    }
+
+    m_reference = reference;
+    // The reference is encoded as a whole at fixed settings; searches and budgets would change what is measured.
+    m_reference.profile.editVideo().targetMetric.clear();
+    m_reference.maxOutputBytes = 0;
+    m_reference.cutSettings.enabled = false;
+    m_reference.globalOutputFolder.clear();
+    m_reference.postEncodeHooks.clear();
+
+    // Slots are created up front and never reallocated; the lambdas below refer to them by position.
+    m_slots = QList<Slot>(std::min<qsizetype>(m_parallelism, m_entries.size()));
+    for (int i = 0; i < m_slots.size(); ++i) {
+        auto *encoder = new Encoder(this);
+        m_slots[i].encoder = encoder;
+        encoder->setJobLogDirectory(JobLogWriter::auxiliaryLogDirectory());
+        connect(encoder, &Encoder::telemetryReady, this, [this, i](const JobTelemetry &telemetry) {
+            PresetMatrixEntry &entry = m_entries[m_slots.at(i).index];
+            entry.averageFps = telemetry.averageFps;
+            entry.wallTimeMs = telemetry.wallTimeMs;
+            entry.cpuMs = telemetry.cpuUserMs + telemetry.cpuSystemMs;
+        });
+        connect(encoder, &Encoder::finished, this, [this, i](bool success) { onEncodeFinished(i, success); });
+    }
+    m_next = 0;
+    m_done = 0;
+    m_running = true;
+    emit messageReceived(tr("Benchmarking %n combination(s)", nullptr, static_cast<int>(m_entries.size())));
+    QTimer::singleShot(0, this, &PresetMatrix::schedule);
+    return true;
+}
+
+void PresetMatrix::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    for (Slot &slot : m_slots) {
+        slot.encoder->disconnect(this);
+        slot.encoder->stopEncoding();
+        slot.encoder->deleteLater();
+        if (slot.metric) {
+            slot.metric->disconnect(this);
+            slot.metric->kill();
+            slot.metric->waitForFinished(1000);
+            delete slot.metric;
+        }
+    }
+    m_slots.clear();
+    m_workDir.reset();
+}
+
+void PresetMatrix::schedule()
+{
+    if (!m_running) {
+        return;
+    }
+    for (int i = 0; i < m_slots.size() && m_next < m_entries.size(); ++i) {
+        if (m_slots.at(i).index < 0) {
+            startEntry(i, m_next++);
+        }
+    }
+}
+
+QString PresetMatrix::outputPathFor(int index) const
+{
+    const PresetMatrixEntry &entry = m_entries.at(index);
+    return m_workDir->filePath(QStringLiteral("%1-%2-%3-crf%4-t%5.mkv")
+                                   .arg(index + 1, 3, 10, QLatin1Char('0'))
+                                   .arg(entry.encoder, entry.preset)
+                                   .arg(entry.quality)
+                                   .arg(entry.threads));
+}
+
+void PresetMatrix::startEntry(int slot, int index)
+{
+    const PresetMatrixEntry &entry = m_entries.at(index);
+    EncodeJob job = m_reference;
+    job.id = static_cast<quint64>(index + 1);
+    job.profile.editVideo().encoder = entry.encoder;
+    job.profile.editVideo().preset = entry.preset;
+    job.profile.editVideo().qualityValue = entry.quality;
+    job.profile.editVideo().threads = entry.threads;
+    job.outputFile = outputPathFor(index);
+    m_slots[slot].index = index;
+    emit messageReceived(tr("[%1/%2] %3 %4 CRF %5, %6")
+                             .arg(index + 1)
+                             .arg(m_entries.size())
+                             .arg(entry.encoder, entry.preset)
+                             .arg(entry.quality)
+                             .arg(entry.threads > 0 ? tr("%n thread(s)", nullptr, entry.threads) : tr("auto threads")));
+    m_slots.at(slot).encoder->startEncoding(job);
+}
+
+void PresetMatrix::onEncodeFinished(int slot, bool success)
+{
+    Slot &current = m_slots[slot];
+    PresetMatrixEntry &entry = m_entries[current.index];
+    const QString outputPath = outputPathFor(current.index);
+    entry.success = success;
+    entry.outputBytes = success ? QFileInfo(outputPath).size() : 0;
+    if (!success) {
+        QFile::remove(outputPath);
+        finishEntry(slot);
+        return;
+    }
+
+    // Same comparison as the CRF search: the reference goes through the encode's own filters.
+    QStringList referenceFilters = Encoder::videoFiltersForJob(m_reference);
+    referenceFilters << QStringLiteral("setpts=PTS-STARTPTS") << QStringLiteral("format=yuv420p");
+    const int threads = std::max(1, QThread::idealThreadCount() / static_cast<int>(m_slots.size()));
+    const QString metricFilter = m_metric == QLatin1String("vmaf")
+        ? QStringLiteral("libvmaf=n_threads=%1").arg(threads)
+        : m_metric;
+
+    current.metric = new QProcess(this);
+    current.metric->setProgram(m_ffmpegPath);
+    current.metric->setArguments({
+        QStringLiteral("-hide_banner"),
+        QStringLiteral("-nostats"),
+        QStringLiteral("-i"), QDir::toNativeSeparators(outputPath),
+        QStringLiteral("-i"), m_reference.videoPath,
+        QStringLiteral("-lavfi"), QStringLiteral("[0:v]setpts=PTS-STARTPTS,format=yuv420p[dist];[1:v]%1[ref];[dist][ref]%2")
+                                      .arg(referenceFilters.join(QLatin1Char(',')), metricFilter),
+        QStringLiteral("-f"), QStringLiteral("null"),
+        QStringLiteral("-")
+    });
+    current.metric->setProcessChannelMode(QProcess::MergedChannels);
+    connect(current.metric, &QProcess::finished, this, [this, slot]() { onMetricFinished(slot); });
+    connect(current.metric, &QProcess::errorOccurred, this, [this, slot](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            QTimer::singleShot(0, this, [this, slot]() { onMetricFinished(slot); });
+        }
+    });
+    current.metric->start();
+}
+
+void PresetMatrix::onMetricFinished(int slot)
+{
+    Slot &current = m_slots[slot];
+    if (!current.metric) {
+        return;
+    }
+    m_entries[current.index].score = CrfSearch::parseScore(m_metric, QString::fromUtf8(current.metric->readAll()));
+    current.metric->disconnect(this);
+    current.metric->deleteLater();
+    current.metric = nullptr;
+    QFile::remove(outputPathFor(current.index));
+    finishEntry(slot);
+}
+
+void PresetMatrix::finishEntry(int slot)
+{
+    const int index = std::exchange(m_slots[slot].index, -1);
+    emit entryFinished(index, m_entries.at(index));
+    if (++m_done < m_entries.size()) {
+        // Deferred so the slot's encoder is not restarted from inside its own finished().
+        QTimer::singleShot(0, this, &PresetMatrix::schedule);
+        return;
+    }
+    markParetoFrontier(m_entries);
+    cancel();
+    emit finished();
+}
+
+void PresetMatrix::markParetoFrontier(QList<PresetMatrixEntry> &entries)
+{
+    for (PresetMatrixEntry &candidate : entries) {
+        candidate.pareto = candidate.success && candidate.score >= 0.0
+            && std::none_of(entries.cbegin(), entries.cend(), [&candidate](const PresetMatrixEntry &other) {
+                   return other.success && other.score >= 0.0 && dominates(other, candidate);
+               });
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "EncodeJob.h"
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+#include <memory>
+
+class Encoder;
+class QProcess;
+class QTemporaryDir;
+
+struct PresetMatrixEntry {
+    QString encoder;
+    QString preset;
+    double quality = 0.0;
+    int threads = 0;
+
+    bool success = false;
+    double averageFps = 0.0;
+    qint64 wallTimeMs = 0;
+    qint64 cpuMs = 0;
+    qint64 outputBytes = 0;
+    double score = -1.0;
+    // Not beaten on size, quality and speed at once by any other entry.
+    bool pareto = false;
+};
+
+// Encodes one reference clip with every encoder × preset × CRF × thread-budget
+// combination, a few at a time, and scores each output against the clip with
+// SSIM, PSNR or VMAF. The finished matrix marks its Pareto frontier.
+class PresetMatrix : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PresetMatrix(QObject *parent = nullptr);
+    ~PresetMatrix() override;
+
+    // Combinations encoding (and then being scored) at the same time.
+    void setParallelism(int jobs);
+    void setMetric(const QString &metric) { m_metric = metric.toLower(); }
+
+    bool start(const EncodeJob &reference, const QStringList &encoders, const QStringList &presets,
+               const QList<double> &qualities, const QList<int> &threadBudgets);
+    void cancel();
+    [[nodiscard]] bool isRunning() const noexcept { return m_running; }
+    [[nodiscard]] const QList<PresetMatrixEntry> &entries() const noexcept { return m_entries; }
+
+    static void markParetoFrontier(QList<PresetMatrixEntry> &entries);
+
+signals:
+    void entryFinished(int index, const PresetMatrixEntry &entry);
+    void messageReceived(const QString &message);
+    void finished();
+
+private:
+    struct Slot {
+        Encoder *encoder = nullptr;
+        QProcess *metric = nullptr;
+        int index = -1;
+    };
+
+    void schedule();
+    void startEntry(int slot, int index);
+    void onEncodeFinished(int slot, bool success);
+    void onMetricFinished(int slot);
+    void finishEntry(int slot);
+    [[nodiscard]] QString outputPathFor(int index) const;
+
+    EncodeJob m_reference;
+    QString m_metric = QStringLiteral("ssim");
+    QString m_ffmpegPath;
+    QList<PresetMatrixEntry> m_entries;
+    QList<Slot> m_slots;
+    std::unique_ptr<QTemporaryDir> m_workDir;
+    int m_parallelism = 1;
+    int m_next = 0;
+    int m_done = 0;
+    bool m_running = false;
+};
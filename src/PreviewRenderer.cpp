@@ -0,0 +1,323 @@
+#include "PreviewRenderer.h"
+
+#include "Encoder.h"
+#include "FfmpegLocator.h"
+#include "MediaProbe.h"
+#include "TimeUtils.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QPointer>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Budget in KiB; a 1080p RGB frame is about 6 MiB, so roughly 40 frames.
+constexpr int kCacheBudgetKb = 256 * 1024;
+constexpr int kWorkerCount = 2;
+constexpr int kPrefetchAhead = 3;
+constexpr int kPrefetchBehind = 1;
+constexpr double kFallbackFrameRate = 24000.0 / 1001.0;
+} // namespace
+
+PreviewRenderer::PreviewRenderer(QObject *parent)
+    : QObject(parent)
+{
+    m_cache.setMaxCost(kCacheBudgetKb);
+    for (int i = 0; i < kWorkerCount; ++i) {
+        Worker worker;
+        worker.process = new QProcess(this);
+        worker.process->setProcessChannelMode(QProcess::SeparateChannels);
+        m_workers.append(worker);
+        connect(worker.process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this,
+                [this, i](int exitCode, QProcess::ExitStatus status) { onWorkerFinished(m_workers[i], exitCode, status); });
+        connect(worker.process, &QProcess::errorOccurred, this, [this, i](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) {
+                onWorkerFinished(m_workers[i], -1, QProcess::CrashExit);
+            }
+        });
+    }
+}
+
+PreviewRenderer::~PreviewRenderer()
+{
+    for (Worker &worker : m_workers) {
+        worker.process->disconnect(this);
+        if (worker.process->state() != QProcess::NotRunning) {
+            worker.process->kill();
+            worker.process->waitForFinished(500);
+        }
+    }
+}
+
+void PreviewRenderer::setJob(const EncodeJob &sourceJob)
+{
+    // The preview walks the whole source timeline (-copyts), so the cut window does not apply.
+    EncodeJob job = sourceJob;
+    job.cutSettings.enabled = false;
+    const QStringList filters = Encoder::videoFiltersForJob(job);
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QFileInfo(job.videoPath).absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(QFileInfo(job.videoPath).lastModified().toMSecsSinceEpoch()));
+    hash.addData(filters.join(QLatin1Char(',')).toUtf8());
+    if (!job.subtitlePath.isEmpty()) {
+        // Editing the .ass between previews must invalidate the cached frames.
+        hash.addData(QByteArray::number(QFileInfo(job.subtitlePath).lastModified().toMSecsSinceEpoch()));
+    }
+    const QByteArray signature = hash.result();
+
+    const bool sameSource = QFileInfo(job.videoPath) == QFileInfo(m_job.videoPath);
+    m_job = job;
+    m_queue.clear();
+    if (signature == m_jobSignature) {
+        return;
+    }
+    m_jobSignature = signature;
+    m_currentTimeUs = -1;
+
+    if (!sameSource) {
+        loadTimeline(job);
+    }
+}
+
+void PreviewRenderer::loadTimeline(const EncodeJob &job)
+{
+    // Fixed frame steps over the queued duration until the index (or a probe) arrives.
+    m_index = SourceIndex();
+    m_frameRate = 0.0;
+    m_durationUs = job.durationMs * 1000;
+    const quint64 generation = ++m_timelineGeneration;
+
+    // Loading hashes the source and probing waits on ffprobe; neither belongs on the UI thread.
+    QThreadPool::globalInstance()->start([self = QPointer<PreviewRenderer>(this), generation, videoPath = job.videoPath]() {
+        const SourceIndex index = SourceIndex::load(videoPath);
+        const MediaInfo info = index.isValid() ? MediaInfo() : MediaProbe::probeBlocking(locateFfprobe(), videoPath, 4000);
+        if (!self) {
+            return;
+        }
+        QMetaObject::invokeMethod(self, [self, generation, index, info]() {
+            if (!self || generation != self->m_timelineGeneration) {
+                return;
+            }
+            self->m_index = index;
+            if (index.isValid()) {
+                self->m_durationUs = index.durationUs();
+            } else {
+                self->m_frameRate = info.frameRate;
+                if (self->m_durationUs <= 0) {
+                    self->m_durationUs = info.durationMs * 1000;
+                }
+            }
+            emit self->timelineChanged();
+        }, Qt::QueuedConnection);
+    });
+}
+
+qint64 PreviewRenderer::durationUs() const
+{
+    return m_durationUs;
+}
+
+qint64 PreviewRenderer::snapToFrame(qint64 timeUs) const
+{
+    timeUs = std::max<qint64>(timeUs, 0);
+    if (m_durationUs > 0) {
+        timeUs = std::min(timeUs, m_durationUs);
+    }
+    if (m_index.isValid()) {
+        const int frame = std::max(m_index.frameAt(timeUs), 0);
+        return m_index.packet(frame).ptsUs;
+    }
+    const double rate = m_frameRate > 0.0 ? m_frameRate : kFallbackFrameRate;
+    const qint64 frame = static_cast<qint64>(std::floor(static_cast<double>(timeUs) * rate / 1000000.0));
+    return static_cast<qint64>(std::llround(frame * 1000000.0 / rate));
+}
+
+qint64 PreviewRenderer::nextFrameTime(qint64 timeUs) const
+{
+    if (m_index.isValid()) {
+        const int frame = std::min(m_index.frameAt(timeUs) + 1, m_index.frameCount() - 1);
+        return m_index.packet(std::max(frame, 0)).ptsUs;
+    }
+    const double rate = m_frameRate > 0.0 ? m_frameRate : kFallbackFrameRate;
+    return snapToFrame(timeUs + static_cast<qint64>(std::ceil(1000000.0 / rate)));
+}
+
+qint64 PreviewRenderer::previousFrameTime(qint64 timeUs) const
+{
+    if (m_index.isValid()) {
+        const int frame = std::max(m_index.frameAt(timeUs) - 1, 0);
+        return m_index.packet(frame).ptsUs;
+    }
+    const double rate = m_frameRate > 0.0 ? m_frameRate : kFallbackFrameRate;
+    return snapToFrame(std::max<qint64>(timeUs - static_cast<qint64>(std::floor(1000000.0 / rate)), 0));
+}
+
+void PreviewRenderer::setAlternateSource(const QString &path, qint64 offsetUs)
+{
+    m_alternatePath = path;
+    m_alternateOffsetUs = offsetUs;
+    // Samples are rewritten in place by the next run, so the key carries the file's identity too.
+    m_alternateKey.clear();
+    if (!path.isEmpty()) {
+        const QFileInfo info(path);
+        m_alternateKey = '|' + path.toUtf8() + '|' + QByteArray::number(info.size()) + '|'
+            + QByteArray::number(info.lastModified().toMSecsSinceEpoch());
+    }
+    m_queue.clear();
+}
+
+QByteArray PreviewRenderer::cacheKey(qint64 frameTimeUs) const
+{
+    return m_jobSignature + QByteArray::number(frameTimeUs) + m_alternateKey;
+}
+
+bool PreviewRenderer::isQueuedOrRunning(qint64 timeUs) const
+{
+    for (const Request &request : m_queue) {
+        if (request.timeUs == timeUs) {
+            return true;
+        }
+    }
+    for (const Worker &worker : m_workers) {
+        if (worker.process->state() != QProcess::NotRunning && worker.request.timeUs == timeUs
+            && worker.cacheKey == cacheKey(timeUs)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void PreviewRenderer::requestFrame(qint64 timeUs)
+{
+    if (m_job.videoPath.isEmpty()) {
+        return;
+    }
+    const qint64 frameTimeUs = snapToFrame(timeUs);
+    m_currentTimeUs = frameTimeUs;
+
+    // Prefetches for the previous position are no longer interesting.
+    m_queue.clear();
+    if (const QImage *cached = m_cache.object(cacheKey(frameTimeUs))) {
+        emit frameReady(frameTimeUs, *cached);
+    } else if (!isQueuedOrRunning(frameTimeUs)) {
+        m_queue.append({frameTimeUs, false});
+    }
+    schedulePrefetch(frameTimeUs);
+    pump();
+}
+
+void PreviewRenderer::schedulePrefetch(qint64 timeUs)
+{
+    qint64 ahead = timeUs;
+    for (int i = 0; i < kPrefetchAhead; ++i) {
+        const qint64 next = nextFrameTime(ahead);
+        if (next == ahead) {
+            break;
+        }
+        ahead = next;
+        if (!m_cache.contains(cacheKey(ahead)) && !isQueuedOrRunning(ahead)) {
+            m_queue.append({ahead, true});
+        }
+    }
+    qint64 behind = timeUs;
+    for (int i = 0; i < kPrefetchBehind; ++i) {
+        const qint64 previous = previousFrameTime(behind);
+        if (previous == behind) {
+            break;
+        }
+        behind = previous;
+        if (!m_cache.contains(cacheKey(behind)) && !isQueuedOrRunning(behind)) {
+            m_queue.append({behind, true});
+        }
+    }
+}
+
+void PreviewRenderer::pump()
+{
+    for (Worker &worker : m_workers) {
+        // A request can be dropped without starting a process, so keep feeding idle workers.
+        while (!m_queue.isEmpty() && worker.process->state() == QProcess::NotRunning) {
+            startWorker(worker, m_queue.takeFirst());
+        }
+    }
+}
+
+void PreviewRenderer::startWorker(Worker &worker, const Request &request)
+{
+    if (m_ffmpegPath.isEmpty()) {
+        m_ffmpegPath = locateFfmpeg();
+    }
+    if (m_ffmpegPath.isEmpty()) {
+        emit renderFailed(request.timeUs, tr("Unable to locate bundled ffmpeg executable."));
+        m_queue.clear();
+        return;
+    }
+
+    worker.request = request;
+    worker.cacheKey = cacheKey(request.timeUs);
+
+    QStringList args{QStringLiteral("-hide_banner"), QStringLiteral("-v"), QStringLiteral("error"), QStringLiteral("-nostdin")};
+    if (!m_alternatePath.isEmpty()) {
+        // Encoded files already carry the filters; only the timeline offset applies.
+        const qint64 localUs = request.timeUs - m_alternateOffsetUs;
+        if (localUs < 0) {
+            if (!request.prefetch) {
+                emit renderFailed(request.timeUs, tr("This position is outside the selected sample."));
+            }
+            return;
+        }
+        args << QStringLiteral("-ss") << formatSeconds(static_cast<double>(localUs) / 1000000.0)
+             << QStringLiteral("-i") << m_alternatePath
+             << QStringLiteral("-map") << QStringLiteral("0:v:0")
+             << QStringLiteral("-frames:v") << QStringLiteral("1");
+    } else {
+        // Input seeking is keyframe-fast and frame-accurate; -copyts keeps the source
+        // timeline so the subtitles filter draws the events for this exact moment.
+        args << QStringLiteral("-ss") << formatSeconds(static_cast<double>(request.timeUs) / 1000000.0)
+             << QStringLiteral("-copyts")
+             << QStringLiteral("-i") << m_job.videoPath
+             << QStringLiteral("-map") << QStringLiteral("0:v:0")
+             << QStringLiteral("-frames:v") << QStringLiteral("1");
+        const QStringList filters = Encoder::videoFiltersForJob(m_job);
+        if (!filters.isEmpty()) {
+            args << QStringLiteral("-vf") << filters.join(QLatin1Char(','));
+        }
+    }
+    args << QStringLiteral("-pix_fmt") << QStringLiteral("rgb24")
+         << QStringLiteral("-c:v") << QStringLiteral("ppm")
+         << QStringLiteral("-f") << QStringLiteral("image2pipe")
+         << QStringLiteral("pipe:1");
+    worker.process->start(m_ffmpegPath, args);
+}
+
+void PreviewRenderer::onWorkerFinished(Worker &worker, int exitCode, QProcess::ExitStatus status)
+{
+    const Request request = worker.request;
+    const QByteArray key = worker.cacheKey;
+    const QByteArray output = worker.process->readAllStandardOutput();
+    const QString errors = QString::fromUtf8(worker.process->readAllStandardError()).trimmed();
+
+    QImage image;
+    if (status == QProcess::NormalExit && exitCode == 0) {
+        image.loadFromData(output, "PPM");
+    }
+
+    if (image.isNull()) {
+        if (!request.prefetch && key == cacheKey(request.timeUs)) {
+            emit renderFailed(request.timeUs, errors.isEmpty() ? tr("ffmpeg produced no frame") : errors);
+        }
+    } else {
+        image = image.convertToFormat(QImage::Format_RGB888);
+        const int costKb = std::max(1, static_cast<int>(image.sizeInBytes() / 1024));
+        const bool current = key == cacheKey(m_currentTimeUs);
+        m_cache.insert(key, new QImage(image), costKb);
+        if (current) {
+            emit frameReady(request.timeUs, image);
+        }
+    }
+    pump();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "SourceIndex.h"
+
+#include <QByteArray>
+#include <QCache>
+#include <QImage>
+#include <QList>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+
+// Renders single frames of a job through the encode's own video filter chain
+// (ffmpeg child processes, so the UI never decodes). Finished frames are kept
+// in an LRU cache and neighbouring frames are prefetched, so stepping back and
+// forth through heavy typesetting does not re-render.
+class PreviewRenderer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PreviewRenderer(QObject *parent = nullptr);
+    ~PreviewRenderer() override;
+
+    // Switches to a job; the cache is kept, since entries are keyed by source and filter chain.
+    void setJob(const EncodeJob &job);
+    void requestFrame(qint64 timeUs);
+    // Renders from an already encoded file (e.g. a sample) instead of the filtered
+    // source. Times stay on the source timeline; offsetUs is where the file starts.
+    void setAlternateSource(const QString &path, qint64 offsetUs);
+    void clearAlternateSource() { setAlternateSource(QString(), 0); }
+    void clearCache() { m_cache.clear(); }
+
+    // Frame-accurate neighbours when an index exists, fixed frame steps otherwise.
+    [[nodiscard]] qint64 nextFrameTime(qint64 timeUs) const;
+    [[nodiscard]] qint64 previousFrameTime(qint64 timeUs) const;
+    [[nodiscard]] qint64 durationUs() const;
+
+signals:
+    void frameReady(qint64 timeUs, const QImage &image);
+    void renderFailed(qint64 timeUs, const QString &message);
+    // The source's frame index or probed frame rate arrived; frame times may snap differently.
+    void timelineChanged();
+
+private:
+    struct Request {
+        qint64 timeUs = 0;
+        bool prefetch = false;
+    };
+
+    struct Worker {
+        QProcess *process = nullptr;
+        Request request;
+        QByteArray cacheKey;
+    };
+
+    void loadTimeline(const EncodeJob &job);
+    qint64 snapToFrame(qint64 timeUs) const;
+    QByteArray cacheKey(qint64 frameTimeUs) const;
+    void schedulePrefetch(qint64 timeUs);
+    void pump();
+    void startWorker(Worker &worker, const Request &request);
+    void onWorkerFinished(Worker &worker, int exitCode, QProcess::ExitStatus status);
+    bool isQueuedOrRunning(qint64 timeUs) const;
+
+    EncodeJob m_job;
+    QByteArray m_jobSignature;
+    QString m_alternatePath;
+    qint64 m_alternateOffsetUs = 0;
+    QByteArray m_alternateKey;
+    SourceIndex m_index;
+    double m_frameRate = 0.0;
+    qint64 m_durationUs = 0;
+    quint64 m_timelineGeneration = 0;
+    QString m_ffmpegPath;
+    QCache<QByteArray, QImage> m_cache;
+    QList<Request> m_queue;
+    QList<Worker> m_workers;
+    qint64 m_currentTimeUs = -1;
+};
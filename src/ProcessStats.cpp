@@ -0,0 +1,179 @@
+#include "ProcessStats.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QList>
+
+#if defined(Q_OS_LINUX)
+#include <time.h>
+#include <unistd.h>
+#elif defined(Q_OS_WIN)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+namespace {
+#if defined(Q_OS_LINUX)
+QByteArray readProcFile(qint64 pid, const char *name)
+{
+    QFile file(QStringLiteral("/proc/%1/%2").arg(pid).arg(QLatin1String(name)));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QByteArray();
+    }
+    return file.readAll();
+}
+#endif
+
+#if defined(Q_OS_WIN)
+qint64 fileTimeToMs(const FILETIME &time)
+{
+    ULARGE_INTEGER value;
+    value.LowPart = time.dwLowDateTime;
+    value.HighPart = time.dwHighDateTime;
+    return static_cast<qint64>(value.QuadPart / 10000ULL);
+}
+#endif
+} // namespace
+
+ProcessSample sampleProcess(qint64 pid)
+{
+    ProcessSample sample;
+    if (pid <= 0) {
+        return sample;
+    }
+
+#if defined(Q_OS_LINUX)
+    const QByteArray stat = readProcFile(pid, "stat");
+    // The command name may contain spaces, so fields are counted from the closing parenthesis.
+    const int commEnd = stat.lastIndexOf(')');
+    if (commEnd < 0) {
+        return sample;
+    }
+    const QList<QByteArray> fields = stat.mid(commEnd + 2).split(' ');
+    // utime and stime are fields 14 and 15 of stat; the list starts at field 3.
+    if (fields.size() < 13) {
+        return sample;
+    }
+    const long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    if (ticksPerSecond <= 0) {
+        return sample;
+    }
+    sample.cpuUserMs = fields.at(11).toLongLong() * 1000 / ticksPerSecond;
+    sample.cpuSystemMs = fields.at(12).toLongLong() * 1000 / ticksPerSecond;
+
+    const QByteArray status = readProcFile(pid, "status");
+    for (const QByteArray &line : status.split('\n')) {
+        if (line.startsWith("VmHWM:")) {
+            sample.peakRssKb = line.mid(6).trimmed().split(' ').value(0).toLongLong();
+            break;
+        }
+    }
+    sample.valid = true;
+#elif defined(Q_OS_WIN)
+    HANDLE process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+    if (!process) {
+        return sample;
+    }
+    FILETIME creationTime;
+    FILETIME exitTime;
+    FILETIME kernelTime;
+    FILETIME userTime;
+    if (GetProcessTimes(process, &creationTime, &exitTime, &kernelTime, &userTime)) {
+        sample.cpuUserMs = fileTimeToMs(userTime);
+        sample.cpuSystemMs = fileTimeToMs(kernelTime);
+        sample.valid = true;
+    }
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(process, &counters, sizeof(counters))) {
+        sample.peakRssKb = static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+    }
+    CloseHandle(process);
+#endif
+
+    return sample;
+}
+
+ExitedProcessStats::~ExitedProcessStats()
+{
+    release();
+}
+
+void ExitedProcessStats::begin(qint64 pid)
+{
+    release();
+    m_pid = pid;
+    m_last = ProcessSample();
+#if defined(Q_OS_WIN)
+    if (pid > 0) {
+        m_handle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, static_cast<DWORD>(pid));
+    }
+#endif
+}
+
+ProcessSample ExitedProcessStats::sample()
+{
+    const ProcessSample current = sampleProcess(m_pid);
+    if (current.valid) {
+        m_last = current;
+    }
+    return current;
+}
+
+ProcessSample ExitedProcessStats::finish()
+{
+    ProcessSample sample = m_last;
+#if defined(Q_OS_WIN)
+    FILETIME creationTime;
+    FILETIME exitTime;
+    FILETIME kernelTime;
+    FILETIME userTime;
+    if (m_handle && GetProcessTimes(static_cast<HANDLE>(m_handle), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        sample.cpuUserMs = fileTimeToMs(userTime);
+        sample.cpuSystemMs = fileTimeToMs(kernelTime);
+        sample.valid = true;
+    }
+    PROCESS_MEMORY_COUNTERS counters;
+    if (m_handle && GetProcessMemoryInfo(static_cast<HANDLE>(m_handle), &counters, sizeof(counters))) {
+        sample.peakRssKb = static_cast<qint64>(counters.PeakWorkingSetSize / 1024);
+    }
+#endif
+    release();
+    m_pid = 0;
+    m_last = ProcessSample();
+    return sample;
+}
+
+void ExitedProcessStats::release()
+{
+#if defined(Q_OS_WIN)
+    if (m_handle) {
+        CloseHandle(static_cast<HANDLE>(m_handle));
+    }
+#endif
+    m_handle = nullptr;
+}
+
+qint64 currentThreadCpuMs()
+{
+#if defined(Q_OS_LINUX)
+    timespec time{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return -1;
+    }
+    return static_cast<qint64>(time.tv_sec) * 1000 + time.tv_nsec / 1000000;
+#elif defined(Q_OS_WIN)
+    FILETIME creationTime;
+    FILETIME exitTime;
+    FILETIME kernelTime;
+    FILETIME userTime;
+    if (!GetThreadTimes(GetCurrentThread(), &creationTime, &exitTime, &kernelTime, &userTime)) {
+        return -1;
+    }
+    return fileTimeToMs(userTime) + fileTimeToMs(kernelTime);
+#else
+    return -1;
+#endif
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QtGlobal>
+
+struct ProcessSample {
+    bool valid = false;
+    qint64 cpuUserMs = 0;
+    qint64 cpuSystemMs = 0;
+    qint64 peakRssKb = 0;
+};
+
+// Reads CPU times and peak resident set size of a running process.
+// Linux uses /proc/<pid>/stat and /proc/<pid>/status, Windows the process handle.
+ProcessSample sampleProcess(qint64 pid);
+
+// Tracks one child's CPU times through to its exit, when its /proc entry or pid
+// is already gone. Windows holds a handle to the process so its times stay
+// queryable after it exits; elsewhere the last sample taken while it ran (ffmpeg
+// reports progress=end right before exiting) stands in for the final reading.
+class ExitedProcessStats
+{
+public:
+    ExitedProcessStats() = default;
+    ~ExitedProcessStats();
+    ExitedProcessStats(const ExitedProcessStats &) = delete;
+    ExitedProcessStats &operator=(const ExitedProcessStats &) = delete;
+
+    // Call right after the child started.
+    void begin(qint64 pid);
+    // Samples the running child and remembers the reading.
+    ProcessSample sample();
+    // Call once the child has exited.
+    ProcessSample finish();
+
+private:
+    void release();
+
+    qint64 m_pid = 0;
+    void *m_handle = nullptr;
+    ProcessSample m_last;
+};
+
+// CPU time (user + system) consumed so far by the calling thread, or -1 where unsupported.
+qint64 currentThreadCpuMs();
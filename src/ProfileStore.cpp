@@ -0,0 +1,77 @@
+#include "ProfileStore.h"
+
+#include "JobSerialization.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+ProfileStore::ProfileStore(const QString &path)
+    : m_path(path)
+{
+    load();
+}
+
+QString ProfileStore::defaultPath()
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return QDir(dir).filePath(QStringLiteral("profiles.json"));
+}
+
+void ProfileStore::save(const QString &name, EncodeProfile profile)
+{
+    profile.setName(name);
+    m_profiles.insert(name, profile);
+    write();
+}
+
+void ProfileStore::remove(const QString &name)
+{
+    if (m_profiles.remove(name) > 0) {
+        write();
+    }
+}
+
+void ProfileStore::load()
+{
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+    const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+    for (auto it = root.constBegin(); it != root.constEnd(); ++it) {
+        const QJsonObject obj = it.value().toObject();
+        EncodeProfile profile = encodeProfileFromJson(obj);
+        profile.setName(it.key());
+        QStringList hooks;
+        for (const QJsonValue &hook : obj.value(QStringLiteral("hooks")).toArray()) {
+            hooks << hook.toString();
+        }
+        profile.setPostEncodeHooks(hooks);
+        m_profiles.insert(it.key(), profile);
+    }
+}
+
+void ProfileStore::write() const
+{
+    QJsonObject root;
+    for (auto it = m_profiles.constBegin(); it != m_profiles.constEnd(); ++it) {
+        QJsonObject obj = encodeProfileToJson(it.value());
+        obj.remove(QStringLiteral("profile"));
+        // Hooks are host commands; encodeProfileToJson() leaves them out because job JSON also goes to workers.
+        obj.insert(QStringLiteral("hooks"), QJsonArray::fromStringList(it.value().postEncodeHooks()));
+        root.insert(it.key(), obj);
+    }
+
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QSaveFile file(m_path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(root).toJson(QJsonDocument::Indented));
+        file.commit();
+    }
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "EncodeProfile.h"
+
+#include <QMap>
+#include <QString>
+#include <QStringList>
+
+// Named encode profiles, kept in profiles.json. Jobs hold the stored profile
+// itself (a shared pointer), so re-saving a profile reaches every job that
+// references it at that job's next start without touching the queue.
+class ProfileStore
+{
+public:
+    explicit ProfileStore(const QString &path = defaultPath());
+
+    [[nodiscard]] QStringList names() const { return m_profiles.keys(); }
+    [[nodiscard]] bool contains(const QString &name) const { return m_profiles.contains(name); }
+    // The saved profile, or a default (unnamed) one for unknown names.
+    [[nodiscard]] EncodeProfile profile(const QString &name) const { return m_profiles.value(name); }
+    void save(const QString &name, EncodeProfile profile);
+    void remove(const QString &name);
+
+    static QString defaultPath();
+
+private:
+    void load();
+    void write() const;
+
+    QString m_path;
+    QMap<QString, EncodeProfile> m_profiles;
+};
@@ -0,0 +1,437 @@
+#include "QueuePreflight.h"
+
+#include "AssFontScanner.h"
+#include "Encoder.h"
+#include "FfmpegLocator.h"
+#include "MediaProbe.h"
+#include "OutputPublisher.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QProcess>
+#include <QRegularExpression>
+#include <QStringConverter>
+#include <QTemporaryFile>
+#include <QThread>
+
+#include <algorithm>
+
+namespace {
+constexpr int kProbeTimeoutMs = 30000;
+constexpr int kDecodeTimeoutMs = 60000;
+// Decoded at each end of the source; truncated downloads usually break the tail.
+constexpr double kDecodeWindowSeconds = 2.0;
+
+struct DecodeResult {
+    QString error;   // the window did not decode: ffmpeg failed or produced no frames
+    QString warning; // it decoded, but ffmpeg complained along the way
+};
+
+// Decodes one window of the source. -v error still prints recoverable glitches
+// (a damaged packet, a missing reference frame), so only a failed run or zero
+// decoded frames counts as an error.
+DecodeResult decodeWindow(const QString &ffmpegPath, const QStringList &inputArgs, const std::atomic_bool &cancelled)
+{
+    DecodeResult result;
+    QProcess process;
+    process.setProgram(ffmpegPath);
+    process.setArguments(QStringList{QStringLiteral("-hide_banner"), QStringLiteral("-nostdin"), QStringLiteral("-nostats"), QStringLiteral("-v"),
+                                     QStringLiteral("error"), QStringLiteral("-progress"), QStringLiteral("pipe:1")}
+                         + inputArgs
+                         + QStringList{QStringLiteral("-t"), QString::number(kDecodeWindowSeconds), QStringLiteral("-map"), QStringLiteral("0:v:0"),
+                                       QStringLiteral("-map"), QStringLiteral("0:a?"), QStringLiteral("-f"), QStringLiteral("null"), QStringLiteral("-")});
+    process.start();
+    if (!process.waitForStarted(5000)) {
+        result.error = process.errorString();
+        return result;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (process.state() != QProcess::NotRunning && !process.waitForFinished(200)) {
+        if (cancelled || timer.elapsed() > kDecodeTimeoutMs) {
+            process.kill();
+            process.waitForFinished(1000);
+            if (!cancelled) {
+                result.error = QStringLiteral("timed out");
+            }
+            return result;
+        }
+    }
+    const QString firstComplaint = QString::fromUtf8(process.readAllStandardError()).trimmed().section(QLatin1Char('\n'), 0, 0).trimmed();
+    qint64 frames = 0;
+    static const QRegularExpression frameLine(QStringLiteral("^frame=(\\d+)\\s*$"), QRegularExpression::MultilineOption);
+    QRegularExpressionMatchIterator it = frameLine.globalMatch(QString::fromUtf8(process.readAllStandardOutput()));
+    while (it.hasNext()) {
+        frames = it.next().captured(1).toLongLong();
+    }
+
+    if (process.exitStatus() != QProcess::NormalExit || process.exitCode() != 0) {
+        result.error = firstComplaint.isEmpty() ? QStringLiteral("exit code %1").arg(process.exitCode()) : firstComplaint;
+    } else if (frames == 0) {
+        result.error = firstComplaint.isEmpty() ? QStringLiteral("no frames decoded") : firstComplaint;
+    } else {
+        result.warning = firstComplaint;
+    }
+    return result;
+}
+
+struct SubtitleSummary {
+    bool readable = false;
+    bool ass = false;
+    bool scriptInfo = false;
+    bool events = false;
+    int dialogues = 0;
+    int malformedDialogues = 0;
+    int srtCues = 0;
+    QSet<QString> undefinedStyles;
+};
+
+SubtitleSummary parseSubtitle(const QString &path)
+{
+    SubtitleSummary summary;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return summary;
+    }
+    summary.readable = true;
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    summary.ass = suffix == QLatin1String("ass") || suffix == QLatin1String("ssa");
+
+    // Honour a UTF-16/32 byte order mark; everything else is read as UTF-8.
+    const QByteArray data = file.readAll();
+    auto decode = QStringDecoder(QStringConverter::encodingForData(data).value_or(QStringConverter::Utf8));
+    const QString text = decode(data);
+    const QStringList lines = text.split(QRegularExpression(QStringLiteral("\\r?\\n")));
+    if (!summary.ass) {
+        summary.srtCues = static_cast<int>(std::count_if(lines.cbegin(), lines.cend(), [](const QString &line) {
+            return line.contains(QLatin1String("-->"));
+        }));
+        return summary;
+    }
+
+    QString section;
+    QStringList styleFormat;
+    QStringList eventFormat;
+    QSet<QString> styles;
+    QSet<QString> usedStyles;
+    for (const QString &raw : lines) {
+        const QString line = raw.trimmed();
+        if (line.startsWith(QLatin1Char('[')) && line.endsWith(QLatin1Char(']'))) {
+            section = line.toLower();
+            summary.scriptInfo = summary.scriptInfo || section == QLatin1String("[script info]");
+            summary.events = summary.events || section == QLatin1String("[events]");
+            continue;
+        }
+        const qsizetype colon = line.indexOf(QLatin1Char(':'));
+        if (colon < 0) {
+            continue;
+        }
+        const QString key = line.left(colon).trimmed();
+        const QString value = line.mid(colon + 1).trimmed();
+        if (section.endsWith(QLatin1String("styles]"))) {
+            if (key == QLatin1String("Format")) {
+                styleFormat = value.split(QLatin1Char(','));
+                for (QString &field : styleFormat) {
+                    field = field.trimmed();
+                }
+            } else if (key == QLatin1String("Style")) {
+                const QStringList fields = value.split(QLatin1Char(','));
+                const qsizetype nameIndex = styleFormat.indexOf(QStringLiteral("Name"));
+                if (nameIndex >= 0 && nameIndex < fields.size()) {
+                    styles.insert(fields.at(nameIndex).trimmed());
+                }
+            }
+        } else if (section == QLatin1String("[events]")) {
+            if (key == QLatin1String("Format")) {
+                eventFormat = value.split(QLatin1Char(','));
+                for (QString &field : eventFormat) {
+                    field = field.trimmed();
+                }
+            } else if (key == QLatin1String("Dialogue")) {
+                ++summary.dialogues;
+                // The last field (Text) may contain commas of its own.
+                const QStringList fields = value.split(QLatin1Char(','));
+                if (eventFormat.isEmpty() || fields.size() < eventFormat.size()) {
+                    ++summary.malformedDialogues;
+                    continue;
+                }
+                const qsizetype styleIndex = eventFormat.indexOf(QStringLiteral("Style"));
+                if (styleIndex >= 0) {
+                    usedStyles.insert(fields.at(styleIndex).trimmed().remove(QLatin1Char('*')));
+                }
+            }
+        }
+    }
+    // libass maps "Default" to the first style when it is not defined.
+    usedStyles.remove(QStringLiteral("Default"));
+    summary.undefinedStyles = usedStyles - styles;
+    return summary;
+}
+} // namespace
+
+QueuePreflight::QueuePreflight(QObject *parent)
+    : QObject(parent)
+{
+    m_pool.setMaxThreadCount(std::max(2, QThread::idealThreadCount() / 2));
+}
+
+QueuePreflight::~QueuePreflight()
+{
+    stop();
+    m_pool.waitForDone();
+}
+
+void QueuePreflight::setParallelism(int jobs)
+{
+    m_pool.setMaxThreadCount(std::max(jobs, 1));
+}
+
+bool QueuePreflight::start(const QList<EncodeJob> &jobs)
+{
+    if (isRunning() || jobs.isEmpty()) {
+        return false;
+    }
+    Context context;
+    context.ffmpegPath = locateFfmpeg();
+    context.ffprobePath = locateFfprobe();
+    context.scratchDirectory = m_scratchDirectory;
+    context.capabilities = m_capabilities;
+    context.fontCatalog = m_fontCatalog;
+    if (!context.fontCatalog) {
+        // Read on this thread; the font database belongs to the GUI side.
+        for (const QString &family : QFontDatabase::families()) {
+            context.installedFonts.insert(family.toLower());
+        }
+    }
+
+    m_cancelled = std::make_shared<std::atomic_bool>(false);
+    m_pending = static_cast<int>(jobs.size());
+    m_checked = 0;
+    m_failed = 0;
+    for (const EncodeJob &job : jobs) {
+        m_pool.start([this, job, context, cancelled = m_cancelled]() {
+            if (*cancelled) {
+                return;
+            }
+            const PreflightReport report = checkJob(job, context, *cancelled);
+            QMetaObject::invokeMethod(this, [this, report, cancelled]() {
+                if (!*cancelled) {
+                    onJobChecked(report);
+                }
+            }, Qt::QueuedConnection);
+        });
+    }
+    return true;
+}
+
+void QueuePreflight::cancel()
+{
+    const bool wasRunning = isRunning();
+    stop();
+    if (wasRunning) {
+        emit finished(m_checked, m_failed, true);
+    }
+}
+
+void QueuePreflight::stop()
+{
+    if (m_cancelled) {
+        *m_cancelled = true;
+    }
+    m_pool.clear();
+    m_pending = 0;
+}
+
+void QueuePreflight::onJobChecked(const PreflightReport &report)
+{
+    ++m_checked;
+    if (!report.ok()) {
+        ++m_failed;
+    }
+    emit jobChecked(report);
+    if (--m_pending == 0) {
+        emit finished(m_checked, m_failed, false);
+    }
+}
+
+PreflightReport QueuePreflight::checkJob(const EncodeJob &job, const Context &context, const std::atomic_bool &cancelled)
+{
+    PreflightReport report;
+    report.jobId = job.id;
+    const QFileInfo source(job.videoPath);
+    if (!source.isFile() || !source.isReadable()) {
+        report.errors << tr("Source is missing or unreadable");
+        return report;
+    }
+
+    EncodeJob probed = job;
+    checkSource(probed, context, cancelled, report);
+    if (cancelled) {
+        return report;
+    }
+    if (!job.subtitlePath.isEmpty()) {
+        checkSubtitle(job.subtitlePath, context, report);
+    }
+    checkOutput(probed, context, report);
+    checkCapabilities(job, context, report);
+    return report;
+}
+
+void QueuePreflight::checkSource(EncodeJob &job, const Context &context, const std::atomic_bool &cancelled, PreflightReport &report)
+{
+    if (context.ffprobePath.isEmpty()) {
+        report.warnings << tr("ffprobe not found; the source was not probed");
+    } else {
+        QString probeError;
+        const MediaInfo info = MediaProbe::probeBlocking(context.ffprobePath, job.videoPath, kProbeTimeoutMs, &probeError);
+        if (!info.valid) {
+            report.errors << tr("Probe failed: %1").arg(probeError.isEmpty() ? tr("no readable video stream") : probeError);
+            return;
+        }
+        if (info.durationMs <= 0) {
+            report.errors << tr("Source reports no duration (incomplete download?)");
+            return;
+        }
+        if (info.width <= 0 || info.height <= 0) {
+            report.errors << tr("Video stream has no frame size");
+            return;
+        }
+        job.durationMs = info.durationMs;
+        job.sourceHeight = info.height;
+        job.sourceFrameRate = info.frameRate;
+    }
+
+    if (context.ffmpegPath.isEmpty()) {
+        report.warnings << tr("ffmpeg not found; decoding was not tested");
+        return;
+    }
+    const DecodeResult head = decodeWindow(context.ffmpegPath, {QStringLiteral("-i"), job.videoPath}, cancelled);
+    if (!head.error.isEmpty()) {
+        report.errors << tr("Decoding the start failed: %1").arg(head.error);
+    } else if (!head.warning.isEmpty()) {
+        report.warnings << tr("Decoding the start reported: %1").arg(head.warning);
+    }
+    if (cancelled || job.durationMs <= kDecodeWindowSeconds * 1000.0) {
+        return;
+    }
+    const DecodeResult tail = decodeWindow(context.ffmpegPath,
+                                           {QStringLiteral("-sseof"), QString::number(-kDecodeWindowSeconds), QStringLiteral("-i"), job.videoPath},
+                                           cancelled);
+    if (!tail.error.isEmpty()) {
+        report.errors << tr("Decoding the end failed (truncated file?): %1").arg(tail.error);
+    } else if (!tail.warning.isEmpty()) {
+        report.warnings << tr("Decoding the end reported: %1").arg(tail.warning);
+    }
+}
+
+void QueuePreflight::checkSubtitle(const QString &path, const Context &context, PreflightReport &report)
+{
+    const QString name = QFileInfo(path).fileName();
+    const SubtitleSummary summary = parseSubtitle(path);
+    if (!summary.readable) {
+        report.errors << tr("Subtitle %1 is missing or unreadable").arg(name);
+        return;
+    }
+    if (!summary.ass) {
+        if (summary.srtCues == 0) {
+            report.errors << tr("Subtitle %1 has no cues").arg(name);
+        }
+        return;
+    }
+    if (!summary.scriptInfo || !summary.events) {
+        report.errors << tr("Subtitle %1 lacks a [Script Info] or [Events] section").arg(name);
+        return;
+    }
+    if (summary.dialogues == 0) {
+        report.warnings << tr("Subtitle %1 has no dialogue lines").arg(name);
+    }
+    if (summary.malformedDialogues > 0) {
+        report.errors << tr("Subtitle %1 has %n malformed dialogue line(s)", nullptr, summary.malformedDialogues).arg(name);
+    }
+    if (!summary.undefinedStyles.isEmpty()) {
+        QStringList styles = summary.undefinedStyles.values();
+        styles.sort();
+        report.warnings << tr("Subtitle %1 uses undefined styles: %2").arg(name, styles.join(QStringLiteral(", ")));
+    }
+    const QList<AssFontRequest> requests = AssFontScanner::scan(path);
+    QSet<QString> missing;
+    if (context.fontCatalog) {
+        for (const AssFontResolution &resolution : AssFontScanner::resolve(requests, *context.fontCatalog)) {
+            if (!resolution.found()) {
+                missing.insert(resolution.request.family);
+            } else if (!resolution.missingGlyphs.isEmpty()) {
+                // libass falls back to another font for these, usually one that looks nothing alike.
+                report.warnings << tr("Font %1 lacks %n glyph(s) used in %2: %3", nullptr, static_cast<int>(resolution.missingGlyphs.size()))
+                                       .arg(resolution.matchedFace, name, AssFontScanner::describeCharacters(resolution.missingGlyphs));
+            }
+        }
+    } else {
+        for (const AssFontRequest &request : requests) {
+            if (!context.installedFonts.contains(request.family.toLower())) {
+                missing.insert(request.family);
+            }
+        }
+    }
+    if (!missing.isEmpty()) {
+        QStringList missingFonts = missing.values();
+        missingFonts.sort();
+        // libass substitutes another font; fonts attached to the source still count.
+        report.warnings << tr("Fonts not installed: %1 (fine if the source has them attached)").arg(missingFonts.join(QStringLiteral(", ")));
+    }
+}
+
+void QueuePreflight::checkOutput(const EncodeJob &job, const Context &context, PreflightReport &report)
+{
+    const QString finalPath = job.resolvedOutputPath();
+    const QString stagingPath = OutputPublisher::stagingPath(finalPath, context.scratchDirectory);
+    QStringList folders{QFileInfo(finalPath).absolutePath()};
+    if (QFileInfo(stagingPath).absolutePath() != folders.constFirst()) {
+        folders << QFileInfo(stagingPath).absolutePath();
+    }
+    for (const QString &folder : std::as_const(folders)) {
+        // Folders the encode would create are probed at their nearest existing parent;
+        // a check must not leave directories behind.
+        const QString existing = OutputPublisher::existingAncestor(folder);
+        QTemporaryFile probe(QDir(existing).filePath(QStringLiteral(".niseyuki-preflight-XXXXXX")));
+        if (!QFileInfo(existing).isDir() || !probe.open()) {
+            report.errors << tr("Cannot write to %1").arg(QDir::toNativeSeparators(folder));
+            return;
+        }
+    }
+
+    const qint64 predictedBytes = Encoder::predictedOutputBytes(job);
+    QString spaceError;
+    bool enoughSpace = OutputPublisher::hasSpaceFor(stagingPath, predictedBytes, &spaceError);
+    if (enoughSpace && !OutputPublisher::sameVolume(stagingPath, finalPath)) {
+        enoughSpace = OutputPublisher::hasSpaceFor(finalPath, predictedBytes, &spaceError);
+    }
+    if (!enoughSpace) {
+        report.errors << tr("Not enough disk space: %1").arg(spaceError);
+    }
+}
+
+void QueuePreflight::checkCapabilities(const EncodeJob &job, const Context &context, PreflightReport &report)
+{
+    const FfmpegCapabilities &capabilities = context.capabilities;
+    if (!capabilities.valid) {
+        return;
+    }
+    // Mirrors Encoder::applyCapabilityFallbacks: a missing encoder falls back to x264 when it can.
+    const QString codec = Encoder::videoCodecForJob(job);
+    if (!capabilities.hasEncoder(codec)) {
+        if (capabilities.hasEncoder(QStringLiteral("libx264"))) {
+            report.warnings << tr("%1 is unavailable; the job will encode with x264").arg(codec);
+        } else {
+            report.errors << tr("%1 is unavailable in this ffmpeg").arg(codec);
+        }
+    }
+    if (job.profile.video().targetMetric == QLatin1String("vmaf") && !capabilities.hasFilter(QStringLiteral("libvmaf"))) {
+        report.warnings << tr("VMAF is unavailable; the job will use its fixed quality value");
+    }
+    if (!job.subtitlePath.isEmpty() && !capabilities.hasFilter(QStringLiteral("subtitles"))) {
+        report.errors << tr("This ffmpeg cannot burn in subtitles (no libass)");
+    }
+}
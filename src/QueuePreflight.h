@@ -0,0 +1,79 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "FfmpegCapabilities.h"
+#include "FontIndex.h"
+
+#include <QList>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QThreadPool>
+
+#include <atomic>
+#include <memory>
+#include <utility>
+
+struct PreflightReport {
+    quint64 jobId = 0;
+    QStringList errors;   // the job would fail; it should not be started
+    QStringList warnings; // the job runs, but not quite as configured
+
+    [[nodiscard]] bool ok() const noexcept { return errors.isEmpty(); }
+};
+
+// Checks every queued job before a long batch, several at a time on its own
+// thread pool: the source probes sanely and decodes at both ends, subtitle files
+// parse and their fonts are installed with every glyph they draw, the output
+// (and scratch) folder is writable with room for the predicted size, and ffmpeg
+// has the encoder and filters the job needs.
+class QueuePreflight : public QObject
+{
+    Q_OBJECT
+public:
+    explicit QueuePreflight(QObject *parent = nullptr);
+    ~QueuePreflight() override;
+
+    void setParallelism(int jobs);
+    void setScratchDirectory(const QString &directory) { m_scratchDirectory = directory; }
+    void setCapabilities(const FfmpegCapabilities &capabilities) { m_capabilities = capabilities; }
+    // With a catalog, fonts are resolved to files and checked for missing glyphs.
+    void setFontCatalog(std::shared_ptr<const FontCatalog> catalog) { m_fontCatalog = std::move(catalog); }
+
+    bool start(const QList<EncodeJob> &jobs);
+    // Stops checking; finished() reports the jobs checked so far as cancelled.
+    void cancel();
+    [[nodiscard]] bool isRunning() const noexcept { return m_pending > 0; }
+
+signals:
+    void jobChecked(const PreflightReport &report);
+    void finished(int checked, int failed, bool cancelled);
+
+private:
+    struct Context {
+        QString ffmpegPath;
+        QString ffprobePath;
+        QString scratchDirectory;
+        FfmpegCapabilities capabilities;
+        std::shared_ptr<const FontCatalog> fontCatalog;
+        QSet<QString> installedFonts; // lower-case family names, used without a catalog
+    };
+
+    static PreflightReport checkJob(const EncodeJob &job, const Context &context, const std::atomic_bool &cancelled);
+    static void checkSource(EncodeJob &job, const Context &context, const std::atomic_bool &cancelled, PreflightReport &report);
+    static void checkSubtitle(const QString &path, const Context &context, PreflightReport &report);
+    static void checkOutput(const EncodeJob &job, const Context &context, PreflightReport &report);
+    static void checkCapabilities(const EncodeJob &job, const Context &context, PreflightReport &report);
+    void onJobChecked(const PreflightReport &report);
+    void stop();
+
+    QThreadPool m_pool;
+    std::shared_ptr<std::atomic_bool> m_cancelled;
+    QString m_scratchDirectory;
+    FfmpegCapabilities m_capabilities;
+    std::shared_ptr<const FontCatalog> m_fontCatalog;
+    int m_pending = 0;
+    int m_checked = 0;
+    int m_failed = 0;
+};
@@ -0,0 +1,92 @@
+#include "QueueScheduler.h"
+
+namespace {
+// Pending jobs whose probe/index/asset stages run while the current job encodes.
+constexpr int kPrepareLookahead = 2;
+} // namespace
+
+QueueScheduler::QueueScheduler(Host &host, QObject *parent)
+    : QObject(parent)
+    , m_host(host)
+{
+}
+
+int QueueScheduler::takeNextPending(bool forRemote)
+{
+    for (int row = 0; row < m_host.jobCount(); ++row) {
+        if (!m_host.isPending(row)) {
+            continue;
+        }
+        if (forRemote && m_host.isLocalOnly(row)) {
+            continue;
+        }
+        if (m_host.takeJob(row)) {
+            return row;
+        }
+    }
+    return -1;
+}
+
+bool QueueScheduler::startNext()
+{
+    bool started = false;
+    if (m_host.localEncoderIdle()) {
+        const int row = takeNextPending(false);
+        if (row >= 0) {
+            m_host.startLocal(row);
+            started = true;
+        }
+    }
+    started = dispatchRemote() || started;
+    if (!m_host.localEncoderIdle()) {
+        prepareUpcoming();
+    }
+    emit scheduled();
+    return started;
+}
+
+bool QueueScheduler::dispatchRemote()
+{
+    bool dispatched = false;
+    while (m_host.freeRemoteSlots() > 0) {
+        const int row = takeNextPending(true);
+        if (row < 0 || !m_host.startRemote(row)) {
+            break;
+        }
+        dispatched = true;
+    }
+    if (dispatched) {
+        emit remoteJobsDispatched();
+    }
+    return dispatched;
+}
+
+void QueueScheduler::prepareUpcoming()
+{
+    int prepared = 0;
+    for (int row = 0; row < m_host.jobCount() && prepared < kPrepareLookahead; ++row) {
+        if (!m_host.isPending(row)) {
+            continue;
+        }
+        m_host.prepare(row);
+        ++prepared;
+    }
+}
+
+void QueueScheduler::continueQueue()
+{
+    if (!m_running) {
+        return;
+    }
+    // Queued so a synchronous start failure cannot recurse through the whole queue.
+    QMetaObject::invokeMethod(this, [this]() {
+        if (!m_running) {
+            return;
+        }
+        const bool started = startNext();
+        if (!started && m_host.localEncoderIdle() && m_host.activeRemoteJobs() == 0) {
+            m_running = false;
+            emit queueFinished();
+        }
+    }, Qt::QueuedConnection);
+}
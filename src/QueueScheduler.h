@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+
+// Decides which queued job runs next and where: the local encoder takes the
+// first pending row, free worker slots take the following ones (skipping jobs
+// that must stay local), and the next few pending jobs are prepared while an
+// encode runs. The queue itself stays with the owner, which answers through
+// Host; the scheduler only holds the running flag and the order of hand-offs,
+// so the GUI and the load test run the same policy.
+class QueueScheduler : public QObject
+{
+    Q_OBJECT
+public:
+    class Host
+    {
+    public:
+        virtual ~Host() = default;
+
+        [[nodiscard]] virtual int jobCount() const = 0;
+        [[nodiscard]] virtual bool isPending(int row) const = 0;
+        [[nodiscard]] virtual bool isLocalOnly(int row) const = 0;
+        // Readies a pending row to start; false when it cannot run (the host marks it failed).
+        virtual bool takeJob(int row) = 0;
+        [[nodiscard]] virtual bool localEncoderIdle() const = 0;
+        virtual void startLocal(int row) = 0;
+        [[nodiscard]] virtual int freeRemoteSlots() const = 0;
+        // False when no worker accepted the job; it stays pending.
+        virtual bool startRemote(int row) = 0;
+        [[nodiscard]] virtual int activeRemoteJobs() const = 0;
+        // Starts the background preparation of a job that runs soon.
+        virtual void prepare(int row) = 0;
+    };
+
+    explicit QueueScheduler(Host &host, QObject *parent = nullptr);
+
+    [[nodiscard]] bool isRunning() const noexcept { return m_running; }
+    void setRunning(bool running) { m_running = running; }
+    // Fills the local encoder and free worker slots; true when a job was started.
+    bool startNext();
+    bool dispatchRemote();
+    // After a job finished or returned: starts the next one from the event loop,
+    // or ends the run once nothing is pending or running.
+    void continueQueue();
+
+signals:
+    void scheduled();
+    void remoteJobsDispatched();
+    void queueFinished();
+
+private:
+    int takeNextPending(bool forRemote);
+    void prepareUpcoming();
+
+    Host &m_host;
+    bool m_running = false;
+};
@@ -0,0 +1,199 @@
+#include "SampleEncoder.h"
+
+#include "Encoder.h"
+#include "FfmpegLocator.h"
+#include "MediaProbe.h"
+#include "TimeUtils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+SampleEncoder::SampleEncoder(QObject *parent)
+    : QObject(parent)
+{
+    // Queued, so a probe that fails to start never finishes inside start().
+    connect(&m_probe, &MediaProbe::finished, this, &SampleEncoder::onProbeFinished, Qt::QueuedConnection);
+}
+
+SampleEncoder::~SampleEncoder()
+{
+    // Stop quietly: whoever listens to our signals is usually being destroyed too.
+    for (Encoder *encoder : std::as_const(m_encoders)) {
+        encoder->disconnect(this);
+    }
+    m_probing = false;
+    cancel();
+}
+
+QString SampleEncoder::sampleDirectory()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation)).filePath(QStringLiteral("niseyuki-samples"));
+}
+
+bool SampleEncoder::start(const EncodeJob &job, const QVector<double> &positions, qint64 sliceMs)
+{
+    if (isRunning() || positions.isEmpty() || sliceMs <= 0) {
+        return false;
+    }
+
+    m_job = job;
+    m_positions = positions;
+    m_sliceMs = sliceMs;
+    if (m_job.durationMs > 0) {
+        return startSlices();
+    }
+
+    // The queue's own probe has not answered (or failed); ask again without blocking.
+    m_probing = true;
+    if (!m_probe.isRunning()) {
+        m_probe.start(locateFfprobe(), m_job.videoPath);
+    }
+    return true;
+}
+
+void SampleEncoder::onProbeFinished(const QString &videoPath, const MediaInfo &info)
+{
+    if (!m_probing) {
+        return;
+    }
+    if (videoPath != m_job.videoPath) {
+        // Answer for a start() that was cancelled; probe the current source instead.
+        m_probe.start(locateFfprobe(), m_job.videoPath);
+        return;
+    }
+    m_probing = false;
+    m_job.durationMs = info.durationMs;
+    if (!startSlices()) {
+        emit finished(false);
+    }
+}
+
+bool SampleEncoder::startSlices()
+{
+    const QVector<double> &positions = m_positions;
+    const qint64 sliceMs = m_sliceMs;
+    const qint64 windowMs = m_job.effectiveDurationMs();
+    if (windowMs <= 0) {
+        emit messageReceived(tr("[warn] Sample encode needs the source duration; ffprobe could not read it."));
+        return false;
+    }
+
+    // Slices are placed inside the job's own cut window, if any.
+    double cutStartSeconds = 0.0;
+    const qint64 windowStartMs = m_job.cutSettings.enabled && parseTimeToSeconds(m_job.cutSettings.startTime, cutStartSeconds)
+        ? static_cast<qint64>(cutStartSeconds * 1000.0)
+        : 0;
+    const qint64 lengthMs = std::min(sliceMs, windowMs);
+
+    qDeleteAll(m_encoders);
+    m_encoders.clear();
+    m_results.clear();
+    QDir().mkpath(m_outputDirectory);
+
+    const QFileInfo source(m_job.videoPath);
+    const QString suffix = QFileInfo(m_job.resolvedOutputPath()).suffix();
+    for (int i = 0; i < positions.size(); ++i) {
+        const double position = std::clamp(positions.at(i), 0.0, 1.0);
+        SampleResult result;
+        result.position = position;
+        result.startMs = windowStartMs + static_cast<qint64>(position * static_cast<double>(windowMs - lengthMs));
+        result.lengthMs = lengthMs;
+        result.outputPath = QDir(m_outputDirectory).filePath(QStringLiteral("%1-sample%2-%3pct.%4")
+                                                                 .arg(source.completeBaseName())
+                                                                 .arg(i + 1)
+                                                                 .arg(qRound(position * 100.0))
+                                                                 .arg(suffix));
+        m_results.append(result);
+
+        auto *encoder = new Encoder(this);
+        m_encoders.append(encoder);
+        encoder->setJobLogDirectory(JobLogWriter::auxiliaryLogDirectory());
+        connect(encoder, &Encoder::progressChanged, this, [this]() {
+            double total = 0.0;
+            for (const Encoder *running : std::as_const(m_encoders)) {
+                total += running->state() == Encoder::State::Idle ? 1.0 : running->progress();
+            }
+            emit progressChanged(total / m_encoders.size());
+        });
+        connect(encoder, &Encoder::messageReceived, this, [this, i](const QString &message) {
+            if (message.startsWith(QLatin1String("[warn]"))) {
+                emit messageReceived(tr("Sample %1: %2").arg(i + 1).arg(message));
+            }
+        });
+        connect(encoder, &Encoder::telemetryReady, this, [this, i](const JobTelemetry &telemetry) {
+            m_results[i].averageFps = telemetry.averageFps;
+            m_results[i].wallTimeMs = telemetry.wallTimeMs;
+        });
+        connect(encoder, &Encoder::finished, this, [this, i](bool success) { onEncoderFinished(i, success); });
+    }
+
+    m_running = static_cast<int>(m_encoders.size());
+    emit messageReceived(tr("Encoding %n sample(s) of %1 s in parallel", nullptr, m_running).arg(lengthMs / 1000.0, 0, 'f', 1));
+    // Started only after every result slot exists, since a failed start finishes synchronously.
+    for (int i = 0; i < m_encoders.size(); ++i) {
+        EncodeJob slice = m_job;
+        slice.cutSettings.enabled = true;
+        slice.cutSettings.startTime = formatSeconds(static_cast<double>(m_results.at(i).startMs) / 1000.0);
+        slice.cutSettings.endTime = formatSeconds(static_cast<double>(m_results.at(i).startMs + lengthMs) / 1000.0);
+        slice.outputFile = m_results.at(i).outputPath;
+        // Slices encode at the given quality and rate control; a quality target or
+        // size budget would otherwise start its own search or plan per slice.
+        slice.profile.editVideo().targetMetric.clear();
+        slice.maxOutputBytes = 0;
+        slice.globalOutputFolder.clear();
+        m_encoders.at(i)->startEncoding(slice);
+    }
+    return true;
+}
+
+void SampleEncoder::cancel()
+{
+    if (m_probing) {
+        m_probing = false;
+        emit finished(false);
+        return;
+    }
+    for (Encoder *encoder : std::as_const(m_encoders)) {
+        if (encoder->state() != Encoder::State::Idle) {
+            encoder->stopEncoding();
+        }
+    }
+}
+
+void SampleEncoder::onEncoderFinished(int index, bool success)
+{
+    SampleResult &result = m_results[index];
+    result.success = success;
+    result.outputBytes = success ? QFileInfo(result.outputPath).size() : 0;
+    if (!success) {
+        QFile::remove(result.outputPath);
+    }
+    emit sampleFinished(index, result);
+
+    if (--m_running > 0) {
+        return;
+    }
+    const bool anySuccess = std::any_of(m_results.cbegin(), m_results.cend(), [](const SampleResult &r) { return r.success; });
+    emit finished(anySuccess);
+}
+
+qint64 SampleEncoder::projectedBytes() const
+{
+    qint64 bytes = 0;
+    qint64 encodedMs = 0;
+    for (const SampleResult &result : m_results) {
+        if (result.success && result.lengthMs > 0) {
+            bytes += result.outputBytes;
+            encodedMs += result.lengthMs;
+        }
+    }
+    if (encodedMs <= 0) {
+        return -1;
+    }
+    return static_cast<qint64>(static_cast<double>(bytes) / static_cast<double>(encodedMs)
+                               * static_cast<double>(m_job.effectiveDurationMs()));
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "MediaProbe.h"
+
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+class Encoder;
+
+struct SampleResult {
+    double position = 0.0;
+    qint64 startMs = 0;
+    qint64 lengthMs = 0;
+    QString outputPath;
+    bool success = false;
+    qint64 outputBytes = 0;
+    double averageFps = 0.0;
+    qint64 wallTimeMs = 0;
+};
+
+// Quality check before a long encode: cuts short slices at fixed positions of
+// the job, encodes them concurrently with the job's exact settings and projects
+// the full-length output size from the results.
+class SampleEncoder : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SampleEncoder(QObject *parent = nullptr);
+    ~SampleEncoder() override;
+
+    bool start(const EncodeJob &job, const QVector<double> &positions = {0.1, 0.5, 0.9}, qint64 sliceMs = 10000);
+    void cancel();
+    [[nodiscard]] bool isRunning() const noexcept { return m_running > 0 || m_probing; }
+    [[nodiscard]] const QVector<SampleResult> &results() const noexcept { return m_results; }
+    [[nodiscard]] const EncodeJob &job() const noexcept { return m_job; }
+
+    // Output size of the whole job extrapolated from the successful samples, or -1.
+    [[nodiscard]] qint64 projectedBytes() const;
+
+    // Where sample files are written; defaults to sampleDirectory().
+    void setOutputDirectory(const QString &directory) { m_outputDirectory = directory; }
+
+    static QString sampleDirectory();
+
+signals:
+    void progressChanged(double progress);
+    void sampleFinished(int index, const SampleResult &result);
+    void messageReceived(const QString &message);
+    void finished(bool success);
+
+private:
+    bool startSlices();
+    void onProbeFinished(const QString &videoPath, const MediaInfo &info);
+    void onEncoderFinished(int index, bool success);
+
+    EncodeJob m_job;
+    QVector<double> m_positions;
+    qint64 m_sliceMs = 0;
+    MediaProbe m_probe;
+    bool m_probing = false;
+    QList<Encoder *> m_encoders;
+    QVector<SampleResult> m_results;
+    int m_running = 0;
+    QString m_outputDirectory = sampleDirectory();
+};
@@ -0,0 +1,319 @@
+#include "SettingsDialog.h"
+
+#include "AppSettings.h"
+
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QDir>
+#include <QFileDialog>
+#include <QFileInfo>
+#include <QGroupBox>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPlainTextEdit>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QSpinBox>
+#include <QTabWidget>
+#include <QVBoxLayout>
+
+#include <algorithm>
+
+namespace {
+// Watch folder items keep the folder and its profile in data roles; the text shows both.
+constexpr int kFolderRole = Qt::UserRole;
+constexpr int kProfileRole = Qt::UserRole + 1;
+
+void updateWatchFolderText(QListWidgetItem *item)
+{
+    const QString folder = QDir::toNativeSeparators(item->data(kFolderRole).toString());
+    const QString profile = item->data(kProfileRole).toString();
+    item->setText(profile.isEmpty() ? folder : QStringLiteral("%1  [%2]").arg(folder, profile));
+}
+
+QListWidgetItem *addWatchFolderItem(QListWidget *list, const QString &folder, const QString &profile)
+{
+    auto *item = new QListWidgetItem(list);
+    item->setData(kFolderRole, folder);
+    item->setData(kProfileRole, profile);
+    updateWatchFolderText(item);
+    return item;
+}
+} // namespace
+
+SettingsDialog::SettingsDialog(const QStringList &profileNames, QWidget *parent)
+    : QDialog(parent)
+{
+    setWindowTitle(tr("Settings"));
+    resize(560, 420);
+
+    auto *layout = new QVBoxLayout(this);
+
+    auto *tabs = new QTabWidget(this);
+    tabs->addTab(createGeneralPage(), tr("General"));
+    tabs->addTab(createWatchFolderPage(profileNames), tr("Watch folders"));
+    tabs->addTab(createWorkersPage(), tr("Workers"));
+    tabs->addTab(createHooksPage(), tr("Hooks"));
+    layout->addWidget(tabs, 1);
+
+    auto *buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, this);
+    connect(buttons, &QDialogButtonBox::accepted, this, &SettingsDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &SettingsDialog::reject);
+    layout->addWidget(buttons);
+}
+
+QWidget *SettingsDialog::createGeneralPage()
+{
+    auto *page = new QWidget(this);
+    auto *layout = new QVBoxLayout(page);
+
+    m_outputCache = new QCheckBox(tr("Reuse outputs of identical earlier encodes"), page);
+    m_outputCache->setToolTip(tr("A job whose source, settings and subtitle match a previous successful encode "
+                                 "links or copies that output instead of encoding again."));
+    m_outputCache->setChecked(AppSettings::outputCacheEnabled());
+    layout->addWidget(m_outputCache);
+
+    m_sourceIndexing = new QCheckBox(tr("Index sources before encoding"), page);
+    m_sourceIndexing->setToolTip(tr("Builds a frame/keyframe index per source once and keeps it in the cache, "
+                                    "so seeking features can find any frame without demuxing from the start."));
+    m_sourceIndexing->setChecked(AppSettings::sourceIndexingEnabled());
+    layout->addWidget(m_sourceIndexing);
+
+    m_moovReservation = new QCheckBox(tr("Reserve MP4 index space instead of rewriting for faststart"), page);
+    m_moovReservation->setToolTip(tr("Telegram MP4s keep their index at the front without the post-encode rewrite "
+                                     "of the whole file. The space is sized from the frame count; outputs whose "
+                                     "estimate falls short are re-encoded with the regular faststart pass."));
+    m_moovReservation->setChecked(AppSettings::moovReservationEnabled());
+    layout->addWidget(m_moovReservation);
+
+    m_lowOverheadUi = new QCheckBox(tr("Keep the interface idle while encoding"), page);
+    m_lowOverheadUi->setToolTip(tr("Progress, status and log updates are batched to the display refresh (once a second "
+                                   "while minimized) and animations stop when the window is hidden, so ffmpeg keeps the CPU."));
+    m_lowOverheadUi->setChecked(AppSettings::lowOverheadUi());
+    layout->addWidget(m_lowOverheadUi);
+
+    m_soundEffects = new QCheckBox(tr("Play a sound when a job finishes, fails or pauses"), page);
+    m_soundEffects->setChecked(AppSettings::soundEffectsEnabled());
+    layout->addWidget(m_soundEffects);
+
+    m_attachSubtitleFonts = new QCheckBox(tr("Attach the fonts used by ASS subtitles to MKV outputs"), page);
+    m_attachSubtitleFonts->setToolTip(tr("Each font the subtitle script uses is resolved to its installed file and "
+                                         "muxed in as an attachment, so the file can be re-subbed or remuxed elsewhere."));
+    m_attachSubtitleFonts->setChecked(AppSettings::attachSubtitleFonts());
+    layout->addWidget(m_attachSubtitleFonts);
+
+    auto *logLevelRow = new QHBoxLayout;
+    logLevelRow->addWidget(new QLabel(tr("ffmpeg log level:"), page));
+    m_ffmpegLogLevel = new QComboBox(page);
+    m_ffmpegLogLevel->addItem(tr("Errors"), QStringLiteral("error"));
+    m_ffmpegLogLevel->addItem(tr("Warnings"), QStringLiteral("warning"));
+    m_ffmpegLogLevel->addItem(tr("Info"), QStringLiteral("info"));
+    m_ffmpegLogLevel->addItem(tr("Verbose"), QStringLiteral("verbose"));
+    m_ffmpegLogLevel->addItem(tr("Debug"), QStringLiteral("debug"));
+    m_ffmpegLogLevel->setToolTip(tr("Everything ffmpeg prints at this level goes to a log file per job; "
+                                    "only warnings and errors are shown in the Log tab."));
+    m_ffmpegLogLevel->setCurrentIndex(std::max(0, m_ffmpegLogLevel->findData(AppSettings::ffmpegLogLevel())));
+    logLevelRow->addWidget(m_ffmpegLogLevel);
+    logLevelRow->addStretch(1);
+    layout->addLayout(logLevelRow);
+
+    auto *scratchLabel = new QLabel(tr("Scratch folder for in-progress outputs:"), page);
+    layout->addWidget(scratchLabel);
+    auto *scratchRow = new QHBoxLayout;
+    m_scratchDirectory = new QLineEdit(QDir::toNativeSeparators(AppSettings::scratchDirectory()), page);
+    m_scratchDirectory->setPlaceholderText(tr("Beside the output"));
+    m_scratchDirectory->setToolTip(tr("Encodes are written here (ideally a fast local disk) and moved to the output "
+                                      "folder when complete, so slow or network destinations never hold a partial file."));
+    auto *scratchBrowse = new QPushButton(tr("Browse"), page);
+    scratchRow->addWidget(m_scratchDirectory, 1);
+    scratchRow->addWidget(scratchBrowse);
+    layout->addLayout(scratchRow);
+    connect(scratchBrowse, &QPushButton::clicked, this, [this]() {
+        const QString folder = QFileDialog::getExistingDirectory(this, tr("Select scratch folder"), m_scratchDirectory->text());
+        if (!folder.isEmpty()) {
+            m_scratchDirectory->setText(QDir::toNativeSeparators(folder));
+        }
+    });
+    layout->addStretch(1);
+
+    return page;
+}
+
+QWidget *SettingsDialog::createWatchFolderPage(const QStringList &profileNames)
+{
+    auto *page = new QWidget(this);
+    auto *layout = new QVBoxLayout(page);
+
+    auto *info = new QLabel(tr("New videos in these folders are queued once they stop growing. Jobs use the "
+                               "folder's profile (or the Main tab settings when it has none) and the "
+                               "auto-detected subtitle."),
+                            page);
+    info->setWordWrap(true);
+    layout->addWidget(info);
+
+    m_watchFolderList = new QListWidget(page);
+    const QHash<QString, QString> profiles = AppSettings::watchFolderProfiles();
+    for (const QString &folder : AppSettings::watchFolders()) {
+        addWatchFolderItem(m_watchFolderList, folder, profiles.value(folder));
+    }
+    layout->addWidget(m_watchFolderList, 1);
+
+    auto *profileRow = new QHBoxLayout;
+    profileRow->addWidget(new QLabel(tr("Profile for the selected folder:"), page));
+    m_watchFolderProfile = new QComboBox(page);
+    m_watchFolderProfile->addItem(tr("Main tab settings"), QString());
+    for (const QString &name : profileNames) {
+        m_watchFolderProfile->addItem(name, name);
+    }
+    m_watchFolderProfile->setEnabled(false);
+    profileRow->addWidget(m_watchFolderProfile, 1);
+    layout->addLayout(profileRow);
+    connect(m_watchFolderList, &QListWidget::currentItemChanged, this, [this](QListWidgetItem *current) {
+        const QSignalBlocker blocker(m_watchFolderProfile);
+        m_watchFolderProfile->setEnabled(current != nullptr);
+        // A profile deleted since shows as the tab settings, which is what the folder falls back to.
+        const int index = current ? m_watchFolderProfile->findData(current->data(kProfileRole).toString()) : 0;
+        m_watchFolderProfile->setCurrentIndex(std::max(index, 0));
+    });
+    connect(m_watchFolderProfile, &QComboBox::currentIndexChanged, this, [this]() {
+        if (QListWidgetItem *item = m_watchFolderList->currentItem()) {
+            item->setData(kProfileRole, m_watchFolderProfile->currentData().toString());
+            updateWatchFolderText(item);
+        }
+    });
+
+    auto *buttonRow = new QHBoxLayout;
+    auto *addButton = new QPushButton(tr("Add folder"), page);
+    auto *removeButton = new QPushButton(tr("Remove"), page);
+    buttonRow->addWidget(addButton);
+    buttonRow->addWidget(removeButton);
+    buttonRow->addStretch(1);
+    layout->addLayout(buttonRow);
+
+    connect(addButton, &QPushButton::clicked, this, [this]() {
+        const QString folder = QFileDialog::getExistingDirectory(this, tr("Select watch folder"));
+        if (folder.isEmpty()) {
+            return;
+        }
+        for (int i = 0; i < m_watchFolderList->count(); ++i) {
+            if (QFileInfo(m_watchFolderList->item(i)->data(kFolderRole).toString()) == QFileInfo(folder)) {
+                return;
+            }
+        }
+        m_watchFolderList->setCurrentItem(addWatchFolderItem(m_watchFolderList, folder, QString()));
+    });
+    connect(removeButton, &QPushButton::clicked, this, [this]() {
+        qDeleteAll(m_watchFolderList->selectedItems());
+    });
+
+    m_autoStartWatched = new QCheckBox(tr("Start encoding watched files automatically"), page);
+    m_autoStartWatched->setChecked(AppSettings::autoStartWatchedJobs());
+    layout->addWidget(m_autoStartWatched);
+
+    return page;
+}
+
+QWidget *SettingsDialog::createWorkersPage()
+{
+    auto *page = new QWidget(this);
+    auto *layout = new QVBoxLayout(page);
+
+    auto *info = new QLabel(tr("Remote niseyuki-worker instances, one host:port per line. Pending jobs are sent to "
+                               "free worker slots while the local encoder is busy. Workers must see the source and "
+                               "subtitle files under the same paths; outputs are streamed back."),
+                            page);
+    info->setWordWrap(true);
+    layout->addWidget(info);
+
+    m_workerEndpoints = new QPlainTextEdit(page);
+    m_workerEndpoints->setPlaceholderText(QStringLiteral("127.0.0.1:7301"));
+    m_workerEndpoints->setPlainText(AppSettings::workerEndpoints().join(QLatin1Char('\n')));
+    layout->addWidget(m_workerEndpoints, 1);
+
+    return page;
+}
+
+QWidget *SettingsDialog::createHooksPage()
+{
+    auto *page = new QWidget(this);
+    auto *layout = new QVBoxLayout(page);
+
+    auto *info = new QLabel(tr("Commands run in order after each successful encode, one per line. {output}, {source}, "
+                               "{subtitle} and {job} are replaced with the job's paths and id (also exported as "
+                               "NISEYUKI_OUTPUT, NISEYUKI_SOURCE, NISEYUKI_SUBTITLE, NISEYUKI_JOB_ID). Hooks run next "
+                               "to the following encode; a failing hook marks its job failed and skips the rest. Jobs queued "
+                               "with a named profile run the hooks saved with that profile instead."),
+                            page);
+    info->setWordWrap(true);
+    layout->addWidget(info);
+
+    m_hookCommands = new QPlainTextEdit(page);
+    m_hookCommands->setPlaceholderText(QStringLiteral("sha256sum {output}\nmv {output} /srv/sync/"));
+    m_hookCommands->setPlainText(AppSettings::postEncodeHooks().join(QLatin1Char('\n')));
+    layout->addWidget(m_hookCommands, 1);
+
+    auto *limitsRow = new QHBoxLayout;
+    limitsRow->addWidget(new QLabel(tr("Timeout per hook:"), page));
+    m_hookTimeout = new QSpinBox(page);
+    m_hookTimeout->setRange(0, 86400);
+    m_hookTimeout->setSuffix(tr(" s"));
+    m_hookTimeout->setSpecialValueText(tr("None"));
+    m_hookTimeout->setValue(AppSettings::hookTimeoutSeconds());
+    limitsRow->addWidget(m_hookTimeout);
+    limitsRow->addSpacing(12);
+    limitsRow->addWidget(new QLabel(tr("Jobs running hooks at once:"), page));
+    m_hookConcurrency = new QSpinBox(page);
+    m_hookConcurrency->setRange(1, 16);
+    m_hookConcurrency->setValue(AppSettings::hookConcurrency());
+    limitsRow->addWidget(m_hookConcurrency);
+    limitsRow->addStretch(1);
+    layout->addLayout(limitsRow);
+
+    return page;
+}
+
+void SettingsDialog::accept()
+{
+    QStringList folders;
+    QHash<QString, QString> folderProfiles;
+    for (int i = 0; i < m_watchFolderList->count(); ++i) {
+        const QString folder = m_watchFolderList->item(i)->data(kFolderRole).toString();
+        folders << folder;
+        folderProfiles.insert(folder, m_watchFolderList->item(i)->data(kProfileRole).toString());
+    }
+    AppSettings::setOutputCacheEnabled(m_outputCache->isChecked());
+    AppSettings::setSourceIndexingEnabled(m_sourceIndexing->isChecked());
+    AppSettings::setMoovReservationEnabled(m_moovReservation->isChecked());
+    AppSettings::setLowOverheadUi(m_lowOverheadUi->isChecked());
+    AppSettings::setSoundEffectsEnabled(m_soundEffects->isChecked());
+    AppSettings::setAttachSubtitleFonts(m_attachSubtitleFonts->isChecked());
+    AppSettings::setFfmpegLogLevel(m_ffmpegLogLevel->currentData().toString());
+    AppSettings::setScratchDirectory(QDir::fromNativeSeparators(m_scratchDirectory->text().trimmed()));
+    AppSettings::setWatchFolders(folders);
+    AppSettings::setWatchFolderProfiles(folderProfiles);
+    AppSettings::setAutoStartWatchedJobs(m_autoStartWatched->isChecked());
+
+    QStringList endpoints;
+    const QStringList lines = m_workerEndpoints->toPlainText().split(QLatin1Char('\n'));
+    for (const QString &line : lines) {
+        if (!line.trimmed().isEmpty()) {
+            endpoints << line.trimmed();
+        }
+    }
+    AppSettings::setWorkerEndpoints(endpoints);
+
+    QStringList hooks;
+    const QStringList hookLines = m_hookCommands->toPlainText().split(QLatin1Char('\n'));
+    for (const QString &line : hookLines) {
+        if (!line.trimmed().isEmpty()) {
+            hooks << line.trimmed();
+        }
+    }
+    AppSettings::setPostEncodeHooks(hooks);
+    AppSettings::setHookTimeoutSeconds(m_hookTimeout->value());
+    AppSettings::setHookConcurrency(m_hookConcurrency->value());
+    QDialog::accept();
+}
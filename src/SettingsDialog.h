@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QDialog>
+#include <QStringList>
+
+class QCheckBox;
+class QComboBox;
+class QLineEdit;
+class QListWidget;
+class QPlainTextEdit;
+class QSpinBox;
+
+class SettingsDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    // profileNames are the named profiles a watch folder can encode with.
+    explicit SettingsDialog(const QStringList &profileNames, QWidget *parent = nullptr);
+
+    void accept() override;
+
+private:
+    QWidget *createGeneralPage();
+    QWidget *createWatchFolderPage(const QStringList &profileNames);
+    QWidget *createWorkersPage();
+    QWidget *createHooksPage();
+
+    QCheckBox *m_outputCache = nullptr;
+    QCheckBox *m_sourceIndexing = nullptr;
+    QCheckBox *m_moovReservation = nullptr;
+    QCheckBox *m_lowOverheadUi = nullptr;
+    QCheckBox *m_soundEffects = nullptr;
+    QCheckBox *m_attachSubtitleFonts = nullptr;
+    QComboBox *m_ffmpegLogLevel = nullptr;
+    QLineEdit *m_scratchDirectory = nullptr;
+    QListWidget *m_watchFolderList = nullptr;
+    QComboBox *m_watchFolderProfile = nullptr;
+    QCheckBox *m_autoStartWatched = nullptr;
+    QPlainTextEdit *m_workerEndpoints = nullptr;
+    QPlainTextEdit *m_hookCommands = nullptr;
+    QSpinBox *m_hookTimeout = nullptr;
+    QSpinBox *m_hookConcurrency = nullptr;
+};
@@ -0,0 +1,158 @@
+#include "SizeBudget.h"
+
+#include "Encoder.h"
+#include "TimeUtils.h"
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include <algorithm>
+
+namespace {
+// Container overhead and encoder rate error are kept out of the budget.
+constexpr double kBudgetMargin = 0.98;
+constexpr qint64 kReservedBytes = 256 * 1024;
+constexpr int kMinVideoKbps = 150;
+// Samples this close to the cap mean it binds throughout; two passes spread the bits better.
+constexpr double kBindingRatio = 0.9;
+constexpr qint64 kSliceMs = 6000;
+
+double toMiB(qint64 bytes)
+{
+    return static_cast<double>(bytes) / (1024.0 * 1024.0);
+}
+} // namespace
+
+SizeBudgetPlanner::SizeBudgetPlanner(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_samples, &SampleEncoder::messageReceived, this, &SizeBudgetPlanner::messageReceived);
+    connect(&m_samples, &SampleEncoder::finished, this, &SizeBudgetPlanner::onSamplesFinished);
+}
+
+SizeBudgetPlanner::~SizeBudgetPlanner()
+{
+    m_samples.disconnect(this);
+    cancel();
+}
+
+int SizeBudgetPlanner::audioKbpsForJob(const EncodeJob &job)
+{
+    const QString codec = job.telegramMode ? QStringLiteral("aac") : job.profile.audio().codec.toLower();
+    if (codec == QLatin1String("flac")) {
+        // Lossless stereo anime audio usually lands well below this.
+        return 900;
+    }
+    return job.profile.audio().bitrateKbps > 0 ? job.profile.audio().bitrateKbps : 192;
+}
+
+bool SizeBudgetPlanner::start(const EncodeJob &job)
+{
+    if (m_running || job.maxOutputBytes <= 0) {
+        return false;
+    }
+    m_job = job;
+    m_plan = SizePlan();
+    m_plan.budgetBytes = job.maxOutputBytes;
+    m_plan.audioKbps = audioKbpsForJob(job);
+
+    const qint64 durationMs = m_job.effectiveDurationMs();
+    if (durationMs <= 0) {
+        emit messageReceived(tr("[warn] The size budget needs the source duration; ffprobe could not read it."));
+        return false;
+    }
+
+    m_usableBytes = static_cast<qint64>(static_cast<double>(m_job.maxOutputBytes) * kBudgetMargin) - kReservedBytes;
+    // bytes * 8 / ms is kbit/s.
+    const qint64 totalKbps = std::max<qint64>(m_usableBytes, 0) * 8 / durationMs;
+    const int videoKbps = static_cast<int>(totalKbps) - m_plan.audioKbps;
+    if (videoKbps < kMinVideoKbps) {
+        emit messageReceived(tr("[warn] %1 MiB for %2 leaves %3 kbps for video; raise the size budget or cut the job.")
+                                 .arg(toMiB(m_job.maxOutputBytes), 0, 'f', 0)
+                                 .arg(formatTimecode(durationMs))
+                                 .arg(std::max(videoKbps, 0)));
+        return false;
+    }
+    m_plan.rateControl.maxrateKbps = videoKbps;
+    m_plan.rateControl.bufsizeKbps = 2 * videoKbps;
+
+    EncodeJob probe = m_job;
+    probe.maxOutputBytes = 0;
+    probe.rateControl = m_plan.rateControl;
+
+    QDir().mkpath(SampleEncoder::sampleDirectory());
+    m_workDir = std::make_unique<QTemporaryDir>(QDir(SampleEncoder::sampleDirectory()).filePath(QStringLiteral("size-XXXXXX")));
+    m_samples.setOutputDirectory(m_workDir->isValid() ? m_workDir->path() : SampleEncoder::sampleDirectory());
+    // Set first: samples that fail to launch finish synchronously inside start().
+    m_running = true;
+    emit statusChanged(tr("Planning size"));
+    emit messageReceived(tr("Size budget %1 MiB: sampling at CRF %2 capped to %3 kbps")
+                             .arg(toMiB(m_job.maxOutputBytes), 0, 'f', 0)
+                             .arg(m_job.profile.video().qualityValue, 0, 'f', 1)
+                             .arg(videoKbps));
+    if (!m_samples.start(probe, {0.1, 0.5, 0.9}, kSliceMs)) {
+        m_running = false;
+        m_workDir.reset();
+        return false;
+    }
+    return true;
+}
+
+void SizeBudgetPlanner::cancel()
+{
+    if (!m_running) {
+        return;
+    }
+    m_running = false;
+    m_samples.cancel();
+    m_workDir.reset();
+}
+
+void SizeBudgetPlanner::onSamplesFinished(bool success)
+{
+    if (!m_running) {
+        return;
+    }
+
+    RateControl &rc = m_plan.rateControl;
+    const qint64 durationMs = m_job.effectiveDurationMs();
+    const qint64 budgetRateBytes = (static_cast<qint64>(rc.maxrateKbps) + m_plan.audioKbps) * durationMs / 8;
+    const qint64 projected = success ? m_samples.projectedBytes() : -1;
+    for (const SampleResult &sample : m_samples.results()) {
+        QFile::remove(sample.outputPath);
+    }
+
+    const bool twoPassCapable = Encoder::videoCodecForJob(m_job) == QLatin1String("libx264");
+    if (projected < 0) {
+        emit messageReceived(tr("[warn] Size samples failed; planning from duration only."));
+    }
+    if (projected >= 0 && projected <= kBindingRatio * m_usableBytes) {
+        // The cap only trims peaks; the CRF decides the size.
+        m_plan.predictedBytes = projected;
+    } else if (twoPassCapable) {
+        rc.twoPass = true;
+        rc.bitrateKbps = rc.maxrateKbps;
+        // Peaks stay bounded for playback while the average is set by the first pass.
+        rc.maxrateKbps = 2 * rc.bitrateKbps;
+        rc.bufsizeKbps = 4 * rc.bitrateKbps;
+        m_plan.predictedBytes = budgetRateBytes;
+    } else {
+        m_plan.predictedBytes = projected >= 0 ? std::min(projected, budgetRateBytes) : budgetRateBytes;
+    }
+    finishPlan();
+}
+
+void SizeBudgetPlanner::finishPlan()
+{
+    const RateControl &rc = m_plan.rateControl;
+    const QString mode = rc.twoPass
+        ? tr("two-pass at %1 kbps").arg(rc.bitrateKbps)
+        : tr("one pass, CRF %1 capped at %2 kbps").arg(m_job.profile.video().qualityValue, 0, 'f', 1).arg(rc.maxrateKbps);
+    emit messageReceived(tr("Size plan: predicted %1 MiB of %2 MiB (%3)")
+                             .arg(toMiB(m_plan.predictedBytes), 0, 'f', 1)
+                             .arg(toMiB(m_plan.budgetBytes), 0, 'f', 0)
+                             .arg(mode));
+    cancel();
+    emit finished(m_plan);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "SampleEncoder.h"
+
+#include <QObject>
+#include <QString>
+
+#include <memory>
+
+class QTemporaryDir;
+
+struct SizePlan {
+    RateControl rateControl;
+    qint64 budgetBytes = 0;
+    qint64 predictedBytes = 0;
+    int audioKbps = 0;
+};
+
+// Turns a maximum output size into rate control for a single encode. The
+// video bitrate follows from the effective duration; capped sample encodes
+// then show whether a VBV-capped CRF pass stays inside the budget or whether
+// the cap binds enough that a two-pass encode at the budget bitrate is better.
+class SizeBudgetPlanner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SizeBudgetPlanner(QObject *parent = nullptr);
+    ~SizeBudgetPlanner() override;
+
+    bool start(const EncodeJob &job);
+    void cancel();
+    [[nodiscard]] bool isRunning() const noexcept { return m_running; }
+
+    // Estimated audio bitrate of the job's audio settings.
+    static int audioKbpsForJob(const EncodeJob &job);
+
+signals:
+    void statusChanged(const QString &text);
+    void messageReceived(const QString &message);
+    void finished(const SizePlan &plan);
+
+private:
+    void onSamplesFinished(bool success);
+    void finishPlan();
+
+    EncodeJob m_job;
+    SizePlan m_plan;
+    qint64 m_usableBytes = 0;
+    SampleEncoder m_samples;
+    std::unique_ptr<QTemporaryDir> m_workDir;
+    bool m_running = false;
+};
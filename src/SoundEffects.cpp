@@ -0,0 +1,91 @@
+#include "SoundEffects.h"
+
+#include <QApplication>
+#include <QCoreApplication>
+#include <QDir>
+#include <QLibrary>
+#include <QThread>
+#include <QUrl>
+
+namespace {
+using CreatePlayer = QObject *(*)();
+using PlaySound = void (*)(QObject *, const QUrl &);
+
+QUrl sourceFor(SoundEffects::Sound sound)
+{
+    switch (sound) {
+    case SoundEffects::Sound::Done:
+        return QUrl(QStringLiteral("qrc:/sfx/audio/done_maou_se_system35.wav"));
+    case SoundEffects::Sound::Failed:
+        return QUrl(QStringLiteral("qrc:/sfx/audio/failed_maou_se_system08.wav"));
+    case SoundEffects::Sound::Paused:
+        return QUrl(QStringLiteral("qrc:/sfx/audio/paused_maou_se_system06.wav"));
+    }
+    return QUrl();
+}
+
+// Lives on the sound thread; loads the niseyuki-sfx module (and with it Qt
+// Multimedia) there on the first cue and forwards every cue to its player.
+class SoundHost : public QObject
+{
+public:
+    ~SoundHost() override { delete m_player; }
+
+    void play(const QUrl &source)
+    {
+        if (!m_loaded) {
+            m_loaded = true;
+            QLibrary library(QDir(QCoreApplication::applicationDirPath()).filePath(QStringLiteral("niseyuki-sfx")));
+            const auto create = reinterpret_cast<CreatePlayer>(library.resolve("niseyukiCreateSoundPlayer"));
+            m_play = reinterpret_cast<PlaySound>(library.resolve("niseyukiPlaySound"));
+            if (create && m_play) {
+                m_player = create();
+            } else {
+                qWarning("Sound effects unavailable: %s", qPrintable(library.errorString()));
+            }
+        }
+        if (m_player) {
+            m_play(m_player, source);
+        } else {
+            // Without the module (or Qt Multimedia) a plain beep still marks the event.
+            QMetaObject::invokeMethod(qApp, []() { QApplication::beep(); }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    QObject *m_player = nullptr;
+    PlaySound m_play = nullptr;
+    bool m_loaded = false;
+};
+} // namespace
+
+SoundEffects::SoundEffects(QObject *parent)
+    : QObject(parent)
+{
+}
+
+SoundEffects::~SoundEffects()
+{
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+    }
+}
+
+void SoundEffects::play(Sound sound)
+{
+    if (!m_enabled) {
+        return;
+    }
+    if (!m_thread) {
+        m_thread = new QThread(this);
+        m_thread->setObjectName(QStringLiteral("SoundEffects"));
+        auto *host = new SoundHost;
+        host->moveToThread(m_thread);
+        connect(m_thread, &QThread::finished, host, &QObject::deleteLater);
+        m_host = host;
+        m_thread->start(QThread::LowPriority);
+    }
+    QMetaObject::invokeMethod(m_host, [host = static_cast<SoundHost *>(m_host), source = sourceFor(sound)]() { host->play(source); },
+                              Qt::QueuedConnection);
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <QObject>
+
+class QThread;
+
+// Done/failed/paused cues. Qt Multimedia is not linked into the application:
+// the first play() loads the niseyuki-sfx module on its own thread, and each
+// clip is decoded there on first use, so neither startup nor the UI thread pays
+// for it. Without the module the cues fall back to a system beep.
+class SoundEffects : public QObject
+{
+    Q_OBJECT
+public:
+    enum class Sound {
+        Done,
+        Failed,
+        Paused
+    };
+    Q_ENUM(Sound)
+
+    explicit SoundEffects(QObject *parent = nullptr);
+    ~SoundEffects() override;
+
+    void setEnabled(bool enabled) { m_enabled = enabled; }
+    void play(Sound sound);
+
+private:
+    QThread *m_thread = nullptr;
+    QObject *m_host = nullptr;
+    bool m_enabled = false;
+};
@@ -0,0 +1,258 @@
+#include "SourceIndex.h"
+
+#include "OutputCache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QList>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+namespace {
+constexpr char kMagic[8] = {'N', 'S', 'Y', 'I', 'D', 'X', '0', '1'};
+
+struct FileHeader {
+    char magic[8];
+    quint32 packetCount;
+    quint32 reserved;
+    qint64 sourceSize;
+    qint64 durationUs;
+};
+
+qint64 parseTimeUs(const QByteArray &value, bool *ok)
+{
+    const double seconds = value.toDouble(ok);
+    return *ok ? static_cast<qint64>(std::llround(seconds * 1000000.0)) : 0;
+}
+} // namespace
+
+int SourceIndex::frameAt(qint64 timeUs) const
+{
+    const auto it = std::upper_bound(m_packets.cbegin(), m_packets.cend(), timeUs,
+                                     [](qint64 time, const Packet &packet) { return time < packet.ptsUs; });
+    return static_cast<int>(it - m_packets.cbegin()) - 1;
+}
+
+int SourceIndex::keyframeAtOrBefore(int frame) const
+{
+    if (frame < 0 || m_keyframes.isEmpty()) {
+        return m_keyframes.isEmpty() ? -1 : m_keyframes.constFirst();
+    }
+    const auto it = std::upper_bound(m_keyframes.cbegin(), m_keyframes.cend(), frame);
+    return it == m_keyframes.cbegin() ? m_keyframes.constFirst() : *(it - 1);
+}
+
+SourceIndex SourceIndex::fromPackets(QVector<Packet> packets)
+{
+    SourceIndex index;
+    // Packets arrive in decode order; B-frames make presentation order differ.
+    std::stable_sort(packets.begin(), packets.end(), [](const Packet &a, const Packet &b) { return a.ptsUs < b.ptsUs; });
+    index.m_packets = std::move(packets);
+    for (int i = 0; i < index.m_packets.size(); ++i) {
+        if (index.m_packets.at(i).flags & KeyframeFlag) {
+            index.m_keyframes.append(i);
+        }
+    }
+    if (index.m_packets.size() > 1) {
+        const Packet &last = index.m_packets.constLast();
+        const Packet &previous = index.m_packets.at(index.m_packets.size() - 2);
+        index.m_durationUs = last.ptsUs + (last.ptsUs - previous.ptsUs) - index.m_packets.constFirst().ptsUs;
+    }
+    return index;
+}
+
+QString SourceIndex::cachePath(const QString &sourcePath)
+{
+    const QByteArray hash = OutputCache::sampledFileHash(sourcePath);
+    if (hash.isEmpty()) {
+        return QString();
+    }
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    return QDir(dir).filePath(QStringLiteral("index/%1.nidx").arg(QString::fromLatin1(hash.toHex())));
+}
+
+SourceIndex SourceIndex::load(const QString &sourcePath)
+{
+    const QString path = cachePath(sourcePath);
+    QFile file(path);
+    if (path.isEmpty() || !file.open(QIODevice::ReadOnly)) {
+        return SourceIndex();
+    }
+
+    FileHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+        || std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0
+        || header.sourceSize != QFileInfo(sourcePath).size()) {
+        return SourceIndex();
+    }
+    const qint64 bytes = static_cast<qint64>(header.packetCount) * static_cast<qint64>(sizeof(Packet));
+    if (file.size() != static_cast<qint64>(sizeof(header)) + bytes) {
+        return SourceIndex();
+    }
+
+    QVector<Packet> packets(static_cast<int>(header.packetCount));
+    if (file.read(reinterpret_cast<char *>(packets.data()), bytes) != bytes) {
+        return SourceIndex();
+    }
+    // Stored already sorted; fromPackets re-derives the keyframe table.
+    SourceIndex index = fromPackets(std::move(packets));
+    index.m_durationUs = header.durationUs;
+    return index;
+}
+
+bool SourceIndex::save(const QString &sourcePath) const
+{
+    const QString path = cachePath(sourcePath);
+    if (path.isEmpty() || !isValid()) {
+        return false;
+    }
+    QDir().mkpath(QFileInfo(path).absolutePath());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    FileHeader header;
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.packetCount = static_cast<quint32>(m_packets.size());
+    header.reserved = 0;
+    header.sourceSize = QFileInfo(sourcePath).size();
+    header.durationUs = m_durationUs;
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char *>(m_packets.constData()),
+               static_cast<qint64>(m_packets.size()) * static_cast<qint64>(sizeof(Packet)));
+    return file.commit();
+}
+
+SourceIndexer::SourceIndexer(QObject *parent)
+    : QObject(parent)
+{
+    m_process.setProcessChannelMode(QProcess::SeparateChannels);
+    connect(&m_process, &QProcess::readyReadStandardOutput, this, &SourceIndexer::readPackets);
+    connect(&m_process, qOverload<int, QProcess::ExitStatus>(&QProcess::finished), this, &SourceIndexer::onProcessFinished);
+    connect(&m_process, &QProcess::errorOccurred, this, [this](QProcess::ProcessError error) {
+        if (error == QProcess::FailedToStart) {
+            emit finished(SourceIndex(), tr("Unable to start ffprobe for indexing: %1").arg(m_process.errorString()));
+        }
+    });
+}
+
+void SourceIndexer::start(const QString &ffprobePath, const QString &sourcePath, qint64 expectedDurationMs)
+{
+    if (isRunning()) {
+        return;
+    }
+    m_sourcePath = sourcePath;
+    m_buffer.clear();
+    m_packets.clear();
+    m_expectedDurationUs = expectedDurationMs * 1000;
+    m_lastProgress = 0.0;
+    m_cancelled = false;
+    m_process.start(ffprobePath, {
+        QStringLiteral("-v"), QStringLiteral("error"),
+        QStringLiteral("-select_streams"), QStringLiteral("v:0"),
+        QStringLiteral("-show_entries"), QStringLiteral("packet=pts_time,dts_time,pos,flags"),
+        QStringLiteral("-of"), QStringLiteral("compact=p=0"),
+        sourcePath
+    });
+}
+
+void SourceIndexer::cancel()
+{
+    if (!isRunning()) {
+        return;
+    }
+    m_cancelled = true;
+    m_process.kill();
+    m_process.waitForFinished(1000);
+}
+
+void SourceIndexer::readPackets()
+{
+    m_buffer.append(m_process.readAllStandardOutput());
+    int start = 0;
+    int newline = -1;
+    while ((newline = m_buffer.indexOf('\n', start)) >= 0) {
+        parseLine(m_buffer.mid(start, newline - start));
+        start = newline + 1;
+    }
+    m_buffer.remove(0, start);
+
+    if (m_expectedDurationUs > 0 && !m_packets.isEmpty()) {
+        const double progress = std::clamp(static_cast<double>(m_packets.constLast().dtsUs) / m_expectedDurationUs, 0.0, 1.0);
+        if (progress - m_lastProgress >= 0.01) {
+            m_lastProgress = progress;
+            emit progressChanged(progress);
+        }
+    }
+}
+
+void SourceIndexer::parseLine(const QByteArray &line)
+{
+    // e.g. "pts_time=1.001000|dts_time=0.959292|pos=48213|flags=K__"
+    SourceIndex::Packet packet;
+    bool hasPts = false;
+    bool hasDts = false;
+    const QList<QByteArray> fields = line.trimmed().split('|');
+    for (const QByteArray &field : fields) {
+        const int equals = field.indexOf('=');
+        if (equals <= 0) {
+            continue;
+        }
+        const QByteArray key = field.left(equals);
+        const QByteArray value = field.mid(equals + 1);
+        if (key == "pts_time") {
+            packet.ptsUs = parseTimeUs(value, &hasPts);
+        } else if (key == "dts_time") {
+            packet.dtsUs = parseTimeUs(value, &hasDts);
+        } else if (key == "pos") {
+            bool ok = false;
+            const qint64 pos = value.toLongLong(&ok);
+            packet.pos = ok ? pos : -1;
+        } else if (key == "flags" && value.startsWith('K')) {
+            packet.flags |= SourceIndex::KeyframeFlag;
+        }
+    }
+    // Some containers omit pts on non-key packets; dts is the best remaining estimate.
+    if (!hasPts && hasDts) {
+        packet.ptsUs = packet.dtsUs;
+        hasPts = true;
+    } else if (hasPts && !hasDts) {
+        packet.dtsUs = packet.ptsUs;
+    }
+    if (hasPts) {
+        m_packets.append(packet);
+    }
+}
+
+void SourceIndexer::onProcessFinished(int exitCode, QProcess::ExitStatus status)
+{
+    if (m_cancelled) {
+        return;
+    }
+    readPackets();
+    if (!m_buffer.isEmpty()) {
+        parseLine(m_buffer);
+        m_buffer.clear();
+    }
+
+    if (status != QProcess::NormalExit || exitCode != 0 || m_packets.isEmpty()) {
+        const QString details = QString::fromUtf8(m_process.readAllStandardError()).trimmed();
+        m_packets.clear();
+        emit finished(SourceIndex(), tr("Indexing failed: %1").arg(details.isEmpty() ? tr("no video packets") : details));
+        return;
+    }
+
+    const SourceIndex index = SourceIndex::fromPackets(std::exchange(m_packets, {}));
+    QString error;
+    if (!index.save(m_sourcePath)) {
+        error = tr("Index built but could not be written to the cache.");
+    }
+    emit finished(index, error);
+}
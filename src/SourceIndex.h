@@ -0,0 +1,76 @@
+#pragma once
+
+#include <QByteArray>
+#include <QObject>
+#include <QProcess>
+#include <QString>
+#include <QVector>
+
+// Packet-level index of a source's first video stream: every frame's
+// presentation/decode timestamp, byte position and keyframe flag, sorted by
+// presentation time so frame and keyframe lookups are binary searches.
+class SourceIndex
+{
+public:
+    struct Packet {
+        qint64 ptsUs = 0;
+        qint64 dtsUs = 0;
+        qint64 pos = -1;
+        quint32 flags = 0;
+        quint32 reserved = 0;
+    };
+    static constexpr quint32 KeyframeFlag = 0x1;
+
+    [[nodiscard]] bool isValid() const noexcept { return !m_packets.isEmpty(); }
+    [[nodiscard]] int frameCount() const noexcept { return static_cast<int>(m_packets.size()); }
+    [[nodiscard]] int keyframeCount() const noexcept { return static_cast<int>(m_keyframes.size()); }
+    [[nodiscard]] qint64 durationUs() const noexcept { return m_durationUs; }
+    [[nodiscard]] const Packet &packet(int frame) const { return m_packets.at(frame); }
+
+    // Frame shown at the given time (last frame whose pts <= timeUs), or -1 before the first frame.
+    [[nodiscard]] int frameAt(qint64 timeUs) const;
+    // Closest keyframe at or before the given frame; decoding from there reaches the frame.
+    [[nodiscard]] int keyframeAtOrBefore(int frame) const;
+    [[nodiscard]] int keyframeAtOrBeforeTime(qint64 timeUs) const { return keyframeAtOrBefore(frameAt(timeUs)); }
+
+    static SourceIndex fromPackets(QVector<Packet> packets);
+    static SourceIndex load(const QString &sourcePath);
+    bool save(const QString &sourcePath) const;
+    // Index files are keyed by the source's sampled content hash, so renames keep them valid.
+    static QString cachePath(const QString &sourcePath);
+
+private:
+    QVector<Packet> m_packets;
+    QVector<int> m_keyframes;
+    qint64 m_durationUs = 0;
+};
+
+// Builds a SourceIndex asynchronously with ffprobe (demux only, no decoding).
+class SourceIndexer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SourceIndexer(QObject *parent = nullptr);
+
+    void start(const QString &ffprobePath, const QString &sourcePath, qint64 expectedDurationMs);
+    void cancel();
+    [[nodiscard]] bool isRunning() const { return m_process.state() != QProcess::NotRunning; }
+    [[nodiscard]] qint64 processId() const { return m_process.processId(); }
+
+signals:
+    void progressChanged(double progress);
+    void finished(const SourceIndex &index, const QString &errorMessage);
+
+private:
+    void readPackets();
+    void parseLine(const QByteArray &line);
+    void onProcessFinished(int exitCode, QProcess::ExitStatus status);
+
+    QProcess m_process;
+    QString m_sourcePath;
+    QByteArray m_buffer;
+    QVector<SourceIndex::Packet> m_packets;
+    qint64 m_expectedDurationUs = 0;
+    double m_lastProgress = 0.0;
+    bool m_cancelled = false;
+};
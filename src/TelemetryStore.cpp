@@ -0,0 +1,180 @@
+#include "TelemetryStore.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStandardPaths>
+#include <QStringList>
+#include <QTextStream>
+
+namespace {
+QJsonObject toJson(const JobTelemetry &record)
+{
+    QJsonObject obj;
+    obj.insert(QStringLiteral("video"), record.videoPath);
+    obj.insert(QStringLiteral("output"), record.outputPath);
+    obj.insert(QStringLiteral("encoder"), record.encoder);
+    obj.insert(QStringLiteral("preset"), record.preset);
+    obj.insert(QStringLiteral("quality"), record.qualityValue);
+    obj.insert(QStringLiteral("resize"), record.resizeMode);
+    obj.insert(QStringLiteral("output_height"), record.outputHeight);
+    obj.insert(QStringLiteral("subtitle_complexity"), record.subtitleComplexity);
+    obj.insert(QStringLiteral("telegram"), record.telegramMode);
+    obj.insert(QStringLiteral("passes"), record.passes);
+    obj.insert(QStringLiteral("success"), record.success);
+    obj.insert(QStringLiteral("finished_at"), record.finishedAt.toString(Qt::ISODate));
+    obj.insert(QStringLiteral("wall_ms"), record.wallTimeMs);
+    obj.insert(QStringLiteral("first_frame_ms"), record.timeToFirstFrameMs);
+    obj.insert(QStringLiteral("encoded_ms"), record.encodedDurationMs);
+    obj.insert(QStringLiteral("avg_fps"), record.averageFps);
+    obj.insert(QStringLiteral("p5_fps"), record.p5Fps);
+    obj.insert(QStringLiteral("speed"), record.speed);
+    obj.insert(QStringLiteral("bitrate_kbps"), record.bitrateKbps);
+    obj.insert(QStringLiteral("output_bytes"), record.outputBytes);
+    obj.insert(QStringLiteral("finalize_ms"), record.finalizeMs);
+    obj.insert(QStringLiteral("cpu_user_ms"), record.cpuUserMs);
+    obj.insert(QStringLiteral("cpu_sys_ms"), record.cpuSystemMs);
+    obj.insert(QStringLiteral("peak_rss_kb"), record.peakRssKb);
+    return obj;
+}
+
+JobTelemetry fromJson(const QJsonObject &obj)
+{
+    JobTelemetry record;
+    record.videoPath = obj.value(QStringLiteral("video")).toString();
+    record.outputPath = obj.value(QStringLiteral("output")).toString();
+    record.encoder = obj.value(QStringLiteral("encoder")).toString();
+    record.preset = obj.value(QStringLiteral("preset")).toString();
+    record.qualityValue = obj.value(QStringLiteral("quality")).toDouble();
+    record.resizeMode = obj.value(QStringLiteral("resize")).toString();
+    record.outputHeight = obj.value(QStringLiteral("output_height")).toInt();
+    record.subtitleComplexity = obj.value(QStringLiteral("subtitle_complexity")).toInt();
+    record.telegramMode = obj.value(QStringLiteral("telegram")).toBool();
+    record.passes = obj.value(QStringLiteral("passes")).toInt(1);
+    record.success = obj.value(QStringLiteral("success")).toBool();
+    record.finishedAt = QDateTime::fromString(obj.value(QStringLiteral("finished_at")).toString(), Qt::ISODate);
+    record.wallTimeMs = obj.value(QStringLiteral("wall_ms")).toInteger();
+    record.timeToFirstFrameMs = obj.value(QStringLiteral("first_frame_ms")).toInteger(-1);
+    record.encodedDurationMs = obj.value(QStringLiteral("encoded_ms")).toInteger();
+    record.averageFps = obj.value(QStringLiteral("avg_fps")).toDouble();
+    record.p5Fps = obj.value(QStringLiteral("p5_fps")).toDouble();
+    record.speed = obj.value(QStringLiteral("speed")).toDouble();
+    record.bitrateKbps = obj.value(QStringLiteral("bitrate_kbps")).toDouble();
+    record.outputBytes = obj.value(QStringLiteral("output_bytes")).toInteger();
+    record.finalizeMs = obj.value(QStringLiteral("finalize_ms")).toInteger();
+    record.cpuUserMs = obj.value(QStringLiteral("cpu_user_ms")).toInteger();
+    record.cpuSystemMs = obj.value(QStringLiteral("cpu_sys_ms")).toInteger();
+    record.peakRssKb = obj.value(QStringLiteral("peak_rss_kb")).toInteger();
+    return record;
+}
+
+QString csvField(const QString &value)
+{
+    if (!value.contains(QLatin1Char(',')) && !value.contains(QLatin1Char('"')) && !value.contains(QLatin1Char('\n'))) {
+        return value;
+    }
+    QString escaped = value;
+    escaped.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+    return QStringLiteral("\"%1\"").arg(escaped);
+}
+} // namespace
+
+TelemetryStore::TelemetryStore(const QString &path)
+    : m_path(path)
+{
+}
+
+QString TelemetryStore::defaultPath()
+{
+    const QString dir = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation);
+    return QDir(dir).filePath(QStringLiteral("telemetry.jsonl"));
+}
+
+bool TelemetryStore::append(const JobTelemetry &record)
+{
+    QDir().mkpath(QFileInfo(m_path).absolutePath());
+    QFile file(m_path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    QByteArray line = QJsonDocument(toJson(record)).toJson(QJsonDocument::Compact);
+    line.append('\n');
+    return file.write(line) == line.size();
+}
+
+QVector<JobTelemetry> TelemetryStore::load() const
+{
+    QVector<JobTelemetry> records;
+    QFile file(m_path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return records;
+    }
+    while (!file.atEnd()) {
+        const QByteArray line = file.readLine().trimmed();
+        if (line.isEmpty()) {
+            continue;
+        }
+        const QJsonDocument doc = QJsonDocument::fromJson(line);
+        if (doc.isObject()) {
+            records.append(fromJson(doc.object()));
+        }
+    }
+    return records;
+}
+
+bool TelemetryStore::exportCsv(const QString &csvPath, QString *errorMessage) const
+{
+    QFile file(csvPath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text)) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+
+    QTextStream out(&file);
+    out << "finished_at,video,output,encoder,preset,quality,resize,output_height,subtitle_complexity,telegram,success,"
+           "wall_ms,first_frame_ms,encoded_ms,avg_fps,p5_fps,speed,bitrate_kbps,output_bytes,finalize_ms,"
+           "cpu_user_ms,cpu_sys_ms,peak_rss_kb\n";
+
+    const QVector<JobTelemetry> records = load();
+    for (const JobTelemetry &record : records) {
+        const QStringList fields{
+            record.finishedAt.toString(Qt::ISODate),
+            csvField(record.videoPath),
+            csvField(record.outputPath),
+            csvField(record.encoder),
+            csvField(record.preset),
+            QString::number(record.qualityValue, 'f', 1),
+            csvField(record.resizeMode),
+            QString::number(record.outputHeight),
+            QString::number(record.subtitleComplexity),
+            record.telegramMode ? QStringLiteral("1") : QStringLiteral("0"),
+            record.success ? QStringLiteral("1") : QStringLiteral("0"),
+            QString::number(record.wallTimeMs),
+            QString::number(record.timeToFirstFrameMs),
+            QString::number(record.encodedDurationMs),
+            QString::number(record.averageFps, 'f', 2),
+            QString::number(record.p5Fps, 'f', 2),
+            QString::number(record.speed, 'f', 3),
+            QString::number(record.bitrateKbps, 'f', 1),
+            QString::number(record.outputBytes),
+            QString::number(record.finalizeMs),
+            QString::number(record.cpuUserMs),
+            QString::number(record.cpuSystemMs),
+            QString::number(record.peakRssKb)
+        };
+        out << fields.join(QLatin1Char(',')) << '\n';
+    }
+
+    out.flush();
+    if (out.status() != QTextStream::Ok) {
+        if (errorMessage) {
+            *errorMessage = file.errorString();
+        }
+        return false;
+    }
+    return true;
+}
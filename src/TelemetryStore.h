@@ -0,0 +1,23 @@
+#pragma once
+
+#include "JobTelemetry.h"
+
+#include <QString>
+#include <QVector>
+
+class TelemetryStore
+{
+public:
+    explicit TelemetryStore(const QString &path = defaultPath());
+
+    bool append(const JobTelemetry &record);
+    [[nodiscard]] QVector<JobTelemetry> load() const;
+    bool exportCsv(const QString &csvPath, QString *errorMessage = nullptr) const;
+
+    [[nodiscard]] QString path() const { return m_path; }
+
+    static QString defaultPath();
+
+private:
+    QString m_path;
+};
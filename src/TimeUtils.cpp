@@ -0,0 +1,60 @@
+#include "TimeUtils.h"
+
+#include <QLatin1Char>
+#include <QStringList>
+
+QString formatTimecode(qint64 ms)
+{
+    if (ms <= 0) {
+        return QStringLiteral("00:00:00");
+    }
+    const qint64 totalSeconds = ms / 1000;
+    const qint64 hours = totalSeconds / 3600;
+    const int minutes = static_cast<int>((totalSeconds % 3600) / 60);
+    const int seconds = static_cast<int>(totalSeconds % 60);
+    return QStringLiteral("%1:%2:%3")
+        .arg(hours, 2, 10, QLatin1Char('0'))
+        .arg(minutes, 2, 10, QLatin1Char('0'))
+        .arg(seconds, 2, 10, QLatin1Char('0'));
+}
+
+QString formatSeconds(double seconds)
+{
+    if (seconds < 0.0) {
+        seconds = 0.0;
+    }
+    return QString::number(seconds, 'f', seconds >= 10.0 ? 2 : 3);
+}
+
+bool parseTimeToSeconds(const QString &text, double &secondsOut)
+{
+    const QString trimmed = text.trimmed();
+    if (trimmed.isEmpty()) {
+        return false;
+    }
+
+    bool ok = false;
+    double numeric = trimmed.toDouble(&ok);
+    if (ok) {
+        secondsOut = numeric;
+        return true;
+    }
+
+    const QStringList parts = trimmed.split(QLatin1Char(':'));
+    if (parts.isEmpty()) {
+        return false;
+    }
+
+    double multiplier = 1.0;
+    double total = 0.0;
+    for (int i = parts.size() - 1; i >= 0; --i) {
+        const double value = parts.at(i).toDouble(&ok);
+        if (!ok) {
+            return false;
+        }
+        total += value * multiplier;
+        multiplier *= 60.0;
+    }
+    secondsOut = total;
+    return true;
+}
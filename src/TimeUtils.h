@@ -0,0 +1,7 @@
+#pragma once
+
+#include <QString>
+
+QString formatTimecode(qint64 ms);
+QString formatSeconds(double seconds);
+bool parseTimeToSeconds(const QString &text, double &secondsOut);
@@ -0,0 +1,243 @@
+#include "WatchFolderService.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSettings>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr int kScanDebounceMs = 500;
+constexpr int kDefaultStabilityIntervalMs = 3000;
+// Coarsest directory timestamp granularity we expect (FAT, some SMB servers).
+constexpr qint64 kTimestampSlackMs = 2000;
+
+QString lastScanKey(const QString &folder)
+{
+    return QStringLiteral("watchFolders/lastScan/%1").arg(QString::fromLatin1(folder.toUtf8().toBase64(QByteArray::Base64UrlEncoding)));
+}
+} // namespace
+
+WatchFolderService::WatchFolderService(QObject *parent)
+    : QObject(parent)
+{
+    connect(&m_watcher, &QFileSystemWatcher::directoryChanged, this, &WatchFolderService::onDirectoryChanged);
+
+    m_scanDebounce.setSingleShot(true);
+    m_scanDebounce.setInterval(kScanDebounceMs);
+    connect(&m_scanDebounce, &QTimer::timeout, this, &WatchFolderService::scanDirtyFolders);
+
+    m_stabilityTimer.setInterval(kDefaultStabilityIntervalMs);
+    connect(&m_stabilityTimer, &QTimer::timeout, this, &WatchFolderService::checkCandidates);
+}
+
+void WatchFolderService::setFolders(const QStringList &folders)
+{
+    QSet<QString> wanted;
+    for (const QString &folder : folders) {
+        const QString cleaned = QDir::cleanPath(QFileInfo(folder).absoluteFilePath());
+        if (!cleaned.isEmpty()) {
+            wanted.insert(cleaned);
+        }
+    }
+
+    const QStringList current = m_folders.keys();
+    for (const QString &folder : current) {
+        if (wanted.contains(folder)) {
+            continue;
+        }
+        m_watcher.removePath(folder);
+        m_folders.remove(folder);
+        m_dirtyFolders.remove(folder);
+        const QString prefix = folder + QLatin1Char('/');
+        for (auto it = m_candidates.begin(); it != m_candidates.end();) {
+            if (it.key().startsWith(prefix)) {
+                it = m_candidates.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    for (const QString &folder : std::as_const(wanted)) {
+        if (m_folders.contains(folder)) {
+            continue;
+        }
+        if (!QFileInfo(folder).isDir()) {
+            emit folderError(folder, tr("Folder does not exist"));
+            continue;
+        }
+        if (!m_watcher.addPath(folder)) {
+            emit folderError(folder, tr("Unable to watch folder"));
+            continue;
+        }
+        FolderState &state = m_folders[folder];
+        scanFolder(folder, state, true);
+    }
+}
+
+void WatchFolderService::setStabilityInterval(int intervalMs)
+{
+    m_stabilityTimer.setInterval(std::max(intervalMs, 250));
+}
+
+void WatchFolderService::setRequiredStableChecks(int checks)
+{
+    m_requiredStableChecks = std::max(checks, 1);
+}
+
+bool WatchFolderService::isVideoFile(const QString &fileName)
+{
+    static const QStringList extensions{
+        QStringLiteral("mkv"), QStringLiteral("mp4"), QStringLiteral("m4v"), QStringLiteral("avi"),
+        QStringLiteral("mov"), QStringLiteral("ts"), QStringLiteral("m2ts"), QStringLiteral("webm"),
+        QStringLiteral("flv"), QStringLiteral("wmv")
+    };
+    const int dot = fileName.lastIndexOf(QLatin1Char('.'));
+    if (dot < 0) {
+        return false;
+    }
+    return extensions.contains(fileName.mid(dot + 1).toLower());
+}
+
+void WatchFolderService::onDirectoryChanged(const QString &path)
+{
+    const QString folder = QDir::cleanPath(path);
+    if (!m_folders.contains(folder)) {
+        return;
+    }
+    // Downloads touch the directory many times; coalesce bursts into one listing.
+    m_dirtyFolders.insert(folder);
+    m_scanDebounce.start();
+}
+
+void WatchFolderService::scanDirtyFolders()
+{
+    const QSet<QString> dirty = std::exchange(m_dirtyFolders, {});
+    for (const QString &folder : dirty) {
+        auto it = m_folders.find(folder);
+        if (it == m_folders.end()) {
+            continue;
+        }
+        if (!QFileInfo(folder).isDir()) {
+            emit folderError(folder, tr("Folder is no longer available"));
+            continue;
+        }
+        // Some platforms drop the watch when the directory is replaced.
+        if (!m_watcher.directories().contains(folder)) {
+            m_watcher.addPath(folder);
+        }
+        if (entriesMayHaveChanged(folder, it.value())) {
+            scanFolder(folder, it.value(), false);
+        }
+    }
+}
+
+bool WatchFolderService::entriesMayHaveChanged(const QString &folder, const FolderState &state)
+{
+    // A download writing into its file fires directoryChanged on every flush, but
+    // only creating, removing or renaming an entry moves the folder's own mtime.
+    const QDateTime modified = QFileInfo(folder).lastModified().toUTC();
+    if (!state.directoryModified.isValid() || !state.lastScan.isValid() || modified != state.directoryModified) {
+        return true;
+    }
+    // Within the timestamp granularity of the last scan an entry change can hide behind an equal mtime.
+    return modified.msecsTo(state.lastScan) < kTimestampSlackMs;
+}
+
+void WatchFolderService::scanFolder(const QString &folder, FolderState &state, bool initial)
+{
+    QSettings settings;
+    const QDateTime previousScan = initial
+        ? settings.value(lastScanKey(folder)).toDateTime()
+        : state.lastScan;
+    const QDateTime scanTime = QDateTime::currentDateTimeUtc();
+    // Read before listing, so an entry added during the listing still moves it past this value.
+    state.directoryModified = QFileInfo(folder).lastModified().toUTC();
+
+    // Only names are compared against the known set; files are stat'ed only when
+    // they are new, so a listing of a large folder stays cheap.
+    QSet<QString> names;
+    names.reserve(state.knownNames.size() + 16);
+    QDirIterator it(folder, QDir::Files | QDir::NoDotAndDotDot);
+    while (it.hasNext()) {
+        it.next();
+        const QString name = it.fileName();
+        if (!isVideoFile(name)) {
+            continue;
+        }
+        names.insert(name);
+        if (state.knownNames.contains(name)) {
+            continue;
+        }
+
+        const QString fullPath = QDir(folder).filePath(name);
+        if (initial) {
+            // Existing files only count as new if they appeared since the last session.
+            const QFileInfo info(fullPath);
+            if (!previousScan.isValid() || info.lastModified().toUTC() <= previousScan) {
+                continue;
+            }
+        }
+        if (!m_candidates.contains(fullPath)) {
+            Candidate candidate;
+            candidate.folder = folder;
+            m_candidates.insert(fullPath, candidate);
+        }
+    }
+
+    state.knownNames = std::move(names);
+    state.lastScan = scanTime;
+    settings.setValue(lastScanKey(folder), scanTime);
+
+    if (!m_candidates.isEmpty() && !m_stabilityTimer.isActive()) {
+        m_stabilityTimer.start();
+    }
+}
+
+void WatchFolderService::checkCandidates()
+{
+    QList<std::pair<QString, QString>> ready;
+    for (auto it = m_candidates.begin(); it != m_candidates.end();) {
+        const QFileInfo info(it.key());
+        if (!info.exists()) {
+            it = m_candidates.erase(it);
+            continue;
+        }
+
+        Candidate &candidate = it.value();
+        const qint64 size = info.size();
+        const QDateTime modified = info.lastModified();
+        if (size > 0 && size == candidate.size && modified == candidate.modified) {
+            ++candidate.stableChecks;
+        } else {
+            candidate.size = size;
+            candidate.modified = modified;
+            candidate.stableChecks = 0;
+        }
+
+        if (candidate.stableChecks >= m_requiredStableChecks) {
+            // Downloaders on Windows keep the file locked until it is complete.
+            QFile probe(it.key());
+            if (probe.open(QIODevice::ReadOnly)) {
+                probe.close();
+                ready.append({it.key(), candidate.folder});
+                it = m_candidates.erase(it);
+                continue;
+            }
+            candidate.stableChecks = 0;
+        }
+        ++it;
+    }
+
+    if (m_candidates.isEmpty()) {
+        m_stabilityTimer.stop();
+    }
+
+    for (const auto &[path, folder] : std::as_const(ready)) {
+        emit fileReady(path, folder);
+    }
+}
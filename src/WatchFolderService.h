@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+// Watches folders for new video files and reports each one once its size and
+// modification time have stopped changing, so partial downloads are skipped.
+class WatchFolderService : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WatchFolderService(QObject *parent = nullptr);
+
+    void setFolders(const QStringList &folders);
+    [[nodiscard]] QStringList folders() const { return m_folders.keys(); }
+
+    void setStabilityInterval(int intervalMs);
+    void setRequiredStableChecks(int checks);
+
+    static bool isVideoFile(const QString &fileName);
+
+signals:
+    // folder is the watched folder the file appeared in (cleaned absolute path).
+    void fileReady(const QString &path, const QString &folder);
+    void folderError(const QString &folder, const QString &message);
+
+private:
+    struct FolderState {
+        QSet<QString> knownNames;
+        QDateTime lastScan;
+        QDateTime directoryModified; // the folder's own mtime at lastScan
+    };
+
+    struct Candidate {
+        QString folder;
+        qint64 size = -1;
+        QDateTime modified;
+        int stableChecks = 0;
+    };
+
+    void onDirectoryChanged(const QString &path);
+    void scanDirtyFolders();
+    void scanFolder(const QString &folder, FolderState &state, bool initial);
+    // False when the folder's entry list cannot have changed since the last scan.
+    static bool entriesMayHaveChanged(const QString &folder, const FolderState &state);
+    void checkCandidates();
+
+    QFileSystemWatcher m_watcher;
+    QHash<QString, FolderState> m_folders;
+    QHash<QString, Candidate> m_candidates;
+    QSet<QString> m_dirtyFolders;
+    QTimer m_scanDebounce;
+    QTimer m_stabilityTimer;
+    int m_requiredStableChecks = 2;
+};
@@ -0,0 +1,342 @@
+#include "WorkerPool.h"
+
+#include "JobSerialization.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTcpSocket>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+constexpr int kReconnectIntervalMs = 5000;
+
+QString partialPath(const QString &target)
+{
+    return target + QStringLiteral(".part");
+}
+} // namespace
+
+WorkerPool::WorkerPool(QObject *parent)
+    : QObject(parent)
+{
+    m_reconnectTimer.setInterval(kReconnectIntervalMs);
+    connect(&m_reconnectTimer, &QTimer::timeout, this, &WorkerPool::reconnectIdle);
+}
+
+WorkerPool::~WorkerPool()
+{
+    // No signals from here: the receivers are usually being torn down as well.
+    for (Worker *worker : std::as_const(m_workers)) {
+        worker->socket->disconnect(this);
+        for (const RemoteJob &job : std::as_const(worker->jobs)) {
+            if (job.output) {
+                job.output->close();
+                job.output->remove();
+            }
+        }
+    }
+    qDeleteAll(m_workers);
+}
+
+void WorkerPool::setEndpoints(const QStringList &endpoints)
+{
+    QStringList wanted;
+    for (const QString &endpoint : endpoints) {
+        const QString trimmed = endpoint.trimmed();
+        if (!trimmed.isEmpty() && !wanted.contains(trimmed)) {
+            wanted.append(trimmed);
+        }
+    }
+
+    for (int i = m_workers.size() - 1; i >= 0; --i) {
+        Worker *worker = m_workers.at(i);
+        const QString key = QStringLiteral("%1:%2").arg(worker->host).arg(worker->port);
+        if (wanted.removeAll(key) > 0 || wanted.removeAll(worker->host) > 0) {
+            continue;
+        }
+        dropJobs(worker, tr("worker %1 was removed").arg(key));
+        worker->socket->disconnect(this);
+        worker->socket->abort();
+        worker->socket->deleteLater();
+        delete m_workers.takeAt(i);
+    }
+
+    for (const QString &endpoint : std::as_const(wanted)) {
+        auto *worker = new Worker;
+        const int colon = endpoint.lastIndexOf(QLatin1Char(':'));
+        bool portOk = false;
+        const uint port = colon > 0 ? endpoint.mid(colon + 1).toUInt(&portOk) : 0;
+        worker->host = portOk ? endpoint.left(colon) : endpoint;
+        worker->port = portOk && port > 0 && port <= 65535 ? static_cast<quint16>(port) : WorkerProtocol::kDefaultPort;
+        worker->socket = new QTcpSocket(this);
+        connect(worker->socket, &QTcpSocket::connected, this, [this, worker]() { onConnected(worker); });
+        connect(worker->socket, &QTcpSocket::readyRead, this, [this, worker]() { onReadyRead(worker); });
+        connect(worker->socket, &QTcpSocket::disconnected, this, [this, worker]() { onDisconnected(worker); });
+        connect(worker->socket, &QTcpSocket::errorOccurred, this, [this, worker](QAbstractSocket::SocketError) {
+            if (worker->socket->state() == QAbstractSocket::UnconnectedState && !worker->ready) {
+                emit workerMessage(tr("Worker %1:%2 unavailable: %3")
+                                       .arg(worker->host).arg(worker->port).arg(worker->socket->errorString()));
+            }
+        });
+        m_workers.append(worker);
+        connectWorker(worker);
+    }
+
+    if (m_workers.isEmpty()) {
+        m_reconnectTimer.stop();
+    } else if (!m_reconnectTimer.isActive()) {
+        m_reconnectTimer.start();
+    }
+    emit capacityChanged();
+}
+
+int WorkerPool::freeSlots(const Worker *worker) const
+{
+    if (!worker->ready) {
+        return 0;
+    }
+    // Other coordinators may share the worker, so trust whichever count is higher.
+    return std::max(0, worker->slotCount - std::max(worker->busy, static_cast<int>(worker->jobs.size())));
+}
+
+int WorkerPool::freeSlots() const
+{
+    int total = 0;
+    for (const Worker *worker : m_workers) {
+        total += freeSlots(worker);
+    }
+    return total;
+}
+
+int WorkerPool::activeJobCount() const
+{
+    int total = 0;
+    for (const Worker *worker : m_workers) {
+        total += static_cast<int>(worker->jobs.size());
+    }
+    return total;
+}
+
+WorkerPool::Worker *WorkerPool::workerForJob(quint64 jobId) const
+{
+    for (Worker *worker : m_workers) {
+        if (worker->jobs.contains(jobId)) {
+            return worker;
+        }
+    }
+    return nullptr;
+}
+
+QString WorkerPool::workerNameForJob(quint64 jobId) const
+{
+    const Worker *worker = workerForJob(jobId);
+    if (!worker) {
+        return QString();
+    }
+    return worker->name.isEmpty() ? worker->host : worker->name;
+}
+
+bool WorkerPool::dispatch(const EncodeJob &job)
+{
+    Worker *target = nullptr;
+    for (Worker *worker : std::as_const(m_workers)) {
+        if (freeSlots(worker) > 0 && (!target || freeSlots(worker) > freeSlots(target))) {
+            target = worker;
+        }
+    }
+    if (!target || workerForJob(job.id)) {
+        return false;
+    }
+
+    EncodeJob remote = job;
+    remote.outputFile = job.resolvedOutputPath();
+    remote.videoPath = QFileInfo(job.videoPath).absoluteFilePath();
+
+    RemoteJob entry;
+    entry.targetPath = remote.outputFile;
+    target->jobs.insert(job.id, entry);
+    target->socket->write(WorkerProtocol::frame({{QStringLiteral("cmd"), QStringLiteral("encode")},
+                                                 {QStringLiteral("ticket"), static_cast<qint64>(job.id)},
+                                                 {QStringLiteral("job"), encodeJobToJson(remote)}}));
+    return true;
+}
+
+void WorkerPool::cancel(quint64 jobId)
+{
+    if (Worker *worker = workerForJob(jobId)) {
+        worker->socket->write(WorkerProtocol::frame({{QStringLiteral("cmd"), QStringLiteral("cancel")},
+                                                     {QStringLiteral("ticket"), static_cast<qint64>(jobId)}}));
+    }
+}
+
+void WorkerPool::cancelAll()
+{
+    for (Worker *worker : std::as_const(m_workers)) {
+        const QList<quint64> ids = worker->jobs.keys();
+        for (quint64 id : ids) {
+            cancel(id);
+        }
+    }
+}
+
+void WorkerPool::connectWorker(Worker *worker)
+{
+    worker->ready = false;
+    worker->reader = WorkerProtocol::Reader();
+    worker->socket->connectToHost(worker->host, worker->port);
+}
+
+void WorkerPool::reconnectIdle()
+{
+    for (Worker *worker : std::as_const(m_workers)) {
+        if (worker->socket->state() == QAbstractSocket::UnconnectedState) {
+            connectWorker(worker);
+        }
+    }
+}
+
+void WorkerPool::onConnected(Worker *worker)
+{
+    worker->socket->write(WorkerProtocol::frame({{QStringLiteral("cmd"), QStringLiteral("hello")},
+                                                 {QStringLiteral("version"), WorkerProtocol::kVersion},
+                                                 {QStringLiteral("token"), WorkerProtocol::authToken()}}));
+}
+
+void WorkerPool::onReadyRead(Worker *worker)
+{
+    worker->reader.feed(worker->socket->readAll());
+    QJsonObject message;
+    QByteArray payload;
+    while (worker->reader.next(message, payload)) {
+        handleMessage(worker, message, payload);
+    }
+    if (worker->reader.hasError()) {
+        emit workerMessage(tr("Protocol error from worker %1; disconnecting").arg(worker->host));
+        worker->socket->abort();
+    }
+}
+
+void WorkerPool::onDisconnected(Worker *worker)
+{
+    const bool wasReady = worker->ready;
+    worker->ready = false;
+    dropJobs(worker, tr("lost connection to worker %1").arg(worker->host));
+    if (wasReady) {
+        emit workerMessage(tr("Worker %1 disconnected").arg(worker->name.isEmpty() ? worker->host : worker->name));
+        emit capacityChanged();
+    }
+}
+
+void WorkerPool::handleMessage(Worker *worker, const QJsonObject &message, const QByteArray &payload)
+{
+    const QString event = message.value(QStringLiteral("event")).toString();
+    const quint64 jobId = static_cast<quint64>(message.value(QStringLiteral("ticket")).toInteger());
+
+    if (event == QLatin1String("hello") || event == QLatin1String("capacity")) {
+        if (event == QLatin1String("hello")) {
+            if (message.value(QStringLiteral("version")).toInt() != WorkerProtocol::kVersion) {
+                emit workerMessage(tr("Worker %1 speaks an incompatible protocol version").arg(worker->host));
+                worker->socket->disconnectFromHost();
+                return;
+            }
+            worker->name = message.value(QStringLiteral("name")).toString();
+            worker->ready = true;
+            emit workerMessage(tr("Worker %1 ready with %2 slot(s)")
+                                   .arg(worker->name.isEmpty() ? worker->host : worker->name)
+                                   .arg(message.value(QStringLiteral("slots")).toInt()));
+        }
+        worker->slotCount = message.value(QStringLiteral("slots")).toInt();
+        worker->busy = message.value(QStringLiteral("busy")).toInt();
+        emit capacityChanged();
+        return;
+    }
+
+    if (event == QLatin1String("error")) {
+        emit workerMessage(tr("Worker %1: %2").arg(worker->host, message.value(QStringLiteral("error")).toString()));
+        return;
+    }
+
+    auto job = worker->jobs.find(jobId);
+    if (job == worker->jobs.end()) {
+        return;
+    }
+
+    if (event == QLatin1String("progress")) {
+        emit jobProgress(jobId, message.value(QStringLiteral("progress")).toDouble(),
+                         message.value(QStringLiteral("eta_ms")).toInteger(-1),
+                         message.value(QStringLiteral("status")).toString());
+    } else if (event == QLatin1String("log")) {
+        emit jobMessage(jobId, message.value(QStringLiteral("line")).toString());
+    } else if (event == QLatin1String("rejected")) {
+        worker->jobs.erase(job);
+        // A busy worker is worth retrying; a worker that cannot see the source is not.
+        const QString reason = message.value(QStringLiteral("error")).toString();
+        emit jobReturned(jobId, reason == QLatin1String("no free slot"), reason);
+        emit capacityChanged();
+    } else if (event == QLatin1String("upload")) {
+        QDir().mkpath(QFileInfo(job->targetPath).absolutePath());
+        job->output = new QFile(partialPath(job->targetPath), this);
+        if (!job->output->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            const QString error = job->output->errorString();
+            cancel(jobId);
+            finishJob(worker, jobId, false, error);
+        }
+    } else if (event == QLatin1String("chunk")) {
+        if (job->output && job->output->write(payload) != payload.size()) {
+            const QString error = job->output->errorString();
+            cancel(jobId);
+            finishJob(worker, jobId, false, error);
+        }
+    } else if (event == QLatin1String("finished")) {
+        finishJob(worker, jobId, message.value(QStringLiteral("success")).toBool(),
+                  message.value(QStringLiteral("error")).toString());
+    }
+}
+
+void WorkerPool::finishJob(Worker *worker, quint64 jobId, bool success, const QString &error)
+{
+    auto job = worker->jobs.find(jobId);
+    if (job == worker->jobs.end()) {
+        return;
+    }
+    const RemoteJob entry = *job;
+    worker->jobs.erase(job);
+
+    QString failure = error;
+    if (entry.output) {
+        entry.output->close();
+        if (success) {
+            QFile::remove(entry.targetPath);
+            if (!QFile::rename(entry.output->fileName(), entry.targetPath)) {
+                success = false;
+                failure = tr("unable to move output into place");
+            }
+        }
+        if (!success) {
+            entry.output->remove();
+        }
+        entry.output->deleteLater();
+    } else if (success) {
+        success = false;
+        failure = tr("worker reported success without sending the output");
+    }
+
+    emit jobFinished(jobId, success, failure);
+    emit capacityChanged();
+}
+
+void WorkerPool::dropJobs(Worker *worker, const QString &reason)
+{
+    const auto jobs = std::exchange(worker->jobs, {});
+    for (auto it = jobs.cbegin(); it != jobs.cend(); ++it) {
+        if (it->output) {
+            it->output->close();
+            it->output->remove();
+            it->output->deleteLater();
+        }
+        emit jobReturned(it.key(), true, reason);
+    }
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "EncodeJob.h"
+#include "WorkerProtocol.h"
+
+#include <QHash>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
+
+class QFile;
+class QTcpSocket;
+
+// Coordinator side of distributed encoding: keeps connections to the configured
+// niseyuki-worker endpoints, hands whole jobs to free slots and writes the
+// streamed-back output to the job's target path.
+class WorkerPool : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WorkerPool(QObject *parent = nullptr);
+    ~WorkerPool() override;
+
+    // Endpoints are "host" or "host:port".
+    void setEndpoints(const QStringList &endpoints);
+
+    [[nodiscard]] int freeSlots() const;
+    [[nodiscard]] int activeJobCount() const;
+    [[nodiscard]] QString workerNameForJob(quint64 jobId) const;
+
+    // The job id doubles as the ticket; the output goes to job.resolvedOutputPath().
+    bool dispatch(const EncodeJob &job);
+    void cancel(quint64 jobId);
+    void cancelAll();
+
+signals:
+    void capacityChanged();
+    void jobProgress(quint64 jobId, double progress, qint64 remainingMs, const QString &status);
+    void jobMessage(quint64 jobId, const QString &line);
+    void jobFinished(quint64 jobId, bool success, const QString &error);
+    // The job never ran to completion remotely and should go back to the queue.
+    void jobReturned(quint64 jobId, bool retryRemotely, const QString &reason);
+    void workerMessage(const QString &message);
+
+private:
+    struct RemoteJob {
+        QString targetPath;
+        QFile *output = nullptr;
+    };
+
+    struct Worker {
+        QString host;
+        quint16 port = WorkerProtocol::kDefaultPort;
+        QTcpSocket *socket = nullptr;
+        WorkerProtocol::Reader reader;
+        QString name;
+        bool ready = false;
+        int slotCount = 0;
+        int busy = 0;
+        QHash<quint64, RemoteJob> jobs;
+    };
+
+    void connectWorker(Worker *worker);
+    void onConnected(Worker *worker);
+    void onReadyRead(Worker *worker);
+    void onDisconnected(Worker *worker);
+    void handleMessage(Worker *worker, const QJsonObject &message, const QByteArray &payload);
+    void finishJob(Worker *worker, quint64 jobId, bool success, const QString &error);
+    void dropJobs(Worker *worker, const QString &reason);
+    void reconnectIdle();
+    [[nodiscard]] int freeSlots(const Worker *worker) const;
+    Worker *workerForJob(quint64 jobId) const;
+
+    QList<Worker *> m_workers;
+    QTimer m_reconnectTimer;
+};
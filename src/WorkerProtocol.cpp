@@ -0,0 +1,64 @@
+#include "WorkerProtocol.h"
+
+#include <QJsonDocument>
+
+namespace {
+constexpr int kMaxHeaderBytes = 1 << 20;
+constexpr qint64 kMaxPayloadBytes = 64LL << 20;
+}
+
+namespace WorkerProtocol {
+QByteArray frame(const QJsonObject &message, const QByteArray &payload)
+{
+    QJsonObject header = message;
+    if (!payload.isEmpty()) {
+        header.insert(QStringLiteral("payload_size"), static_cast<qint64>(payload.size()));
+    }
+    QByteArray data = QJsonDocument(header).toJson(QJsonDocument::Compact);
+    data.append('\n');
+    data.append(payload);
+    return data;
+}
+
+QString authToken()
+{
+    return qEnvironmentVariable("NISEYUKI_WORKER_TOKEN");
+}
+
+bool Reader::next(QJsonObject &message, QByteArray &payload)
+{
+    if (m_error) {
+        return false;
+    }
+
+    if (m_payloadSize < 0) {
+        const int newline = m_buffer.indexOf('\n');
+        if (newline < 0) {
+            m_error = m_buffer.size() > kMaxHeaderBytes;
+            return false;
+        }
+        const QJsonDocument doc = QJsonDocument::fromJson(m_buffer.left(newline));
+        m_buffer.remove(0, newline + 1);
+        if (!doc.isObject()) {
+            m_error = true;
+            return false;
+        }
+        m_header = doc.object();
+        m_payloadSize = m_header.value(QStringLiteral("payload_size")).toInteger();
+        if (m_payloadSize < 0 || m_payloadSize > kMaxPayloadBytes) {
+            m_error = true;
+            return false;
+        }
+    }
+
+    if (m_buffer.size() < m_payloadSize) {
+        return false;
+    }
+    payload = m_buffer.left(static_cast<int>(m_payloadSize));
+    m_buffer.remove(0, static_cast<int>(m_payloadSize));
+    message = m_header;
+    m_header = QJsonObject();
+    m_payloadSize = -1;
+    return true;
+}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+
+// Wire format between the coordinator and niseyuki-worker: newline-terminated
+// compact JSON objects. A message carrying "payload_size" is followed by that
+// many raw bytes, which is how output files travel back without base64.
+namespace WorkerProtocol {
+constexpr quint16 kDefaultPort = 7301;
+constexpr int kVersion = 1;
+constexpr qint64 kChunkBytes = 1 << 20;
+
+QByteArray frame(const QJsonObject &message, const QByteArray &payload = QByteArray());
+
+// Shared secret from NISEYUKI_WORKER_TOKEN; empty means no authentication.
+QString authToken();
+
+class Reader
+{
+public:
+    void feed(const QByteArray &data) { m_buffer.append(data); }
+    // Returns false until a complete message (and its payload, if any) is buffered.
+    bool next(QJsonObject &message, QByteArray &payload);
+    [[nodiscard]] bool hasError() const noexcept { return m_error; }
+
+private:
+    QByteArray m_buffer;
+    QJsonObject m_header;
+    qint64 m_payloadSize = -1;
+    bool m_error = false;
+};
+}
@@ -1,11 +1,197 @@
+#include "ControlServer.h"
+#include "EncodeJob.h"
 #include "MainWindow.h"
+#include "PresetMatrix.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QTextStream>
+#include <QThread>
+
+#include <cstring>
+
+namespace {
+QList<double> parseQualities(const QString &text, bool *ok)
+{
+    QList<double> values;
+    *ok = true;
+    for (const QString &part : text.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        bool valueOk = false;
+        values.append(part.trimmed().toDouble(&valueOk));
+        *ok = *ok && valueOk;
+    }
+    *ok = *ok && !values.isEmpty();
+    return values;
+}
+
+QList<int> parseThreadBudgets(const QString &text, bool *ok)
+{
+    QList<int> values;
+    *ok = true;
+    for (const QString &part : text.split(QLatin1Char(','), Qt::SkipEmptyParts)) {
+        bool valueOk = false;
+        values.append(part.trimmed().toInt(&valueOk));
+        *ok = *ok && valueOk && values.constLast() >= 0;
+    }
+    *ok = *ok && !values.isEmpty();
+    return values;
+}
+
+QJsonObject entryToJson(const PresetMatrixEntry &entry)
+{
+    return {
+        {QStringLiteral("encoder"), entry.encoder},
+        {QStringLiteral("preset"), entry.preset},
+        {QStringLiteral("quality"), entry.quality},
+        {QStringLiteral("threads"), entry.threads},
+        {QStringLiteral("success"), entry.success},
+        {QStringLiteral("fps"), entry.averageFps},
+        {QStringLiteral("wall_ms"), entry.wallTimeMs},
+        {QStringLiteral("cpu_ms"), entry.cpuMs},
+        {QStringLiteral("bytes"), entry.outputBytes},
+        {QStringLiteral("score"), entry.score},
+        {QStringLiteral("pareto"), entry.pareto}
+    };
+}
+
+// Headless: niseyuki --preset-matrix clip.mkv [--encoders ...] [--presets ...] [--crf ...] [--threads ...]
+int runPresetMatrix(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Encodes a reference clip with every encoder, preset, CRF and thread "
+                                                    "budget combination and prints the size/quality/speed Pareto frontier."));
+    parser.addHelpOption();
+    QCommandLineOption clipOption(QStringLiteral("preset-matrix"), QStringLiteral("Reference clip to encode."), QStringLiteral("clip"));
+    QCommandLineOption encodersOption(QStringLiteral("encoders"), QStringLiteral("Comma-separated encoders (default x264)."),
+                                      QStringLiteral("list"), QStringLiteral("x264"));
+    QCommandLineOption presetsOption(QStringLiteral("presets"), QStringLiteral("Comma-separated presets (default veryslow to veryfast)."),
+                                     QStringLiteral("list"), QStringLiteral("veryslow,slower,slow,medium,fast,faster,veryfast"));
+    QCommandLineOption crfOption(QStringLiteral("crf"), QStringLiteral("Comma-separated CRF/CQ values (default 18,20,22,24)."),
+                                 QStringLiteral("list"), QStringLiteral("18,20,22,24"));
+    QCommandLineOption threadsOption(QStringLiteral("threads"), QStringLiteral("Comma-separated encoder thread budgets, 0 for auto (default 0)."),
+                                     QStringLiteral("list"), QStringLiteral("0"));
+    QCommandLineOption parallelOption(QStringLiteral("parallel"), QStringLiteral("Combinations running at once (default 1)."),
+                                      QStringLiteral("count"), QStringLiteral("1"));
+    QCommandLineOption metricOption(QStringLiteral("metric"), QStringLiteral("ssim, psnr or vmaf (default ssim)."),
+                                    QStringLiteral("metric"), QStringLiteral("ssim"));
+    QCommandLineOption resizeOption(QStringLiteral("resize"), QStringLiteral("Resize mode as in the Video tab, e.g. 720p."),
+                                    QStringLiteral("mode"));
+    QCommandLineOption reportOption(QStringLiteral("report"), QStringLiteral("Also write the results as JSON to this file."),
+                                    QStringLiteral("file"));
+    parser.addOptions({clipOption, encodersOption, presetsOption, crfOption, threadsOption, parallelOption,
+                       metricOption, resizeOption, reportOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    bool qualitiesOk = false;
+    bool threadsOk = false;
+    const QList<double> qualities = parseQualities(parser.value(crfOption), &qualitiesOk);
+    const QList<int> threadBudgets = parseThreadBudgets(parser.value(threadsOption), &threadsOk);
+    const int parallel = parser.value(parallelOption).toInt();
+    if (!qualitiesOk || !threadsOk || parallel < 1 || parallel > QThread::idealThreadCount()) {
+        err << "Invalid --crf, --threads or --parallel value" << Qt::endl;
+        return 2;
+    }
+
+    EncodeJob reference;
+    reference.videoPath = QFileInfo(parser.value(clipOption)).absoluteFilePath();
+    reference.profile.editVideo().resizeMode = parser.value(resizeOption);
+    reference.profile.editAudio().codec = QStringLiteral("AAC");
+
+    PresetMatrix matrix;
+    matrix.setParallelism(parallel);
+    matrix.setMetric(parser.value(metricOption));
+    QObject::connect(&matrix, &PresetMatrix::messageReceived, &app, [&err](const QString &message) { err << message << Qt::endl; });
+    QObject::connect(&matrix, &PresetMatrix::finished, &app, &QCoreApplication::quit, Qt::QueuedConnection);
+    if (!matrix.start(reference, parser.value(encodersOption).split(QLatin1Char(','), Qt::SkipEmptyParts),
+                      parser.value(presetsOption).split(QLatin1Char(','), Qt::SkipEmptyParts), qualities, threadBudgets)) {
+        err << "Unable to start: check the clip, the metric and that ffmpeg can be found" << Qt::endl;
+        return 1;
+    }
+    app.exec();
+
+    QTextStream out(stdout);
+    const QString metric = parser.value(metricOption).toUpper();
+    out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8\n")
+               .arg(QStringLiteral("encoder"), -8).arg(QStringLiteral("preset"), -9).arg(QStringLiteral("crf"), 5)
+               .arg(QStringLiteral("thr"), 4).arg(QStringLiteral("fps"), 8).arg(QStringLiteral("cpu s"), 8)
+               .arg(QStringLiteral("MiB"), 8).arg(metric, 8);
+    QJsonArray results;
+    for (const PresetMatrixEntry &entry : matrix.entries()) {
+        results.append(entryToJson(entry));
+        out << QStringLiteral("%1 %2 %3 %4 %5 %6 %7 %8%9\n")
+                   .arg(entry.encoder, -8).arg(entry.preset, -9).arg(entry.quality, 5, 'f', 1).arg(entry.threads, 4)
+                   .arg(entry.averageFps, 8, 'f', 1).arg(entry.cpuMs / 1000.0, 8, 'f', 1)
+                   .arg(entry.outputBytes / (1024.0 * 1024.0), 8, 'f', 2)
+                   .arg(entry.success ? QString::number(entry.score, 'f', 4) : QStringLiteral("failed"), 8)
+                   .arg(entry.pareto ? QStringLiteral("  *") : QString());
+    }
+    out << "* = Pareto frontier (no other combination is smaller, better and faster at once)" << Qt::endl;
+
+    const QString reportPath = parser.value(reportOption);
+    if (!reportPath.isEmpty()) {
+        QFile report(reportPath);
+        if (!report.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            err << "Unable to write " << reportPath << Qt::endl;
+            return 1;
+        }
+        report.write(QJsonDocument(QJsonObject{
+            {QStringLiteral("clip"), reference.videoPath},
+            {QStringLiteral("metric"), parser.value(metricOption).toLower()},
+            {QStringLiteral("parallel"), parallel},
+            {QStringLiteral("results"), results}
+        }).toJson());
+    }
+    return 0;
+}
+} // namespace
 
 int main(int argc, char *argv[])
 {
+    // The benchmark mode runs headless, so it must not need a display.
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--preset-matrix", 15) == 0) {
+            QCoreApplication app(argc, argv);
+            QCoreApplication::setOrganizationName(QStringLiteral("Niseyuki Project"));
+            QCoreApplication::setApplicationName(QStringLiteral("Niseyuki"));
+            return runPresetMatrix(app);
+        }
+    }
+
     QApplication app(argc, argv);
+    QApplication::setOrganizationName(QStringLiteral("Niseyuki Project"));
+    QApplication::setApplicationName(QStringLiteral("Niseyuki"));
+
+    QStringList files;
+    const QStringList arguments = QApplication::arguments().mid(1);
+    for (const QString &argument : arguments) {
+        const QFileInfo info(argument);
+        if (info.isFile()) {
+            files.append(info.absoluteFilePath());
+        }
+    }
+
+    // A second launch hands its files to the running instance instead of opening another window.
+    QList<QJsonObject> forwarded;
+    for (const QString &file : files) {
+        forwarded.append({{QStringLiteral("cmd"), QStringLiteral("enqueue")}, {QStringLiteral("path"), file}});
+    }
+    forwarded.append({{QStringLiteral("cmd"), QStringLiteral("activate")}});
+    if (ControlServer::sendToRunningInstance(forwarded)) {
+        return 0;
+    }
+
     MainWindow window;
     window.show();
+    for (const QString &file : files) {
+        window.enqueueFile(file);
+    }
     return app.exec();
 }
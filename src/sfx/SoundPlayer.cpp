@@ -0,0 +1,53 @@
+// The only code that uses Qt Multimedia. It is built as a separate module that
+// SoundEffects loads with QLibrary on the first cue, so the application neither
+// links nor loads Qt Multimedia until a sound actually plays.
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QSoundEffect>
+#include <QUrl>
+
+namespace {
+// Lives on the sound thread and owns the QSoundEffect objects there.
+class SoundPlayer : public QObject
+{
+public:
+    void play(const QUrl &source)
+    {
+        QSoundEffect *effect = m_effects.value(source);
+        if (!effect) {
+            effect = new QSoundEffect(this);
+            m_effects.insert(source, effect);
+            // The first request plays once the clip is decoded; later ones play straight away.
+            connect(effect, &QSoundEffect::statusChanged, this, [this, source, effect]() {
+                if (effect->status() == QSoundEffect::Ready && m_pending.remove(source)) {
+                    effect->play();
+                }
+            });
+            m_pending.insert(source);
+            effect->setSource(source);
+            return;
+        }
+        if (effect->status() == QSoundEffect::Ready) {
+            effect->play();
+        } else if (effect->status() == QSoundEffect::Loading) {
+            m_pending.insert(source);
+        }
+    }
+
+private:
+    QHash<QUrl, QSoundEffect *> m_effects;
+    QSet<QUrl> m_pending;
+};
+} // namespace
+
+extern "C" Q_DECL_EXPORT QObject *niseyukiCreateSoundPlayer()
+{
+    return new SoundPlayer;
+}
+
+extern "C" Q_DECL_EXPORT void niseyukiPlaySound(QObject *player, const QUrl &source)
+{
+    static_cast<SoundPlayer *>(player)->play(source);
+}
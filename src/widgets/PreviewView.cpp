@@ -0,0 +1,53 @@
+#include "PreviewView.h"
+
+#include <QPainter>
+#include <QPaintEvent>
+
+PreviewView::PreviewView(QWidget *parent)
+    : QWidget(parent)
+{
+    setMinimumHeight(180);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+}
+
+void PreviewView::setImage(const QImage &image)
+{
+    m_image = image;
+    m_message.clear();
+    update();
+}
+
+void PreviewView::setMessage(const QString &message)
+{
+    m_message = message;
+    if (!message.isEmpty()) {
+        m_image = QImage();
+    }
+    update();
+}
+
+QSize PreviewView::sizeHint() const
+{
+    return QSize(480, 270);
+}
+
+void PreviewView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+    QPainter painter(this);
+    painter.fillRect(rect(), palette().color(QPalette::Base));
+
+    if (m_image.isNull()) {
+        painter.setPen(QPen(palette().color(QPalette::Mid), 1, Qt::DashLine));
+        painter.drawRect(rect().adjusted(0, 0, -1, -1));
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText(rect(), Qt::AlignCenter | Qt::TextWordWrap, m_message);
+        return;
+    }
+
+    const QSize scaled = m_image.size().scaled(size(), Qt::KeepAspectRatio);
+    const QRect target(QPoint((width() - scaled.width()) / 2, (height() - scaled.height()) / 2), scaled);
+    painter.fillRect(rect(), Qt::black);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(target, m_image);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <QImage>
+#include <QString>
+#include <QWidget>
+
+// Letterboxed frame display for the preview panel; shows a message when there is no frame.
+class PreviewView : public QWidget
+{
+    Q_OBJECT
+public:
+    explicit PreviewView(QWidget *parent = nullptr);
+
+    void setImage(const QImage &image);
+    void setMessage(const QString &message);
+
+    QSize sizeHint() const override;
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+private:
+    QImage m_image;
+    QString m_message;
+};
@@ -4,6 +4,7 @@
 #include <QPaintEvent>
 #include <QMarginsF>
 #include <QPolygonF>
+#include <QRegion>
 #include <QtMath>
 
 #include <cmath>
@@ -24,7 +25,7 @@ StartButton::StartButton(QWidget *parent)
     setToolTip(tr("Start encoding"));
     connect(&m_timer, &QTimer::timeout, this, [this]() {
         m_rotation = std::fmod(m_rotation + 3.6, 360.0);
-        update();
+        update(ringRegion());
     });
     m_timer.setInterval(kAnimationIntervalMs);
     updateAnimationTimer();
@@ -47,8 +48,12 @@ void StartButton::setProgress(double progress)
     if (qFuzzyCompare(m_progress, clamped)) {
         return;
     }
+    // The arc is drawn in 1/16 degree steps; most progress reports do not move it at all.
+    const bool arcMoved = static_cast<int>(360 * m_progress * 16) != static_cast<int>(360 * clamped * 16);
     m_progress = clamped;
-    update();
+    if (arcMoved && m_state == State::Encoding) {
+        update(ringRegion());
+    }
 }
 
 void StartButton::setReducedMotion(bool reducedMotion)
@@ -60,6 +65,15 @@ void StartButton::setReducedMotion(bool reducedMotion)
     updateAnimationTimer();
 }
 
+void StartButton::setAnimationSuspended(bool suspended)
+{
+    if (m_animationSuspended == suspended) {
+        return;
+    }
+    m_animationSuspended = suspended;
+    updateAnimationTimer();
+}
+
 QSize StartButton::sizeHint() const
 {
     return QSize(kBaseSize, kBaseSize);
@@ -72,7 +86,7 @@ void StartButton::paintEvent(QPaintEvent *event)
     QPainter painter(this);
     painter.setRenderHint(QPainter::Antialiasing, true);
 
-    const QRectF bounds = QRectF(0, 0, width(), height()).marginsRemoved(QMarginsF(4, 4, 4, 4));
+    const QRectF bounds = contentRect();
     const QPointF center = bounds.center();
     const qreal radius = std::min(bounds.width(), bounds.height()) / 2.0;
 
@@ -131,9 +145,40 @@ void StartButton::paintEvent(QPaintEvent *event)
     }
 }
 
+void StartButton::showEvent(QShowEvent *event)
+{
+    QAbstractButton::showEvent(event);
+    updateAnimationTimer();
+}
+
+void StartButton::hideEvent(QHideEvent *event)
+{
+    QAbstractButton::hideEvent(event);
+    updateAnimationTimer();
+}
+
+QRectF StartButton::contentRect() const
+{
+    return QRectF(0, 0, width(), height()).marginsRemoved(QMarginsF(4, 4, 4, 4));
+}
+
+QRegion StartButton::ringRegion() const
+{
+    // Two pixels of slack on each side cover the antialiased edges and the round caps.
+    const QRectF bounds = contentRect();
+    const qreal radius = std::min(bounds.width(), bounds.height()) / 2.0;
+    const QPointF center = bounds.center();
+    const qreal outer = radius + 2.0;
+    const qreal inner = std::max<qreal>(0.0, radius - kRingThickness - 2.0);
+    const QRegion outerRegion(QRectF(center.x() - outer, center.y() - outer, 2 * outer, 2 * outer).toAlignedRect(), QRegion::Ellipse);
+    const QRegion innerRegion(QRectF(center.x() - inner, center.y() - inner, 2 * inner, 2 * inner).toRect(), QRegion::Ellipse);
+    return outerRegion.subtracted(innerRegion);
+}
+
 void StartButton::updateAnimationTimer()
 {
-    const bool shouldAnimate = !m_reducedMotion && (m_state == State::Indexing || m_state == State::Encoding);
+    const bool shouldAnimate = !m_reducedMotion && !m_animationSuspended && isVisible()
+        && (m_state == State::Indexing || m_state == State::Encoding);
     if (shouldAnimate) {
         if (!m_timer.isActive()) {
             m_timer.start();
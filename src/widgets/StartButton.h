@@ -18,6 +18,8 @@ public:
     void setState(State state);
     void setProgress(double progress);
     void setReducedMotion(bool reducedMotion);
+    // Stops the spinner while nobody can see it, e.g. when the window is minimized.
+    void setAnimationSuspended(bool suspended);
 
     [[nodiscard]] State state() const noexcept { return m_state; }
     [[nodiscard]] double progress() const noexcept { return m_progress; }
@@ -30,13 +32,19 @@ signals:
 
 protected:
     void paintEvent(QPaintEvent *event) override;
+    void showEvent(QShowEvent *event) override;
+    void hideEvent(QHideEvent *event) override;
 
 private:
     void updateAnimationTimer();
+    [[nodiscard]] QRectF contentRect() const;
+    // The annulus the ring is drawn in; the only part a rotation or progress step changes.
+    [[nodiscard]] QRegion ringRegion() const;
 
     State m_state = State::Idle;
     double m_progress = 0.0;
     bool m_reducedMotion = false;
+    bool m_animationSuspended = false;
     qreal m_rotation = 0.0;
     QTimer m_timer;
 };
@@ -0,0 +1,405 @@
+#include "WorkerServer.h"
+
+#include "Encoder.h"
+#include "FfmpegLocator.h"
+#include "JobSerialization.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSysInfo>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTextStream>
+#include <QUuid>
+
+namespace {
+constexpr int kProgressIntervalMs = 250;
+// Upload chunks are queued only while the socket has less than this pending,
+// so a slow link does not pull the whole output into memory.
+constexpr qint64 kMaxPendingBytes = 4 * WorkerProtocol::kChunkBytes;
+
+void logLine(const QString &line)
+{
+    QTextStream(stderr) << line << Qt::endl;
+}
+
+// Compares digests byte by byte without an early exit, so the time taken says
+// nothing about how much of the token a client got right (or its length).
+bool tokenMatches(const QString &given, const QString &expected)
+{
+    const QByteArray a = QCryptographicHash::hash(given.toUtf8(), QCryptographicHash::Sha256);
+    const QByteArray b = QCryptographicHash::hash(expected.toUtf8(), QCryptographicHash::Sha256);
+    unsigned char difference = 0;
+    for (qsizetype i = 0; i < a.size(); ++i) {
+        difference |= static_cast<unsigned char>(a.at(i) ^ b.at(i));
+    }
+    return difference == 0;
+}
+} // namespace
+
+WorkerServer::WorkerServer(int slotCount, const QString &scratchDir, QObject *parent)
+    : QObject(parent)
+    , m_scratchDir(scratchDir)
+    , m_token(WorkerProtocol::authToken())
+{
+    QDir().mkpath(m_scratchDir);
+
+    for (int i = 0; i < slotCount; ++i) {
+        Slot slot;
+        slot.encoder = new Encoder(this);
+        // Outputs are streamed back once finished, so a faststart rewrite would delay the upload.
+        slot.encoder->setMoovReservationEnabled(true);
+        m_slots.append(slot);
+
+        Encoder *encoder = slot.encoder;
+        connect(encoder, &Encoder::progressChanged, this, [this, i]() {
+            m_slots[i].progressDirty = true;
+        });
+        connect(encoder, &Encoder::etaChanged, this, [this, i](qint64 remainingMs) {
+            m_slots[i].etaMs = remainingMs;
+            m_slots[i].progressDirty = true;
+        });
+        connect(encoder, &Encoder::messageReceived, this, [this, i](const QString &line) {
+            const Slot &slot = m_slots.at(i);
+            send(slot.owner, {{QStringLiteral("event"), QStringLiteral("log")},
+                              {QStringLiteral("ticket"), slot.ticket},
+                              {QStringLiteral("line"), line}});
+        });
+        connect(encoder, &Encoder::finished, this, [this, i](bool success) { onSlotFinished(i, success); });
+    }
+
+    // GPU-less workers then encode hardware jobs with libx264 instead of failing them.
+    connect(&m_capabilityProbe, &CapabilityProbe::finished, this, [this](const FfmpegCapabilities &capabilities) {
+        for (const Slot &slot : std::as_const(m_slots)) {
+            slot.encoder->setCapabilities(capabilities);
+        }
+    });
+    m_capabilityProbe.start(locateFfmpeg());
+
+    m_progressTimer.setInterval(kProgressIntervalMs);
+    connect(&m_progressTimer, &QTimer::timeout, this, &WorkerServer::flushProgress);
+    m_progressTimer.start();
+}
+
+WorkerServer::~WorkerServer()
+{
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (m_slots.at(i).busy) {
+            m_slots.at(i).encoder->stopEncoding();
+            releaseSlot(i);
+        }
+    }
+}
+
+bool WorkerServer::listen(const QHostAddress &address, quint16 port, QString *errorMessage)
+{
+    if (!m_server) {
+        m_server = new QTcpServer(this);
+        connect(m_server, &QTcpServer::newConnection, this, &WorkerServer::onNewConnection);
+    }
+    if (m_server->listen(address, port)) {
+        return true;
+    }
+    if (errorMessage) {
+        *errorMessage = m_server->errorString();
+    }
+    return false;
+}
+
+quint16 WorkerServer::port() const
+{
+    return m_server ? m_server->serverPort() : 0;
+}
+
+void WorkerServer::onNewConnection()
+{
+    while (QTcpSocket *socket = m_server->nextPendingConnection()) {
+        Connection connection;
+        connection.socket = socket;
+        connection.authenticated = m_token.isEmpty();
+        m_connections.append(connection);
+        connect(socket, &QTcpSocket::readyRead, this, [this, socket]() { onReadyRead(socket); });
+        connect(socket, &QTcpSocket::bytesWritten, this, [this, socket]() { pumpUploads(socket); });
+        connect(socket, &QTcpSocket::disconnected, this, [this, socket]() { onDisconnected(socket); });
+        logLine(QStringLiteral("Coordinator connected from %1").arg(socket->peerAddress().toString()));
+    }
+}
+
+void WorkerServer::onReadyRead(QTcpSocket *socket)
+{
+    for (int i = 0; i < m_connections.size(); ++i) {
+        if (m_connections.at(i).socket != socket) {
+            continue;
+        }
+        m_connections[i].reader.feed(socket->readAll());
+        QJsonObject message;
+        QByteArray payload;
+        while (i < m_connections.size() && m_connections.at(i).socket == socket
+               && m_connections[i].reader.next(message, payload)) {
+            handleMessage(m_connections[i], message);
+        }
+        if (i < m_connections.size() && m_connections.at(i).socket == socket && m_connections.at(i).reader.hasError()) {
+            logLine(QStringLiteral("Protocol error from %1; closing").arg(socket->peerAddress().toString()));
+            socket->abort();
+        }
+        return;
+    }
+}
+
+void WorkerServer::onDisconnected(QTcpSocket *socket)
+{
+    // Jobs belong to the coordinator that sent them; nobody is left to collect the output.
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (m_slots.at(i).busy && m_slots.at(i).owner == socket) {
+            m_slots[i].owner = nullptr;
+            if (m_slots.at(i).upload) {
+                releaseSlot(i);
+            } else {
+                m_slots.at(i).encoder->stopEncoding();
+            }
+        }
+    }
+    for (int i = 0; i < m_connections.size(); ++i) {
+        if (m_connections.at(i).socket == socket) {
+            m_connections.removeAt(i);
+            break;
+        }
+    }
+    socket->deleteLater();
+}
+
+void WorkerServer::handleMessage(Connection &connection, const QJsonObject &message)
+{
+    const QString command = message.value(QStringLiteral("cmd")).toString();
+    QTcpSocket *socket = connection.socket;
+
+    if (command == QLatin1String("hello")) {
+        if (!m_token.isEmpty() && !tokenMatches(message.value(QStringLiteral("token")).toString(), m_token)) {
+            send(socket, {{QStringLiteral("event"), QStringLiteral("error")},
+                          {QStringLiteral("error"), QStringLiteral("authentication failed")}});
+            socket->disconnectFromHost();
+            return;
+        }
+        connection.authenticated = true;
+        send(socket, capacityMessage(QStringLiteral("hello")));
+        return;
+    }
+
+    if (!connection.authenticated) {
+        send(socket, {{QStringLiteral("event"), QStringLiteral("error")},
+                      {QStringLiteral("error"), QStringLiteral("hello required")}});
+        socket->disconnectFromHost();
+        return;
+    }
+
+    if (command == QLatin1String("encode")) {
+        startJob(socket, message);
+    } else if (command == QLatin1String("cancel")) {
+        cancelJob(socket, message.value(QStringLiteral("ticket")).toInteger());
+    } else {
+        send(socket, {{QStringLiteral("event"), QStringLiteral("error")},
+                      {QStringLiteral("error"), QStringLiteral("unknown command %1").arg(command)}});
+    }
+}
+
+void WorkerServer::startJob(QTcpSocket *socket, const QJsonObject &message)
+{
+    const qint64 ticket = message.value(QStringLiteral("ticket")).toInteger();
+    const auto reject = [&](const QString &reason) {
+        send(socket, {{QStringLiteral("event"), QStringLiteral("rejected")},
+                      {QStringLiteral("ticket"), ticket},
+                      {QStringLiteral("error"), reason}});
+    };
+
+    int index = -1;
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (!m_slots.at(i).busy) {
+            index = i;
+            break;
+        }
+    }
+    if (index < 0) {
+        reject(QStringLiteral("no free slot"));
+        return;
+    }
+
+    EncodeJob job = encodeJobFromJson(message.value(QStringLiteral("job")).toObject());
+    if (!QFileInfo(job.videoPath).isFile()) {
+        reject(QStringLiteral("source not reachable on %1: %2").arg(QSysInfo::machineHostName(), job.videoPath));
+        return;
+    }
+
+    // The worker never writes to the coordinator's paths; the result is staged
+    // locally and streamed back once the encode succeeds.
+    Slot &slot = m_slots[index];
+    slot.busy = true;
+    slot.owner = socket;
+    slot.ticket = ticket;
+    slot.etaMs = -1;
+    slot.progressDirty = false;
+    // Tickets are only unique per coordinator, and several may share this worker;
+    // the scratch name comes from the worker so their outputs never collide.
+    slot.scratchId = QUuid::createUuid().toString(QUuid::WithoutBraces);
+    slot.scratchPath = QDir(m_scratchDir).filePath(
+        QStringLiteral("%1-%2").arg(slot.scratchId, QFileInfo(job.resolvedOutputPath()).fileName()));
+    job.outputFile = slot.scratchPath;
+    job.globalOutputFolder.clear();
+
+    logLine(QStringLiteral("Ticket %1: encoding %2 in slot %3 (%4)").arg(ticket).arg(job.videoPath).arg(index).arg(slot.scratchId));
+    send(socket, {{QStringLiteral("event"), QStringLiteral("accepted")}, {QStringLiteral("ticket"), ticket}});
+    broadcastCapacity();
+    slot.encoder->startEncoding(job);
+}
+
+void WorkerServer::cancelJob(QTcpSocket *socket, qint64 ticket)
+{
+    for (int i = 0; i < m_slots.size(); ++i) {
+        const Slot &slot = m_slots.at(i);
+        if (!slot.busy || slot.owner != socket || slot.ticket != ticket) {
+            continue;
+        }
+        if (slot.upload) {
+            send(socket, {{QStringLiteral("event"), QStringLiteral("finished")},
+                          {QStringLiteral("ticket"), ticket},
+                          {QStringLiteral("success"), false},
+                          {QStringLiteral("error"), QStringLiteral("cancelled")}});
+            releaseSlot(i);
+        } else {
+            slot.encoder->stopEncoding();
+        }
+        return;
+    }
+}
+
+void WorkerServer::onSlotFinished(int index, bool success)
+{
+    Slot &slot = m_slots[index];
+    if (!slot.busy) {
+        return;
+    }
+    logLine(QStringLiteral("Ticket %1: encode %2").arg(slot.ticket).arg(success ? QStringLiteral("done") : QStringLiteral("failed")));
+    if (!slot.owner) {
+        releaseSlot(index);
+        return;
+    }
+    if (!success) {
+        send(slot.owner, {{QStringLiteral("event"), QStringLiteral("finished")},
+                          {QStringLiteral("ticket"), slot.ticket},
+                          {QStringLiteral("success"), false},
+                          {QStringLiteral("error"), slot.encoder->statusText()}});
+        releaseSlot(index);
+        return;
+    }
+
+    slot.upload = new QFile(slot.scratchPath, this);
+    if (!slot.upload->open(QIODevice::ReadOnly)) {
+        send(slot.owner, {{QStringLiteral("event"), QStringLiteral("finished")},
+                          {QStringLiteral("ticket"), slot.ticket},
+                          {QStringLiteral("success"), false},
+                          {QStringLiteral("error"), slot.upload->errorString()}});
+        releaseSlot(index);
+        return;
+    }
+    send(slot.owner, {{QStringLiteral("event"), QStringLiteral("upload")},
+                      {QStringLiteral("ticket"), slot.ticket},
+                      {QStringLiteral("size"), slot.upload->size()}});
+    pumpUploads(slot.owner);
+}
+
+void WorkerServer::pumpUploads(QTcpSocket *socket)
+{
+    for (int i = 0; i < m_slots.size(); ++i) {
+        if (!m_slots.at(i).upload || m_slots.at(i).owner != socket) {
+            continue;
+        }
+        while (m_slots.at(i).upload && socket->bytesToWrite() < kMaxPendingBytes) {
+            Slot &slot = m_slots[i];
+            const QByteArray chunk = slot.upload->read(WorkerProtocol::kChunkBytes);
+            if (!chunk.isEmpty()) {
+                send(socket, {{QStringLiteral("event"), QStringLiteral("chunk")}, {QStringLiteral("ticket"), slot.ticket}}, chunk);
+                continue;
+            }
+            const bool ok = slot.upload->atEnd();
+            QJsonObject done{{QStringLiteral("event"), QStringLiteral("finished")},
+                             {QStringLiteral("ticket"), slot.ticket},
+                             {QStringLiteral("success"), ok}};
+            if (!ok) {
+                done.insert(QStringLiteral("error"), slot.upload->errorString());
+            }
+            send(socket, done);
+            releaseSlot(i);
+        }
+    }
+}
+
+void WorkerServer::releaseSlot(int index)
+{
+    Slot &slot = m_slots[index];
+    if (slot.upload) {
+        slot.upload->close();
+        slot.upload->deleteLater();
+        slot.upload = nullptr;
+    }
+    if (!slot.scratchPath.isEmpty()) {
+        QFile::remove(slot.scratchPath);
+        slot.scratchPath.clear();
+    }
+    slot.scratchId.clear();
+    slot.busy = false;
+    slot.owner = nullptr;
+    slot.ticket = 0;
+    broadcastCapacity();
+}
+
+void WorkerServer::flushProgress()
+{
+    for (Slot &slot : m_slots) {
+        if (!slot.busy || !slot.progressDirty || !slot.owner) {
+            continue;
+        }
+        slot.progressDirty = false;
+        send(slot.owner, {{QStringLiteral("event"), QStringLiteral("progress")},
+                          {QStringLiteral("ticket"), slot.ticket},
+                          {QStringLiteral("progress"), slot.encoder->progress()},
+                          {QStringLiteral("eta_ms"), slot.etaMs},
+                          {QStringLiteral("status"), slot.encoder->statusText()}});
+    }
+}
+
+void WorkerServer::broadcastCapacity()
+{
+    const QJsonObject message = capacityMessage(QStringLiteral("capacity"));
+    for (const Connection &connection : std::as_const(m_connections)) {
+        if (connection.authenticated) {
+            send(connection.socket, message);
+        }
+    }
+}
+
+QJsonObject WorkerServer::capacityMessage(const QString &event) const
+{
+    return {{QStringLiteral("event"), event},
+            {QStringLiteral("version"), WorkerProtocol::kVersion},
+            {QStringLiteral("name"), QSysInfo::machineHostName()},
+            {QStringLiteral("slots"), m_slots.size()},
+            {QStringLiteral("busy"), busySlots()}};
+}
+
+int WorkerServer::busySlots() const
+{
+    int busy = 0;
+    for (const Slot &slot : m_slots) {
+        busy += slot.busy ? 1 : 0;
+    }
+    return busy;
+}
+
+void WorkerServer::send(QTcpSocket *socket, const QJsonObject &message, const QByteArray &payload)
+{
+    if (!socket || socket->state() != QAbstractSocket::ConnectedState) {
+        return;
+    }
+    socket->write(WorkerProtocol::frame(message, payload));
+}
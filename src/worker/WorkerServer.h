@@ -0,0 +1,71 @@
+#pragma once
+
+#include "FfmpegCapabilities.h"
+#include "WorkerProtocol.h"
+
+#include <QHostAddress>
+#include <QList>
+#include <QObject>
+#include <QPointer>
+#include <QString>
+#include <QTimer>
+
+class Encoder;
+class QFile;
+class QTcpServer;
+class QTcpSocket;
+
+// Accepts serialized jobs from coordinators, runs them on a fixed number of
+// Encoder slots and streams progress and the finished output back.
+class WorkerServer : public QObject
+{
+    Q_OBJECT
+public:
+    WorkerServer(int slotCount, const QString &scratchDir, QObject *parent = nullptr);
+    ~WorkerServer() override;
+
+    bool listen(const QHostAddress &address, quint16 port, QString *errorMessage = nullptr);
+    [[nodiscard]] quint16 port() const;
+
+private:
+    struct Connection {
+        QPointer<QTcpSocket> socket;
+        WorkerProtocol::Reader reader;
+        bool authenticated = false;
+    };
+
+    struct Slot {
+        Encoder *encoder = nullptr;
+        QPointer<QTcpSocket> owner;
+        qint64 ticket = 0; // the coordinator's id; owner and ticket together identify the job
+        QString scratchId; // worker-generated, names the scratch output
+        QString scratchPath;
+        QFile *upload = nullptr;
+        bool busy = false;
+        bool progressDirty = false;
+        qint64 etaMs = -1;
+    };
+
+    void onNewConnection();
+    void onReadyRead(QTcpSocket *socket);
+    void onDisconnected(QTcpSocket *socket);
+    void handleMessage(Connection &connection, const QJsonObject &message);
+    void startJob(QTcpSocket *socket, const QJsonObject &message);
+    void cancelJob(QTcpSocket *socket, qint64 ticket);
+    void onSlotFinished(int index, bool success);
+    void pumpUploads(QTcpSocket *socket);
+    void releaseSlot(int index);
+    void flushProgress();
+    void broadcastCapacity();
+    void send(QTcpSocket *socket, const QJsonObject &message, const QByteArray &payload = QByteArray());
+    [[nodiscard]] int busySlots() const;
+    [[nodiscard]] QJsonObject capacityMessage(const QString &event) const;
+
+    QTcpServer *m_server = nullptr;
+    QList<Connection> m_connections;
+    QList<Slot> m_slots;
+    QString m_scratchDir;
+    QString m_token;
+    QTimer m_progressTimer;
+    CapabilityProbe m_capabilityProbe;
+};
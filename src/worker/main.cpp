@@ -0,0 +1,72 @@
+#include "WorkerProtocol.h"
+#include "worker/WorkerServer.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QHostAddress>
+#include <QStandardPaths>
+#include <QTextStream>
+#include <QThread>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setOrganizationName(QStringLiteral("Niseyuki Project"));
+    QCoreApplication::setApplicationName(QStringLiteral("Niseyuki Worker"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Runs Niseyuki encode jobs on behalf of a coordinator."));
+    parser.addHelpOption();
+    QCommandLineOption listenOption(QStringLiteral("listen"), QStringLiteral("Address to bind (default 127.0.0.1)."),
+                                    QStringLiteral("address"), QStringLiteral("127.0.0.1"));
+    QCommandLineOption portOption(QStringLiteral("port"), QStringLiteral("TCP port (default %1).").arg(WorkerProtocol::kDefaultPort),
+                                  QStringLiteral("port"), QString::number(WorkerProtocol::kDefaultPort));
+    QCommandLineOption slotsOption(QStringLiteral("slots"), QStringLiteral("Concurrent encodes (default 1)."),
+                                   QStringLiteral("count"), QStringLiteral("1"));
+    QCommandLineOption scratchOption(QStringLiteral("scratch"), QStringLiteral("Directory for in-progress outputs."),
+                                     QStringLiteral("dir"));
+    QCommandLineOption insecureOption(QStringLiteral("insecure"),
+                                      QStringLiteral("Allow a non-loopback --listen without NISEYUKI_WORKER_TOKEN."));
+    parser.addOption(listenOption);
+    parser.addOption(portOption);
+    parser.addOption(slotsOption);
+    parser.addOption(scratchOption);
+    parser.addOption(insecureOption);
+    parser.process(app);
+
+    QTextStream err(stderr);
+    const QHostAddress address(parser.value(listenOption));
+    bool portOk = false;
+    const uint port = parser.value(portOption).toUInt(&portOk);
+    const int slotCount = parser.value(slotsOption).toInt();
+    if (address.isNull() || !portOk || port > 65535 || slotCount < 1 || slotCount > QThread::idealThreadCount() * 4) {
+        err << "Invalid --listen, --port or --slots value" << Qt::endl;
+        return 2;
+    }
+    if (!address.isLoopback() && WorkerProtocol::authToken().isEmpty()) {
+        // Jobs name arbitrary input and output paths, so an open port hands out the worker's file access.
+        if (!parser.isSet(insecureOption)) {
+            err << "Refusing to listen on a non-loopback address without NISEYUKI_WORKER_TOKEN (pass --insecure to override)"
+                << Qt::endl;
+            return 2;
+        }
+        err << "Warning: listening on a non-loopback address without NISEYUKI_WORKER_TOKEN" << Qt::endl;
+    }
+
+    QString scratch = parser.value(scratchOption);
+    if (scratch.isEmpty()) {
+        scratch = QDir(QStandardPaths::writableLocation(QStandardPaths::TempLocation))
+                      .filePath(QStringLiteral("niseyuki-worker-%1").arg(port));
+    }
+
+    WorkerServer server(slotCount, scratch);
+    QString error;
+    if (!server.listen(address, static_cast<quint16>(port), &error)) {
+        err << "Unable to listen: " << error << Qt::endl;
+        return 1;
+    }
+    err << "niseyuki-worker listening on " << address.toString() << ':' << server.port()
+        << " with " << slotCount << " slot(s)" << Qt::endl;
+    return app.exec();
+}